@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for data that lives and dies together, such as the syntax
+// tree of one module. Allocation is a pointer increment into the current
+// block, nothing is freed individually, and the destructor releases every
+// block at once. Objects are never destroyed, so only trivially
+// destructible types may live here.
+class Arena {
+private:
+    static constexpr size_t MIN_BLOCK = 16 * 1024;
+
+    std::vector<void*> blocks;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    size_t nextBlock;
+    size_t used = 0;
+
+    void grow(size_t size) {
+        size_t bytes = std::max(nextBlock, size);
+        void* block = std::malloc(bytes);
+        if (!block) {
+            throw std::bad_alloc();
+        }
+        blocks.push_back(block);
+        cursor = static_cast<char*>(block);
+        limit = cursor + bytes;
+        // Double up to 1 MB so large inputs need few blocks
+        nextBlock = std::min<size_t>(bytes * 2, 1024 * 1024);
+    }
+
+public:
+    // `firstBlock` is a size hint, e.g. proportional to the source size,
+    // so that most modules fit in a single contiguous block
+    explicit Arena(size_t firstBlock = MIN_BLOCK) : nextBlock(std::max(firstBlock, MIN_BLOCK)) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        for (void* block : blocks) {
+            std::free(block);
+        }
+    }
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        size_t pad = (align - reinterpret_cast<uintptr_t>(cursor) % align) % align;
+        if (!cursor || static_cast<size_t>(limit - cursor) < pad + size) {
+            grow(size + align);
+            pad = (align - reinterpret_cast<uintptr_t>(cursor) % align) % align;
+        }
+        char* p = cursor + pad;
+        cursor = p + size;
+        used += size;
+        return p;
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Uninitialized room for `count` objects
+    template <typename T>
+    T* allocateArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return count ? static_cast<T*>(allocate(sizeof(T) * count, alignof(T))) : nullptr;
+    }
+
+    std::string_view copy(std::string_view text) {
+        char* p = allocateArray<char>(text.size());
+        if (!text.empty()) {
+            std::memcpy(p, text.data(), text.size());
+        }
+        return std::string_view(p, text.size());
+    }
+
+    // Bytes handed out, not counting alignment and unused block tails
+    size_t bytesUsed() const {
+        return used;
+    }
+};
@@ -0,0 +1,1744 @@
+#pragma once
+
+#include "arena.hpp"
+#include "interner.hpp"
+#include "lexer.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+enum class NodeKind : uint8_t {
+    // Statements
+    Program,          // list: body
+    Block,            // list: body
+    Empty,
+    Expression,       // a: expression
+    If,               // a: test, b: consequent, c: alternate or null
+    For,              // a: init, b: test, c: update (each may be null), d: body
+    ForIn,            // a: left, b: right, d: body
+    ForOf,            // a: left, b: right, d: body; Await
+    While,            // a: test, d: body
+    DoWhile,          // a: test, d: body
+    Return,           // a: argument or null
+    Throw,            // a: argument
+    Break,            // name: label, may be empty
+    Continue,         // name: label, may be empty
+    Try,              // a: block, b: catch parameter, c: catch block, d: finally block (b, c, d may be null)
+    Switch,           // a: discriminant, list: cases
+    Case,             // a: test, null for default; list: body
+    Labeled,          // name: label, d: body
+    VarDecl,          // varKind; list: declarators
+    Declarator,       // a: target, b: initializer or null
+    Debugger,
+    With,             // a: object, d: body
+    Import,           // list: specifiers, b: source
+    ImportSpecifier,  // name: imported name, "default" or "*"; a: local identifier
+    ExportNamed,      // list: specifiers, c: source or null
+    ExportSpecifier,  // a: local, b: exported (Identifier or String)
+    ExportDecl,       // a: declaration
+    ExportDefault,    // a: declaration or expression
+    ExportAll,        // b: exported name or null, c: source
+    // Functions and classes; declarations and expressions share a layout
+    Function,         // a: name or null, list: params, b: body; Async, Generator
+    FunctionExpr,
+    Arrow,            // list: params, b: body block or expression (ExpressionBody); Async
+    Class,            // a: name or null, b: superclass or null, list: members
+    ClassExpr,
+    Method,           // a: key, b: FunctionExpr; Static, Computed, Getter, Setter
+    Field,            // a: key, b: value or null; Static, Computed
+    StaticBlock,      // list: body
+    // Expressions. Literals keep no value; their text is the source range.
+    Identifier,       // name
+    PrivateName,      // name, with the '#'
+    Number,
+    String,
+    Regex,
+    Template,         // list: TemplateElement, expression, TemplateElement, ...
+    TemplateElement,  // raw text from the backquote or `}` to the backquote or `${`
+    TaggedTemplate,   // a: tag, b: Template
+    This,
+    Super,
+    Null,
+    True,
+    False,
+    Array,            // list: elements, Hole for elisions
+    Hole,
+    Object,           // list: Property, Method or Spread
+    Property,         // a: key, b: value; Computed, Shorthand
+    Spread,           // a: argument; also rest elements of patterns
+    Unary,            // op, a
+    Update,           // op, a; Prefix
+    Binary,           // op, a, b; includes &&, || and ??
+    Assign,           // op, a: target, b: value; also defaults in patterns
+    Conditional,      // a: test, b: consequent, c: alternate
+    Call,             // a: callee, list: arguments; Optional
+    New,              // a: callee, list: arguments
+    Member,           // a: object, name: property; Optional
+    Index,            // a: object, b: property; Optional
+    Sequence,         // list
+    Yield,            // a: argument or null; Delegate
+    Await,            // a
+    MetaProperty,     // name: "import.meta" or "new.target"
+    ImportCall        // list: specifier and options
+};
+
+enum class Op : uint8_t {
+    None,
+    // Binary, in increasing precedence
+    Coalesce, Or, And, BitOr, BitXor, BitAnd,
+    Eq, Ne, StrictEq, StrictNe,
+    Lt, Gt, Le, Ge, InstanceOf, In,
+    Shl, Shr, UShr,
+    Add, Sub,
+    Mul, Div, Mod,
+    Exp,
+    // Unary
+    Not, BitNot, Pos, Neg, TypeOf, Void, Delete, Inc, Dec,
+    // Assignment
+    Assign, AddAssign, SubAssign, MulAssign, DivAssign, ModAssign, ExpAssign, ShlAssign, ShrAssign, UShrAssign,
+    BitAndAssign, BitOrAssign, BitXorAssign, AndAssign, OrAssign, CoalesceAssign
+};
+
+inline const char* opText(Op op) {
+    static const char* texts[] = {
+        "", "??", "||", "&&", "|", "^", "&", "==", "!=", "===", "!==", "<", ">", "<=", ">=", "instanceof", "in",
+        "<<", ">>", ">>>", "+", "-", "*", "/", "%", "**", "!", "~", "+", "-", "typeof", "void", "delete", "++",
+        "--", "=", "+=", "-=", "*=", "/=", "%=", "**=", "<<=", ">>=", ">>>=", "&=", "|=", "^=", "&&=", "||=",
+        "?\?="};
+    return texts[static_cast<size_t>(op)];
+}
+
+// Binding power of a binary operator, 0 for anything else
+inline int binaryPrecedence(Op op) {
+    switch (op) {
+        case Op::Coalesce: return 1;
+        case Op::Or: return 2;
+        case Op::And: return 3;
+        case Op::BitOr: return 4;
+        case Op::BitXor: return 5;
+        case Op::BitAnd: return 6;
+        case Op::Eq: case Op::Ne: case Op::StrictEq: case Op::StrictNe: return 7;
+        case Op::Lt: case Op::Gt: case Op::Le: case Op::Ge: case Op::InstanceOf: case Op::In: return 8;
+        case Op::Shl: case Op::Shr: case Op::UShr: return 9;
+        case Op::Add: case Op::Sub: return 10;
+        case Op::Mul: case Op::Div: case Op::Mod: return 11;
+        case Op::Exp: return 12;
+        default: return 0;
+    }
+}
+
+enum class VarKind : uint8_t { Var, Let, Const };
+
+class Node;
+
+// Children of a node, allocated in the same arena
+class NodeList {
+public:
+    Node** items = nullptr;
+    uint32_t size = 0;
+
+    Node** begin() const {
+        return items;
+    }
+
+    Node** end() const {
+        return items + size;
+    }
+
+    Node* operator[](size_t i) const {
+        return items[i];
+    }
+
+    bool empty() const {
+        return size == 0;
+    }
+};
+
+// One syntax tree node. Every kind uses the same few fields, as listed in
+// NodeKind; this keeps nodes a fixed 72 bytes that pack densely in the
+// arena, and lets generic walks reach every child without a visitor per
+// kind. Keys of Property, Method and Field are expressions only when
+// Computed; otherwise they are names, not references.
+class Node {
+public:
+    enum Flag : uint16_t {
+        Async = 1 << 0,
+        Generator = 1 << 1,
+        Static = 1 << 2,
+        Computed = 1 << 3,
+        Shorthand = 1 << 4,
+        Prefix = 1 << 5,
+        Optional = 1 << 6,
+        Getter = 1 << 7,
+        Setter = 1 << 8,
+        Delegate = 1 << 9,
+        Await = 1 << 10,
+        ExpressionBody = 1 << 11
+    };
+
+    NodeKind kind = NodeKind::Empty;
+    Op op = Op::None;
+    VarKind varKind = VarKind::Var;
+    uint16_t flags = 0;
+    // Source range
+    uint32_t start = 0;
+    uint32_t end = 0;
+    Atom name;
+    Node* a = nullptr;
+    Node* b = nullptr;
+    Node* c = nullptr;
+    Node* d = nullptr;
+    NodeList list;
+
+    bool has(Flag flag) const {
+        return (flags & flag) != 0;
+    }
+};
+
+// The syntax tree of one module. Nodes and lists live in the tree's
+// arena, so dropping the tree frees a module in one go instead of one
+// `delete` per node; names are atoms, shared by every tree.
+class Ast {
+public:
+    Arena arena;
+    Node* program = nullptr;
+
+    // Nodes take roughly seven times the source size; start with a block
+    // that big so a typical module's tree is contiguous
+    explicit Ast(size_t sourceSize) : arena(sourceSize * 7) {}
+};
+
+// Recursive-descent parser for modern JavaScript (ES2022 and import
+// attributes) into an Ast. TypeScript and JSX syntax are not understood
+// and are reported as syntax errors, which callers treat as "leave this
+// module's text alone".
+class Parser {
+private:
+    class SyntaxError {
+    public:
+        std::string message;
+        uint32_t offset;
+    };
+
+    const std::string& source;
+    Ast& ast;
+    Lexer lexer;
+    Token tok;
+    std::string_view text;
+    // End of the previous token, where a node that ended there stops
+    uint32_t lastEnd = 0;
+    bool module;
+    // Context of the code being parsed
+    bool inFunction = false;
+    bool inAsync = false;
+    bool inGenerator = false;
+    // `in` is not an operator in the init of a for statement
+    bool noIn = false;
+    // Lists under construction, innermost last
+    std::vector<Node*> scratch;
+    std::string errorMessage;
+
+    // Saves the context flags and restores them on scope exit
+    class Context {
+    private:
+        Parser& parser;
+        bool function, async, generator, in;
+
+    public:
+        explicit Context(Parser& p)
+            : parser(p), function(p.inFunction), async(p.inAsync), generator(p.inGenerator), in(p.noIn) {}
+
+        ~Context() {
+            parser.inFunction = function;
+            parser.inAsync = async;
+            parser.inGenerator = generator;
+            parser.noIn = in;
+        }
+    };
+
+    [[noreturn]] void syntaxError(const std::string& message) {
+        throw SyntaxError{message, tok.start};
+    }
+
+    [[noreturn]] void unexpected() {
+        if (tok.kind == TokenKind::End) {
+            syntaxError("Unexpected end of input");
+        }
+        syntaxError("Unexpected token '" + std::string(text) + "'");
+    }
+
+    void advance() {
+        lastEnd = tok.end;
+        tok = lexer.next();
+        text = std::string_view(source.data() + tok.start, tok.end - tok.start);
+        if (tok.kind == TokenKind::Invalid) {
+            syntaxError(tok.end >= source.size() ? "Unterminated literal" : "Invalid or unexpected token");
+        }
+    }
+
+    void relex(bool regex) {
+        tok = lexer.relex(tok, regex);
+        text = std::string_view(source.data() + tok.start, tok.end - tok.start);
+        if (tok.kind == TokenKind::Invalid) {
+            syntaxError("Invalid regular expression");
+        }
+    }
+
+    bool is(const char* punctuator) const {
+        return tok.kind == TokenKind::Punctuator && text == punctuator;
+    }
+
+    bool isWord(const char* word) const {
+        return tok.kind == TokenKind::Identifier && text == word;
+    }
+
+    bool eat(const char* punctuator) {
+        if (is(punctuator)) {
+            advance();
+            return true;
+        }
+        return false;
+    }
+
+    void expect(const char* punctuator) {
+        if (!eat(punctuator)) {
+            if (tok.kind == TokenKind::End) {
+                unexpected();
+            }
+            syntaxError("Expected '" + std::string(punctuator) + "' but found '" + std::string(text) + "'");
+        }
+    }
+
+    void expectWord(const char* word) {
+        if (!isWord(word)) {
+            syntaxError("Expected '" + std::string(word) + "' but found '" + std::string(text) + "'");
+        }
+        advance();
+    }
+
+    // Automatic semicolon insertion
+    void semicolon() {
+        if (eat(";") || is("}") || tok.kind == TokenKind::End || tok.newlineBefore) {
+            return;
+        }
+        syntaxError("Expected ';' but found '" + std::string(text) + "'");
+    }
+
+    // The first non-blank source character after `offset`, for the few
+    // places that need one character of lookahead
+    char charAfter(uint32_t offset) const {
+        while (offset < source.size() && (source[offset] == ' ' || source[offset] == '\t')) {
+            ++offset;
+        }
+        return offset < source.size() ? source[offset] : '\0';
+    }
+
+    bool arrowFollows() const {
+        uint32_t offset = tok.end;
+        while (offset < source.size() && (source[offset] == ' ' || source[offset] == '\t')) {
+            ++offset;
+        }
+        return source.compare(offset, 2, "=>") == 0;
+    }
+
+    Token peek() {
+        Lexer::State state = lexer.save();
+        Token next = lexer.next();
+        lexer.restore(state);
+        return next;
+    }
+
+    bool peekIs(const Token& next, const char* word) const {
+        size_t length = std::strlen(word);
+        return next.end - next.start == length && source.compare(next.start, length, word) == 0;
+    }
+
+    Node* node(NodeKind kind, uint32_t start) {
+        Node* n = ast.arena.make<Node>();
+        n->kind = kind;
+        n->start = start;
+        return n;
+    }
+
+    Node* finish(Node* n) {
+        n->end = lastEnd;
+        return n;
+    }
+
+    NodeList takeList(size_t mark) {
+        NodeList list;
+        list.size = static_cast<uint32_t>(scratch.size() - mark);
+        list.items = ast.arena.allocateArray<Node*>(list.size);
+        std::copy(scratch.begin() + mark, scratch.end(), list.items);
+        scratch.resize(mark);
+        return list;
+    }
+
+    static bool isReserved(std::string_view word) {
+        // Called for every identifier: reject on length and first letter
+        // before comparing
+        if (word.size() < 2 || word.size() > 10 || word[0] < 'b' || word[0] > 'w') {
+            return false;
+        }
+        static const char* words[] = {"break", "case", "catch", "const", "continue", "debugger", "default", "delete",
+                                      "do", "else", "enum", "export", "extends", "finally", "for", "if", "in",
+                                      "instanceof", "return", "switch", "throw", "try", "typeof", "var", "void",
+                                      "while", "with"};
+        for (const char* w : words) {
+            if (w[0] == word[0] && word == w) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Node* identifier() {
+        if (tok.kind != TokenKind::Identifier || isReserved(text)) {
+            if (tok.kind == TokenKind::End) {
+                unexpected();
+            }
+            syntaxError("Expected identifier but found '" + std::string(text) + "'");
+        }
+        Node* n = node(NodeKind::Identifier, tok.start);
+        n->name = intern(text);
+        advance();
+        return finish(n);
+    }
+
+    // Any name after `.`, keywords included
+    Atom propertyName() {
+        if (tok.kind != TokenKind::Identifier && tok.kind != TokenKind::PrivateName) {
+            syntaxError("Expected property name but found '" + std::string(text) + "'");
+        }
+        Atom name = intern(text);
+        advance();
+        return name;
+    }
+
+    // ---- Statements ----
+
+    Node* statement() {
+        uint32_t start = tok.start;
+        if (tok.kind == TokenKind::Punctuator) {
+            if (is("{")) {
+                return block();
+            }
+            if (is(";")) {
+                advance();
+                return finish(node(NodeKind::Empty, start));
+            }
+        } else if (tok.kind == TokenKind::Identifier) {
+            switch (text[0]) {
+                case 'a':
+                    if (text == "async") {
+                        Token next = peek();
+                        if (!next.newlineBefore && peekIs(next, "function")) {
+                            advance();
+                            return function(NodeKind::Function, start, true);
+                        }
+                    }
+                    break;
+                case 'b':
+                    if (text == "break") {
+                        return jump(NodeKind::Break);
+                    }
+                    break;
+                case 'c':
+                    if (text == "const") {
+                        return variables(VarKind::Const);
+                    }
+                    if (text == "class") {
+                        return classNode(NodeKind::Class);
+                    }
+                    if (text == "continue") {
+                        return jump(NodeKind::Continue);
+                    }
+                    break;
+                case 'd':
+                    if (text == "do") {
+                        advance();
+                        Node* n = node(NodeKind::DoWhile, start);
+                        n->d = statement();
+                        expectWord("while");
+                        n->a = condition();
+                        eat(";");
+                        return finish(n);
+                    }
+                    if (text == "debugger") {
+                        advance();
+                        semicolon();
+                        return finish(node(NodeKind::Debugger, start));
+                    }
+                    break;
+                case 'e':
+                    if (text == "export") {
+                        return exportDeclaration();
+                    }
+                    break;
+                case 'f':
+                    if (text == "function") {
+                        return function(NodeKind::Function, start, false);
+                    }
+                    if (text == "for") {
+                        return forStatement();
+                    }
+                    break;
+                case 'i':
+                    if (text == "if") {
+                        advance();
+                        Node* n = node(NodeKind::If, start);
+                        n->a = condition();
+                        n->b = statement();
+                        if (isWord("else")) {
+                            advance();
+                            n->c = statement();
+                        }
+                        return finish(n);
+                    }
+                    if (text == "import") {
+                        char next = charAfter(tok.end);
+                        if (next != '(' && next != '.') {
+                            return importDeclaration();
+                        }
+                    }
+                    break;
+                case 'l':
+                    if (text == "let") {
+                        char next = charAfter(tok.end);
+                        if (next == '[' || next == '{' || Simd::isIdentifierByte(static_cast<unsigned char>(next))) {
+                            return variables(VarKind::Let);
+                        }
+                    }
+                    break;
+                case 'r':
+                    if (text == "return") {
+                        advance();
+                        Node* n = node(NodeKind::Return, start);
+                        if (!is(";") && !is("}") && tok.kind != TokenKind::End && !tok.newlineBefore) {
+                            n->a = expression();
+                        }
+                        semicolon();
+                        return finish(n);
+                    }
+                    break;
+                case 's':
+                    if (text == "switch") {
+                        return switchStatement();
+                    }
+                    break;
+                case 't':
+                    if (text == "throw") {
+                        advance();
+                        Node* n = node(NodeKind::Throw, start);
+                        n->a = expression();
+                        semicolon();
+                        return finish(n);
+                    }
+                    if (text == "try") {
+                        return tryStatement();
+                    }
+                    break;
+                case 'v':
+                    if (text == "var") {
+                        return variables(VarKind::Var);
+                    }
+                    break;
+                case 'w':
+                    if (text == "while" || text == "with") {
+                        Node* n = node(text == "while" ? NodeKind::While : NodeKind::With, start);
+                        advance();
+                        n->a = condition();
+                        n->d = statement();
+                        return finish(n);
+                    }
+                    break;
+                default:
+                    break;
+            }
+            if (charAfter(tok.end) == ':' && !isReserved(text)) {
+                Node* n = node(NodeKind::Labeled, start);
+                n->name = intern(text);
+                advance();
+                advance();
+                n->d = statement();
+                return finish(n);
+            }
+        }
+        Node* n = node(NodeKind::Expression, start);
+        n->a = expression();
+        semicolon();
+        return finish(n);
+    }
+
+    Node* block() {
+        Node* n = node(NodeKind::Block, tok.start);
+        expect("{");
+        size_t mark = scratch.size();
+        while (!is("}")) {
+            if (tok.kind == TokenKind::End) {
+                unexpected();
+            }
+            scratch.push_back(statement());
+        }
+        advance();
+        n->list = takeList(mark);
+        return finish(n);
+    }
+
+    // `( expression )` of if, while and friends
+    Node* condition() {
+        Context context(*this);
+        noIn = false;
+        expect("(");
+        Node* n = expression();
+        expect(")");
+        return n;
+    }
+
+    Node* jump(NodeKind kind) {
+        Node* n = node(kind, tok.start);
+        advance();
+        if (tok.kind == TokenKind::Identifier && !tok.newlineBefore && !isReserved(text)) {
+            n->name = intern(text);
+            advance();
+        }
+        semicolon();
+        return finish(n);
+    }
+
+    Node* variableList(VarKind kind) {
+        Node* n = node(NodeKind::VarDecl, tok.start);
+        n->varKind = kind;
+        advance();
+        size_t mark = scratch.size();
+        do {
+            Node* declarator = node(NodeKind::Declarator, tok.start);
+            declarator->a = bindingTarget();
+            if (eat("=")) {
+                declarator->b = assignment();
+            }
+            scratch.push_back(finish(declarator));
+        } while (eat(","));
+        n->list = takeList(mark);
+        return finish(n);
+    }
+
+    Node* variables(VarKind kind) {
+        Node* n = variableList(kind);
+        semicolon();
+        return finish(n);
+    }
+
+    Node* forStatement() {
+        uint32_t start = tok.start;
+        advance();
+        bool isAwait = false;
+        if (isWord("await")) {
+            isAwait = true;
+            advance();
+        }
+        expect("(");
+        Node* init = nullptr;
+        {
+            Context context(*this);
+            noIn = true;
+            if (isWord("var") || isWord("const") ||
+                (isWord("let") && (charAfter(tok.end) == '[' || charAfter(tok.end) == '{' ||
+                                   Simd::isIdentifierByte(static_cast<unsigned char>(charAfter(tok.end)))))) {
+                init = variableList(text == "var" ? VarKind::Var : text == "let" ? VarKind::Let : VarKind::Const);
+            } else if (!is(";")) {
+                init = expression();
+            }
+        }
+        if (init && (isWord("of") || isWord("in"))) {
+            Node* n = node(isWord("of") ? NodeKind::ForOf : NodeKind::ForIn, start);
+            if (isAwait) {
+                n->flags |= Node::Await;
+            }
+            advance();
+            n->a = init;
+            n->b = n->kind == NodeKind::ForOf ? assignment() : expression();
+            expect(")");
+            n->d = statement();
+            return finish(n);
+        }
+        Node* n = node(NodeKind::For, start);
+        n->a = init;
+        expect(";");
+        if (!is(";")) {
+            n->b = expression();
+        }
+        expect(";");
+        if (!is(")")) {
+            n->c = expression();
+        }
+        expect(")");
+        n->d = statement();
+        return finish(n);
+    }
+
+    Node* switchStatement() {
+        Node* n = node(NodeKind::Switch, tok.start);
+        advance();
+        n->a = condition();
+        expect("{");
+        size_t mark = scratch.size();
+        while (!eat("}")) {
+            Node* c = node(NodeKind::Case, tok.start);
+            if (isWord("case")) {
+                advance();
+                c->a = expression();
+            } else {
+                expectWord("default");
+            }
+            expect(":");
+            size_t body = scratch.size();
+            while (!is("}") && !isWord("case") && !isWord("default")) {
+                if (tok.kind == TokenKind::End) {
+                    unexpected();
+                }
+                scratch.push_back(statement());
+            }
+            c->list = takeList(body);
+            scratch.push_back(finish(c));
+        }
+        n->list = takeList(mark);
+        return finish(n);
+    }
+
+    Node* tryStatement() {
+        Node* n = node(NodeKind::Try, tok.start);
+        advance();
+        n->a = block();
+        if (isWord("catch")) {
+            advance();
+            if (eat("(")) {
+                n->b = bindingTarget();
+                expect(")");
+            }
+            n->c = block();
+        }
+        if (isWord("finally")) {
+            advance();
+            n->d = block();
+        }
+        if (!n->c && !n->d) {
+            syntaxError("Missing catch or finally after try");
+        }
+        return finish(n);
+    }
+
+    // ---- Modules ----
+
+    Node* moduleSource() {
+        if (tok.kind != TokenKind::String) {
+            syntaxError("Expected module specifier but found '" + std::string(text) + "'");
+        }
+        Node* n = node(NodeKind::String, tok.start);
+        advance();
+        finish(n);
+        // Import attributes: `with { type: "json" }`
+        if ((isWord("with") || isWord("assert")) && !tok.newlineBefore) {
+            advance();
+            object();
+        }
+        return n;
+    }
+
+    // A name in an import or export list, which may be a string
+    Node* moduleExportName() {
+        if (tok.kind == TokenKind::String) {
+            Node* n = node(NodeKind::String, tok.start);
+            advance();
+            return finish(n);
+        }
+        if (tok.kind != TokenKind::Identifier) {
+            syntaxError("Expected name but found '" + std::string(text) + "'");
+        }
+        Node* n = node(NodeKind::Identifier, tok.start);
+        n->name = intern(text);
+        advance();
+        return finish(n);
+    }
+
+    Atom exportNameOf(const Node* n) {
+        if (n->kind == NodeKind::Identifier) {
+            return n->name;
+        }
+        // A string literal; names with escapes are rare enough to keep raw
+        return intern(std::string_view(source.data() + n->start + 1, n->end - n->start - 2));
+    }
+
+    Node* importDeclaration() {
+        Node* n = node(NodeKind::Import, tok.start);
+        advance();
+        size_t mark = scratch.size();
+        if (tok.kind != TokenKind::String) {
+            bool more = true;
+            if (tok.kind == TokenKind::Identifier) {
+                Node* specifier = node(NodeKind::ImportSpecifier, tok.start);
+                specifier->name = intern("default");
+                specifier->a = identifier();
+                scratch.push_back(finish(specifier));
+                more = eat(",");
+            }
+            if (more && is("*")) {
+                Node* specifier = node(NodeKind::ImportSpecifier, tok.start);
+                advance();
+                expectWord("as");
+                specifier->name = intern("*");
+                specifier->a = identifier();
+                scratch.push_back(finish(specifier));
+            } else if (more) {
+                expect("{");
+                while (!eat("}")) {
+                    Node* specifier = node(NodeKind::ImportSpecifier, tok.start);
+                    Node* imported = moduleExportName();
+                    specifier->name = exportNameOf(imported);
+                    if (isWord("as")) {
+                        advance();
+                        specifier->a = identifier();
+                    } else {
+                        if (imported->kind != NodeKind::Identifier) {
+                            syntaxError("A string import must be renamed with 'as'");
+                        }
+                        specifier->a = imported;
+                    }
+                    scratch.push_back(finish(specifier));
+                    if (!is("}")) {
+                        expect(",");
+                    }
+                }
+            }
+            expectWord("from");
+        }
+        n->list = takeList(mark);
+        n->b = moduleSource();
+        semicolon();
+        return finish(n);
+    }
+
+    Node* exportDeclaration() {
+        uint32_t start = tok.start;
+        advance();
+        if (is("*")) {
+            Node* n = node(NodeKind::ExportAll, start);
+            advance();
+            if (isWord("as")) {
+                advance();
+                n->b = moduleExportName();
+            }
+            expectWord("from");
+            n->c = moduleSource();
+            semicolon();
+            return finish(n);
+        }
+        if (is("{")) {
+            Node* n = node(NodeKind::ExportNamed, start);
+            advance();
+            size_t mark = scratch.size();
+            while (!eat("}")) {
+                Node* specifier = node(NodeKind::ExportSpecifier, tok.start);
+                specifier->a = moduleExportName();
+                if (isWord("as")) {
+                    advance();
+                    specifier->b = moduleExportName();
+                } else {
+                    specifier->b = specifier->a;
+                }
+                scratch.push_back(finish(specifier));
+                if (!is("}")) {
+                    expect(",");
+                }
+            }
+            n->list = takeList(mark);
+            if (isWord("from")) {
+                advance();
+                n->c = moduleSource();
+            }
+            semicolon();
+            return finish(n);
+        }
+        if (isWord("default")) {
+            Node* n = node(NodeKind::ExportDefault, start);
+            advance();
+            uint32_t declStart = tok.start;
+            if (isWord("function")) {
+                n->a = function(NodeKind::Function, declStart, false, true);
+            } else if (isWord("async") && peekIs(peek(), "function") && !peek().newlineBefore) {
+                advance();
+                n->a = function(NodeKind::Function, declStart, true, true);
+            } else if (isWord("class")) {
+                n->a = classNode(NodeKind::Class, true);
+            } else {
+                n->a = assignment();
+                semicolon();
+            }
+            return finish(n);
+        }
+        Node* n = node(NodeKind::ExportDecl, start);
+        uint32_t declStart = tok.start;
+        if (isWord("var") || isWord("let") || isWord("const")) {
+            n->a = variables(text == "var" ? VarKind::Var : text == "let" ? VarKind::Let : VarKind::Const);
+        } else if (isWord("function")) {
+            n->a = function(NodeKind::Function, declStart, false);
+        } else if (isWord("async")) {
+            advance();
+            n->a = function(NodeKind::Function, declStart, true);
+        } else if (isWord("class")) {
+            n->a = classNode(NodeKind::Class);
+        } else {
+            unexpected();
+        }
+        return finish(n);
+    }
+
+    // ---- Functions and classes ----
+
+    // Identifier or destructuring pattern
+    Node* bindingTarget() {
+        if (is("[")) {
+            return array();
+        }
+        if (is("{")) {
+            return object();
+        }
+        return identifier();
+    }
+
+    // Parameters up to and including the `)`
+    NodeList parameters() {
+        expect("(");
+        size_t mark = scratch.size();
+        while (!eat(")")) {
+            uint32_t start = tok.start;
+            if (eat("...")) {
+                Node* rest = node(NodeKind::Spread, start);
+                rest->a = bindingTarget();
+                scratch.push_back(finish(rest));
+            } else {
+                Node* target = bindingTarget();
+                if (is("=")) {
+                    Node* withDefault = node(NodeKind::Assign, start);
+                    withDefault->op = Op::Assign;
+                    advance();
+                    withDefault->a = target;
+                    withDefault->b = assignment();
+                    target = finish(withDefault);
+                }
+                scratch.push_back(target);
+            }
+            if (!is(")")) {
+                expect(",");
+            }
+        }
+        return takeList(mark);
+    }
+
+    // From `function`; the caller consumed any `async`
+    Node* function(NodeKind kind, uint32_t start, bool isAsync, bool optionalName = false) {
+        Node* n = node(kind, start);
+        expectWord("function");
+        if (eat("*")) {
+            n->flags |= Node::Generator;
+        }
+        if (isAsync) {
+            n->flags |= Node::Async;
+        }
+        if (tok.kind == TokenKind::Identifier) {
+            n->a = identifier();
+        } else if (kind == NodeKind::Function && !optionalName) {
+            syntaxError("Function declarations need a name");
+        }
+        return functionRest(n);
+    }
+
+    // Parameters and body of `n`, whose flags say async and generator
+    Node* functionRest(Node* n) {
+        Context context(*this);
+        inFunction = true;
+        inAsync = n->has(Node::Async);
+        inGenerator = n->has(Node::Generator);
+        noIn = false;
+        n->list = parameters();
+        n->b = block();
+        return finish(n);
+    }
+
+    // Body of an arrow function whose parameters are parsed
+    Node* arrowBody(Node* n) {
+        Context context(*this);
+        inFunction = true;
+        inAsync = n->has(Node::Async);
+        inGenerator = false;
+        expect("=>");
+        if (is("{")) {
+            noIn = false;
+            n->b = block();
+        } else {
+            n->flags |= Node::ExpressionBody;
+            n->b = assignment();
+        }
+        return finish(n);
+    }
+
+    Node* classNode(NodeKind kind, bool optionalName = false) {
+        Node* n = node(kind, tok.start);
+        advance();
+        if (tok.kind == TokenKind::Identifier && !isWord("extends")) {
+            n->a = identifier();
+        } else if (kind == NodeKind::Class && !optionalName) {
+            syntaxError("Class declarations need a name");
+        }
+        if (isWord("extends")) {
+            advance();
+            n->b = callOrMember(primary(), false);
+        }
+        expect("{");
+        size_t mark = scratch.size();
+        while (!eat("}")) {
+            if (eat(";")) {
+                continue;
+            }
+            scratch.push_back(member(true));
+        }
+        n->list = takeList(mark);
+        return finish(n);
+    }
+
+    // Key of a property, method or field. Names, including keywords,
+    // become Identifier nodes that are not references.
+    Node* propertyKey(Node* owner) {
+        if (is("[")) {
+            advance();
+            owner->flags |= Node::Computed;
+            Context context(*this);
+            noIn = false;
+            Node* key = assignment();
+            expect("]");
+            return key;
+        }
+        NodeKind kind = NodeKind::Identifier;
+        switch (tok.kind) {
+            case TokenKind::Identifier:
+                break;
+            case TokenKind::String:
+                kind = NodeKind::String;
+                break;
+            case TokenKind::Number:
+                kind = NodeKind::Number;
+                break;
+            case TokenKind::PrivateName:
+                kind = NodeKind::PrivateName;
+                break;
+            default:
+                unexpected();
+        }
+        Node* key = node(kind, tok.start);
+        if (kind == NodeKind::Identifier || kind == NodeKind::PrivateName) {
+            key->name = intern(text);
+        }
+        advance();
+        return finish(key);
+    }
+
+    // A class member, or an object literal entry other than spread
+    Node* member(bool inClass) {
+        Node* n = node(NodeKind::Property, tok.start);
+        // `get`, `set`, `async` and `static` are modifiers unless what
+        // follows ends the name, as in `{ get: 1 }` or `static() {}`
+        auto modifierEnds = [this]() {
+            return is("(") || is("=") || is(";") || is("}") || is(",") || is(":") || tok.kind == TokenKind::End;
+        };
+        Node* key = nullptr;
+        if (inClass && isWord("static")) {
+            key = propertyKey(n);
+            if (is("{")) {
+                n->kind = NodeKind::StaticBlock;
+                Context context(*this);
+                inFunction = true;
+                inAsync = false;
+                inGenerator = false;
+                NodeList body = block()->list;
+                n->list = body;
+                return finish(n);
+            }
+            if (!modifierEnds()) {
+                n->flags |= Node::Static;
+                key = nullptr;
+            }
+        }
+        if (!key && isWord("async")) {
+            key = propertyKey(n);
+            if (!modifierEnds() && !tok.newlineBefore) {
+                n->flags |= Node::Async;
+                key = nullptr;
+            }
+        }
+        if (!key && is("*")) {
+            advance();
+            n->flags |= Node::Generator;
+        }
+        if (!key && !n->has(Node::Generator) && (isWord("get") || isWord("set"))) {
+            bool getter = text == "get";
+            key = propertyKey(n);
+            if (!modifierEnds()) {
+                n->flags |= getter ? Node::Getter : Node::Setter;
+                key = nullptr;
+            }
+        }
+        if (!key) {
+            key = propertyKey(n);
+        }
+        n->a = key;
+        if (is("(")) {
+            n->kind = NodeKind::Method;
+            Node* value = node(NodeKind::FunctionExpr, tok.start);
+            value->flags = n->flags & (Node::Async | Node::Generator);
+            n->b = functionRest(value);
+            return finish(n);
+        }
+        if (n->flags & (Node::Async | Node::Generator | Node::Getter | Node::Setter)) {
+            unexpected();
+        }
+        if (inClass) {
+            n->kind = NodeKind::Field;
+            if (eat("=")) {
+                Context context(*this);
+                inFunction = true;
+                inAsync = false;
+                inGenerator = false;
+                noIn = false;
+                n->b = assignment();
+            }
+            semicolon();
+            return finish(n);
+        }
+        if (eat(":")) {
+            n->b = assignment();
+            return finish(n);
+        }
+        if (key->kind != NodeKind::Identifier || n->has(Node::Computed)) {
+            unexpected();
+        }
+        // Shorthand `{ a }`, or `{ a = 1 }` in a pattern
+        n->flags |= Node::Shorthand;
+        Node* value = node(NodeKind::Identifier, key->start);
+        value->name = key->name;
+        finish(value);
+        if (is("=")) {
+            Node* withDefault = node(NodeKind::Assign, key->start);
+            withDefault->op = Op::Assign;
+            advance();
+            withDefault->a = value;
+            withDefault->b = assignment();
+            value = finish(withDefault);
+        }
+        n->b = value;
+        return finish(n);
+    }
+
+    // ---- Expressions ----
+
+    Node* expression() {
+        Node* first = assignment();
+        if (!is(",")) {
+            return first;
+        }
+        Node* n = node(NodeKind::Sequence, first->start);
+        size_t mark = scratch.size();
+        scratch.push_back(first);
+        while (eat(",")) {
+            scratch.push_back(assignment());
+        }
+        n->list = takeList(mark);
+        return finish(n);
+    }
+
+    Op assignmentOp() const {
+        if (tok.kind != TokenKind::Punctuator || text.back() != '=') {
+            return Op::None;
+        }
+        static const std::pair<const char*, Op> ops[] = {
+            {"=", Op::Assign}, {"+=", Op::AddAssign}, {"-=", Op::SubAssign}, {"*=", Op::MulAssign},
+            {"/=", Op::DivAssign}, {"%=", Op::ModAssign}, {"**=", Op::ExpAssign}, {"<<=", Op::ShlAssign},
+            {">>=", Op::ShrAssign}, {">>>=", Op::UShrAssign}, {"&=", Op::BitAndAssign}, {"|=", Op::BitOrAssign},
+            {"^=", Op::BitXorAssign}, {"&&=", Op::AndAssign}, {"||=", Op::OrAssign}, {"?\?=", Op::CoalesceAssign}};
+        for (const auto& op : ops) {
+            if (text == op.first) {
+                return op.second;
+            }
+        }
+        return Op::None;
+    }
+
+    Op binaryOp() const {
+        if (tok.kind == TokenKind::Identifier) {
+            if (text == "instanceof") {
+                return Op::InstanceOf;
+            }
+            return text == "in" && !noIn ? Op::In : Op::None;
+        }
+        if (tok.kind != TokenKind::Punctuator) {
+            return Op::None;
+        }
+        char c = text[0];
+        switch (text.size()) {
+            case 1:
+                switch (c) {
+                    case '|': return Op::BitOr;
+                    case '^': return Op::BitXor;
+                    case '&': return Op::BitAnd;
+                    case '<': return Op::Lt;
+                    case '>': return Op::Gt;
+                    case '+': return Op::Add;
+                    case '-': return Op::Sub;
+                    case '*': return Op::Mul;
+                    case '/': return Op::Div;
+                    case '%': return Op::Mod;
+                    default: return Op::None;
+                }
+            case 2:
+                if (text[1] == '=') {
+                    return c == '=' ? Op::Eq : c == '!' ? Op::Ne : c == '<' ? Op::Le : c == '>' ? Op::Ge : Op::None;
+                }
+                if (text[1] != c) {
+                    return Op::None;
+                }
+                switch (c) {
+                    case '?': return Op::Coalesce;
+                    case '|': return Op::Or;
+                    case '&': return Op::And;
+                    case '<': return Op::Shl;
+                    case '>': return Op::Shr;
+                    case '*': return Op::Exp;
+                    default: return Op::None;
+                }
+            case 3:
+                return text == "===" ? Op::StrictEq : text == "!==" ? Op::StrictNe : text == ">>>" ? Op::UShr : Op::None;
+            default:
+                return Op::None;
+        }
+    }
+
+    // After an operand a `/` divides; the lexer may have guessed regex
+    void operatorPosition() {
+        if (tok.kind == TokenKind::Regex) {
+            relex(false);
+        }
+    }
+
+    Node* assignment() {
+        uint32_t start = tok.start;
+        if (inGenerator && isWord("yield")) {
+            Node* n = node(NodeKind::Yield, start);
+            advance();
+            if (eat("*")) {
+                n->flags |= Node::Delegate;
+                n->a = assignment();
+            } else if (!tok.newlineBefore && !is(")") && !is("]") && !is("}") && !is(",") && !is(";") &&
+                       !is(":") && tok.kind != TokenKind::End && tok.kind != TokenKind::TemplateMiddle &&
+                       tok.kind != TokenKind::TemplateTail && !isWord("in") && !isWord("of")) {
+                n->a = assignment();
+            }
+            return finish(n);
+        }
+        Node* left = conditional();
+        Op op = assignmentOp();
+        if (op == Op::None) {
+            return left;
+        }
+        Node* n = node(NodeKind::Assign, start);
+        n->op = op;
+        advance();
+        n->a = left;
+        n->b = assignment();
+        return finish(n);
+    }
+
+    Node* conditional() {
+        uint32_t start = tok.start;
+        Node* test = binary(1);
+        if (!is("?")) {
+            return test;
+        }
+        Node* n = node(NodeKind::Conditional, start);
+        advance();
+        n->a = test;
+        {
+            Context context(*this);
+            noIn = false;
+            n->b = assignment();
+        }
+        expect(":");
+        n->c = assignment();
+        return finish(n);
+    }
+
+    Node* binary(int minPrecedence) {
+        uint32_t start = tok.start;
+        Node* left = unary();
+        for (;;) {
+            operatorPosition();
+            Op op = binaryOp();
+            int precedence = binaryPrecedence(op);
+            if (precedence < minPrecedence || precedence == 0) {
+                return left;
+            }
+            advance();
+            Node* n = node(NodeKind::Binary, start);
+            n->op = op;
+            n->a = left;
+            // ** groups to the right, everything else to the left
+            n->b = binary(op == Op::Exp ? precedence : precedence + 1);
+            left = finish(n);
+        }
+    }
+
+    Node* unary() {
+        uint32_t start = tok.start;
+        Op op = Op::None;
+        if (tok.kind == TokenKind::Punctuator) {
+            if (text.size() == 1) {
+                op = text[0] == '!' ? Op::Not : text[0] == '~' ? Op::BitNot : text[0] == '+' ? Op::Pos
+                     : text[0] == '-' ? Op::Neg : Op::None;
+            } else if (text == "++" || text == "--") {
+                Node* n = node(NodeKind::Update, start);
+                n->op = text[0] == '+' ? Op::Inc : Op::Dec;
+                n->flags |= Node::Prefix;
+                advance();
+                n->a = unary();
+                return finish(n);
+            }
+        } else if (tok.kind == TokenKind::Identifier) {
+            op = text == "typeof" ? Op::TypeOf : text == "void" ? Op::Void : text == "delete" ? Op::Delete : Op::None;
+            if (text == "await" && (inAsync || (module && !inFunction))) {
+                Node* n = node(NodeKind::Await, start);
+                advance();
+                n->a = unary();
+                return finish(n);
+            }
+        }
+        if (op != Op::None) {
+            Node* n = node(NodeKind::Unary, start);
+            n->op = op;
+            advance();
+            n->a = unary();
+            return finish(n);
+        }
+        Node* operand = callOrMember(primary(), false);
+        operatorPosition();
+        if ((is("++") || is("--")) && !tok.newlineBefore) {
+            Node* n = node(NodeKind::Update, start);
+            n->op = text[0] == '+' ? Op::Inc : Op::Dec;
+            n->a = operand;
+            advance();
+            return finish(n);
+        }
+        return operand;
+    }
+
+    NodeList arguments() {
+        Context context(*this);
+        noIn = false;
+        expect("(");
+        size_t mark = scratch.size();
+        while (!eat(")")) {
+            uint32_t start = tok.start;
+            if (eat("...")) {
+                Node* spread = node(NodeKind::Spread, start);
+                spread->a = assignment();
+                scratch.push_back(finish(spread));
+            } else {
+                scratch.push_back(assignment());
+            }
+            if (!is(")")) {
+                expect(",");
+            }
+        }
+        return takeList(mark);
+    }
+
+    // Member accesses, calls and tagged templates after `object`. `new`
+    // callees stop before the first call, which belongs to the `new`.
+    Node* callOrMember(Node* object, bool noCall) {
+        uint32_t start = object->start;
+        for (;;) {
+            operatorPosition();
+            if (tok.kind == TokenKind::Punctuator) {
+                if (is(".")) {
+                    advance();
+                    Node* n = node(NodeKind::Member, start);
+                    n->a = object;
+                    n->name = propertyName();
+                    object = finish(n);
+                    continue;
+                }
+                if (is("?.")) {
+                    if (noCall) {
+                        syntaxError("Optional chain in new expression");
+                    }
+                    advance();
+                    Node* n;
+                    if (is("(")) {
+                        n = node(NodeKind::Call, start);
+                        n->list = arguments();
+                    } else if (eat("[")) {
+                        n = node(NodeKind::Index, start);
+                        Context context(*this);
+                        noIn = false;
+                        n->b = expression();
+                        expect("]");
+                    } else {
+                        n = node(NodeKind::Member, start);
+                        n->name = propertyName();
+                    }
+                    n->a = object;
+                    n->flags |= Node::Optional;
+                    object = finish(n);
+                    continue;
+                }
+                if (is("[")) {
+                    advance();
+                    Node* n = node(NodeKind::Index, start);
+                    n->a = object;
+                    Context context(*this);
+                    noIn = false;
+                    n->b = expression();
+                    expect("]");
+                    object = finish(n);
+                    continue;
+                }
+                if (is("(") && !noCall) {
+                    Node* n = node(NodeKind::Call, start);
+                    n->a = object;
+                    n->list = arguments();
+                    object = finish(n);
+                    continue;
+                }
+            } else if (tok.kind == TokenKind::Template || tok.kind == TokenKind::TemplateHead) {
+                Node* n = node(NodeKind::TaggedTemplate, start);
+                n->a = object;
+                n->b = templateLiteral();
+                object = finish(n);
+                continue;
+            }
+            return object;
+        }
+    }
+
+    Node* templateLiteral() {
+        Node* n = node(NodeKind::Template, tok.start);
+        size_t mark = scratch.size();
+        Context context(*this);
+        noIn = false;
+        for (;;) {
+            bool last = tok.kind == TokenKind::Template || tok.kind == TokenKind::TemplateTail;
+            if (!last && tok.kind != TokenKind::TemplateHead && tok.kind != TokenKind::TemplateMiddle) {
+                unexpected();
+            }
+            Node* element = node(NodeKind::TemplateElement, tok.start);
+            advance();
+            scratch.push_back(finish(element));
+            if (last) {
+                break;
+            }
+            scratch.push_back(expression());
+        }
+        n->list = takeList(mark);
+        return finish(n);
+    }
+
+    Node* array() {
+        Node* n = node(NodeKind::Array, tok.start);
+        Context context(*this);
+        noIn = false;
+        expect("[");
+        size_t mark = scratch.size();
+        while (!eat("]")) {
+            uint32_t start = tok.start;
+            if (is(",")) {
+                advance();
+                scratch.push_back(finish(node(NodeKind::Hole, start)));
+                continue;
+            }
+            if (eat("...")) {
+                Node* spread = node(NodeKind::Spread, start);
+                spread->a = assignment();
+                scratch.push_back(finish(spread));
+            } else {
+                scratch.push_back(assignment());
+            }
+            if (!is("]")) {
+                expect(",");
+            }
+        }
+        n->list = takeList(mark);
+        return finish(n);
+    }
+
+    Node* object() {
+        Node* n = node(NodeKind::Object, tok.start);
+        Context context(*this);
+        noIn = false;
+        expect("{");
+        size_t mark = scratch.size();
+        while (!eat("}")) {
+            uint32_t start = tok.start;
+            if (eat("...")) {
+                Node* spread = node(NodeKind::Spread, start);
+                spread->a = assignment();
+                scratch.push_back(finish(spread));
+            } else {
+                scratch.push_back(member(false));
+            }
+            if (!is("}")) {
+                expect(",");
+            }
+        }
+        n->list = takeList(mark);
+        return finish(n);
+    }
+
+    // `(` in expression position: parenthesized expression or arrow
+    // parameters, or the arguments of `async(...)`
+    Node* parenthesized(uint32_t start, Node* asyncCallee) {
+        Context context(*this);
+        noIn = false;
+        expect("(");
+        size_t mark = scratch.size();
+        bool spread = false;
+        while (!is(")")) {
+            uint32_t itemStart = tok.start;
+            if (eat("...")) {
+                Node* rest = node(NodeKind::Spread, itemStart);
+                rest->a = assignment();
+                scratch.push_back(finish(rest));
+                spread = true;
+            } else {
+                scratch.push_back(assignment());
+            }
+            if (!is(")")) {
+                expect(",");
+            }
+        }
+        advance();
+        if (is("=>") && !tok.newlineBefore) {
+            Node* n = node(NodeKind::Arrow, start);
+            if (asyncCallee) {
+                n->flags |= Node::Async;
+            }
+            n->list = takeList(mark);
+            return arrowBody(n);
+        }
+        if (asyncCallee) {
+            Node* n = node(NodeKind::Call, start);
+            n->a = asyncCallee;
+            n->list = takeList(mark);
+            return finish(n);
+        }
+        if (spread || scratch.size() == mark) {
+            syntaxError("Unexpected token ')'");
+        }
+        if (scratch.size() == mark + 1) {
+            Node* only = scratch.back();
+            scratch.pop_back();
+            return only;
+        }
+        Node* n = node(NodeKind::Sequence, scratch[mark]->start);
+        n->list = takeList(mark);
+        // A parenthesized sequence ends at its last item, not the `)`
+        n->end = n->list[n->list.size - 1]->end;
+        return n;
+    }
+
+    Node* singleParameterArrow(uint32_t start, bool isAsync) {
+        Node* n = node(NodeKind::Arrow, start);
+        if (isAsync) {
+            n->flags |= Node::Async;
+        }
+        size_t mark = scratch.size();
+        scratch.push_back(identifier());
+        n->list = takeList(mark);
+        return arrowBody(n);
+    }
+
+    Node* primary() {
+        uint32_t start = tok.start;
+        switch (tok.kind) {
+            case TokenKind::Identifier:
+                return primaryWord();
+            case TokenKind::Number:
+            case TokenKind::String:
+            case TokenKind::Regex: {
+                Node* n = node(tok.kind == TokenKind::Number   ? NodeKind::Number
+                               : tok.kind == TokenKind::String ? NodeKind::String
+                                                               : NodeKind::Regex,
+                               start);
+                advance();
+                return finish(n);
+            }
+            case TokenKind::Template:
+            case TokenKind::TemplateHead:
+                return templateLiteral();
+            case TokenKind::PrivateName: {
+                // `#field in object`
+                Node* n = node(NodeKind::PrivateName, start);
+                n->name = intern(text);
+                advance();
+                return finish(n);
+            }
+            case TokenKind::Punctuator:
+                if (is("(")) {
+                    return parenthesized(start, nullptr);
+                }
+                if (is("[")) {
+                    return array();
+                }
+                if (is("{")) {
+                    return object();
+                }
+                if (is("/") || is("/=")) {
+                    relex(true);
+                    return primary();
+                }
+                unexpected();
+            default:
+                unexpected();
+        }
+    }
+
+    Node* primaryWord() {
+        uint32_t start = tok.start;
+        auto simple = [&](NodeKind kind) {
+            advance();
+            return finish(node(kind, start));
+        };
+        switch (text[0]) {
+            case 'a':
+                if (text == "async" && !peek().newlineBefore) {
+                    Token next = peek();
+                    if (peekIs(next, "function")) {
+                        advance();
+                        return function(NodeKind::FunctionExpr, start, true);
+                    }
+                    if (next.kind == TokenKind::Identifier) {
+                        advance();
+                        return singleParameterArrow(start, true);
+                    }
+                    if (next.kind == TokenKind::Punctuator && peekIs(next, "(")) {
+                        Node* callee = identifier();
+                        return parenthesized(start, callee);
+                    }
+                }
+                break;
+            case 'c':
+                if (text == "class") {
+                    return classNode(NodeKind::ClassExpr);
+                }
+                break;
+            case 'f':
+                if (text == "function") {
+                    return function(NodeKind::FunctionExpr, start, false);
+                }
+                if (text == "false") {
+                    return simple(NodeKind::False);
+                }
+                break;
+            case 'i':
+                if (text == "import") {
+                    advance();
+                    if (eat(".")) {
+                        Node* n = node(NodeKind::MetaProperty, start);
+                        expectWord("meta");
+                        n->name = intern("import.meta");
+                        return finish(n);
+                    }
+                    Node* n = node(NodeKind::ImportCall, start);
+                    n->list = arguments();
+                    return finish(n);
+                }
+                break;
+            case 'n':
+                if (text == "null") {
+                    return simple(NodeKind::Null);
+                }
+                if (text == "new") {
+                    advance();
+                    if (eat(".")) {
+                        Node* n = node(NodeKind::MetaProperty, start);
+                        expectWord("target");
+                        n->name = intern("new.target");
+                        return finish(n);
+                    }
+                    Node* n = node(NodeKind::New, start);
+                    n->a = callOrMember(primary(), true);
+                    if (is("(")) {
+                        n->list = arguments();
+                    }
+                    return finish(n);
+                }
+                break;
+            case 's':
+                if (text == "super") {
+                    return simple(NodeKind::Super);
+                }
+                break;
+            case 't':
+                if (text == "this") {
+                    return simple(NodeKind::This);
+                }
+                if (text == "true") {
+                    return simple(NodeKind::True);
+                }
+                break;
+            default:
+                break;
+        }
+        if (arrowFollows()) {
+            return singleParameterArrow(start, false);
+        }
+        return identifier();
+    }
+
+public:
+    // `isModule` enables top-level await
+    Parser(const std::string& sourceText, Ast& tree, bool isModule = true)
+        : source(sourceText), ast(tree), lexer(sourceText), module(isModule) {}
+
+    bool parse() {
+        try {
+            advance();
+            Node* program = node(NodeKind::Program, 0);
+            size_t mark = scratch.size();
+            while (tok.kind != TokenKind::End) {
+                scratch.push_back(statement());
+            }
+            program->list = takeList(mark);
+            program->end = static_cast<uint32_t>(source.size());
+            ast.program = program;
+            return true;
+        } catch (const SyntaxError& e) {
+            uint32_t line = 1;
+            uint32_t column = 1;
+            for (uint32_t i = 0; i < e.offset && i < source.size(); ++i) {
+                if (source[i] == '\n') {
+                    ++line;
+                    column = 1;
+                } else {
+                    ++column;
+                }
+            }
+            errorMessage = e.message + " (" + std::to_string(line) + ":" + std::to_string(column) + ")";
+            return false;
+        }
+    }
+
+    // Why parse() failed, with line and column
+    const std::string& error() const {
+        return errorMessage;
+    }
+};
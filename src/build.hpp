@@ -0,0 +1,977 @@
+#pragma once
+
+#include "bundler.hpp"
+#include "minifier.hpp"
+#include "import_scanner.hpp"
+#include "resolver.hpp"
+#include "static_files.hpp"
+#include "transform.hpp"
+#include "hash.hpp"
+#include "interner.hpp"
+#include "phase_timer.hpp"
+#include "logger.hpp"
+#include "work_stealing.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+
+namespace fs = std::filesystem;
+
+// A file `vite build` wrote
+class BuildOutput {
+public:
+    enum class Kind { Page, Script, Stylesheet, Asset };
+
+    // Relative to the output directory, e.g. "assets/index-1a2b3c4d.js"
+    std::string name;
+    Kind kind = Kind::Asset;
+    size_t bytes = 0;
+};
+
+class BuildResult {
+public:
+    std::vector<BuildOutput> outputs;
+    // Modules parsed, pages and inline scripts included
+    size_t modules = 0;
+    // Arena memory held by the modules' syntax trees
+    size_t astBytes = 0;
+    // What tree shaking left out: whole modules, top-level statements of
+    // the others, and their source bytes
+    size_t shakenModules = 0;
+    size_t shakenStatements = 0;
+    size_t shakenBytes = 0;
+    // Scripts code splitting produced, the shared ones among them, and the
+    // modules copied into pages instead of a shared chunk below the minimum
+    // chunk size
+    size_t chunks = 0;
+    size_t sharedChunks = 0;
+    size_t copiedModules = 0;
+    // Script bytes before and after minification, how long it took, and
+    // what it did: bindings renamed, constants folded, and branches and
+    // unreachable statements left out
+    size_t minifyInputBytes = 0;
+    size_t minifyOutputBytes = 0;
+    double minifyMillis = 0;
+    size_t renamedBindings = 0;
+    size_t foldedConstants = 0;
+    size_t droppedBranches = 0;
+
+    // Bytes of JavaScript and CSS, the part of the output the bundler
+    // decides
+    size_t bundleBytes() const {
+        size_t total = 0;
+        for (const auto& output : outputs) {
+            if (output.kind == BuildOutput::Kind::Script || output.kind == BuildOutput::Kind::Stylesheet) {
+                total += output.bytes;
+            }
+        }
+        return total;
+    }
+};
+
+// The production build: every .html page in the root is an entry, its
+// module scripts are parsed together with everything they import, and the
+// pages' graphs are linked together and split into chunks under
+// <outDir>/assets: a script per page, one per import() target, and shared
+// chunks for modules several of them use (see ChunkGraph), plus one
+// stylesheet per page, with each page rewritten to load its script and
+// preload the chunks that script imports. Linking shakes the graph first,
+// so modules and declarations no used export or side effect reaches are
+// left out, and hoists each chunk's ES modules into one scope. Chunks are
+// then minified (see Minifier), each on a worker of its own.
+//
+// Parsing is the expensive part and runs on a WorkStealingPool: a worker
+// reads, scans, parses and resolves a module and queues the imports no
+// other worker has claimed yet, so discovering the graph and parsing it
+// overlap. Afterwards a single thread numbers the modules breadth-first in
+// import order; that and linking, which runs on one thread too, keep the
+// output independent of the number of workers and of scheduling.
+class BuildPipeline {
+private:
+    enum class ModuleKind { Script, Json, Stylesheet, Asset };
+
+    // Where an import leads: a module key (a file path, or a "\0"-prefixed
+    // name for modules that exist only in a page) or an external URL
+    struct Target {
+        Atom key;
+        bool external = false;
+    };
+
+    struct ParsedModule {
+        Atom key;
+        BundleModule module;
+        ModuleKind kind = ModuleKind::Script;
+        // Source came from a page rather than from disk
+        bool preloaded = false;
+        bool readFailed = false;
+        // Why the syntax tree could not be built; the module is then
+        // bundled from its text alone
+        std::string parseError;
+        std::vector<Target> importTargets;
+        std::vector<Target> requireTargets;
+    };
+
+    // One module script or stylesheet link of a page: the tag's range in
+    // the page and, for stylesheets, the file
+    struct PageTag {
+        size_t start = 0;
+        size_t end = 0;
+        fs::path stylesheet;
+    };
+
+    struct Page {
+        fs::path file;
+        std::string html;
+        Atom entryKey;
+        int entry = -1;
+        std::vector<PageTag> scripts;
+        std::vector<PageTag> stylesheets;
+        // Its chunk, and the chunks that chunk imports
+        std::string scriptUrl;
+        std::vector<std::string> preloads;
+    };
+
+    fs::path root;
+    fs::path outDir;
+    ModuleResolver& resolver;
+    static constexpr size_t SHARDS = 16;
+
+    // Modules found while parsing, by key; the first worker to claim an
+    // import creates and queues it
+    struct ClaimShard {
+        std::mutex mutex;
+        std::unordered_map<Atom, std::unique_ptr<ParsedModule>> modules;
+    };
+
+    size_t threadCount;
+    size_t minChunkSize = 0;
+    bool minify = true;
+    ClaimShard claims[SHARDS];
+    // Every module, in the order numbered after parsing
+    std::vector<ParsedModule> modules;
+    std::unordered_map<Atom, int> idsByKey;
+    std::vector<Page> pages;
+    // Source file -> URL of its hashed copy under assets/
+    std::map<std::string, std::string> emittedAssets;
+    BuildResult result;
+    bool failed = false;
+
+    // The progress bar leaves the cursor mid-line; errors start a new one
+    bool fail(const std::string& message) {
+        if (!failed) {
+            std::cout << std::endl;
+            failed = true;
+        }
+        Logger::error(message);
+        return false;
+    }
+
+    void warn(const std::string& message) {
+        std::cout << std::endl;
+        Logger::warning(message);
+    }
+
+    static bool isScript(const fs::path& file) {
+        std::string ext = file.extension().string();
+        return ext == ".js" || ext == ".mjs" || ext == ".cjs" || ext == ".jsx" || ext == ".ts" || ext == ".tsx" ||
+               ext == ".mts" || ext == ".cts";
+    }
+
+    static ModuleKind kindOf(const fs::path& file) {
+        std::string ext = file.extension().string();
+        if (ext == ".json") {
+            return ModuleKind::Json;
+        }
+        if (ext == ".css") {
+            return ModuleKind::Stylesheet;
+        }
+        return isScript(file) ? ModuleKind::Script : ModuleKind::Asset;
+    }
+
+    // URLs with a scheme or protocol-relative URLs are left to the browser
+    static bool isUrl(const std::string& specifier) {
+        return specifier.compare(0, 2, "//") == 0 ||
+               (!specifier.empty() && specifier[0] != '.' && specifier[0] != '/' && !ModuleResolver::isBare(specifier));
+    }
+
+    // Start and end of the value of `name` inside the tag html[start, end),
+    // false when the attribute is absent
+    static bool attributeSpan(const std::string& html, size_t start, size_t end, const std::string& name,
+                              size_t& valueStart, size_t& valueEnd) {
+        for (size_t at = html.find(name, start); at != std::string::npos && at < end; at = html.find(name, at + 1)) {
+            size_t p = at + name.size();
+            if (!std::isspace(static_cast<unsigned char>(html[at - 1])) || p >= end || html[p] != '=') {
+                continue;
+            }
+            char quote = html[p + 1];
+            if (quote != '"' && quote != '\'') {
+                valueStart = p + 1;
+                valueEnd = std::min(end, html.find_first_of(" \t\r\n>", valueStart));
+                return true;
+            }
+            size_t close = html.find(quote, p + 2);
+            if (close == std::string::npos || close > end) {
+                return false;
+            }
+            valueStart = p + 2;
+            valueEnd = close;
+            return true;
+        }
+        return false;
+    }
+
+    static std::string attribute(const std::string& html, size_t start, size_t end, const std::string& name) {
+        size_t valueStart = 0;
+        size_t valueEnd = 0;
+        return attributeSpan(html, start, end, name, valueStart, valueEnd)
+                   ? html.substr(valueStart, valueEnd - valueStart)
+                   : "";
+    }
+
+    // The module for `key`, created unless some worker already claimed it;
+    // `created` tells which
+    ParsedModule* claim(Atom key, const fs::path& file, bool& created) {
+        ClaimShard& shard = claims[std::hash<Atom>()(key) % SHARDS];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::unique_ptr<ParsedModule>& slot = shard.modules[key];
+        created = !slot;
+        if (created) {
+            slot = std::make_unique<ParsedModule>();
+            slot->key = key;
+            slot->module.file = file;
+            slot->kind = kindOf(file);
+        }
+        return slot.get();
+    }
+
+    ParsedModule* claimed(Atom key) {
+        ClaimShard& shard = claims[std::hash<Atom>()(key) % SHARDS];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.modules.at(key).get();
+    }
+
+    // A local file named by a page: root-absolute or relative to the page
+    fs::path pageFile(const Page& page, const std::string& url) {
+        std::string specifier = url.substr(0, url.find_first_of("?#"));
+        if (specifier.empty() || isUrl(specifier)) {
+            return {};
+        }
+        if (specifier[0] != '/' && specifier[0] != '.') {
+            specifier = "./" + specifier;
+        }
+        return resolver.resolve(specifier, page.file.parent_path());
+    }
+
+    // A page entry imports its scripts by module key. The key is written
+    // raw behind a NUL, which no real specifier starts with; the import
+    // statements are removed when linking, so it never reaches the output.
+    static std::string pageImport(const std::string& key) {
+        return "import \"" + std::string(1, '\0') + key + "\";\n";
+    }
+
+    // Collect the module scripts and stylesheet links of `page` and give it
+    // an entry module that imports its scripts in document order. The
+    // page's own modules are appended to `roots`.
+    bool loadPage(Page& page, std::vector<ParsedModule*>& roots) {
+        if (!StaticFiles::readFile(page.file, page.html)) {
+            return fail("Cannot read " + page.file.string());
+        }
+        std::string entrySource;
+        const std::string& html = page.html;
+        for (size_t at = html.find('<'); at != std::string::npos; at = html.find('<', at + 1)) {
+            if (html.compare(at, 4, "<!--") == 0) {
+                size_t close = html.find("-->", at);
+                if (close == std::string::npos) {
+                    break;
+                }
+                at = close;
+                continue;
+            }
+            bool script = html.compare(at, 7, "<script") == 0;
+            bool link = html.compare(at, 5, "<link") == 0;
+            if (!script && !link) {
+                continue;
+            }
+            size_t tagEnd = html.find('>', at);
+            if (tagEnd == std::string::npos) {
+                break;
+            }
+            if (link) {
+                std::string href = attribute(html, at, tagEnd, "href");
+                fs::path file = attribute(html, at, tagEnd, "rel") == "stylesheet" ? pageFile(page, href) : fs::path();
+                if (!file.empty() && file.extension() == ".css") {
+                    page.stylesheets.push_back(PageTag{at, tagEnd + 1, file});
+                }
+                continue;
+            }
+            size_t close = html.find("</script", tagEnd);
+            size_t end = close == std::string::npos ? std::string::npos : html.find('>', close);
+            if (end == std::string::npos) {
+                break;
+            }
+            if (attribute(html, at, tagEnd, "type") != "module") {
+                at = end;
+                continue;
+            }
+            std::string src = attribute(html, at, tagEnd, "src");
+            if (!src.empty()) {
+                fs::path file = pageFile(page, src);
+                if (file.empty()) {
+                    if (!isUrl(src)) {
+                        return fail("Cannot resolve script \"" + src + "\" in " + page.file.string());
+                    }
+                    at = end;
+                    continue;
+                }
+                entrySource += pageImport(file.string());
+            } else {
+                // Inline scripts become modules of their own, resolving
+                // imports relative to the page
+                std::string key = std::string(1, '\0') + page.file.string() + "?html-proxy&index=" +
+                                  std::to_string(page.scripts.size()) + ".js";
+                bool created = false;
+                ParsedModule* script = claim(intern(key), page.file.string() + "?html-proxy&index=" +
+                                                              std::to_string(page.scripts.size()) + ".js",
+                                             created);
+                script->module.source = html.substr(tagEnd + 1, close - tagEnd - 1);
+                script->kind = ModuleKind::Script;
+                script->preloaded = true;
+                roots.push_back(script);
+                entrySource += pageImport(key);
+            }
+            page.scripts.push_back(PageTag{at, end + 1, {}});
+            at = end;
+        }
+        bool created = false;
+        ParsedModule* entry = claim(intern(std::string(1, '\0') + page.file.string()), page.file, created);
+        entry->module.source = std::move(entrySource);
+        entry->kind = ModuleKind::Script;
+        entry->preloaded = true;
+        page.entryKey = entry->key;
+        roots.push_back(entry);
+        return true;
+    }
+
+    Target targetFor(const std::string& specifier, const fs::path& importerDir) {
+        if (!specifier.empty() && specifier[0] == '\0') {
+            return Target{intern(std::string_view(specifier).substr(1)), false};
+        }
+        std::string path = specifier.substr(0, specifier.find_first_of("?#", 1));
+        if (isUrl(path)) {
+            return Target{intern(specifier), true};
+        }
+        return Target{intern(resolver.resolve(path, importerDir).native()), false};
+    }
+
+    // Read, scan and resolve one module. Runs on any worker; touches only
+    // its own module and the thread-safe resolver.
+    void parse(ParsedModule& parsed) {
+        BundleModule& module = parsed.module;
+        if (!parsed.preloaded && !StaticFiles::readFile(module.file, module.source)) {
+            parsed.readFailed = true;
+            return;
+        }
+        if (parsed.kind != ModuleKind::Script) {
+            return;
+        }
+        module.sideEffects = resolver.hasSideEffects(module.file);
+        module.scan = ImportScanner::scan(module.source);
+        module.esm = module.scan.isEsm();
+        auto ast = std::make_shared<Ast>(module.source.size());
+        Parser parser(module.source, *ast, module.esm);
+        if (parser.parse()) {
+            module.ast = std::move(ast);
+        } else {
+            parsed.parseError = parser.error();
+        }
+        // Inline scripts are named after their page, so this is the page's
+        // directory for them
+        fs::path importerDir = module.file.parent_path();
+        for (const auto& record : module.scan.imports) {
+            parsed.importTargets.push_back(targetFor(record.specifier, importerDir));
+        }
+        for (const auto& call : module.scan.requires) {
+            parsed.requireTargets.push_back(targetFor(call.specifier, importerDir));
+        }
+    }
+
+    // Parse everything reachable from `roots`. Each worker queues the
+    // modules it claims on its own deque, so it mostly follows its own
+    // imports while idle workers steal elsewhere in the graph.
+    void parseGraph(const std::vector<ParsedModule*>& roots) {
+        WorkStealingPool<ParsedModule*> pool(threadCount);
+        for (size_t i = 0; i < roots.size(); ++i) {
+            pool.push(i, roots[i]);
+        }
+        pool.run([this, &pool](size_t worker, ParsedModule*& parsed) {
+            parse(*parsed);
+            for (const auto* targets : {&parsed->importTargets, &parsed->requireTargets}) {
+                for (const Target& target : *targets) {
+                    if (target.external || target.key.empty()) {
+                        continue;
+                    }
+                    bool created = false;
+                    ParsedModule* found = claim(target.key, fs::path(target.key.view()), created);
+                    if (created) {
+                        pool.push(worker, found);
+                    }
+                }
+            }
+        });
+    }
+
+    // Number the parsed modules breadth-first from the pages, importers
+    // before their imports and imports in source order, which is the same
+    // for any number of workers; problems are reported in that order too
+    bool numberModules(const std::vector<ParsedModule*>& roots) {
+        std::vector<ParsedModule*> order;
+        auto number = [&](ParsedModule* parsed) {
+            if (idsByKey.emplace(parsed->key, static_cast<int>(order.size())).second) {
+                order.push_back(parsed);
+            }
+        };
+        for (ParsedModule* parsed : roots) {
+            number(parsed);
+        }
+        bool ok = true;
+        // `order` grows while walking it
+        for (size_t id = 0; id < order.size(); ++id) {
+            const ParsedModule& parsed = *order[id];
+            const BundleModule& module = parsed.module;
+            if (parsed.readFailed) {
+                return fail("Cannot read " + module.file.string());
+            }
+            if (!parsed.parseError.empty()) {
+                warn(module.file.string() + ": " + parsed.parseError + "; bundling it unoptimized");
+            } else if (module.ast) {
+                result.astBytes += module.ast->arena.bytesUsed();
+            }
+            for (size_t which = 0; which < 2; ++which) {
+                const std::vector<Target>& targets = which == 0 ? parsed.importTargets : parsed.requireTargets;
+                for (size_t i = 0; i < targets.size(); ++i) {
+                    if (targets[i].key.empty()) {
+                        const std::string& specifier =
+                            which == 0 ? module.scan.imports[i].specifier : module.scan.requires[i].specifier;
+                        ok = fail("Could not resolve \"" + specifier + "\" from " + module.file.string());
+                    } else if (!targets[i].external) {
+                        number(claimed(targets[i].key));
+                    }
+                }
+            }
+        }
+        if (!ok) {
+            return false;
+        }
+        modules.reserve(order.size());
+        for (ParsedModule* parsed : order) {
+            modules.push_back(std::move(*parsed));
+        }
+        for (auto& shard : claims) {
+            shard.modules.clear();
+        }
+        for (auto& page : pages) {
+            page.entry = idsByKey.at(page.entryKey);
+        }
+        return true;
+    }
+
+    static bool writeFile(const fs::path& path, const std::string& contents) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << contents;
+        return static_cast<bool>(out);
+    }
+
+    static std::string contentHash(const std::string& contents) {
+        return Hash::hex(Hash::xxh64(contents)).substr(0, 8);
+    }
+
+    // Write `contents` as assets/<stem>-<hash><ext> and return its URL
+    bool emit(const std::string& stem, const std::string& ext, const std::string& contents, BuildOutput::Kind kind,
+              std::string& url) {
+        return write("assets/" + stem + "-" + contentHash(contents) + ext, contents, kind, url);
+    }
+
+    bool write(const std::string& name, const std::string& contents, BuildOutput::Kind kind, std::string& url) {
+        url = "/" + name;
+        if (!writeFile(outDir / name, contents)) {
+            return fail("Cannot write " + (outDir / name).string());
+        }
+        result.outputs.push_back(BuildOutput{name, kind, contents.size()});
+        return true;
+    }
+
+    // Copy an imported or referenced file into assets/ once
+    bool emitAsset(const fs::path& file, const std::string& contents, std::string& url) {
+        auto it = emittedAssets.find(file.string());
+        if (it != emittedAssets.end()) {
+            url = it->second;
+            return true;
+        }
+        if (!emit(file.stem().string(), file.extension().string(), contents, BuildOutput::Kind::Asset, url)) {
+            return false;
+        }
+        emittedAssets.emplace(file.string(), url);
+        return true;
+    }
+
+    // Point relative url(...) references of a stylesheet at hashed copies
+    // of the files, since the stylesheet itself moves to assets/
+    bool rewriteCssUrls(const fs::path& file, std::string& css) {
+        std::string out;
+        size_t copied = 0;
+        for (size_t at = css.find("url("); at != std::string::npos; at = css.find("url(", at + 4)) {
+            size_t p = at + 4;
+            while (p < css.size() && std::isspace(static_cast<unsigned char>(css[p]))) {
+                ++p;
+            }
+            char quote = p < css.size() && (css[p] == '"' || css[p] == '\'') ? css[p] : '\0';
+            size_t start = quote ? p + 1 : p;
+            size_t end = quote ? css.find(quote, start) : css.find(')', start);
+            if (end == std::string::npos) {
+                break;
+            }
+            while (!quote && end > start && std::isspace(static_cast<unsigned char>(css[end - 1]))) {
+                --end;
+            }
+            std::string ref = css.substr(start, end - start);
+            if (ref.empty() || ref[0] == '/' || ref[0] == '#' || isUrl(ref)) {
+                continue;
+            }
+            fs::path referenced = (file.parent_path() / ref.substr(0, ref.find_first_of("?#"))).lexically_normal();
+            std::string contents;
+            std::string url;
+            if (!StaticFiles::readFile(referenced, contents)) {
+                Logger::warning(ref + " referenced in " + file.string() + " does not exist");
+                continue;
+            }
+            if (!emitAsset(referenced, contents, url)) {
+                return false;
+            }
+            out.append(css, copied, start - copied);
+            out += url;
+            copied = end;
+        }
+        out.append(css, copied, std::string::npos);
+        css = std::move(out);
+        return true;
+    }
+
+    // Modules reachable from `entry` in evaluation order: dependencies
+    // before the modules importing them, imports in source order
+    std::vector<int> evaluationOrder(int entry) const {
+        std::vector<int> order;
+        std::vector<char> state(modules.size(), 0);
+        // (module, next import to visit); requires follow the imports
+        std::vector<std::pair<int, size_t>> stack = {{entry, 0}};
+        state[entry] = 1;
+        while (!stack.empty()) {
+            int id = stack.back().first;
+            size_t next = stack.back().second++;
+            const BundleModule& module = modules[id].module;
+            size_t imports = module.importTargets.size();
+            if (next < imports + module.requireTargets.size()) {
+                int target = next < imports ? module.importTargets[next] : module.requireTargets[next - imports];
+                if (target >= 0 && !state[target]) {
+                    state[target] = 1;
+                    stack.emplace_back(target, 0);
+                }
+                continue;
+            }
+            order.push_back(id);
+            stack.pop_back();
+        }
+        return order;
+    }
+
+    // Fill in the bundler's view of every module: numeric targets, and
+    // assets as modules exporting their URL
+    bool linkTargets(std::vector<std::string>& externalUrls) {
+        std::map<std::string, int> externalIds;
+        for (auto& parsed : modules) {
+            BundleModule& module = parsed.module;
+            for (size_t which = 0; which < 2; ++which) {
+                const std::vector<Target>& targets = which == 0 ? parsed.importTargets : parsed.requireTargets;
+                std::vector<int>& ids = which == 0 ? module.importTargets : module.requireTargets;
+                ids.clear();
+                for (size_t i = 0; i < targets.size(); ++i) {
+                    const Target& target = targets[i];
+                    if (target.external) {
+                        auto it = externalIds.emplace(target.key.str(), static_cast<int>(externalUrls.size())).first;
+                        if (it->second == static_cast<int>(externalUrls.size())) {
+                            externalUrls.push_back(target.key.str());
+                        }
+                        ids.push_back(-(it->second + 1));
+                    } else {
+                        ids.push_back(idsByKey.at(target.key));
+                    }
+                }
+            }
+            if (parsed.kind == ModuleKind::Json) {
+                module.json = true;
+                module.esm = false;
+            } else if (parsed.kind == ModuleKind::Stylesheet) {
+                module.empty = true;
+            } else if (parsed.kind == ModuleKind::Asset) {
+                std::string url;
+                if (!emitAsset(module.file, module.source, url)) {
+                    return false;
+                }
+                module.source = Transforms::jsStringLiteral(url);
+                module.json = true;
+                module.esm = false;
+            }
+        }
+        return true;
+    }
+
+    // A file name for the chunk named after `module`: inline scripts are
+    // named after their page
+    std::string chunkStem(int module) const {
+        if (module < 0) {
+            return "runtime";
+        }
+        std::string name = modules[module].module.file.filename().string();
+        return fs::path(name.substr(0, name.find('?'))).stem().string();
+    }
+
+    // Minify chunks in place, one per task on the pool. A chunk that does
+    // not parse, because it holds a module the parser does not understand,
+    // stays as linked.
+    void minifyChunks(std::vector<std::string>& codes, const std::vector<Chunk>& chunks) {
+        auto started = std::chrono::steady_clock::now();
+        std::vector<std::string> errors(codes.size());
+        std::mutex statsMutex;
+        size_t workers = std::max<size_t>(1, std::min(threadCount, codes.size()));
+        WorkStealingPool<size_t> pool(workers);
+        for (size_t c = 0; c < codes.size(); ++c) {
+            result.minifyInputBytes += codes[c].size();
+            pool.push(c % workers, c);
+        }
+        pool.run([&](size_t, size_t& c) {
+            std::string minified;
+            {
+                Minifier minifier(codes[c]);
+                if (!minifier.minify(minified)) {
+                    errors[c] = minifier.error();
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(statsMutex);
+                result.renamedBindings += minifier.renamed;
+                result.foldedConstants += minifier.folded;
+                result.droppedBranches += minifier.dropped;
+            }
+            codes[c] = std::move(minified);
+        });
+        for (size_t c = 0; c < codes.size(); ++c) {
+            result.minifyOutputBytes += codes[c].size();
+            if (!errors[c].empty()) {
+                warn("Cannot minify the " + chunkStem(chunks[c].nameModule) + " chunk: " + errors[c]);
+            }
+        }
+        result.minifyMillis =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    // Link the scripts of all pages together, split into chunks, and write
+    // the chunks. A chunk's file name hashes its code and the names of the
+    // chunks it loads, so a change in any chunk renames every chunk that
+    // leads to it; the names of chunks that import() each other in a cycle
+    // hash all of the cycle's code.
+    bool emitScripts(const std::vector<std::string>& externalUrls) {
+        std::vector<int> entries;
+        for (const auto& page : pages) {
+            if (!page.scripts.empty()) {
+                entries.push_back(page.entry);
+            }
+        }
+        if (entries.empty()) {
+            return true;
+        }
+        std::vector<BundleModule> graph;
+        graph.reserve(modules.size());
+        for (const auto& parsed : modules) {
+            graph.push_back(parsed.module);
+        }
+        std::vector<ExternalModule> externals;
+        for (const auto& url : externalUrls) {
+            ExternalModule external;
+            external.path = url;
+            externals.push_back(external);
+        }
+        Bundler bundler(resolver, "production");
+        bundler.setTreeShaking(true);
+        bundler.setScopeHoisting(true);
+        const ChunkGraph& split = bundler.split(std::move(graph), std::move(externals), entries, minChunkSize);
+        result.shakenModules += bundler.shaking()->modulesRemoved;
+        result.shakenStatements += bundler.shaking()->statementsRemoved;
+        result.shakenBytes += bundler.shaking()->bytesRemoved;
+        result.chunks = split.chunks.size();
+        result.copiedModules = split.copiedModules;
+
+        const std::vector<Chunk>& chunks = split.chunks;
+        std::vector<std::string> codes;
+        for (const auto& chunk : chunks) {
+            codes.push_back(chunk.code);
+            result.sharedChunks += chunk.entryCount > 1;
+        }
+        if (minify) {
+            minifyChunks(codes, chunks);
+        }
+        std::vector<std::string> codeHashes;
+        for (const auto& code : codes) {
+            codeHashes.push_back(Hash::hex(Hash::xxh64(code)));
+        }
+        std::vector<std::string> names;
+        std::vector<std::string> urls;
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            std::vector<char> reached(chunks.size(), 0);
+            std::vector<size_t> stack = {c};
+            reached[c] = 1;
+            while (!stack.empty()) {
+                const Chunk& chunk = chunks[stack.back()];
+                stack.pop_back();
+                for (const auto* deps : {&chunk.imports, &chunk.dynamicImports}) {
+                    for (int dep : *deps) {
+                        if (!reached[dep]) {
+                            reached[dep] = 1;
+                            stack.push_back(dep);
+                        }
+                    }
+                }
+            }
+            std::string key;
+            for (size_t d = 0; d < chunks.size(); ++d) {
+                if (reached[d]) {
+                    key += codeHashes[d];
+                }
+            }
+            names.push_back("assets/" + chunkStem(chunks[c].nameModule) + "-" + contentHash(key) + ".js");
+            urls.push_back("./" + fs::path(names.back()).filename().string());
+        }
+        std::vector<std::string> written(chunks.size());
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            if (!write(names[c], ChunkGraph::fillPlaceholders(codes[c], urls), BuildOutput::Kind::Script,
+                       written[c])) {
+                return false;
+            }
+        }
+
+        for (auto& page : pages) {
+            if (page.scripts.empty()) {
+                continue;
+            }
+            int chunk = split.chunkOf[page.entry];
+            page.scriptUrl = written[chunk];
+            std::vector<char> reached(chunks.size(), 0);
+            std::vector<int> stack = {chunk};
+            while (!stack.empty()) {
+                const Chunk& from = chunks[stack.back()];
+                stack.pop_back();
+                for (int dep : from.imports) {
+                    if (!reached[dep]) {
+                        reached[dep] = 1;
+                        page.preloads.push_back(written[dep]);
+                        stack.push_back(dep);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // Write a page's stylesheet and rewrite the page to load it and its
+    // script
+    bool emitPage(Page& page) {
+        std::vector<int> order = evaluationOrder(page.entry);
+        std::string stem = page.file.stem().string();
+        std::string css;
+        // Stylesheets in evaluation order
+        for (int id : order) {
+            if (modules[id].kind == ModuleKind::Stylesheet) {
+                std::string sheet = modules[id].module.source;
+                if (!rewriteCssUrls(modules[id].module.file, sheet)) {
+                    return false;
+                }
+                css += sheet;
+                if (!css.empty() && css.back() != '\n') {
+                    css += '\n';
+                }
+            }
+        }
+
+        std::string html;
+        size_t copied = 0;
+        std::string cssUrl;
+        if (!css.empty() && !emit(stem, ".css", css, BuildOutput::Kind::Stylesheet, cssUrl)) {
+            return false;
+        }
+
+        // Linked stylesheets keep their place; the page's bundled script
+        // replaces its first module script and the others are dropped
+        std::vector<std::pair<PageTag, bool>> tags;
+        for (const auto& tag : page.scripts) {
+            tags.emplace_back(tag, true);
+        }
+        for (const auto& tag : page.stylesheets) {
+            tags.emplace_back(tag, false);
+        }
+        std::sort(tags.begin(), tags.end(), [](const std::pair<PageTag, bool>& a, const std::pair<PageTag, bool>& b) {
+            return a.first.start < b.first.start;
+        });
+        bool scriptWritten = false;
+        for (const auto& tag : tags) {
+            html.append(page.html, copied, tag.first.start - copied);
+            copied = tag.first.end;
+            if (tag.second) {
+                if (!scriptWritten) {
+                    html += "<script type=\"module\" crossorigin src=\"" + page.scriptUrl + "\"></script>";
+                    scriptWritten = true;
+                }
+                continue;
+            }
+            std::string sheet;
+            std::string url;
+            const fs::path& file = tag.first.stylesheet;
+            if (!StaticFiles::readFile(file, sheet)) {
+                return fail("Cannot read " + file.string());
+            }
+            if (!rewriteCssUrls(file, sheet) ||
+                !emit(file.stem().string(), ".css", sheet, BuildOutput::Kind::Stylesheet, url)) {
+                return false;
+            }
+            html += "<link rel=\"stylesheet\" crossorigin href=\"" + url + "\">";
+        }
+        html.append(page.html, copied, std::string::npos);
+        std::string links;
+        for (const auto& url : page.preloads) {
+            links += "<link rel=\"modulepreload\" crossorigin href=\"" + url + "\">\n";
+        }
+        if (!cssUrl.empty()) {
+            links += "<link rel=\"stylesheet\" crossorigin href=\"" + cssUrl + "\">\n";
+        }
+        if (!links.empty()) {
+            size_t head = html.find("</head>");
+            html.insert(head == std::string::npos ? 0 : head, links);
+        }
+
+        std::string name = page.file.filename().string();
+        if (!writeFile(outDir / name, html)) {
+            return fail("Cannot write " + (outDir / name).string());
+        }
+        result.outputs.push_back(BuildOutput{name, BuildOutput::Kind::Page, html.size()});
+        return true;
+    }
+
+    // Start from an empty output directory holding a copy of public/
+    bool prepareOutDir() {
+        std::error_code ec;
+        fs::path relative = root.lexically_relative(outDir);
+        if (outDir == root || (!relative.empty() && *relative.begin() != "..")) {
+            return fail("The output directory " + outDir.string() + " must not contain the project root");
+        }
+        fs::remove_all(outDir, ec);
+        fs::create_directories(outDir / "assets", ec);
+        if (ec) {
+            return fail("Cannot create " + outDir.string() + ": " + ec.message());
+        }
+        fs::path publicDir = root / "public";
+        if (fs::is_directory(publicDir, ec)) {
+            fs::copy(publicDir, outDir, fs::copy_options::recursive | fs::copy_options::overwrite_existing, ec);
+            if (ec) {
+                return fail("Cannot copy " + publicDir.string() + ": " + ec.message());
+            }
+        }
+        return true;
+    }
+
+public:
+    // `threads` = 0 uses one worker per hardware thread
+    BuildPipeline(const fs::path& rootDir, const fs::path& outputDir, ModuleResolver& moduleResolver,
+                  size_t threads = 0)
+        : root(fs::absolute(rootDir).lexically_normal()),
+          outDir(fs::absolute(outputDir).lexically_normal()),
+          resolver(moduleResolver),
+          threadCount(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+    // Copy shared chunks smaller than `bytes` of source that only pages
+    // share into those pages rather than loading them separately
+    void setMinChunkSize(size_t bytes) {
+        minChunkSize = bytes;
+    }
+
+    // Write the chunks as linked instead of minifying them
+    void setMinify(bool enabled) {
+        minify = enabled;
+    }
+
+    // Build every page of the project into the output directory. Errors
+    // are logged; false means the output is incomplete.
+    bool run(PhaseTimer& timer, ProgressBar& progress) {
+        timer.begin("Resolving entries");
+        progress.show(0.0, "Resolving entries");
+        std::error_code ec;
+        std::vector<fs::path> pageFiles;
+        for (const auto& entry : fs::directory_iterator(root, ec)) {
+            if (entry.path().extension() == ".html" && entry.is_regular_file(ec)) {
+                pageFiles.push_back(entry.path());
+            }
+        }
+        std::sort(pageFiles.begin(), pageFiles.end());
+        if (pageFiles.empty()) {
+            return fail("No index.html found in " + root.string());
+        }
+        std::vector<ParsedModule*> roots;
+        for (const auto& file : pageFiles) {
+            pages.emplace_back();
+            pages.back().file = file;
+            if (!loadPage(pages.back(), roots)) {
+                return false;
+            }
+        }
+
+        timer.begin("Parsing modules");
+        progress.show(0.2, "Parsing modules");
+        parseGraph(roots);
+        if (!numberModules(roots)) {
+            return false;
+        }
+        result.modules = modules.size();
+
+        timer.begin("Cleaning output directory");
+        progress.show(0.6, "Cleaning output directory");
+        if (!prepareOutDir()) {
+            return false;
+        }
+
+        timer.begin("Linking and writing chunks");
+        progress.show(0.7, "Linking and writing chunks");
+        std::vector<std::string> externalUrls;
+        if (!linkTargets(externalUrls)) {
+            return false;
+        }
+        if (!emitScripts(externalUrls)) {
+            return false;
+        }
+        for (auto& page : pages) {
+            if (!emitPage(page)) {
+                return false;
+            }
+        }
+        timer.end();
+        progress.show(1.0, "Done");
+        return true;
+    }
+
+    const BuildResult& output() const {
+        return result;
+    }
+};
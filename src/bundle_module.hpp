@@ -0,0 +1,127 @@
+#pragma once
+
+#include "import_scanner.hpp"
+#include "ast.hpp"
+#include "interner.hpp"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// A module imported from outside the bundle: the bundle imports `path`
+// and reaches it through a hoisted namespace import
+class ExternalModule {
+public:
+    std::string path;
+    // The external is a CommonJS module whose default export is its
+    // module.exports, which is what require() must return
+    bool commonJs = false;
+};
+
+// A module pulled into a bundle
+class BundleModule {
+public:
+    fs::path file;
+    std::string source;
+    ImportScan scan;
+    // Syntax tree, when the source parsed; shared by the copies of the
+    // module in each page's graph
+    std::shared_ptr<const Ast> ast;
+    bool esm = true;
+    bool json = false;
+    // False when the package.json of its package declares it free of side
+    // effects; nothing importing it then needs it unless it uses an export
+    bool sideEffects = true;
+    // Neither script nor JSON (stylesheets, images); contributes nothing
+    bool empty = false;
+    // Per entry of scan.imports and scan.requires: a module id, or a
+    // negative value -(k + 1) for external k; unresolved is INT_MIN
+    std::vector<int> importTargets;
+    std::vector<int> requireTargets;
+};
+
+// The bindings an ES module's import and export statements set up, by
+// name: what each imported local refers to, and what each export name
+// refers to
+class ModuleBindings {
+public:
+    // A local an import declaration creates: the import it came from and
+    // the name imported, "*" for a namespace
+    class Import {
+    public:
+        int importIndex = -1;
+        std::string imported;
+    };
+
+    // `export { imported as exported } from`, imported "*" for a namespace
+    class Reexport {
+    public:
+        int importIndex = -1;
+        std::string imported;
+        std::string exported;
+    };
+
+    std::unordered_map<Atom, Import> imports;
+    // Exported name -> local binding
+    std::unordered_map<std::string, Atom> exportLocals;
+    std::vector<Reexport> reexports;
+    // Import indexes of `export * from`
+    std::vector<int> stars;
+
+    // The local an `export default <expression>` or an anonymous default
+    // function or class declares. It is not an identifier, so no reference
+    // in the source can name it.
+    static Atom defaultLocal() {
+        static const Atom atom = intern("*default*");
+        return atom;
+    }
+
+    ModuleBindings() = default;
+
+    explicit ModuleBindings(const ImportScan& scan) {
+        using Kind = ModuleDeclaration::Kind;
+        for (const auto& decl : scan.declarations) {
+            switch (decl.kind) {
+                case Kind::Import:
+                    if (!decl.defaultBinding.empty()) {
+                        imports[intern(decl.defaultBinding)] = Import{decl.importIndex, "default"};
+                    }
+                    if (!decl.namespaceBinding.empty()) {
+                        imports[intern(decl.namespaceBinding)] = Import{decl.importIndex, "*"};
+                    }
+                    for (const auto& name : decl.names) {
+                        imports[intern(name.second)] = Import{decl.importIndex, name.first};
+                    }
+                    break;
+                case Kind::ExportFrom:
+                    for (const auto& name : decl.names) {
+                        reexports.push_back(Reexport{decl.importIndex, name.first, name.second});
+                    }
+                    if (!decl.namespaceBinding.empty()) {
+                        reexports.push_back(Reexport{decl.importIndex, "*", decl.namespaceBinding});
+                    }
+                    break;
+                case Kind::ExportAll:
+                    stars.push_back(decl.importIndex);
+                    break;
+                case Kind::ExportList:
+                    for (const auto& name : decl.names) {
+                        exportLocals[name.second] = intern(name.first);
+                    }
+                    break;
+                case Kind::ExportDeclaration:
+                    for (const auto& name : decl.names) {
+                        exportLocals[name.first] = intern(name.first);
+                    }
+                    break;
+                case Kind::ExportDefault:
+                    exportLocals["default"] = decl.defaultName.empty() ? defaultLocal() : intern(decl.defaultName);
+                    break;
+            }
+        }
+    }
+};
@@ -0,0 +1,1326 @@
+#pragma once
+
+#include "bundle_module.hpp"
+#include "tree_shaker.hpp"
+#include "scope.hpp"
+#include "chunk_graph.hpp"
+#include "resolver.hpp"
+#include "static_files.hpp"
+#include "transform.hpp"
+#include "logger.hpp"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <filesystem>
+#include <cctype>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+// Links a module graph into one ES module. Every module becomes a function
+// in a small registry and runs on first import, so evaluation order, cycles
+// and CommonJS modules behave as they do unbundled. Imported bindings are
+// read when the importing module starts rather than kept live, which only
+// differs for exports that are reassigned after a cycle reads them.
+//
+// With scope hoisting, ES modules that run at startup are instead
+// concatenated into the bundle's top-level scope in evaluation order, with
+// top-level bindings renamed where names collide and imported bindings
+// replaced by what they refer to, so they cost no function or lookup at
+// run time and imports stay live. CommonJS modules, modules loaded through
+// require() or only through import(), and modules that could not be parsed
+// keep their registry functions.
+//
+// split() links a graph with several entries into chunks instead: each
+// chunk is hoisted the same way and imports what it reads of other chunks
+// by name, and import() loads the chunk holding its target.
+class Bundler {
+private:
+    static constexpr int UNRESOLVED = -2147483647 - 1;
+
+    ModuleResolver& resolver;
+    std::string nodeEnv;
+    std::function<bool(const std::string&, const fs::path&, ExternalModule&)> externalFor;
+    std::vector<BundleModule> modules;
+    std::unordered_map<std::string, int> idsByFile;
+    std::vector<ExternalModule> externals;
+    std::map<std::string, int> externalIds;
+    bool treeShaking = false;
+    // What the last link keeps of each module, when tree shaking
+    std::unique_ptr<TreeShaker> shaker;
+    bool scopeHoisting = false;
+    // How the last link split the graph into chunks
+    std::unique_ptr<ChunkGraph> chunkGraph;
+
+    static bool isScript(const fs::path& file) {
+        std::string ext = file.extension().string();
+        return ext == ".js" || ext == ".mjs" || ext == ".cjs" || ext == ".jsx" || ext == ".ts" || ext == ".tsx" ||
+               ext == ".mts" || ext == ".cts";
+    }
+
+    int targetFor(const std::string& specifier, const fs::path& importer, std::vector<int>& pending) {
+        ExternalModule external;
+        if (externalFor && externalFor(specifier, importer, external)) {
+            auto it = externalIds.find(external.path);
+            if (it == externalIds.end()) {
+                it = externalIds.emplace(external.path, static_cast<int>(externals.size())).first;
+                externals.push_back(external);
+            }
+            return -(it->second + 1);
+        }
+        fs::path file = resolver.resolve(specifier, importer.parent_path());
+        if (file.empty()) {
+            return UNRESOLVED;
+        }
+        auto it = idsByFile.find(file.string());
+        if (it != idsByFile.end()) {
+            return it->second;
+        }
+        int id = static_cast<int>(modules.size());
+        idsByFile.emplace(file.string(), id);
+        modules.emplace_back();
+        modules.back().file = file;
+        pending.push_back(id);
+        return id;
+    }
+
+    bool load(const fs::path& entry) {
+        std::vector<int> pending = {0};
+        idsByFile.emplace(entry.string(), 0);
+        modules.emplace_back();
+        modules.back().file = entry;
+        while (!pending.empty()) {
+            int id = pending.back();
+            pending.pop_back();
+            BundleModule& module = modules[id];
+            if (!StaticFiles::readFile(module.file, module.source)) {
+                Logger::error("Cannot read " + module.file.string());
+                return false;
+            }
+            std::string ext = module.file.extension().string();
+            if (ext == ".json") {
+                module.json = true;
+                module.esm = false;
+                continue;
+            }
+            if (!isScript(module.file)) {
+                module.empty = true;
+                continue;
+            }
+            module.scan = ImportScanner::scan(module.source);
+            module.esm = module.scan.isEsm();
+            std::vector<int> importTargets;
+            std::vector<int> requireTargets;
+            fs::path file = module.file;
+            ImportScan scan = module.scan;
+            for (const auto& record : scan.imports) {
+                importTargets.push_back(targetFor(record.specifier, file, pending));
+            }
+            for (const auto& call : scan.requires) {
+                requireTargets.push_back(targetFor(call.specifier, file, pending));
+            }
+            // targetFor may have grown `modules`, so look the module up again
+            modules[id].importTargets = std::move(importTargets);
+            modules[id].requireTargets = std::move(requireTargets);
+        }
+        return true;
+    }
+
+    std::string namespaceOf(int target) const {
+        if (target == UNRESOLVED) {
+            return "__missing";
+        }
+        return target < 0 ? "__e" + std::to_string(-target - 1) : "__import(" + std::to_string(target) + ")";
+    }
+
+    std::string requireOf(int target) const {
+        if (target == UNRESOLVED) {
+            return "__missing";
+        }
+        if (target < 0) {
+            const ExternalModule& external = externals[-target - 1];
+            return "__e" + std::to_string(-target - 1) + (external.commonJs ? ".default" : "");
+        }
+        return "__require(" + std::to_string(target) + ")";
+    }
+
+    static bool isIdentifier(const std::string& name) {
+        static const std::set<std::string> reserved = {
+            "break", "case", "catch", "class", "const", "continue", "debugger", "default", "delete", "do",
+            "else", "enum", "export", "extends", "false", "finally", "for", "function", "if", "import", "in",
+            "instanceof", "new", "null", "return", "super", "switch", "this", "throw", "true", "try", "typeof",
+            "var", "void", "while", "with", "yield", "let", "static", "implements", "interface", "package",
+            "private", "protected", "public", "await", "arguments", "eval"};
+        if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0])) || reserved.count(name)) {
+            return false;
+        }
+        for (char c : name) {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '$') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Statically known export names of module `id`
+    void exportNames(int id, std::set<std::string>& names, std::set<int>& visited) const {
+        if (id < 0 || !visited.insert(id).second) {
+            return;
+        }
+        const BundleModule& module = modules[id];
+        if (module.json || module.empty) {
+            return;
+        }
+        if (!module.esm) {
+            names.insert(module.scan.cjsExports.begin(), module.scan.cjsExports.end());
+            for (const auto& reexported : module.scan.cjsReexports) {
+                for (size_t i = 0; i < module.scan.requires.size(); ++i) {
+                    if (module.scan.requires[i].specifier == reexported) {
+                        std::set<int> nested = visited;
+                        exportNames(module.requireTargets[i], names, nested);
+                    }
+                }
+            }
+            return;
+        }
+        for (const auto& decl : module.scan.declarations) {
+            using Kind = ModuleDeclaration::Kind;
+            switch (decl.kind) {
+                case Kind::Import:
+                    break;
+                case Kind::ExportDefault:
+                    names.insert("default");
+                    break;
+                case Kind::ExportAll: {
+                    std::set<std::string> reexported;
+                    exportNames(module.importTargets[decl.importIndex], reexported, visited);
+                    reexported.erase("default");
+                    names.insert(reexported.begin(), reexported.end());
+                    break;
+                }
+                default:
+                    for (const auto& name : decl.names) {
+                        names.insert(name.second);
+                    }
+                    if (!decl.namespaceBinding.empty()) {
+                        names.insert(decl.namespaceBinding);
+                    }
+                    break;
+            }
+        }
+    }
+
+    class Edit {
+    public:
+        size_t start;
+        size_t end;
+        std::string text;
+    };
+
+    static std::string applyEdits(const std::string& source, std::vector<Edit>& edits) {
+        std::sort(edits.begin(), edits.end(), [](const Edit& a, const Edit& b) { return a.start < b.start; });
+        std::string out;
+        out.reserve(source.size() + 256);
+        size_t copied = 0;
+        for (const auto& edit : edits) {
+            if (edit.start < copied) {
+                continue;
+            }
+            out.append(source, copied, edit.start - copied);
+            out += edit.text;
+            copied = edit.end;
+        }
+        out.append(source, copied, std::string::npos);
+        return out;
+    }
+
+    // Replace process.env.NODE_ENV, which browser builds of packages branch
+    // on, outside the ranges already being rewritten
+    void defineNodeEnv(const std::string& source, std::vector<Edit>& edits) const {
+        static const std::string key = "process.env.NODE_ENV";
+        for (size_t at = source.find(key); at != std::string::npos; at = source.find(key, at + key.size())) {
+            bool overlaps = false;
+            for (const auto& edit : edits) {
+                overlaps = overlaps || (at < edit.end && at + key.size() > edit.start);
+            }
+            if (!overlaps) {
+                edits.push_back(Edit{at, at + key.size(), Transforms::jsStringLiteral(nodeEnv)});
+            }
+        }
+    }
+
+    // Blank out `ranges`, dropping the edits inside them
+    static void removeRanges(std::vector<Edit>& edits, const std::vector<std::pair<uint32_t, uint32_t>>& ranges) {
+        if (ranges.empty()) {
+            return;
+        }
+        edits.erase(std::remove_if(edits.begin(), edits.end(),
+                                   [&](const Edit& edit) {
+                                       for (const auto& range : ranges) {
+                                           if (edit.start >= range.first && edit.end <= range.second) {
+                                               return true;
+                                           }
+                                       }
+                                       return false;
+                                   }),
+                    edits.end());
+        for (const auto& range : ranges) {
+            edits.push_back(Edit{range.first, range.second, ""});
+        }
+    }
+
+    // Where the name of `export default function () {}` or
+    // `export default class {}` would go
+    static size_t anonymousNameAt(const std::string& source, const ModuleDeclaration& decl) {
+        size_t p = decl.end;
+        if (source.compare(p, 5, "async") == 0) {
+            p = source.find("function", p);
+        }
+        p += source.compare(p, 5, "class") == 0 ? 5 : 8;
+        while (p < source.size() && (std::isspace(static_cast<unsigned char>(source[p])) || source[p] == '*')) {
+            ++p;
+        }
+        return p;
+    }
+
+    bool included(int id) const {
+        return id < 0 || !shaker || shaker->usage(id).included;
+    }
+
+    std::string emitEsm(int id) const {
+        const BundleModule& module = modules[id];
+        const ImportScan& scan = module.scan;
+        const TreeShaker::ModuleUsage& usage = shaker ? shaker->usage(id) : TreeShaker::ModuleUsage::whole();
+        std::vector<Edit> edits;
+        std::vector<std::string> getters;
+        std::vector<std::string> reexports;
+        std::string prologue;
+        std::set<int> loaded;
+        auto ns = [&](int importIndex) {
+            int target = module.importTargets[importIndex];
+            if (!included(target)) {
+                // Shaken out: nothing reads from it
+                return std::string("__missing");
+            }
+            if (target < 0 || loaded.count(target)) {
+                return target < 0 ? namespaceOf(target) : "__i" + std::to_string(target);
+            }
+            loaded.insert(target);
+            prologue += "const __i" + std::to_string(target) + " = __import(" + std::to_string(target) + ");\n";
+            return "__i" + std::to_string(target);
+        };
+
+        for (const auto& decl : scan.declarations) {
+            using Kind = ModuleDeclaration::Kind;
+            if (decl.kind == Kind::Import) {
+                std::string from = ns(decl.importIndex);
+                if (!decl.defaultBinding.empty() && usage.keepsBinding(decl.defaultBinding)) {
+                    prologue += "const " + decl.defaultBinding + " = " + from + ".default;\n";
+                }
+                if (!decl.namespaceBinding.empty() && usage.keepsBinding(decl.namespaceBinding)) {
+                    prologue += "const " + decl.namespaceBinding + " = " + from + ";\n";
+                }
+                std::string pattern;
+                for (const auto& name : decl.names) {
+                    if (usage.keepsBinding(name.second)) {
+                        pattern += (pattern.empty() ? "" : ", ") + Transforms::jsStringLiteral(name.first) + ": " +
+                                   name.second;
+                    }
+                }
+                if (!pattern.empty()) {
+                    prologue += "const { " + pattern + " } = " + from + ";\n";
+                }
+                if (decl.defaultBinding.empty() && decl.namespaceBinding.empty() && decl.names.empty() &&
+                    module.importTargets[decl.importIndex] >= 0) {
+                    // Side-effect import: loading is the point
+                    ns(decl.importIndex);
+                }
+                edits.push_back(Edit{decl.start, decl.end, ""});
+            } else if (decl.kind == Kind::ExportFrom) {
+                std::string from = ns(decl.importIndex);
+                for (const auto& name : decl.names) {
+                    if (usage.keepsExport(name.second)) {
+                        getters.push_back(Transforms::jsStringLiteral(name.second) + ": () => " + from + "[" +
+                                          Transforms::jsStringLiteral(name.first) + "]");
+                    }
+                }
+                if (!decl.namespaceBinding.empty() && usage.keepsExport(decl.namespaceBinding)) {
+                    getters.push_back(Transforms::jsStringLiteral(decl.namespaceBinding) + ": () => " + from);
+                }
+                edits.push_back(Edit{decl.start, decl.end, ""});
+            } else if (decl.kind == Kind::ExportAll) {
+                if (included(module.importTargets[decl.importIndex])) {
+                    reexports.push_back(ns(decl.importIndex));
+                }
+                edits.push_back(Edit{decl.start, decl.end, ""});
+            } else if (decl.kind == Kind::ExportList) {
+                for (const auto& name : decl.names) {
+                    if (usage.keepsExport(name.second)) {
+                        getters.push_back(Transforms::jsStringLiteral(name.second) + ": () => " + name.first);
+                    }
+                }
+                edits.push_back(Edit{decl.start, decl.end, ""});
+            } else if (decl.kind == Kind::ExportDeclaration) {
+                for (const auto& name : decl.names) {
+                    if (usage.keepsExport(name.first)) {
+                        getters.push_back(Transforms::jsStringLiteral(name.first) + ": () => " + name.first);
+                    }
+                }
+                edits.push_back(Edit{decl.start, decl.end, ""});
+            } else if (decl.kind == Kind::ExportDefault) {
+                bool kept = usage.keepsExport("default");
+                if (!decl.defaultIsDeclaration) {
+                    edits.push_back(Edit{decl.start, decl.end, "const __default = "});
+                    if (kept) {
+                        getters.push_back("default: () => __default");
+                    }
+                } else if (!decl.defaultName.empty()) {
+                    edits.push_back(Edit{decl.start, decl.end, ""});
+                    if (kept) {
+                        getters.push_back("default: () => " + decl.defaultName);
+                    }
+                } else {
+                    // Name the anonymous declaration so it stays hoisted
+                    size_t p = anonymousNameAt(module.source, decl);
+                    edits.push_back(Edit{decl.start, decl.end, ""});
+                    edits.push_back(Edit{p, p, " __default "});
+                    if (kept) {
+                        getters.push_back("default: () => __default");
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < scan.imports.size(); ++i) {
+            const ImportRecord& record = scan.imports[i];
+            if (record.dynamic && record.callEnd > 0) {
+                int target = module.importTargets[i];
+                std::string loaded = target >= 0 ? chunkLoad(id, target) + ".then(() => __import(" + std::to_string(target) + "))"
+                                                 : "Promise.resolve(" + namespaceOf(target) + ")";
+                edits.push_back(Edit{record.callStart, record.callEnd, loaded});
+            }
+        }
+        for (size_t i = 0; i < scan.requires.size(); ++i) {
+            edits.push_back(Edit{scan.requires[i].start, scan.requires[i].end, requireOf(module.requireTargets[i])});
+        }
+        removeRanges(edits, usage.removed);
+        defineNodeEnv(module.source, edits);
+
+        std::string head;
+        if (!getters.empty()) {
+            head = "__export(__ns, {";
+            for (size_t i = 0; i < getters.size(); ++i) {
+                head += (i ? ", " : " ") + getters[i];
+            }
+            head += " });\n";
+        }
+        std::string tail;
+        for (const auto& from : reexports) {
+            tail += "__reexport(__ns, " + from + ");\n";
+        }
+        return "{ esm: true, init: function (__ns) {\n" + head + prologue + tail +
+               applyEdits(module.source, edits) + "\n} }";
+    }
+
+    std::string emitCommonJs(int id) const {
+        const BundleModule& module = modules[id];
+        if (module.json) {
+            return "{ esm: false, init: function (module) {\nmodule.exports = " + module.source + ";\n} }";
+        }
+        std::vector<Edit> edits;
+        for (size_t i = 0; i < module.scan.requires.size(); ++i) {
+            const RequireCall& call = module.scan.requires[i];
+            edits.push_back(Edit{call.start, call.end, requireOf(module.requireTargets[i])});
+        }
+        for (size_t i = 0; i < module.scan.imports.size(); ++i) {
+            const ImportRecord& record = module.scan.imports[i];
+            if (record.dynamic && record.callEnd > 0 && module.importTargets[i] >= 0) {
+                edits.push_back(Edit{record.callStart, record.callEnd,
+                                     chunkLoad(id, module.importTargets[i]) + ".then(() => __import(" +
+                                     std::to_string(module.importTargets[i]) + "))"});
+            }
+        }
+        defineNodeEnv(module.source, edits);
+        return "{ esm: false, init: function (module, exports, require) {\n" + applyEdits(module.source, edits) +
+               "\n} }";
+    }
+
+    // A piece of the runtime: the registry or one of its helpers
+    struct Helper {
+        const char* name;
+        // Helpers it calls, all listed before it
+        std::vector<const char*> calls;
+        const char* code;
+    };
+
+    static const std::vector<Helper>& helpers() {
+        static const std::vector<Helper> all = {
+            {"__modules", {}, "const __modules = [];\n"},
+            {"__missing", {}, "const __missing = Object.freeze(Object.create(null));\n"},
+            {"__export", {}, R"JS(function __export(ns, getters) {
+  for (const name in getters) {
+    Object.defineProperty(ns, name, { enumerable: true, get() {
+      try { return getters[name](); } catch (e) { if (e instanceof ReferenceError) return undefined; throw e; }
+    } });
+  }
+}
+)JS"},
+            {"__reexport", {}, R"JS(function __reexport(ns, from) {
+  for (const name of Object.keys(from)) {
+    if (name !== 'default' && !(name in ns)) Object.defineProperty(ns, name, { enumerable: true, get: () => from[name] });
+  }
+}
+)JS"},
+            {"__namespace", {"__export"}, R"JS(function __namespace(getters) {
+  const ns = Object.create(null);
+  Object.defineProperty(ns, '__esModule', { value: true });
+  Object.defineProperty(ns, Symbol.toStringTag, { value: 'Module' });
+  __export(ns, getters);
+  return ns;
+}
+)JS"},
+            {"__dynamicRequire", {}, R"JS(function __dynamicRequire(id) {
+  throw new Error('Could not resolve require("' + id + '") while bundling');
+}
+)JS"},
+            {"__load", {"__modules", "__namespace", "__dynamicRequire"}, R"JS(function __load(id) {
+  const m = __modules[id];
+  if (!m.loaded) {
+    m.loaded = true;
+    if (m.esm) {
+      m.ns = __namespace({});
+      m.init(m.ns);
+    } else {
+      m.module = { exports: {} };
+      m.init(m.module, m.module.exports, __dynamicRequire);
+    }
+  }
+  return m;
+}
+)JS"},
+            {"__require", {"__load"}, R"JS(function __require(id) {
+  const m = __load(id);
+  return m.esm ? m.ns : m.module.exports;
+}
+)JS"},
+            {"__import", {"__load"}, R"JS(function __import(id) {
+  const m = __load(id);
+  if (m.esm) return m.ns;
+  if (!m.interop) {
+    const e = m.module.exports;
+    if (e && e.__esModule) return e;
+    const ns = Object.create(null);
+    if (e !== null && (typeof e === 'object' || typeof e === 'function')) {
+      for (const name of Object.keys(e)) Object.defineProperty(ns, name, { enumerable: true, get: () => e[name] });
+    }
+    ns.default = e;
+    m.interop = ns;
+  }
+  return m.interop;
+}
+)JS"}};
+        return all;
+    }
+
+    // The runtime names `code` refers to. A name inside a string or comment
+    // counts too, which at worst keeps a helper nothing calls.
+    static std::set<std::string> helpersIn(const std::string& code) {
+        auto identifierChar = [](char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+        };
+        std::set<std::string> used;
+        for (const Helper& helper : helpers()) {
+            size_t length = std::strlen(helper.name);
+            for (size_t at = code.find(helper.name); at != std::string::npos; at = code.find(helper.name, at + 1)) {
+                if ((at == 0 || !identifierChar(code[at - 1])) &&
+                    (at + length == code.size() || !identifierChar(code[at + length]))) {
+                    used.insert(helper.name);
+                    break;
+                }
+            }
+        }
+        return used;
+    }
+
+    // The helpers in `used` and those they call
+    static std::string runtime(const std::set<std::string>& used) {
+        const std::vector<Helper>& all = helpers();
+        std::set<std::string> needed = used;
+        for (size_t i = all.size(); i-- > 0;) {
+            if (needed.count(all[i].name)) {
+                needed.insert(all[i].calls.begin(), all[i].calls.end());
+            }
+        }
+        std::string out;
+        for (const Helper& helper : all) {
+            if (needed.count(helper.name)) {
+                out += helper.code;
+            }
+        }
+        return out;
+    }
+
+public:
+    explicit Bundler(ModuleResolver& moduleResolver, const std::string& nodeEnvValue = "development")
+        : resolver(moduleResolver), nodeEnv(nodeEnvValue) {}
+
+    // Decide which specifiers stay imports of another bundle instead of
+    // being inlined
+    void setExternals(std::function<bool(const std::string&, const fs::path&, ExternalModule&)> external) {
+        externalFor = std::move(external);
+    }
+
+    // Leave out the modules and top-level statements the entry cannot
+    // reach through used exports or side effects
+    void setTreeShaking(bool enabled) {
+        treeShaking = enabled;
+    }
+
+    // Concatenate ES modules into one scope instead of wrapping each in a
+    // registry function
+    void setScopeHoisting(bool enabled) {
+        scopeHoisting = enabled;
+    }
+
+    // Bundle everything reachable from `entry` into one ES module that
+    // re-exports the entry's exports. Returns false when the entry or a
+    // module it needs cannot be read.
+    bool bundle(const fs::path& entry, std::string& out) {
+        modules.clear();
+        idsByFile.clear();
+        externals.clear();
+        externalIds.clear();
+        if (!load(entry)) {
+            return false;
+        }
+        shaker = treeShaking ? std::make_unique<TreeShaker>(modules, true) : nullptr;
+        emit(true, out);
+        return true;
+    }
+
+    // Link a graph someone else loaded, module 0 being the entry, with
+    // negative targets naming `externalModules`. An entry that is not
+    // exported only runs, as an application entry does.
+    void link(std::vector<BundleModule> graph, std::vector<ExternalModule> externalModules, bool exportEntry,
+              std::string& out) {
+        modules = std::move(graph);
+        externals = std::move(externalModules);
+        idsByFile.clear();
+        externalIds.clear();
+        shaker = treeShaking ? std::make_unique<TreeShaker>(modules, exportEntry) : nullptr;
+        emit(exportEntry, out);
+    }
+
+    // Link a graph with several entries, such as the pages of an app, into
+    // chunks: one per entry and per import() target, and one per set of
+    // them sharing modules (see ChunkGraph). Modules and externals are as
+    // for link(); entries only run. Chunks name each other by
+    // ChunkGraph::placeholder() until the caller knows their file names.
+    const ChunkGraph& split(std::vector<BundleModule> graph, std::vector<ExternalModule> externalModules,
+                            const std::vector<int>& entries, size_t minChunkSize) {
+        modules = std::move(graph);
+        externals = std::move(externalModules);
+        idsByFile.clear();
+        externalIds.clear();
+        shaker = treeShaking ? std::make_unique<TreeShaker>(modules, entries, false) : nullptr;
+        warnUnresolved();
+        chunkGraph = std::make_unique<ChunkGraph>(modules, entries, [this](int id) { return included(id); },
+                                                  minChunkSize);
+        emitChunks(false, *chunkGraph);
+        return *chunkGraph;
+    }
+
+private:
+    // What a chunk reads from the other chunks of a link and what they read
+    // from it, by top-level name
+    struct ChunkLinks {
+        std::map<int, std::set<std::string>> imports;
+        std::set<std::string> exports;
+    };
+
+    // How one link lays the graph out when hoisting scopes
+    struct Hoisting {
+        const ChunkGraph* graph = nullptr;
+        // Modules that run when their chunk loads, dependencies first, the
+        // way ES modules evaluate
+        std::vector<int> order;
+        std::vector<char> hoisted;
+        std::vector<std::unique_ptr<ScopeAnalysis>> scopes;
+        std::vector<ModuleBindings> bindings;
+        // Final name of each top-level binding of a hoisted module
+        std::vector<std::unordered_map<Atom, std::string>> names;
+        // Hoisted modules registry modules import, which the registry must
+        // know too
+        std::vector<char> registered;
+        // Namespace objects to create, as (chunk, module)
+        std::set<std::pair<int, int>> namespaced;
+        std::deque<std::pair<int, int>> pendingNamespaces;
+        // Static export names, filled in on demand
+        std::vector<std::unique_ptr<std::set<std::string>>> exported;
+        std::vector<ChunkLinks> links;
+        // The chunk whose code is being generated
+        int chunk = 0;
+
+        // The chunk the current one finds module `id` in
+        int chunkOf(int id) const {
+            return graph->chunks[chunk].contains(id) ? chunk : graph->chunkOf[id];
+        }
+    };
+
+    // What a reference to an imported binding becomes
+    struct Resolved {
+        std::string expression;
+        // A property read, which as a callee would pass the namespace as
+        // `this`
+        bool member = false;
+    };
+
+    // Names the bundle's own code declares or reads at the top level
+    static bool generatedName(const std::string& name) {
+        size_t digits = name.compare(0, 4, "__ns") == 0                                        ? 4
+                        : name.compare(0, 3, "__i") == 0 || name.compare(0, 3, "__e") == 0 ? 3
+                                                                                             : 0;
+        return digits && name.size() > digits &&
+               std::all_of(name.begin() + digits, name.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+    }
+
+    // `base.name`, or `base["name"]` when the name is not an identifier
+    static std::string memberOf(const std::string& base, const std::string& name) {
+        bool plain = !name.empty() && !std::isdigit(static_cast<unsigned char>(name[0])) &&
+                     std::all_of(name.begin(), name.end(), [](char c) {
+                         return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+                     });
+        return plain ? base + "." + name : base + "[" + Transforms::jsStringLiteral(name) + "]";
+    }
+
+    static bool inRanges(const std::vector<std::pair<uint32_t, uint32_t>>& ranges, uint32_t at) {
+        auto it = std::upper_bound(ranges.begin(), ranges.end(), std::make_pair(at, UINT32_MAX));
+        return it != ranges.begin() && at < std::prev(it)->second;
+    }
+
+    const TreeShaker::ModuleUsage& usageOf(int id) const {
+        return shaker ? shaker->usage(id) : TreeShaker::ModuleUsage::whole();
+    }
+
+    // Decide which modules are concatenated: ES modules with a syntax tree
+    // that run when their chunk loads. Modules require() loads run when
+    // they are called, and so stay in the registry, as do CommonJS modules
+    // and, without chunks of their own, modules only import() reaches.
+    void planHoisting(Hoisting& h) const {
+        size_t count = modules.size();
+        h.hoisted.assign(count, 0);
+        h.scopes.resize(count);
+        h.bindings.resize(count);
+        h.names.resize(count);
+        h.registered.assign(count, 0);
+        h.exported.resize(count);
+
+        std::vector<char> lazy(count, 0);
+        for (size_t id = 0; id < count; ++id) {
+            if (included(static_cast<int>(id))) {
+                for (int target : modules[id].requireTargets) {
+                    if (target >= 0) {
+                        lazy[target] = 1;
+                    }
+                }
+            }
+        }
+
+        // Depth-first over static imports from each entry; a module is done
+        // once all of its imports are
+        std::vector<char> visited(count, 0);
+        std::vector<std::pair<int, size_t>> stack;
+        auto visit = [&](int id) {
+            if (id >= 0 && included(id) && !visited[id]) {
+                visited[id] = 1;
+                stack.emplace_back(id, 0);
+            }
+        };
+        for (size_t k = 0; k < h.graph->entries.size(); ++k) {
+            // An import() target that require() loads too runs when required
+            if (k > 0 && lazy[h.graph->entries[k]]) {
+                continue;
+            }
+            visit(h.graph->entries[k]);
+            while (!stack.empty()) {
+                int id = stack.back().first;
+                size_t next = stack.back().second;
+                const BundleModule& module = modules[id];
+                if (module.esm && !lazy[id] && next < module.scan.imports.size()) {
+                    stack.back().second = next + 1;
+                    if (!module.scan.imports[next].dynamic) {
+                        visit(module.importTargets[next]);
+                    }
+                    continue;
+                }
+                h.order.push_back(id);
+                stack.pop_back();
+            }
+        }
+
+        for (int id : h.order) {
+            const BundleModule& module = modules[id];
+            if (!scopeHoisting || !module.esm || !module.ast || module.empty || module.json || lazy[id]) {
+                continue;
+            }
+            auto scope = std::make_unique<ScopeAnalysis>(*module.ast);
+            if (scope->directEval) {
+                continue;
+            }
+            h.scopes[id] = std::move(scope);
+            h.bindings[id] = ModuleBindings(module.scan);
+            h.hoisted[id] = 1;
+        }
+        // `export *` from a module outside the concatenation exports names
+        // known only at run time
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (int id : h.order) {
+                if (!h.hoisted[id]) {
+                    continue;
+                }
+                for (int star : h.bindings[id].stars) {
+                    int target = modules[id].importTargets[star];
+                    if (target != UNRESOLVED &&
+                        (target < 0 || (included(target) && !modules[target].empty && !h.hoisted[target]))) {
+                        h.hoisted[id] = 0;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+        // Registry modules reach hoisted ones through __import()
+        for (size_t id = 0; id < count; ++id) {
+            if (!included(static_cast<int>(id)) || h.hoisted[id]) {
+                continue;
+            }
+            for (const auto* targets : {&modules[id].importTargets, &modules[id].requireTargets}) {
+                for (int target : *targets) {
+                    if (target >= 0 && h.hoisted[target]) {
+                        h.registered[target] = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    // Give every top-level binding of the hoisted modules a name no other
+    // binding, global or nested declaration of the bundle uses. Bindings
+    // keep their own name when they can and get a `$n` suffix otherwise.
+    void assignNames(Hoisting& h) const {
+        std::unordered_set<std::string> reserved = {
+            "__modules", "__missing", "__export", "__reexport", "__dynamicRequire", "__load", "__require",
+            "__import", "__namespace", "__entry", "Object", "Symbol", "Promise", "Error", "ReferenceError"};
+        for (size_t id = 0; id < modules.size(); ++id) {
+            const BundleModule& module = modules[id];
+            if (!included(static_cast<int>(id)) || module.empty || module.json) {
+                continue;
+            }
+            if (h.hoisted[id]) {
+                for (Atom name : h.scopes[id]->freeNames) {
+                    reserved.insert(name.str());
+                }
+                for (Atom name : h.scopes[id]->nestedNames) {
+                    reserved.insert(name.str());
+                }
+                continue;
+            }
+            // Registry modules are not analyzed; any identifier in them
+            // may be a global they read
+            Lexer lexer(module.source);
+            for (Token token = lexer.next(); token.kind != TokenKind::End; token = lexer.next()) {
+                if (token.kind == TokenKind::Identifier) {
+                    reserved.emplace(module.source, token.start, token.end - token.start);
+                }
+            }
+        }
+
+        std::unordered_set<std::string> assigned;
+        auto claim = [&](const std::string& base) {
+            std::string name = base;
+            for (int n = 1; reserved.count(name) || assigned.count(name) || generatedName(name); ++n) {
+                name = base + "$" + std::to_string(n);
+            }
+            assigned.insert(name);
+            return name;
+        };
+        for (int id : h.order) {
+            if (!h.hoisted[id]) {
+                continue;
+            }
+            // In source order, so names do not depend on hash order
+            std::vector<std::pair<uint32_t, Atom>> declared;
+            for (const auto& binding : h.scopes[id]->topLevel) {
+                if (!h.bindings[id].imports.count(binding.first)) {
+                    declared.emplace_back(binding.second.empty() ? 0 : binding.second.front().start, binding.first);
+                }
+            }
+            std::sort(declared.begin(), declared.end(),
+                      [](const std::pair<uint32_t, Atom>& a, const std::pair<uint32_t, Atom>& b) {
+                          return a.first != b.first ? a.first < b.first : a.second.view() < b.second.view();
+                      });
+            for (const auto& binding : declared) {
+                h.names[id][binding.second] = claim(binding.second.str());
+            }
+            auto exportedDefault = h.bindings[id].exportLocals.find("default");
+            if (exportedDefault != h.bindings[id].exportLocals.end() &&
+                exportedDefault->second == ModuleBindings::defaultLocal()) {
+                std::string base = modules[id].file.stem().string();
+                for (char& c : base) {
+                    c = std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+                }
+                if (base.empty() || std::isdigit(static_cast<unsigned char>(base[0]))) {
+                    base = "_" + base;
+                }
+                h.names[id][exportedDefault->second] = claim(base + "_default");
+            }
+        }
+    }
+
+    // Read `symbol`, a top-level name of chunk `owner`, from the current
+    // chunk
+    static void readFrom(Hoisting& h, int owner, const std::string& symbol) {
+        if (owner >= 0 && owner != h.chunk) {
+            h.links[h.chunk].imports[owner].insert(symbol);
+            h.links[owner].exports.insert(symbol);
+        }
+    }
+
+    // Have the chunk holding hoisted module `id` create its namespace
+    // object; returns that chunk
+    static int requireNamespace(Hoisting& h, int id) {
+        int owner = h.chunkOf(id);
+        if (h.namespaced.emplace(owner, id).second) {
+            h.pendingNamespaces.emplace_back(owner, id);
+        }
+        return owner;
+    }
+
+    const std::set<std::string>& exportedNames(Hoisting& h, int id) const {
+        if (!h.exported[id]) {
+            h.exported[id] = std::make_unique<std::set<std::string>>();
+            std::set<int> visited;
+            exportNames(id, *h.exported[id], visited);
+        }
+        return *h.exported[id];
+    }
+
+    // What export `name` of hoisted module `id` refers to
+    Resolved resolveExport(Hoisting& h, int id, const std::string& name,
+                           std::set<std::pair<int, std::string>>& visiting) const {
+        if (!visiting.emplace(id, name).second) {
+            return Resolved{"void 0", false};
+        }
+        const ModuleBindings& bindings = h.bindings[id];
+        auto local = bindings.exportLocals.find(name);
+        if (local != bindings.exportLocals.end()) {
+            auto imported = bindings.imports.find(local->second);
+            if (imported != bindings.imports.end()) {
+                return resolveImport(h, id, imported->second, visiting);
+            }
+            auto renamed = h.names[id].find(local->second);
+            std::string symbol = renamed != h.names[id].end() ? renamed->second : local->second.str();
+            readFrom(h, h.chunkOf(id), symbol);
+            return Resolved{symbol, false};
+        }
+        for (const auto& reexport : bindings.reexports) {
+            if (reexport.exported == name) {
+                return resolveImport(h, id, ModuleBindings::Import{reexport.importIndex, reexport.imported}, visiting);
+            }
+        }
+        if (name != "default") {
+            for (int star : bindings.stars) {
+                int target = modules[id].importTargets[star];
+                if (target >= 0 && included(target) && h.hoisted[target] && exportedNames(h, target).count(name)) {
+                    return resolveExport(h, target, name, visiting);
+                }
+            }
+        }
+        return Resolved{"void 0", false};
+    }
+
+    // What an import binding of hoisted module `id` refers to
+    Resolved resolveImport(Hoisting& h, int id, const ModuleBindings::Import& binding,
+                           std::set<std::pair<int, std::string>>& visiting) const {
+        int target = modules[id].importTargets[binding.importIndex];
+        bool whole = binding.imported == "*";
+        if (target == UNRESOLVED || (target >= 0 && (!included(target) || modules[target].empty))) {
+            return Resolved{whole ? "__missing" : "void 0", false};
+        }
+        if (target >= 0 && h.hoisted[target]) {
+            if (whole) {
+                std::string ns = "__ns" + std::to_string(target);
+                readFrom(h, requireNamespace(h, target), ns);
+                return Resolved{ns, false};
+            }
+            return resolveExport(h, target, binding.imported, visiting);
+        }
+        std::string ns;
+        if (target < 0) {
+            ns = namespaceOf(target);
+        } else {
+            ns = "__i" + std::to_string(target);
+            readFrom(h, h.chunkOf(target), ns);
+        }
+        return whole ? Resolved{ns, false} : Resolved{memberOf(ns, binding.imported), true};
+    }
+
+    // What an import() of `target` in `importer` waits for before reading
+    // the registry: the chunk holding the target, when that is another
+    std::string chunkLoad(int importer, int target) const {
+        int owner = chunkGraph ? chunkGraph->chunkOf[target] : -1;
+        if (owner < 0 || owner == chunkGraph->chunkOf[importer]) {
+            return "Promise.resolve()";
+        }
+        return "import(" + ChunkGraph::placeholder(owner) + ")";
+    }
+
+    // The code of a hoisted module with its import and export statements
+    // removed and its top-level bindings renamed
+    std::string emitHoisted(Hoisting& h, int id) const {
+        const BundleModule& module = modules[id];
+        const ImportScan& scan = module.scan;
+        const TreeShaker::ModuleUsage& usage = usageOf(id);
+        const auto& names = h.names[id];
+        std::vector<Edit> edits;
+        for (const auto& decl : scan.declarations) {
+            if (decl.kind != ModuleDeclaration::Kind::ExportDefault || decl.defaultIsDeclaration) {
+                edits.push_back(Edit{decl.start, decl.end, ""});
+                if (decl.kind == ModuleDeclaration::Kind::ExportDefault && decl.defaultName.empty()) {
+                    size_t p = anonymousNameAt(module.source, decl);
+                    edits.push_back(Edit{p, p, " " + names.at(ModuleBindings::defaultLocal()) + " "});
+                }
+            } else {
+                edits.push_back(Edit{decl.start, decl.end, "const " + names.at(ModuleBindings::defaultLocal()) + " = "});
+            }
+        }
+
+        for (const auto& binding : h.scopes[id]->topLevel) {
+            std::vector<const BindingUse*> uses;
+            for (const auto& use : binding.second) {
+                if (!inRanges(usage.removed, use.start)) {
+                    uses.push_back(&use);
+                }
+            }
+            if (uses.empty()) {
+                continue;
+            }
+            Resolved to;
+            auto imported = h.bindings[id].imports.find(binding.first);
+            if (imported != h.bindings[id].imports.end()) {
+                std::set<std::pair<int, std::string>> visiting;
+                to = resolveImport(h, id, imported->second, visiting);
+            } else {
+                to.expression = names.at(binding.first);
+                if (to.expression == binding.first.view()) {
+                    continue;
+                }
+            }
+            for (const BindingUse* use : uses) {
+                std::string text = use->callee && to.member ? "(0, " + to.expression + ")" : to.expression;
+                edits.push_back(Edit{use->start, use->end, use->shorthand ? binding.first.str() + ": " + text : text});
+            }
+        }
+
+        for (size_t i = 0; i < scan.imports.size(); ++i) {
+            const ImportRecord& record = scan.imports[i];
+            if (!record.dynamic || record.callEnd == 0 || inRanges(usage.removed, record.callStart)) {
+                continue;
+            }
+            int target = module.importTargets[i];
+            std::string loaded;
+            if (target >= 0 && h.hoisted[target]) {
+                int owner = requireNamespace(h, target);
+                std::string ns = "__ns" + std::to_string(target);
+                if (owner == h.chunk) {
+                    loaded = "Promise.resolve().then(() => " + ns + ")";
+                } else {
+                    h.links[owner].exports.insert(ns);
+                    loaded = "import(" + ChunkGraph::placeholder(owner) + ").then((chunk) => chunk." + ns + ")";
+                }
+            } else if (target >= 0) {
+                loaded = chunkLoad(id, target) + ".then(() => __import(" + std::to_string(target) + "))";
+            } else {
+                loaded = "Promise.resolve(" + namespaceOf(target) + ")";
+            }
+            edits.push_back(Edit{record.callStart, record.callEnd, loaded});
+        }
+        for (size_t i = 0; i < scan.requires.size(); ++i) {
+            int target = module.requireTargets[i];
+            if (!inRanges(usage.removed, scan.requires[i].start)) {
+                edits.push_back(Edit{scan.requires[i].start, scan.requires[i].end, requireOf(target)});
+            }
+        }
+        removeRanges(edits, usage.removed);
+        defineNodeEnv(module.source, edits);
+        return applyEdits(module.source, edits);
+    }
+
+    // The namespace object of a hoisted module, for namespace imports,
+    // import() and registry modules
+    std::string namespaceObject(Hoisting& h, int id) const {
+        const TreeShaker::ModuleUsage& usage = usageOf(id);
+        std::string getters;
+        for (const auto& name : exportedNames(h, id)) {
+            if (usage.keepsExport(name)) {
+                std::set<std::pair<int, std::string>> visiting;
+                Resolved to = resolveExport(h, id, name, visiting);
+                getters += (getters.empty() ? " " : ", ") + Transforms::jsStringLiteral(name) + ": () => " +
+                           to.expression;
+            }
+        }
+        return "const __ns" + std::to_string(id) + " = __namespace({" + getters + (getters.empty() ? "" : " ") +
+               "});\n";
+    }
+
+    // One module as a registry entry
+    std::string registryEntry(int id) const {
+        const BundleModule& module = modules[id];
+        std::string out = "// " + module.file.filename().string() + "\n";
+        out += "__modules[" + std::to_string(id) + "] = ";
+        if (module.empty) {
+            out += "{ esm: true, init() {} }";
+        } else {
+            out += module.esm ? emitEsm(id) : emitCommonJs(id);
+        }
+        return out + ";\n";
+    }
+
+    // Re-export the entry's exports from the namespace in `__entry`
+    void exportEntryNames(std::string& out) const {
+        std::set<std::string> names;
+        std::set<int> visited;
+        exportNames(0, names, visited);
+        bool hasDefault = !modules[0].esm || names.count("default");
+        if (hasDefault) {
+            out += "export default __entry.default;\n";
+        }
+        std::string named;
+        for (const auto& name : names) {
+            if (name != "default" && name != "__esModule" && isIdentifier(name)) {
+                named += (named.empty() ? "" : ", ") + name;
+            }
+        }
+        if (!named.empty()) {
+            out += "export const { " + named + " } = __entry;\n";
+        }
+    }
+
+    static std::string nameList(const std::set<std::string>& names) {
+        std::string list;
+        for (const auto& name : names) {
+            list += (list.empty() ? "" : ", ") + name;
+        }
+        return list;
+    }
+
+    // Concatenate the hoisted modules of each chunk into the chunk's scope
+    // in evaluation order; the rest keep their registry functions and run
+    // where an import of them would have run them. Top-level names are
+    // unique across chunks, so a chunk reads another's bindings by
+    // importing them under the same names. A runtime chunk holding the
+    // registry helpers may be added after the graph's chunks.
+    void emitChunks(bool exportEntry, ChunkGraph& graph) const {
+        size_t count = graph.chunks.size();
+        Hoisting h;
+        h.graph = &graph;
+        h.links.resize(count);
+        planHoisting(h);
+        assignNames(h);
+        for (size_t c = 0; c < count; ++c) {
+            h.chunk = static_cast<int>(c);
+            for (int id : graph.chunks[c].modules) {
+                if (h.registered[id]) {
+                    requireNamespace(h, id);
+                }
+            }
+        }
+        if (exportEntry && h.hoisted[0]) {
+            h.chunk = 0;
+            requireNamespace(h, 0);
+        }
+
+        std::vector<std::string> code(count);
+        std::vector<std::string> registry(count);
+        for (size_t c = 0; c < count; ++c) {
+            const Chunk& chunk = graph.chunks[c];
+            h.chunk = static_cast<int>(c);
+            for (int id : h.order) {
+                const BundleModule& module = modules[id];
+                if (module.empty || !chunk.contains(id)) {
+                    continue;
+                }
+                std::string emitted;
+                if (h.hoisted[id]) {
+                    emitted = emitHoisted(h, id);
+                    // A module that hoists to nothing (an HTML entry, a file
+                    // of bare imports) gets no banner either
+                    if (emitted.find_first_not_of(" \t\r\n") == std::string::npos) {
+                        continue;
+                    }
+                    if (emitted.back() != '\n') {
+                        emitted += '\n';
+                    }
+                } else {
+                    emitted = "const __i" + std::to_string(id) + " = __import(" + std::to_string(id) + ");\n";
+                }
+                code[c] += "// " + module.file.filename().string() + "\n" + emitted;
+            }
+            for (int id : chunk.modules) {
+                if (!h.hoisted[id]) {
+                    registry[c] += registryEntry(id);
+                }
+            }
+        }
+        std::vector<std::string> namespaces(count);
+        std::vector<std::string> registered(count);
+        while (!h.pendingNamespaces.empty()) {
+            auto pending = h.pendingNamespaces.front();
+            h.pendingNamespaces.pop_front();
+            h.chunk = pending.first;
+            int id = pending.second;
+            namespaces[h.chunk] += namespaceObject(h, id);
+            if (h.registered[id]) {
+                registered[h.chunk] += "__modules[" + std::to_string(id) + "] = { esm: true, loaded: true, ns: __ns" +
+                                       std::to_string(id) + " };\n";
+            }
+        }
+
+        // Helpers that several chunks call go to a runtime chunk of their
+        // own, which those chunks import them from. That also gives the
+        // chunks one registry.
+        std::vector<std::string> bodies(count);
+        std::vector<std::set<std::string>> calls(count);
+        std::set<std::string> shared;
+        size_t users = 0;
+        for (size_t c = 0; c < count; ++c) {
+            bodies[c] = registry[c] + namespaces[c] + registered[c] + code[c];
+            calls[c] = helpersIn(bodies[c]);
+            users += !calls[c].empty();
+        }
+        if (users > 1) {
+            int runtimeChunk = static_cast<int>(count);
+            graph.chunks.emplace_back();
+            for (size_t c = 0; c < count; ++c) {
+                if (!calls[c].empty()) {
+                    h.links[c].imports[runtimeChunk] = calls[c];
+                    graph.chunks[c].imports.push_back(runtimeChunk);
+                    shared.insert(calls[c].begin(), calls[c].end());
+                }
+            }
+            graph.chunks[runtimeChunk].code = runtime(shared) + "export { " + nameList(shared) + " };\n";
+        }
+
+        for (size_t c = 0; c < count; ++c) {
+            Chunk& chunk = graph.chunks[c];
+            ChunkLinks& links = h.links[c];
+            std::string& out = chunk.code;
+            out.clear();
+            std::set<int> used;
+            for (int id : chunk.modules) {
+                for (const auto* targets : {&modules[id].importTargets, &modules[id].requireTargets}) {
+                    for (int target : *targets) {
+                        if (target < 0 && target != UNRESOLVED) {
+                            used.insert(-target - 1);
+                        }
+                    }
+                }
+            }
+            for (int k : used) {
+                out += "import * as __e" + std::to_string(k) + " from " +
+                       Transforms::jsStringLiteral(externals[k].path) + ";\n";
+            }
+            std::vector<int> from = chunk.imports;
+            for (const auto& imported : links.imports) {
+                if (std::find(from.begin(), from.end(), imported.first) == from.end()) {
+                    from.push_back(imported.first);
+                }
+            }
+            for (int dep : from) {
+                auto names = links.imports.find(dep);
+                out += names == links.imports.end() ? "import "
+                                                     : "import { " + nameList(names->second) + " } from ";
+                out += ChunkGraph::placeholder(dep) + ";\n";
+            }
+            if (shared.empty()) {
+                out += runtime(calls[c]);
+            }
+            out += bodies[c];
+            if (!links.exports.empty()) {
+                out += "export { " + nameList(links.exports) + " };\n";
+            }
+            if (exportEntry && c == 0) {
+                out += std::string("const __entry = ") + (h.hoisted[0] ? "__ns0" : "__i0") + ";\n";
+                exportEntryNames(out);
+            }
+        }
+    }
+
+    void warnUnresolved() const {
+        for (const auto& module : modules) {
+            for (size_t i = 0; i < module.scan.imports.size(); ++i) {
+                if (module.importTargets[i] == UNRESOLVED) {
+                    Logger::warning("Could not resolve \"" + module.scan.imports[i].specifier + "\" from " +
+                                    module.file.string());
+                }
+            }
+        }
+    }
+
+    void emit(bool exportEntry, std::string& out) {
+        warnUnresolved();
+        chunkGraph.reset();
+        if (scopeHoisting) {
+            chunkGraph = std::make_unique<ChunkGraph>(modules, std::vector<int>{0},
+                                                      [this](int id) { return included(id); }, 0, false);
+            emitChunks(exportEntry, *chunkGraph);
+            out = std::move(chunkGraph->chunks[0].code);
+            return;
+        }
+
+        out.clear();
+        for (size_t i = 0; i < externals.size(); ++i) {
+            out += "import * as __e" + std::to_string(i) + " from " + Transforms::jsStringLiteral(externals[i].path) +
+                   ";\n";
+        }
+        std::string body;
+        for (size_t id = 0; id < modules.size(); ++id) {
+            if (included(static_cast<int>(id))) {
+                body += registryEntry(static_cast<int>(id));
+            }
+        }
+        if (!exportEntry) {
+            body += "__import(0);\n";
+        } else {
+            body += "const __entry = __import(0);\n";
+            exportEntryNames(body);
+        }
+        out += runtime(helpersIn(body));
+        out += body;
+    }
+
+public:
+
+    // Whether the last entry bundled was CommonJS
+    bool entryIsCommonJs() const {
+        return !modules.empty() && !modules[0].esm;
+    }
+
+    size_t moduleCount() const {
+        return modules.size();
+    }
+
+    // The analysis behind the last link; null without tree shaking
+    const TreeShaker* shaking() const {
+        return shaker.get();
+    }
+};
@@ -0,0 +1,304 @@
+#pragma once
+
+#include "bundle_module.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <algorithm>
+#include <functional>
+#include <cctype>
+#include <cstdint>
+
+// One script of a split build
+class Chunk {
+public:
+    // The module the chunk is named after: its entry, or for a shared
+    // chunk its first module. -1 for the runtime chunk the bundler adds,
+    // which holds no modules.
+    int nameModule = -1;
+    // Entries that load it; more than one makes it a shared chunk
+    size_t entryCount = 0;
+    // Modules in id order. A module copied into pages is in several.
+    std::vector<int> modules;
+    // Chunks it imports statically, which run before it
+    std::vector<int> imports;
+    // Chunks it loads with import()
+    std::vector<int> dynamicImports;
+    // Source bytes of its modules
+    size_t bytes = 0;
+    // The linked code, naming other chunks by placeholder()
+    std::string code;
+
+    bool contains(int id) const {
+        return std::binary_search(modules.begin(), modules.end(), id);
+    }
+};
+
+// Splits a module graph into chunks. Every page entry and every target of
+// import() is an entry, and each module goes to the chunk of the exact set
+// of entries that reach it through static imports and require(): code
+// that several entries share is loaded once, from a chunk they all import,
+// and code only an import() needs is not loaded before it runs.
+//
+// A chunk that only pages share and that is smaller than the minimum chunk
+// size is copied into each of those pages instead, trading a few
+// duplicated bytes across pages for one request less. Pages never run in
+// the same document, so the copies cannot meet; chunks shared with import()
+// targets are never copied.
+class ChunkGraph {
+private:
+    const std::vector<BundleModule>& modules;
+    std::function<bool(int)> included;
+
+    template <typename Visit>
+    void staticTargets(int id, Visit visit) const {
+        const BundleModule& module = modules[id];
+        for (size_t i = 0; i < module.importTargets.size(); ++i) {
+            if (!module.scan.imports[i].dynamic) {
+                visit(module.importTargets[i]);
+            }
+        }
+        for (int target : module.requireTargets) {
+            visit(target);
+        }
+    }
+
+    // Page entries, then import() targets in the order a breadth-first
+    // walk from the pages meets them
+    void findEntries(const std::vector<int>& pages) {
+        std::vector<char> seen(modules.size(), 0);
+        std::vector<char> entry(modules.size(), 0);
+        std::deque<int> queue;
+        for (int page : pages) {
+            entry[page] = 1;
+            entries.push_back(page);
+            seen[page] = 1;
+            queue.push_back(page);
+        }
+        while (!queue.empty()) {
+            int id = queue.front();
+            queue.pop_front();
+            const BundleModule& module = modules[id];
+            for (size_t i = 0; i < module.importTargets.size(); ++i) {
+                int target = module.importTargets[i];
+                if (target < 0 || !included(target)) {
+                    continue;
+                }
+                if (module.scan.imports[i].dynamic && !entry[target]) {
+                    entry[target] = 1;
+                    entries.push_back(target);
+                }
+                if (!seen[target]) {
+                    seen[target] = 1;
+                    queue.push_back(target);
+                }
+            }
+            for (int target : module.requireTargets) {
+                if (target >= 0 && included(target) && !seen[target]) {
+                    seen[target] = 1;
+                    queue.push_back(target);
+                }
+            }
+        }
+    }
+
+    // Copy the small chunks only pages share into the pages, unless a
+    // shared chunk that stays imports from them
+    void copySmallChunks(size_t pageCount, const std::vector<std::vector<int>>& chunkEntries, size_t minChunkSize) {
+        std::vector<char> copied(chunks.size(), 0);
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            const std::vector<int>& users = chunkEntries[c];
+            copied[c] = users.size() > 1 && chunks[c].bytes < minChunkSize &&
+                        std::all_of(users.begin(), users.end(), [&](int k) { return k < static_cast<int>(pageCount); });
+        }
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t c = 0; c < chunks.size(); ++c) {
+                if (copied[c] || chunkEntries[c].size() < 2) {
+                    continue;
+                }
+                for (int id : chunks[c].modules) {
+                    staticTargets(id, [&](int target) {
+                        if (target >= 0 && chunkOf[target] >= 0 && copied[chunkOf[target]]) {
+                            copied[chunkOf[target]] = 0;
+                            changed = true;
+                        }
+                    });
+                }
+            }
+        }
+
+        std::vector<int> remap(chunks.size(), -1);
+        std::vector<Chunk> kept;
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            if (!copied[c]) {
+                remap[c] = static_cast<int>(kept.size());
+                kept.push_back(std::move(chunks[c]));
+            }
+        }
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            if (!copied[c]) {
+                continue;
+            }
+            for (int k : chunkEntries[c]) {
+                Chunk& page = kept[remap[chunkOf[entries[k]]]];
+                page.modules.insert(page.modules.end(), chunks[c].modules.begin(), chunks[c].modules.end());
+                page.bytes += chunks[c].bytes;
+            }
+            copiedModules += chunks[c].modules.size();
+        }
+        for (auto& chunk : kept) {
+            std::sort(chunk.modules.begin(), chunk.modules.end());
+        }
+        for (int& chunk : chunkOf) {
+            chunk = chunk < 0 ? -1 : remap[chunk];
+        }
+        chunks = std::move(kept);
+    }
+
+    void linkChunks() {
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            Chunk& chunk = chunks[c];
+            auto add = [&](std::vector<int>& list, int target) {
+                if (target < 0 || !included(target) || chunk.contains(target)) {
+                    return;
+                }
+                int owner = chunkOf[target];
+                if (owner >= 0 && std::find(list.begin(), list.end(), owner) == list.end()) {
+                    list.push_back(owner);
+                }
+            };
+            for (int id : chunk.modules) {
+                const BundleModule& module = modules[id];
+                for (size_t i = 0; i < module.importTargets.size(); ++i) {
+                    add(module.scan.imports[i].dynamic ? chunk.dynamicImports : chunk.imports,
+                        module.importTargets[i]);
+                }
+                for (int target : module.requireTargets) {
+                    add(chunk.imports, target);
+                }
+            }
+        }
+    }
+
+public:
+    // Page entries first, then import() targets
+    std::vector<int> entries;
+    std::vector<Chunk> chunks;
+    // The chunk holding each module; -1 for modules in no chunk and for
+    // modules copied into several
+    std::vector<int> chunkOf;
+    // Modules of small shared chunks that were copied into pages instead
+    size_t copiedModules = 0;
+
+    // Split the modules `included` accepts, entered at `pages`. Without
+    // `split` everything goes into one chunk entered at module 0, and
+    // import() targets are not entries.
+    ChunkGraph(const std::vector<BundleModule>& graph, const std::vector<int>& pages,
+               std::function<bool(int)> isIncluded, size_t minChunkSize, bool split = true)
+        : modules(graph), included(std::move(isIncluded)), chunkOf(graph.size(), -1) {
+        if (!split) {
+            entries = {0};
+            chunks.emplace_back();
+            chunks[0].nameModule = 0;
+            chunks[0].entryCount = 1;
+            for (size_t id = 0; id < modules.size(); ++id) {
+                if (included(static_cast<int>(id))) {
+                    chunks[0].modules.push_back(static_cast<int>(id));
+                    chunks[0].bytes += modules[id].source.size();
+                    chunkOf[id] = 0;
+                }
+            }
+            return;
+        }
+
+        findEntries(pages);
+        // Which entries reach each module, as a bit set per module
+        size_t words = (entries.size() + 63) / 64;
+        std::vector<uint64_t> reached(modules.size() * words, 0);
+        for (size_t k = 0; k < entries.size(); ++k) {
+            std::vector<int> stack = {entries[k]};
+            reached[entries[k] * words + k / 64] |= uint64_t(1) << (k % 64);
+            while (!stack.empty()) {
+                int id = stack.back();
+                stack.pop_back();
+                staticTargets(id, [&](int target) {
+                    if (target < 0 || !included(target)) {
+                        return;
+                    }
+                    uint64_t& word = reached[target * words + k / 64];
+                    uint64_t bit = uint64_t(1) << (k % 64);
+                    if (!(word & bit)) {
+                        word |= bit;
+                        stack.push_back(target);
+                    }
+                });
+            }
+        }
+
+        std::map<std::vector<uint64_t>, int> chunkIds;
+        std::vector<std::vector<int>> chunkEntries;
+        for (size_t id = 0; id < modules.size(); ++id) {
+            std::vector<uint64_t> key(reached.begin() + id * words, reached.begin() + (id + 1) * words);
+            if (std::all_of(key.begin(), key.end(), [](uint64_t word) { return word == 0; })) {
+                continue;
+            }
+            auto it = chunkIds.find(key);
+            if (it == chunkIds.end()) {
+                it = chunkIds.emplace(key, static_cast<int>(chunks.size())).first;
+                chunks.emplace_back();
+                chunkEntries.emplace_back();
+                for (size_t k = 0; k < entries.size(); ++k) {
+                    if (key[k / 64] & (uint64_t(1) << (k % 64))) {
+                        chunkEntries.back().push_back(static_cast<int>(k));
+                    }
+                }
+                Chunk& chunk = chunks.back();
+                chunk.entryCount = chunkEntries.back().size();
+                chunk.nameModule = chunk.entryCount == 1 ? entries[chunkEntries.back()[0]] : static_cast<int>(id);
+            }
+            Chunk& chunk = chunks[it->second];
+            chunk.modules.push_back(static_cast<int>(id));
+            chunk.bytes += modules[id].source.size();
+            chunkOf[id] = it->second;
+        }
+        copySmallChunks(pages.size(), chunkEntries, minChunkSize);
+        linkChunks();
+    }
+
+    // What a chunk's code names chunk `index` by until the chunks have
+    // file names: a string literal, so it can stand in import statements
+    // and import() calls alike
+    static std::string placeholder(int index) {
+        return "\"__VITE_CHUNK_" + std::to_string(index) + "__\"";
+    }
+
+    // Replace the placeholders in `code` by the chunks' URLs
+    static std::string fillPlaceholders(const std::string& code, const std::vector<std::string>& urls) {
+        static const std::string marker = "\"__VITE_CHUNK_";
+        std::string out;
+        out.reserve(code.size());
+        size_t copied = 0;
+        for (size_t at = code.find(marker); at != std::string::npos; at = code.find(marker, at + 1)) {
+            size_t p = at + marker.size();
+            size_t digits = p;
+            while (digits < code.size() && std::isdigit(static_cast<unsigned char>(code[digits]))) {
+                ++digits;
+            }
+            if (digits == p || code.compare(digits, 3, "__\"") != 0) {
+                continue;
+            }
+            size_t index = std::stoul(code.substr(p, digits - p));
+            if (index >= urls.size()) {
+                continue;
+            }
+            out.append(code, copied, at - copied);
+            out += "\"" + urls[index] + "\"";
+            copied = digits + 3;
+        }
+        out.append(code, copied, std::string::npos);
+        return out;
+    }
+};
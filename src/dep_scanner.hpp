@@ -0,0 +1,192 @@
+#pragma once
+
+#include "import_scanner.hpp"
+#include "resolver.hpp"
+#include "static_files.hpp"
+#include "work_stealing.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <unordered_set>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// What a crawl of the project found
+class DependencyScan {
+public:
+    // Bare specifier -> the file in node_modules it resolves to
+    std::map<std::string, fs::path> deps;
+    // Project files read: pages and modules
+    size_t files = 0;
+};
+
+// Crawls the project from its HTML pages through every local module they
+// import and collects the bare imports that land in node_modules. Files
+// are crawled on a WorkStealingPool; a file is claimed once in a sharded
+// set before it is queued, so no file is read twice.
+class DependencyScanner {
+private:
+    static constexpr size_t SHARDS = 16;
+
+    struct SeenShard {
+        std::mutex mutex;
+        std::unordered_set<std::string> paths;
+    };
+
+    fs::path root;
+    ModuleResolver& resolver;
+    WorkStealingPool<fs::path> pool;
+    SeenShard seen[SHARDS];
+    std::atomic<size_t> filesRead{0};
+
+    static bool isHtml(const fs::path& file) {
+        return file.extension() == ".html";
+    }
+
+    static bool inNodeModules(const fs::path& file) {
+        for (const auto& part : file) {
+            if (part == "node_modules") {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Value of `name="..."` inside one start tag, "" when absent
+    static std::string attribute(const std::string& tag, const std::string& name) {
+        for (size_t at = tag.find(name); at != std::string::npos; at = tag.find(name, at + 1)) {
+            size_t p = at + name.size();
+            if (at == 0 || !std::isspace(static_cast<unsigned char>(tag[at - 1])) || p >= tag.size() ||
+                tag[p] != '=') {
+                continue;
+            }
+            char quote = p + 1 < tag.size() ? tag[p + 1] : '\0';
+            if (quote != '"' && quote != '\'') {
+                size_t end = tag.find_first_of(" \t\r\n>", p + 1);
+                return tag.substr(p + 1, end - p - 1);
+            }
+            size_t close = tag.find(quote, p + 2);
+            return close == std::string::npos ? "" : tag.substr(p + 2, close - p - 2);
+        }
+        return "";
+    }
+
+    // Module scripts of one page: `src` files go to `files`, inline script
+    // bodies to `inlineScripts`
+    static void scanHtml(const std::string& html, std::vector<std::string>& files,
+                         std::vector<std::string>& inlineScripts) {
+        for (size_t at = html.find("<script"); at != std::string::npos; at = html.find("<script", at + 7)) {
+            size_t tagEnd = html.find('>', at);
+            if (tagEnd == std::string::npos) {
+                return;
+            }
+            std::string tag = html.substr(at, tagEnd - at);
+            if (attribute(tag, "type") != "module") {
+                continue;
+            }
+            std::string src = attribute(tag, "src");
+            size_t close = html.find("</script", tagEnd);
+            if (!src.empty()) {
+                files.push_back(src);
+            } else if (close != std::string::npos) {
+                inlineScripts.push_back(html.substr(tagEnd + 1, close - tagEnd - 1));
+            }
+        }
+    }
+
+    // Queue `file` on `worker`'s deque unless some worker already claimed it
+    void enqueue(size_t worker, const fs::path& file) {
+        const std::string& key = file.native();
+        SeenShard& shard = seen[std::hash<std::string>{}(key) % SHARDS];
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (!shard.paths.insert(key).second) {
+                return;
+            }
+        }
+        pool.push(worker, file);
+    }
+
+    void visitImports(size_t worker, const std::string& source, const fs::path& importerDir,
+                      std::map<std::string, fs::path>& deps) {
+        for (const auto& record : ImportScanner::scan(source).imports) {
+            std::string specifier = record.specifier.substr(0, record.specifier.find_first_of("?#", 1));
+            fs::path file = resolver.resolve(specifier, importerDir);
+            if (file.empty()) {
+                continue;
+            }
+            if (inNodeModules(file)) {
+                if (ModuleResolver::isBare(specifier) && isScript(file)) {
+                    deps.emplace(specifier, file);
+                }
+            } else if (isScript(file)) {
+                enqueue(worker, file);
+            }
+        }
+    }
+
+    void scanFile(size_t worker, const fs::path& file, std::map<std::string, fs::path>& deps) {
+        std::string source;
+        if (!StaticFiles::readFile(file, source)) {
+            return;
+        }
+        filesRead.fetch_add(1, std::memory_order_relaxed);
+        if (!isHtml(file)) {
+            visitImports(worker, source, file.parent_path(), deps);
+            return;
+        }
+        std::vector<std::string> scripts;
+        std::vector<std::string> inlineScripts;
+        scanHtml(source, scripts, inlineScripts);
+        for (const auto& script : inlineScripts) {
+            visitImports(worker, script, file.parent_path(), deps);
+        }
+        for (const auto& src : scripts) {
+            std::string specifier = src[0] == '/' || src[0] == '.' ? src : "./" + src;
+            fs::path module = resolver.resolve(specifier, file.parent_path());
+            if (!module.empty()) {
+                enqueue(worker, module);
+            }
+        }
+    }
+
+public:
+    // `threads` = 0 uses one worker per hardware thread
+    DependencyScanner(const fs::path& rootDir, ModuleResolver& moduleResolver, size_t threads = 0)
+        : root(fs::absolute(rootDir).lexically_normal()), resolver(moduleResolver), pool(threads) {}
+
+    static bool isScript(const fs::path& file) {
+        std::string ext = file.extension().string();
+        return ext == ".js" || ext == ".mjs" || ext == ".cjs" || ext == ".jsx" || ext == ".ts" || ext == ".tsx" ||
+               ext == ".mts";
+    }
+
+    // Crawl from every .html file in the root. Safe to call once per
+    // scanner.
+    DependencyScan scan() {
+        std::error_code ec;
+        size_t next = 0;
+        for (const auto& entry : fs::directory_iterator(root, ec)) {
+            if (isHtml(entry.path()) && entry.is_regular_file(ec)) {
+                enqueue(next++ % pool.workers(), entry.path());
+            }
+        }
+
+        std::vector<std::map<std::string, fs::path>> found(pool.workers());
+        pool.run([this, &found](size_t worker, fs::path& file) { scanFile(worker, file, found[worker]); });
+
+        DependencyScan result;
+        for (const auto& deps : found) {
+            result.deps.insert(deps.begin(), deps.end());
+        }
+        result.files = filesRead.load();
+        return result;
+    }
+};
@@ -0,0 +1,298 @@
+#pragma once
+
+#include "hash.hpp"
+#include "logger.hpp"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <filesystem>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+// Length-prefixed little-endian encoding for cache values
+class ByteWriter {
+private:
+    std::string out;
+
+public:
+    void putU32(uint32_t v) {
+        char buf[4];
+        std::memcpy(buf, &v, sizeof(v));
+        out.append(buf, sizeof(buf));
+    }
+
+    void putString(const std::string& s) {
+        putU32(static_cast<uint32_t>(s.size()));
+        out += s;
+    }
+
+    const std::string& bytes() const {
+        return out;
+    }
+};
+
+class ByteReader {
+private:
+    const std::string& in;
+    size_t pos = 0;
+
+public:
+    explicit ByteReader(const std::string& data) : in(data) {}
+
+    bool getU32(uint32_t& v) {
+        if (in.size() - pos < sizeof(v)) {
+            return false;
+        }
+        std::memcpy(&v, in.data() + pos, sizeof(v));
+        pos += sizeof(v);
+        return true;
+    }
+
+    bool getString(std::string& s) {
+        uint32_t len;
+        if (!getU32(len) || in.size() - pos < len) {
+            return false;
+        }
+        s.assign(in, pos, len);
+        pos += len;
+        return true;
+    }
+
+    bool done() const {
+        return pos == in.size();
+    }
+};
+
+// Key/value store in one append-only file. Records are only ever appended,
+// so concurrent dev servers on the same project cannot corrupt each other
+// and a crash can at worst leave a torn tail, which is cut off on the next
+// open. The file is mapped read-only; lookups go through an in-memory index
+// of record offsets rebuilt from the record headers at open.
+class DiskCache {
+private:
+    static constexpr char FILE_MAGIC[8] = {'V', 'I', 'T', 'E', 'X', 'F', 'R', 'M'};
+    static constexpr uint32_t FORMAT_VERSION = 1;
+    static constexpr uint32_t RECORD_MAGIC = 0x52455856;  // "VXER"
+    static constexpr size_t FILE_HEADER_BYTES = 16;
+    // Keys are content-addressed, so old records are never overwritten.
+    // Past this size nothing more is stored, and the next open starts the
+    // cache over instead of letting it grow forever.
+    static constexpr size_t MAX_FILE_BYTES = 256 * 1024 * 1024;
+
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t keyLength;
+        uint32_t valueLength;
+        uint32_t checksum;
+    };
+
+    struct Location {
+        size_t offset;
+        uint32_t length;
+        uint32_t checksum;
+    };
+
+    int fd = -1;
+    const char* map = nullptr;
+    size_t mapCapacity = 0;
+    size_t fileEnd = 0;
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, Location> index;
+
+    // Map at least `size` bytes. The mapping grows geometrically past the
+    // end of the file so appends rarely need a new one; bytes past EOF are
+    // never touched.
+    bool ensureMapped(size_t size) {
+        if (size <= mapCapacity) {
+            return true;
+        }
+        size_t capacity = std::max<size_t>(mapCapacity ? mapCapacity : 1024 * 1024, 1024 * 1024);
+        while (capacity < size) {
+            capacity *= 2;
+        }
+        void* mapped = mmap(nullptr, capacity, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+        if (map) {
+            munmap(const_cast<char*>(map), mapCapacity);
+        }
+        map = static_cast<const char*>(mapped);
+        mapCapacity = capacity;
+        return true;
+    }
+
+    static uint32_t checksumOf(const char* data, size_t len) {
+        return static_cast<uint32_t>(Hash::xxh64(data, len));
+    }
+
+    // Start an empty cache. The new file is written aside and renamed over
+    // `file`, so a dev server that still maps the old one keeps its inode
+    // instead of faulting on truncated pages.
+    bool reset(const fs::path& file) {
+        char header[FILE_HEADER_BYTES] = {};
+        std::memcpy(header, FILE_MAGIC, sizeof(FILE_MAGIC));
+        uint32_t version = FORMAT_VERSION;
+        std::memcpy(header + sizeof(FILE_MAGIC), &version, sizeof(version));
+        index.clear();
+
+        fs::path fresh = file;
+        fresh += ".tmp" + std::to_string(getpid());
+        int freshFd = ::open(fresh.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (freshFd < 0) {
+            return false;
+        }
+        if (pwrite(freshFd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+            rename(fresh.c_str(), file.c_str()) != 0) {
+            close(freshFd);
+            unlink(fresh.c_str());
+            return false;
+        }
+        if (map) {
+            munmap(const_cast<char*>(map), mapCapacity);
+            map = nullptr;
+            mapCapacity = 0;
+        }
+        flock(fd, LOCK_UN);
+        close(fd);
+        fd = freshFd;
+        fileEnd = FILE_HEADER_BYTES;
+        return true;
+    }
+
+    // Index every complete record; anything after the last one is a torn
+    // append and is truncated away
+    void scan(size_t size) {
+        size_t pos = FILE_HEADER_BYTES;
+        while (pos + sizeof(RecordHeader) <= size) {
+            RecordHeader header;
+            std::memcpy(&header, map + pos, sizeof(header));
+            size_t total = sizeof(header) + header.keyLength + static_cast<size_t>(header.valueLength);
+            if (header.magic != RECORD_MAGIC || total > size - pos) {
+                break;
+            }
+            std::string key(map + pos + sizeof(header), header.keyLength);
+            index[key] = Location{pos + sizeof(header) + header.keyLength, header.valueLength, header.checksum};
+            pos += total;
+        }
+        fileEnd = pos;
+        if (pos < size && ftruncate(fd, static_cast<off_t>(pos)) != 0) {
+            fileEnd = size;
+        }
+    }
+
+public:
+    DiskCache() = default;
+    DiskCache(const DiskCache&) = delete;
+    DiskCache& operator=(const DiskCache&) = delete;
+
+    ~DiskCache() {
+        if (map) munmap(const_cast<char*>(map), mapCapacity);
+        if (fd >= 0) close(fd);
+    }
+
+    // Open or create the cache file. Returns false (after warning) when it
+    // cannot be used; callers then simply run without persistence.
+    bool open(const fs::path& file) {
+        std::error_code ec;
+        fs::create_directories(file.parent_path(), ec);
+        fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            Logger::warning("Transform cache disabled: cannot open " + file.string() + ": " + std::strerror(errno));
+            return false;
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        flock(fd, LOCK_EX);
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0;
+        size_t size = ok ? static_cast<size_t>(st.st_size) : 0;
+        if (ok && size >= FILE_HEADER_BYTES && size <= MAX_FILE_BYTES && ensureMapped(size)) {
+            uint32_t version = 0;
+            std::memcpy(&version, map + sizeof(FILE_MAGIC), sizeof(version));
+            if (std::memcmp(map, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0 && version == FORMAT_VERSION) {
+                scan(size);
+            } else {
+                ok = reset(file);
+            }
+        } else if (ok) {
+            ok = reset(file);
+        }
+        flock(fd, LOCK_UN);
+
+        if (!ok) {
+            Logger::warning("Transform cache disabled: " + file.string() + " is not writable");
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    bool isOpen() const {
+        return fd >= 0;
+    }
+
+    bool find(const std::string& key, std::string& value) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it == index.end() || it->second.offset + it->second.length > mapCapacity) {
+            return false;
+        }
+        const char* data = map + it->second.offset;
+        // Checksums are verified on use rather than at open, so startup
+        // only touches record headers. The key sits right before the value.
+        if (checksumOf(data - key.size(), key.size() + it->second.length) != it->second.checksum) {
+            return false;
+        }
+        value.assign(data, it->second.length);
+        return true;
+    }
+
+    void store(const std::string& key, const std::string& value) {
+        if (fd < 0) {
+            return;
+        }
+        std::string record(sizeof(RecordHeader), '\0');
+        record += key;
+        record += value;
+        RecordHeader header{RECORD_MAGIC, static_cast<uint32_t>(key.size()), static_cast<uint32_t>(value.size()),
+                            checksumOf(record.data() + sizeof(RecordHeader), key.size() + value.size())};
+        std::memcpy(&record[0], &header, sizeof(header));
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (index.count(key)) {
+            return;
+        }
+        flock(fd, LOCK_EX);
+        off_t end = lseek(fd, 0, SEEK_END);
+        bool written = end >= 0 && static_cast<size_t>(end) + record.size() <= MAX_FILE_BYTES &&
+                       pwrite(fd, record.data(), record.size(), end) == static_cast<ssize_t>(record.size());
+        flock(fd, LOCK_UN);
+        if (!written) {
+            return;
+        }
+        size_t offset = static_cast<size_t>(end);
+        fileEnd = offset + record.size();
+        if (ensureMapped(fileEnd)) {
+            index[key] = Location{offset + sizeof(RecordHeader) + key.size(), header.valueLength, header.checksum};
+        }
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return index.size();
+    }
+};
@@ -0,0 +1,547 @@
+#pragma once
+
+#include "http.hpp"
+#include "websocket.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+using RequestHandler = std::function<void(const HttpRequest&, HttpResponse&)>;
+
+// A queued piece of response output: either buffered bytes or a byte range
+// of an open file that is handed to sendfile(2) without entering userspace.
+class OutputChunk {
+public:
+    std::string data;
+    std::shared_ptr<const OpenFile> file;
+    off_t offset = 0;
+    off_t end = 0;
+    // Set once the kernel holds a pointer into `data` (an io_uring send in
+    // flight); later output then goes to a fresh chunk instead of growing
+    // this one and moving its bytes out from under the send
+    bool sealed = false;
+
+    bool done() const {
+        return file ? offset >= end : static_cast<size_t>(offset) >= data.size();
+    }
+};
+
+// Per-connection protocol state. The connection owns its buffers but does no
+// I/O itself; the event loop feeds it bytes and drains its output.
+class HttpConnection {
+public:
+    static constexpr size_t OUTPUT_HIGH_WATER = 1024 * 1024;
+    static constexpr size_t MAX_QUEUED_CHUNKS = 256;
+    // Room for the largest request the parser accepts, so an oversized one
+    // gets its 413 or 431 before the connection gives up on it
+    static constexpr size_t MAX_INPUT_BYTES = HttpParser::MAX_HEADER_BYTES + HttpParser::MAX_BODY_BYTES;
+
+    int fd;
+    std::string input;
+    std::deque<OutputChunk> output;
+    size_t bufferedBytes = 0;
+    bool closeAfterFlush = false;
+    bool peerClosed = false;
+    bool websocket = false;
+    std::chrono::steady_clock::time_point lastActive;
+
+    explicit HttpConnection(int f) : fd(f), lastActive(std::chrono::steady_clock::now()) {}
+
+    bool hasPendingOutput() const {
+        return !output.empty();
+    }
+
+    // Answer every complete request sitting in the input buffer, in order, so
+    // pipelined requests are handled without waiting for a round trip. Stops
+    // early when too much output is queued; the loop resumes after a flush.
+    // Once a request has been upgraded, the rest of the input is WebSocket
+    // frames.
+    void processInput(const RequestHandler& handler, const std::string& date) {
+        if (websocket) {
+            processFrames();
+            return;
+        }
+        size_t consumed = 0;
+        while (!closeAfterFlush && consumed < input.size() &&
+               bufferedBytes < OUTPUT_HIGH_WATER && output.size() < MAX_QUEUED_CHUNKS) {
+            HttpRequest req;
+            size_t used = 0;
+            int errorStatus = 400;
+            auto result = HttpParser::parse(input.data() + consumed, input.size() - consumed, req, used, errorStatus);
+
+            if (result == HttpParser::Result::Incomplete) {
+                break;
+            }
+
+            HttpResponse res;
+            if (result == HttpParser::Result::Error) {
+                res.status = errorStatus;
+                res.setHeader("Content-Type", "text/plain; charset=utf-8");
+                res.body = std::string(Http::statusText(errorStatus)) + "\n";
+                appendResponse(res, false, date);
+                closeAfterFlush = true;
+                consumed = input.size();
+                break;
+            }
+
+            consumed += used;
+            res.headOnly = req.method == "HEAD";
+            try {
+                handler(req, res);
+            } catch (const std::exception& e) {
+                res = HttpResponse();
+                res.status = 500;
+                res.setHeader("Content-Type", "text/plain; charset=utf-8");
+                res.body = std::string("Internal Server Error: ") + e.what() + "\n";
+            }
+
+            bool keepAlive = req.keepAlive && !res.close;
+            appendResponse(res, keepAlive, date);
+            if (res.upgrade && res.status == 101) {
+                websocket = true;
+                break;
+            }
+            if (!keepAlive) {
+                closeAfterFlush = true;
+            }
+        }
+
+        if (consumed > 0) {
+            input.erase(0, consumed);
+        }
+        if (websocket) {
+            processFrames();
+        }
+    }
+
+    // Queue an already encoded frame on an upgraded connection
+    void sendFrame(const std::string& frame) {
+        if (websocket && !closeAfterFlush) {
+            appendBytes(frame);
+        }
+    }
+
+    // Account for `n` bytes of buffered output having been written
+    void consumedBuffered(size_t n) {
+        bufferedBytes -= n;
+    }
+
+private:
+    // Clients only ever send us control frames worth acting on: pings are
+    // answered, a close is echoed, and data frames are dropped.
+    void processFrames() {
+        size_t consumed = 0;
+        while (!closeAfterFlush && consumed < input.size()) {
+            WebSocket::Opcode opcode;
+            std::string payload;
+            size_t used = 0;
+            auto result = WebSocket::parseFrame(input.data() + consumed, input.size() - consumed, opcode, payload, used);
+            if (result == WebSocket::ParseResult::Incomplete) {
+                break;
+            }
+            if (result == WebSocket::ParseResult::Error) {
+                // 1002: protocol error
+                appendBytes(WebSocket::encodeFrame(std::string("\x03\xea", 2), WebSocket::CLOSE));
+                closeAfterFlush = true;
+                consumed = input.size();
+                break;
+            }
+            consumed += used;
+            if (opcode == WebSocket::PING) {
+                appendBytes(WebSocket::encodeFrame(payload, WebSocket::PONG));
+            } else if (opcode == WebSocket::CLOSE) {
+                appendBytes(WebSocket::encodeFrame(payload.substr(0, 2), WebSocket::CLOSE));
+                closeAfterFlush = true;
+            }
+        }
+        if (consumed > 0) {
+            input.erase(0, consumed);
+        }
+    }
+
+    void appendBytes(const std::string& bytes) {
+        if (bytes.empty()) {
+            return;
+        }
+        if (output.empty() || output.back().file || output.back().sealed) {
+            output.emplace_back();
+        }
+        output.back().data += bytes;
+        bufferedBytes += bytes.size();
+    }
+
+    void appendResponse(const HttpResponse& res, bool keepAlive, const std::string& date) {
+        appendBytes(res.serializeHead(keepAlive, date));
+        if (res.headOnly || res.status == 304 || res.status == 204) {
+            return;
+        }
+        if (res.file) {
+            if (res.file->size > 0) {
+                OutputChunk chunk;
+                chunk.file = res.file;
+                chunk.end = static_cast<off_t>(res.file->size);
+                output.push_back(std::move(chunk));
+            }
+        } else {
+            appendBytes(res.body);
+        }
+    }
+};
+
+// I/O backends an HttpServer can drive its connections with
+enum class IoBackend { Epoll, Uring };
+
+// A single-threaded loop serving one listening socket. Implementations differ
+// only in how they move bytes; protocol handling lives in HttpConnection.
+class EventLoop {
+private:
+    std::mutex broadcastMutex;
+    std::vector<std::string> pendingFrames;
+
+protected:
+    std::atomic<bool> stopRequested{false};
+
+    // Interrupt the loop's wait from another thread
+    virtual void wake() = 0;
+
+    // Frames queued by broadcast() since the last call, for the loop thread
+    std::vector<std::string> takeBroadcasts() {
+        std::lock_guard<std::mutex> lock(broadcastMutex);
+        return std::move(pendingFrames);
+    }
+
+public:
+    virtual ~EventLoop() = default;
+
+    // Serve until stop() is called or a signal arrives on the watched fd
+    virtual void run() = 0;
+
+    // Stop the loop when a signal arrives on this signalfd
+    virtual void watchSignals(int fd) = 0;
+
+    // Safe to call from any thread
+    void stop() {
+        stopRequested = true;
+        wake();
+    }
+
+    // Send a text message to every upgraded WebSocket connection on this
+    // loop. Safe to call from any thread; delivery happens on the loop.
+    void broadcast(const std::string& message) {
+        {
+            std::lock_guard<std::mutex> lock(broadcastMutex);
+            pendingFrames.push_back(WebSocket::encodeFrame(message));
+        }
+        wake();
+    }
+};
+
+// Readiness-based loop on epoll. Sockets are registered edge-triggered once
+// and drained until EAGAIN, so thousands of keep-alive connections cost one
+// epoll_wait per batch of ready events.
+class EpollLoop : public EventLoop {
+private:
+    static constexpr int MAX_EVENTS = 256;
+    static constexpr auto IDLE_TIMEOUT = std::chrono::seconds(5);
+
+    int epollFd = -1;
+    int wakeFd = -1;
+    int signalFd = -1;
+    int listenFd;
+    int spareFd = -1;
+    RequestHandler handler;
+    std::vector<std::unique_ptr<HttpConnection>> connections;
+    size_t connectionCount = 0;
+    bool running = false;
+    std::time_t dateSecond = 0;
+    std::string date;
+
+    void wake() override {
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+
+    void addFd(int fd, uint32_t events) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            throw std::runtime_error(std::string("epoll_ctl failed: ") + std::strerror(errno));
+        }
+    }
+
+    void refreshDate() {
+        std::time_t now = std::time(nullptr);
+        if (now != dateSecond) {
+            dateSecond = now;
+            date = Http::formatDate(now);
+        }
+    }
+
+    void acceptConnections() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                if (errno == EMFILE || errno == ENFILE) {
+                    // Out of descriptors: accept-and-drop with the reserved fd so
+                    // the edge-triggered listener does not stall forever.
+                    close(spareFd);
+                    int dropped = accept(listenFd, nullptr, nullptr);
+                    if (dropped >= 0) {
+                        close(dropped);
+                    }
+                    spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                    continue;
+                }
+                break;
+            }
+
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if (static_cast<size_t>(fd) >= connections.size()) {
+                connections.resize(static_cast<size_t>(fd) * 2 + 1);
+            }
+            connections[fd] = std::make_unique<HttpConnection>(fd);
+            ++connectionCount;
+            addFd(fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+        }
+    }
+
+    void closeConnection(HttpConnection* conn) {
+        int fd = conn->fd;
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections[fd].reset();
+        --connectionCount;
+    }
+
+    // Returns false once the connection has been closed.
+    bool readInput(HttpConnection* conn) {
+        char buf[64 * 1024];
+        while (true) {
+            ssize_t n = recv(conn->fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                conn->input.append(buf, static_cast<size_t>(n));
+                if (conn->input.size() > HttpConnection::MAX_INPUT_BYTES) {
+                    closeConnection(conn);
+                    return false;
+                }
+                continue;
+            }
+            if (n == 0) {
+                conn->peerClosed = true;
+                return true;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            closeConnection(conn);
+            return false;
+        }
+    }
+
+    // Returns false once the connection has been closed.
+    bool flushOutput(HttpConnection* conn) {
+        while (conn->hasPendingOutput()) {
+            OutputChunk& chunk = conn->output.front();
+            ssize_t n;
+            if (chunk.file) {
+                n = sendfile(conn->fd, chunk.file->fd, &chunk.offset, static_cast<size_t>(chunk.end - chunk.offset));
+                if (n == 0) {
+                    // The file shrank underneath us; the promised length can't be met
+                    closeConnection(conn);
+                    return false;
+                }
+            } else {
+                // Hold back a partial segment when file data follows the headers
+                int flags = MSG_NOSIGNAL;
+                if (conn->output.size() > 1 && conn->output[1].file) {
+                    flags |= MSG_MORE;
+                }
+                n = send(conn->fd, chunk.data.data() + chunk.offset,
+                         chunk.data.size() - static_cast<size_t>(chunk.offset), flags);
+                if (n > 0) {
+                    chunk.offset += n;
+                    conn->consumedBuffered(static_cast<size_t>(n));
+                }
+            }
+            if (n > 0) {
+                if (chunk.done()) {
+                    conn->output.pop_front();
+                }
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return true;
+            }
+            closeConnection(conn);
+            return false;
+        }
+        if (conn->closeAfterFlush || (conn->peerClosed && conn->input.empty())) {
+            closeConnection(conn);
+            return false;
+        }
+        return true;
+    }
+
+    void serviceConnection(HttpConnection* conn, uint32_t events) {
+        conn->lastActive = std::chrono::steady_clock::now();
+        if (events & EPOLLERR) {
+            closeConnection(conn);
+            return;
+        }
+        if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) && !readInput(conn)) {
+            return;
+        }
+        // Process, flush, and repeat while flushing frees room for requests
+        // that were held back by the output high-water mark.
+        while (true) {
+            size_t before = conn->input.size();
+            conn->processInput(handler, date);
+            if (!flushOutput(conn)) {
+                return;
+            }
+            if (conn->hasPendingOutput() || conn->input.size() == before || conn->input.empty()) {
+                break;
+            }
+        }
+        if (conn->peerClosed && !conn->hasPendingOutput()) {
+            closeConnection(conn);
+        }
+    }
+
+    // WebSocket connections sit idle between updates by design
+    void closeIdleConnections() {
+        auto now = std::chrono::steady_clock::now();
+        for (auto& slot : connections) {
+            if (slot && !slot->websocket && !slot->hasPendingOutput() && now - slot->lastActive > IDLE_TIMEOUT) {
+                closeConnection(slot.get());
+            }
+        }
+    }
+
+    void deliverBroadcasts() {
+        uint64_t count;
+        ssize_t ignored = read(wakeFd, &count, sizeof(count));
+        (void)ignored;
+        if (stopRequested) {
+            running = false;
+            return;
+        }
+        std::vector<std::string> frames = takeBroadcasts();
+        for (auto& slot : connections) {
+            if (!slot || !slot->websocket) {
+                continue;
+            }
+            for (const auto& frame : frames) {
+                slot->sendFrame(frame);
+            }
+            flushOutput(slot.get());
+        }
+    }
+
+public:
+    EpollLoop(int listenSocket, RequestHandler h) : listenFd(listenSocket), handler(std::move(h)) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (epollFd < 0 || wakeFd < 0) {
+            throw std::runtime_error(std::string("Failed to create event loop: ") + std::strerror(errno));
+        }
+        addFd(listenFd, EPOLLIN | EPOLLET);
+        addFd(wakeFd, EPOLLIN);
+    }
+
+    ~EpollLoop() override {
+        for (auto& slot : connections) {
+            if (slot) {
+                close(slot->fd);
+            }
+        }
+        if (spareFd >= 0) close(spareFd);
+        if (wakeFd >= 0) close(wakeFd);
+        if (epollFd >= 0) close(epollFd);
+    }
+
+    EpollLoop(const EpollLoop&) = delete;
+    EpollLoop& operator=(const EpollLoop&) = delete;
+
+    void watchSignals(int fd) override {
+        signalFd = fd;
+        addFd(fd, EPOLLIN);
+    }
+
+    size_t activeConnections() const {
+        return connectionCount;
+    }
+
+    void run() override {
+        running = true;
+        epoll_event events[MAX_EVENTS];
+        auto lastSweep = std::chrono::steady_clock::now();
+
+        while (running) {
+            int n = epoll_wait(epollFd, events, MAX_EVENTS, 1000);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("epoll_wait failed: ") + std::strerror(errno));
+            }
+
+            refreshDate();
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) {
+                    acceptConnections();
+                } else if (fd == wakeFd) {
+                    deliverBroadcasts();
+                } else if (fd == signalFd) {
+                    // Consume it, or it is delivered once the mask is restored
+                    signalfd_siginfo info;
+                    ssize_t ignored = read(signalFd, &info, sizeof(info));
+                    (void)ignored;
+                    running = false;
+                } else if (static_cast<size_t>(fd) < connections.size() && connections[fd]) {
+                    serviceConnection(connections[fd].get(), events[i].events);
+                }
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastSweep >= std::chrono::seconds(1)) {
+                closeIdleConnections();
+                lastSweep = now;
+            }
+        }
+    }
+};
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// XXH64 (https://github.com/Cyan4973/xxHash): a non-cryptographic hash fast
+// enough to run over every module the dev server touches.
+namespace Hash {
+    constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+    constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+    inline uint64_t rotl64(uint64_t v, int r) {
+        return (v << r) | (v >> (64 - r));
+    }
+
+    inline uint64_t read64(const unsigned char* p) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint32_t read32(const unsigned char* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint64_t round64(uint64_t acc, uint64_t input) {
+        acc += input * PRIME64_2;
+        acc = rotl64(acc, 31);
+        return acc * PRIME64_1;
+    }
+
+    inline uint64_t mergeRound64(uint64_t acc, uint64_t val) {
+        acc ^= round64(0, val);
+        return acc * PRIME64_1 + PRIME64_4;
+    }
+
+    inline uint64_t xxh64(const void* data, size_t len, uint64_t seed = 0) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        const unsigned char* end = p + len;
+        uint64_t h;
+
+        if (len >= 32) {
+            uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+            uint64_t v2 = seed + PRIME64_2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - PRIME64_1;
+            const unsigned char* limit = end - 32;
+            do {
+                v1 = round64(v1, read64(p));
+                v2 = round64(v2, read64(p + 8));
+                v3 = round64(v3, read64(p + 16));
+                v4 = round64(v4, read64(p + 24));
+                p += 32;
+            } while (p <= limit);
+            h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+            h = mergeRound64(h, v1);
+            h = mergeRound64(h, v2);
+            h = mergeRound64(h, v3);
+            h = mergeRound64(h, v4);
+        } else {
+            h = seed + PRIME64_5;
+        }
+        h += static_cast<uint64_t>(len);
+
+        while (p + 8 <= end) {
+            h ^= round64(0, read64(p));
+            h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+            p += 8;
+        }
+        if (p + 4 <= end) {
+            h ^= static_cast<uint64_t>(read32(p)) * PRIME64_1;
+            h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+            p += 4;
+        }
+        while (p < end) {
+            h ^= (*p) * PRIME64_5;
+            h = rotl64(h, 11) * PRIME64_1;
+            ++p;
+        }
+
+        h ^= h >> 33;
+        h *= PRIME64_2;
+        h ^= h >> 29;
+        h *= PRIME64_3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    inline uint64_t xxh64(const std::string& data, uint64_t seed = 0) {
+        return xxh64(data.data(), data.size(), seed);
+    }
+
+    // XXH64 over data fed in pieces; digest() equals xxh64() of the pieces
+    // concatenated, so large inputs never need to sit in one buffer
+    class Xxh64 {
+    private:
+        uint64_t seed;
+        uint64_t v1, v2, v3, v4;
+        uint64_t totalLength = 0;
+        unsigned char buffer[32];
+        size_t buffered = 0;
+
+        void consume(const unsigned char* p) {
+            v1 = round64(v1, read64(p));
+            v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16));
+            v4 = round64(v4, read64(p + 24));
+        }
+
+    public:
+        explicit Xxh64(uint64_t seedValue = 0)
+            : seed(seedValue), v1(seedValue + PRIME64_1 + PRIME64_2), v2(seedValue + PRIME64_2), v3(seedValue),
+              v4(seedValue - PRIME64_1) {}
+
+        void update(const void* data, size_t len) {
+            const auto* p = static_cast<const unsigned char*>(data);
+            const unsigned char* end = p + len;
+            totalLength += len;
+            if (buffered + len < 32) {
+                std::memcpy(buffer + buffered, p, len);
+                buffered += len;
+                return;
+            }
+            if (buffered > 0) {
+                size_t fill = 32 - buffered;
+                std::memcpy(buffer + buffered, p, fill);
+                consume(buffer);
+                p += fill;
+                buffered = 0;
+            }
+            for (; p + 32 <= end; p += 32) {
+                consume(p);
+            }
+            buffered = static_cast<size_t>(end - p);
+            std::memcpy(buffer, p, buffered);
+        }
+
+        void update(const std::string& data) {
+            update(data.data(), data.size());
+        }
+
+        uint64_t digest() const {
+            uint64_t h;
+            if (totalLength >= 32) {
+                h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+                h = mergeRound64(h, v1);
+                h = mergeRound64(h, v2);
+                h = mergeRound64(h, v3);
+                h = mergeRound64(h, v4);
+            } else {
+                h = seed + PRIME64_5;
+            }
+            h += totalLength;
+
+            const unsigned char* p = buffer;
+            const unsigned char* end = buffer + buffered;
+            while (p + 8 <= end) {
+                h ^= round64(0, read64(p));
+                h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+                p += 8;
+            }
+            if (p + 4 <= end) {
+                h ^= static_cast<uint64_t>(read32(p)) * PRIME64_1;
+                h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+                p += 4;
+            }
+            while (p < end) {
+                h ^= (*p) * PRIME64_5;
+                h = rotl64(h, 11) * PRIME64_1;
+                ++p;
+            }
+
+            h ^= h >> 33;
+            h *= PRIME64_2;
+            h ^= h >> 29;
+            h *= PRIME64_3;
+            h ^= h >> 32;
+            return h;
+        }
+    };
+
+    // Feed a file's bytes to `state` straight from a read-only mapping, so
+    // a multi-megabyte lockfile is hashed without being copied into a
+    // buffer first. Returns false when the file cannot be opened.
+    inline bool updateWithFile(Xxh64& state, const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            close(fd);
+            return false;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        if (size > 0) {
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                close(fd);
+                return false;
+            }
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            state.update(mapped, size);
+            munmap(mapped, size);
+        }
+        close(fd);
+        return true;
+    }
+
+    inline std::string hex(uint64_t value) {
+        static const char* digits = "0123456789abcdef";
+        std::string out(16, '0');
+        for (int i = 15; i >= 0; --i) {
+            out[i] = digits[value & 0xf];
+            value >>= 4;
+        }
+        return out;
+    }
+
+    // Strong validator for a response body
+    inline std::string etag(const std::string& body) {
+        return "\"" + hex(xxh64(body)) + "\"";
+    }
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "module_graph.hpp"
+#include "transform.hpp"
+
+#include <string>
+#include <vector>
+
+// Hot module replacement glue between the module graph and the browser. The
+// wire format matches Vite's, so `import.meta.hot` code written for Vite runs
+// unchanged.
+namespace Hmr {
+    // Subprotocol the client requests; other upgrade requests are refused
+    constexpr const char* PROTOCOL = "vite-hmr";
+    constexpr const char* CLIENT_PATH = "/@vite/client";
+
+    // Browser runtime served at CLIENT_PATH
+    inline const std::string& clientScript() {
+        static const std::string script = R"JS(// HMR client served by the dev server
+const hotModules = new Map();
+const disposeCallbacks = new Map();
+const dataMap = new Map();
+const customListeners = new Map();
+
+const socketProtocol = location.protocol === 'https:' ? 'wss' : 'ws';
+const socket = new WebSocket(`${socketProtocol}://${location.host}/`, 'vite-hmr');
+
+socket.addEventListener('open', () => console.debug('[vite] connected.'));
+socket.addEventListener('message', ({ data }) => handleMessage(JSON.parse(data)));
+socket.addEventListener('close', async ({ wasClean }) => {
+  if (wasClean) return;
+  console.log('[vite] server connection lost. Polling for restart...');
+  while (true) {
+    try {
+      await fetch(`${location.protocol}//${location.host}/`, { method: 'HEAD' });
+      break;
+    } catch {
+      await new Promise((resolve) => setTimeout(resolve, 1000));
+    }
+  }
+  location.reload();
+});
+
+function notifyListeners(event, data) {
+  const callbacks = customListeners.get(event);
+  if (callbacks) callbacks.forEach((cb) => cb(data));
+}
+
+async function handleMessage(payload) {
+  switch (payload.type) {
+    case 'update':
+      notifyListeners('vite:beforeUpdate', payload);
+      await Promise.all(payload.updates.map((update) =>
+        update.type === 'js-update' ? queueUpdate(fetchUpdate(update)) : updateStylesheet(update)));
+      notifyListeners('vite:afterUpdate', payload);
+      break;
+    case 'full-reload':
+      notifyListeners('vite:beforeFullReload', payload);
+      location.reload();
+      break;
+    case 'error':
+      console.error(`[vite] ${payload.err && payload.err.message}`);
+      break;
+  }
+}
+
+function updateStylesheet({ path, timestamp }) {
+  const links = document.querySelectorAll('link[rel="stylesheet"]');
+  const el = [...links].find((link) => new URL(link.href).pathname === path);
+  if (!el) return;
+  const next = el.cloneNode();
+  next.href = new URL(`${path}?t=${timestamp}`, location.href).href;
+  const done = () => el.remove();
+  next.addEventListener('load', done);
+  next.addEventListener('error', done);
+  el.after(next);
+  console.debug(`[vite] css hot updated: ${path}`);
+}
+
+// Updates arriving together are fetched in parallel but applied in order
+let pending = false;
+let queued = [];
+async function queueUpdate(promise) {
+  queued.push(promise);
+  if (!pending) {
+    pending = true;
+    await Promise.resolve();
+    pending = false;
+    const loading = [...queued];
+    queued = [];
+    (await Promise.all(loading)).forEach((apply) => apply && apply());
+  }
+}
+
+async function fetchUpdate({ path, acceptedPath, timestamp }) {
+  const mod = hotModules.get(path);
+  if (!mod) return;
+  const qualified = mod.callbacks.filter(({ deps }) => deps.includes(acceptedPath));
+  const dispose = disposeCallbacks.get(acceptedPath);
+  if (dispose) await dispose(dataMap.get(acceptedPath));
+
+  let fetched;
+  try {
+    const separator = acceptedPath.includes('?') ? '&' : '?';
+    fetched = await import(`${acceptedPath}${separator}t=${timestamp}`);
+  } catch (e) {
+    console.error(`[vite] failed to reload ${acceptedPath}. Reloading the page.`, e);
+    location.reload();
+    return;
+  }
+  return () => {
+    for (const { deps, fn } of qualified) {
+      fn(deps.map((dep) => (dep === acceptedPath ? fetched : undefined)));
+    }
+    const via = acceptedPath === path ? path : `${acceptedPath} via ${path}`;
+    console.debug(`[vite] hot updated: ${via}`);
+  };
+}
+
+export function createHotContext(ownerPath) {
+  if (!dataMap.has(ownerPath)) dataMap.set(ownerPath, {});
+  // A re-executed module registers fresh callbacks
+  const existing = hotModules.get(ownerPath);
+  if (existing) existing.callbacks = [];
+
+  const resolve = (dep) => new URL(dep, `${location.origin}${ownerPath}`).pathname;
+  const accept = (deps, fn) => {
+    const mod = hotModules.get(ownerPath) || { id: ownerPath, callbacks: [] };
+    mod.callbacks.push({ deps, fn });
+    hotModules.set(ownerPath, mod);
+  };
+
+  return {
+    get data() {
+      return dataMap.get(ownerPath);
+    },
+    accept(deps, callback) {
+      if (typeof deps === 'function' || !deps) {
+        accept([ownerPath], ([mod]) => deps && deps(mod));
+      } else if (typeof deps === 'string') {
+        accept([resolve(deps)], ([mod]) => callback && callback(mod));
+      } else if (Array.isArray(deps)) {
+        accept(deps.map(resolve), callback || (() => {}));
+      }
+    },
+    dispose(cb) {
+      disposeCallbacks.set(ownerPath, cb);
+    },
+    prune() {},
+    decline() {},
+    invalidate() {
+      location.reload();
+    },
+    on(event, cb) {
+      const callbacks = customListeners.get(event) || [];
+      callbacks.push(cb);
+      customListeners.set(event, callbacks);
+    },
+    send() {},
+  };
+}
+)JS";
+        return script;
+    }
+
+    // Load the client from every served HTML page
+    inline std::string injectClient(const std::string& html) {
+        std::string tag = std::string("<script type=\"module\" src=\"") + CLIENT_PATH + "\"></script>";
+        size_t head = html.find("<head");
+        if (head != std::string::npos) {
+            size_t close = html.find('>', head);
+            if (close != std::string::npos) {
+                return html.substr(0, close + 1) + "\n    " + tag + html.substr(close + 1);
+            }
+        }
+        return tag + "\n" + html;
+    }
+
+    // Prepended to modules using import.meta.hot
+    inline std::string hotPreamble(const std::string& url) {
+        return std::string("import { createHotContext as __vite__createHotContext } from \"") + CLIENT_PATH + "\";\n"
+               "import.meta.hot = __vite__createHotContext(" + Transforms::jsStringLiteral(url) + ");\n";
+    }
+
+    // JS modules re-imported at their accept boundaries, plus stylesheets
+    // loaded with <link> that are swapped in place
+    inline std::string updateMessage(const std::vector<HmrBoundary>& boundaries,
+                                     const std::vector<std::string>& stylesheets, long long timestamp) {
+        std::string json = "{\"type\":\"update\",\"updates\":[";
+        auto add = [&](const char* type, const std::string& path, const std::string& acceptedPath) {
+            json += json.back() == '[' ? "" : ",";
+            json += std::string("{\"type\":\"") + type + "\",\"timestamp\":" + std::to_string(timestamp) +
+                    ",\"path\":" + Transforms::jsStringLiteral(path) +
+                    ",\"acceptedPath\":" + Transforms::jsStringLiteral(acceptedPath) + "}";
+        };
+        for (const auto& b : boundaries) {
+            add("js-update", b.boundary, b.acceptedVia);
+        }
+        for (const auto& url : stylesheets) {
+            add("css-update", url, url);
+        }
+        json += "]}";
+        return json;
+    }
+
+    inline std::string fullReloadMessage(const std::string& url) {
+        return "{\"type\":\"full-reload\",\"path\":" + Transforms::jsStringLiteral(url) + "}";
+    }
+}
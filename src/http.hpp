@@ -0,0 +1,393 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <ctime>
+#include <cctype>
+#include <memory>
+
+#include <unistd.h>
+#include <sys/types.h>
+
+// Minimal HTTP/1.1 message types shared by the dev and preview servers
+namespace Http {
+    inline bool iequals(const std::string& a, const std::string& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline const char* statusText(int status) {
+        switch (status) {
+            case 101: return "Switching Protocols";
+            case 200: return "OK";
+            case 204: return "No Content";
+            case 206: return "Partial Content";
+            case 301: return "Moved Permanently";
+            case 302: return "Found";
+            case 304: return "Not Modified";
+            case 400: return "Bad Request";
+            case 403: return "Forbidden";
+            case 404: return "Not Found";
+            case 405: return "Method Not Allowed";
+            case 413: return "Payload Too Large";
+            case 414: return "URI Too Long";
+            case 431: return "Request Header Fields Too Large";
+            case 500: return "Internal Server Error";
+            case 501: return "Not Implemented";
+            case 505: return "HTTP Version Not Supported";
+            default: return "Unknown";
+        }
+    }
+
+    inline std::string mimeType(const std::string& path) {
+        size_t dot = path.rfind('.');
+        if (dot == std::string::npos) {
+            return "application/octet-stream";
+        }
+        std::string ext = path.substr(dot + 1);
+        for (auto& c : ext) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        if (ext == "html" || ext == "htm") return "text/html; charset=utf-8";
+        if (ext == "js" || ext == "mjs" || ext == "cjs" || ext == "jsx" || ext == "ts" || ext == "tsx") return "text/javascript; charset=utf-8";
+        if (ext == "css") return "text/css; charset=utf-8";
+        if (ext == "json" || ext == "map") return "application/json; charset=utf-8";
+        if (ext == "svg") return "image/svg+xml";
+        if (ext == "png") return "image/png";
+        if (ext == "jpg" || ext == "jpeg") return "image/jpeg";
+        if (ext == "gif") return "image/gif";
+        if (ext == "webp") return "image/webp";
+        if (ext == "avif") return "image/avif";
+        if (ext == "ico") return "image/x-icon";
+        if (ext == "woff") return "font/woff";
+        if (ext == "woff2") return "font/woff2";
+        if (ext == "ttf") return "font/ttf";
+        if (ext == "otf") return "font/otf";
+        if (ext == "wasm") return "application/wasm";
+        if (ext == "txt") return "text/plain; charset=utf-8";
+        if (ext == "xml") return "application/xml";
+        if (ext == "mp4") return "video/mp4";
+        if (ext == "webm") return "video/webm";
+        if (ext == "mp3") return "audio/mpeg";
+        if (ext == "pdf") return "application/pdf";
+        return "application/octet-stream";
+    }
+
+    // RFC 7231 IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+    inline std::string formatDate(std::time_t t) {
+        char buf[64];
+        std::tm tm{};
+        gmtime_r(&t, &tm);
+        std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        return buf;
+    }
+
+    // If-None-Match uses the weak comparison: W/ prefixes are ignored and
+    // any entry (or "*") matching `etag` counts
+    inline bool etagMatches(const std::string& ifNoneMatch, const std::string& etag) {
+        if (ifNoneMatch.empty() || etag.empty()) {
+            return false;
+        }
+        size_t pos = 0;
+        while (pos < ifNoneMatch.size()) {
+            size_t comma = ifNoneMatch.find(',', pos);
+            std::string candidate = ifNoneMatch.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+            size_t first = candidate.find_first_not_of(" \t");
+            size_t last = candidate.find_last_not_of(" \t");
+            candidate = first == std::string::npos ? "" : candidate.substr(first, last - first + 1);
+            if (candidate.compare(0, 2, "W/") == 0) {
+                candidate.erase(0, 2);
+            }
+            if (candidate == "*" || candidate == etag) {
+                return true;
+            }
+            if (comma == std::string::npos) {
+                break;
+            }
+            pos = comma + 1;
+        }
+        return false;
+    }
+
+    // Decode %XX escapes in a URL path; returns false on malformed input
+    inline bool percentDecode(const std::string& in, std::string& out) {
+        out.clear();
+        out.reserve(in.size());
+        for (size_t i = 0; i < in.size(); ++i) {
+            if (in[i] == '%') {
+                if (i + 2 >= in.size() || !std::isxdigit(static_cast<unsigned char>(in[i + 1])) ||
+                    !std::isxdigit(static_cast<unsigned char>(in[i + 2]))) {
+                    return false;
+                }
+                out += static_cast<char>(std::stoi(in.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+            } else {
+                out += in[i];
+            }
+        }
+        return true;
+    }
+}
+
+// An open file descriptor that response bodies can be streamed from with
+// sendfile(2). Shared ownership keeps the fd alive while a response is still
+// being written, even after the file has left the cache that opened it.
+class OpenFile {
+public:
+    int fd;
+    size_t size;
+    ino_t inode;
+    struct timespec mtime;
+
+    OpenFile(int f, size_t s, ino_t ino, struct timespec mt) : fd(f), size(s), inode(ino), mtime(mt) {}
+    ~OpenFile() {
+        close(fd);
+    }
+
+    OpenFile(const OpenFile&) = delete;
+    OpenFile& operator=(const OpenFile&) = delete;
+};
+
+class HttpRequest {
+public:
+    std::string method;
+    std::string target;
+    std::string path;
+    std::string query;
+    int versionMinor = 1;
+    std::vector<std::pair<std::string, std::string>> headers;
+    bool keepAlive = true;
+
+    std::string header(const std::string& name) const {
+        for (const auto& h : headers) {
+            if (Http::iequals(h.first, name)) {
+                return h.second;
+            }
+        }
+        return "";
+    }
+
+    bool hasHeader(const std::string& name) const {
+        for (const auto& h : headers) {
+            if (Http::iequals(h.first, name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+class HttpResponse {
+public:
+    int status = 200;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    std::shared_ptr<const OpenFile> file;
+    bool headOnly = false;
+    bool close = false;
+    // Switch the connection to the WebSocket protocol after this 101
+    bool upgrade = false;
+
+    // Stream the body straight from an open file instead of `body`
+    void sendFile(std::shared_ptr<const OpenFile> f) {
+        file = std::move(f);
+        body.clear();
+    }
+
+    size_t contentLength() const {
+        return file ? file->size : body.size();
+    }
+
+    void setHeader(const std::string& name, const std::string& value) {
+        for (auto& h : headers) {
+            if (Http::iequals(h.first, name)) {
+                h.second = value;
+                return;
+            }
+        }
+        headers.emplace_back(name, value);
+    }
+
+    // Serialize status line and headers; the body is appended by the caller
+    std::string serializeHead(bool keepAlive, const std::string& date) const {
+        std::string out;
+        out.reserve(256);
+        out += "HTTP/1.1 ";
+        out += std::to_string(status);
+        out += ' ';
+        out += Http::statusText(status);
+        out += "\r\n";
+        for (const auto& h : headers) {
+            out += h.first;
+            out += ": ";
+            out += h.second;
+            out += "\r\n";
+        }
+        if (status != 304 && status != 204 && status >= 200) {
+            out += "Content-Length: ";
+            out += std::to_string(contentLength());
+            out += "\r\n";
+        }
+        out += "Date: ";
+        out += date;
+        out += "\r\n";
+        if (!upgrade) {
+            out += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+        }
+        out += "\r\n";
+        return out;
+    }
+};
+
+// Incremental request parser. Requests are parsed straight out of the
+// connection buffer so pipelined requests can be consumed one after another.
+class HttpParser {
+public:
+    enum class Result { Complete, Incomplete, Error };
+
+    static constexpr size_t MAX_HEADER_BYTES = 64 * 1024;
+    static constexpr size_t MAX_BODY_BYTES = 8 * 1024 * 1024;
+
+    // On Complete, `consumed` is the number of bytes making up the request
+    // (head and body). On Error, `errorStatus` holds the status to reply with.
+    static Result parse(const char* data, size_t len, HttpRequest& req, size_t& consumed, int& errorStatus) {
+        const char* end = findHeadEnd(data, len);
+        if (!end) {
+            if (len > MAX_HEADER_BYTES) {
+                errorStatus = 431;
+                return Result::Error;
+            }
+            return Result::Incomplete;
+        }
+        size_t headLen = static_cast<size_t>(end - data) + 4;
+
+        req = HttpRequest();
+        const char* p = data;
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\r', headLen));
+        if (!parseRequestLine(p, lineEnd, req)) {
+            errorStatus = 400;
+            return Result::Error;
+        }
+        if (req.versionMinor < 0) {
+            errorStatus = 505;
+            return Result::Error;
+        }
+
+        p = lineEnd + 2;
+        while (p < end) {
+            const char* eol = static_cast<const char*>(std::memchr(p, '\r', static_cast<size_t>(end + 2 - p)));
+            const char* colon = static_cast<const char*>(std::memchr(p, ':', static_cast<size_t>(eol - p)));
+            if (!colon || colon == p) {
+                errorStatus = 400;
+                return Result::Error;
+            }
+            const char* v = colon + 1;
+            while (v < eol && (*v == ' ' || *v == '\t')) ++v;
+            const char* ve = eol;
+            while (ve > v && (ve[-1] == ' ' || ve[-1] == '\t')) --ve;
+            req.headers.emplace_back(std::string(p, colon), std::string(v, ve));
+            p = eol + 2;
+        }
+
+        size_t bodyLen = 0;
+        for (const auto& h : req.headers) {
+            if (Http::iequals(h.first, "Transfer-Encoding")) {
+                errorStatus = 501;
+                return Result::Error;
+            }
+            if (Http::iequals(h.first, "Content-Length")) {
+                try {
+                    unsigned long long n = std::stoull(h.second);
+                    if (n > MAX_BODY_BYTES) {
+                        errorStatus = 413;
+                        return Result::Error;
+                    }
+                    bodyLen = static_cast<size_t>(n);
+                } catch (...) {
+                    errorStatus = 400;
+                    return Result::Error;
+                }
+            }
+        }
+        if (len < headLen + bodyLen) {
+            return Result::Incomplete;
+        }
+
+        std::string connection = req.header("Connection");
+        if (req.versionMinor == 0) {
+            req.keepAlive = Http::iequals(connection, "keep-alive");
+        } else {
+            req.keepAlive = !Http::iequals(connection, "close");
+        }
+
+        consumed = headLen + bodyLen;
+        return Result::Complete;
+    }
+
+private:
+    static const char* findHeadEnd(const char* data, size_t len) {
+        if (len < 4) {
+            return nullptr;
+        }
+        const char* p = data;
+        const char* last = data + len - 3;
+        while (p < last) {
+            p = static_cast<const char*>(std::memchr(p, '\r', static_cast<size_t>(last - p)));
+            if (!p) {
+                return nullptr;
+            }
+            if (p[1] == '\n' && p[2] == '\r' && p[3] == '\n') {
+                return p;
+            }
+            ++p;
+        }
+        return nullptr;
+    }
+
+    static bool parseRequestLine(const char* p, const char* eol, HttpRequest& req) {
+        if (!eol || eol[1] != '\n') {
+            return false;
+        }
+        const char* sp1 = static_cast<const char*>(std::memchr(p, ' ', static_cast<size_t>(eol - p)));
+        if (!sp1 || sp1 == p) {
+            return false;
+        }
+        const char* sp2 = static_cast<const char*>(std::memchr(sp1 + 1, ' ', static_cast<size_t>(eol - sp1 - 1)));
+        if (!sp2 || sp2 == sp1 + 1) {
+            return false;
+        }
+        req.method.assign(p, sp1);
+        req.target.assign(sp1 + 1, sp2);
+
+        std::string version(sp2 + 1, eol);
+        if (version == "HTTP/1.1") {
+            req.versionMinor = 1;
+        } else if (version == "HTTP/1.0") {
+            req.versionMinor = 0;
+        } else if (version.compare(0, 5, "HTTP/") == 0) {
+            req.versionMinor = -1;
+        } else {
+            return false;
+        }
+
+        size_t q = req.target.find('?');
+        std::string rawPath = q == std::string::npos ? req.target : req.target.substr(0, q);
+        if (q != std::string::npos) {
+            req.query = req.target.substr(q + 1);
+        }
+        size_t hash = rawPath.find('#');
+        if (hash != std::string::npos) {
+            rawPath.resize(hash);
+        }
+        return Http::percentDecode(rawPath, req.path);
+    }
+};
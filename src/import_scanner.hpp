@@ -0,0 +1,868 @@
+#pragma once
+
+#include "lexer.hpp"
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <cctype>
+
+// One import specifier found in a module. `start` and `end` delimit the
+// specifier text inside its quotes, so callers can rewrite it in place.
+class ImportRecord {
+public:
+    std::string specifier;
+    size_t start = 0;
+    size_t end = 0;
+    bool dynamic = false;
+    // The whole `import(...)` expression of a dynamic import
+    size_t callStart = 0;
+    size_t callEnd = 0;
+};
+
+// A top-level import or export statement, for tools that rewrite module
+// syntax rather than just specifiers. For statements with a module
+// specifier, `importIndex` points into ImportScan::imports.
+class ModuleDeclaration {
+public:
+    enum class Kind {
+        Import,             // import d, { a as b } from 'x' / import * as ns from 'x' / import 'x'
+        ExportFrom,         // export { a as b } from 'x' / export * as ns from 'x'
+        ExportAll,          // export * from 'x'
+        ExportList,         // export { a as b }
+        ExportDefault,      // export default <expression or declaration>
+        ExportDeclaration   // export const/let/var/function/class ...
+    };
+
+    Kind kind = Kind::Import;
+    // The statement, including a trailing semicolon. For ExportDefault and
+    // ExportDeclaration only the `export` / `export default` keywords are
+    // covered; the body that follows is ordinary code.
+    size_t start = 0;
+    size_t end = 0;
+    int importIndex = -1;
+    std::string defaultBinding;
+    std::string namespaceBinding;
+    // Braced bindings as (name before `as`, name after `as`); for
+    // ExportDeclaration each declared name paired with itself
+    std::vector<std::pair<std::string, std::string>> names;
+    // ExportDefault of a function or class declaration: its name, "" when
+    // anonymous. `defaultIsDeclaration` is false for expressions.
+    bool defaultIsDeclaration = false;
+    std::string defaultName;
+};
+
+// A `require('x')` call; start/end cover the whole call
+class RequireCall {
+public:
+    std::string specifier;
+    size_t start = 0;
+    size_t end = 0;
+};
+
+class ImportScan {
+public:
+    std::vector<ImportRecord> imports;
+    // The module touches import.meta.hot and needs a hot context
+    bool usesHot = false;
+    // import.meta.hot.accept() / accept(cb)
+    bool selfAccepting = false;
+    // Specifiers passed to import.meta.hot.accept('./dep', cb)
+    std::vector<std::string> acceptedDeps;
+    std::vector<ModuleDeclaration> declarations;
+    // CommonJS: `require`, `module` or `exports` is used
+    bool usesCommonJs = false;
+    std::vector<RequireCall> requires;
+    // Names assigned to exports.NAME / module.exports.NAME or defined with
+    // Object.defineProperty(exports, 'NAME'), and modules whose exports are
+    // re-exported with `module.exports = require('x')`
+    std::vector<std::string> cjsExports;
+    std::vector<std::string> cjsReexports;
+
+    // Static syntax, or no CommonJS either
+    bool isEsm() const {
+        return !declarations.empty() || !usesCommonJs;
+    }
+};
+
+// Finds the import and re-export specifiers of an ES module without building
+// a syntax tree. It tracks just enough lexical state (strings, comments,
+// template literals, regex literals) that specifier-looking text inside them
+// is never mistaken for an import.
+class ImportScanner {
+private:
+    const std::string& src;
+    size_t pos = 0;
+    bool regexAllowed = true;
+    int braceDepth = 0;
+    // braceDepth at each open `${` of an enclosing template literal
+    std::vector<int> templateBraces;
+    ImportScan result;
+
+    explicit ImportScanner(const std::string& source) : src(source) {}
+
+    static bool isIdentStart(char c) {
+        return std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '$' || static_cast<unsigned char>(c) >= 0x80;
+    }
+
+    static bool isIdentPart(char c) {
+        return isIdentStart(c) || std::isdigit(static_cast<unsigned char>(c));
+    }
+
+    // Skip whitespace and comments starting at `p`
+    size_t skipTrivia(size_t p) const {
+        while (p < src.size()) {
+            char c = src[p];
+            if (Simd::isSpaceByte(static_cast<unsigned char>(c))) {
+                p = static_cast<size_t>(Simd::skipSpace(src.data() + p, src.data() + src.size()) - src.data());
+            } else if (c == '/' && p + 1 < src.size() && src[p + 1] == '/') {
+                size_t eol = src.find('\n', p);
+                p = eol == std::string::npos ? src.size() : eol + 1;
+            } else if (c == '/' && p + 1 < src.size() && src[p + 1] == '*') {
+                size_t close = src.find("*/", p + 2);
+                p = close == std::string::npos ? src.size() : close + 2;
+            } else {
+                break;
+            }
+        }
+        return p;
+    }
+
+    // `p` is on an opening quote; returns the index of the closing quote,
+    // or of the line break ending an unterminated string
+    size_t stringEnd(size_t p) const {
+        char quote = src[p];
+        const char* end = src.data() + src.size();
+        for (++p; p < src.size(); p += 2) {
+            p = static_cast<size_t>(Simd::findStringStop(src.data() + p, end, quote) - src.data());
+            if (p >= src.size() || src[p] != '\\') {
+                return std::min(p, src.size());
+            }
+        }
+        return src.size();
+    }
+
+    size_t identEnd(size_t p) const {
+        if (p >= src.size()) {
+            return p;
+        }
+        return static_cast<size_t>(Simd::identifierEnd(src.data() + p, src.data() + src.size()) - src.data());
+    }
+
+    bool identAt(size_t p, const char* word) const {
+        size_t len = std::strlen(word);
+        return src.compare(p, len, word) == 0 && identEnd(p) == p + len;
+    }
+
+    // Continue a template literal from `pos` until its end or the next `${`
+    void scanTemplate() {
+        while (pos < src.size()) {
+            pos = static_cast<size_t>(Simd::findTemplateStop(src.data() + pos, src.data() + src.size()) - src.data());
+            if (pos >= src.size()) {
+                return;
+            }
+            char c = src[pos];
+            if (c == '\\') {
+                pos += 2;
+            } else if (c == '`') {
+                ++pos;
+                regexAllowed = false;
+                return;
+            } else if (c == '$' && pos + 1 < src.size() && src[pos + 1] == '{') {
+                templateBraces.push_back(braceDepth);
+                ++braceDepth;
+                pos += 2;
+                regexAllowed = true;
+                return;
+            } else {
+                ++pos;
+            }
+        }
+    }
+
+    void skipRegex() {
+        bool inClass = false;
+        for (++pos; pos < src.size(); ++pos) {
+            char c = src[pos];
+            if (c == '\\') {
+                ++pos;
+            } else if (c == '[') {
+                inClass = true;
+            } else if (c == ']') {
+                inClass = false;
+            } else if (c == '\n') {
+                break;
+            } else if (c == '/' && !inClass) {
+                ++pos;
+                break;
+            }
+        }
+        pos = identEnd(pos);
+        regexAllowed = false;
+    }
+
+    ImportRecord& record(size_t quote, bool dynamic) {
+        size_t close = stringEnd(quote);
+        ImportRecord rec;
+        rec.start = quote + 1;
+        rec.end = close;
+        rec.specifier = src.substr(rec.start, rec.end - rec.start);
+        rec.dynamic = dynamic;
+        result.imports.push_back(std::move(rec));
+        return result.imports.back();
+    }
+
+    bool topLevel() const {
+        return braceDepth == 0 && templateBraces.empty();
+    }
+
+    // An identifier or quoted name at `p`; returns the position after it
+    size_t readName(size_t p, std::string& name) const {
+        if (p < src.size() && (src[p] == '\'' || src[p] == '"')) {
+            size_t close = stringEnd(p);
+            name = src.substr(p + 1, close - p - 1);
+            return close + 1;
+        }
+        size_t e = identEnd(p);
+        name = src.substr(p, e - p);
+        return e;
+    }
+
+    // Past the specifier of an import/export: skip import attributes
+    // (`with { type: 'json' }`) and a terminating semicolon
+    size_t statementEnd(size_t p) const {
+        size_t q = skipTrivia(p);
+        if (identAt(q, "with") || identAt(q, "assert")) {
+            size_t brace = skipTrivia(identEnd(q));
+            if (brace < src.size() && src[brace] == '{') {
+                size_t close = src.find('}', brace);
+                p = close == std::string::npos ? src.size() : close + 1;
+                q = skipTrivia(p);
+            }
+        }
+        return q < src.size() && src[q] == ';' ? q + 1 : p;
+    }
+
+    // Bindings of an import/export clause between `p` and `limit`
+    void parseBindings(size_t p, size_t limit, ModuleDeclaration& decl) const {
+        bool inBraces = false;
+        while (true) {
+            p = skipTrivia(p);
+            if (p >= limit) {
+                return;
+            }
+            char c = src[p];
+            if (c == '{' || c == '}') {
+                inBraces = c == '{';
+                ++p;
+            } else if (c == '*') {
+                p = skipTrivia(p + 1);
+                if (identAt(p, "as")) {
+                    p = readName(skipTrivia(p + 2), decl.namespaceBinding);
+                }
+            } else if (c == '\'' || c == '"' || isIdentStart(c)) {
+                std::string first;
+                p = readName(p, first);
+                if (!inBraces) {
+                    if (first == "from") {
+                        return;
+                    }
+                    if (first != "type") {
+                        decl.defaultBinding = first;
+                    }
+                    continue;
+                }
+                std::string second = first;
+                size_t q = skipTrivia(p);
+                if (identAt(q, "as")) {
+                    p = readName(skipTrivia(q + 2), second);
+                }
+                decl.names.emplace_back(first, second);
+            } else {
+                ++p;
+            }
+        }
+    }
+
+    // Whether a `/` after `prev` (the last significant character, 'a' for
+    // identifiers and literals) starts a regex
+    static bool regexAfter(char prev) {
+        return prev != 'a' && prev != ')' && prev != ']' && prev != '}';
+    }
+
+    // `p` is on a backquote; returns the position after the template
+    size_t templateEnd(size_t p) const {
+        for (++p; p < src.size(); ++p) {
+            if (src[p] == '\\') {
+                ++p;
+            } else if (src[p] == '`') {
+                return p + 1;
+            } else if (src[p] == '$' && p + 1 < src.size() && src[p + 1] == '{') {
+                p = skipExpression(p + 2, false);
+            }
+        }
+        return src.size();
+    }
+
+    // Skip an expression starting at `p`, stopping at a `,` or `;` outside
+    // brackets or at an unbalanced closing bracket. With `statement`, a line
+    // break after a complete operand followed by an identifier also ends it
+    // (automatic semicolon insertion).
+    size_t skipExpression(size_t p, bool statement) const {
+        int depth = 0;
+        char prev = '=';
+        while (p < src.size()) {
+            char c = src[p];
+            if (std::isspace(static_cast<unsigned char>(c)) ||
+                (c == '/' && p + 1 < src.size() && (src[p + 1] == '/' || src[p + 1] == '*'))) {
+                size_t next = skipTrivia(p);
+                bool newline = src.find('\n', p) < next;
+                if (statement && depth == 0 && newline && !regexAfter(prev) && next < src.size() &&
+                    isIdentStart(src[next]) && !identAt(next, "instanceof") && !identAt(next, "in")) {
+                    return p;
+                }
+                p = next;
+                continue;
+            }
+            if (c == '\'' || c == '"') {
+                p = stringEnd(p) + 1;
+                prev = 'a';
+            } else if (c == '`') {
+                p = templateEnd(p);
+                prev = 'a';
+            } else if (c == '/' && regexAfter(prev)) {
+                bool inClass = false;
+                for (++p; p < src.size() && src[p] != '\n'; ++p) {
+                    if (src[p] == '\\') {
+                        ++p;
+                    } else if (src[p] == '[') {
+                        inClass = true;
+                    } else if (src[p] == ']') {
+                        inClass = false;
+                    } else if (src[p] == '/' && !inClass) {
+                        break;
+                    }
+                }
+                p = identEnd(p + 1);
+                prev = 'a';
+            } else if (c == '(' || c == '[' || c == '{') {
+                ++depth;
+                ++p;
+                prev = c;
+            } else if (c == ')' || c == ']' || c == '}') {
+                if (depth == 0) {
+                    return p;
+                }
+                --depth;
+                ++p;
+                prev = c;
+            } else if ((c == ',' || c == ';') && depth == 0) {
+                return p;
+            } else if (isIdentStart(c)) {
+                size_t e = identEnd(p);
+                prev = Lexer::keywordBeforeExpression(src.data() + p, e - p) ? '=' : 'a';
+                p = e;
+            } else if (std::isdigit(static_cast<unsigned char>(c))) {
+                while (p < src.size() && (isIdentPart(src[p]) || src[p] == '.')) {
+                    ++p;
+                }
+                prev = 'a';
+            } else {
+                ++p;
+                prev = c;
+            }
+        }
+        return p;
+    }
+
+    // Names bound by a declaration target: an identifier or a destructuring
+    // pattern. Returns the position after it.
+    size_t collectPattern(size_t p, std::vector<std::string>& names) const {
+        p = skipTrivia(p);
+        if (p >= src.size()) {
+            return p;
+        }
+        char open = src[p];
+        if (open != '{' && open != '[') {
+            std::string name;
+            size_t e = readName(p, name);
+            if (!name.empty()) {
+                names.push_back(name);
+            }
+            return e;
+        }
+        char close = open == '{' ? '}' : ']';
+        ++p;
+        while (true) {
+            p = skipTrivia(p);
+            if (p >= src.size() || src[p] == close) {
+                return p + 1;
+            }
+            if (src[p] == ',') {
+                ++p;
+                continue;
+            }
+            if (src.compare(p, 3, "...") == 0) {
+                p = collectPattern(p + 3, names);
+            } else if (open == '[') {
+                p = collectPattern(p, names);
+            } else {
+                // Object pattern: `key`, `key: target` or `[computed]: target`
+                std::string key;
+                size_t afterKey;
+                if (src[p] == '[') {
+                    afterKey = skipExpression(p + 1, false) + 1;
+                } else {
+                    afterKey = readName(p, key);
+                    if (afterKey == p) {
+                        return src.size();
+                    }
+                }
+                size_t q = skipTrivia(afterKey);
+                if (q < src.size() && src[q] == ':') {
+                    p = collectPattern(q + 1, names);
+                } else {
+                    names.push_back(key);
+                    p = afterKey;
+                }
+            }
+            p = skipTrivia(p);
+            if (p < src.size() && src[p] == '=') {
+                p = skipExpression(p + 1, false);
+            }
+        }
+    }
+
+    // `export <declaration>` at `p`
+    void declaredNames(size_t p, ModuleDeclaration& decl) const {
+        std::vector<std::string> names;
+        if (identAt(p, "async")) {
+            p = skipTrivia(p + 5);
+        }
+        if (identAt(p, "function") || identAt(p, "class")) {
+            p = skipTrivia(identEnd(p));
+            if (p < src.size() && src[p] == '*') {
+                p = skipTrivia(p + 1);
+            }
+            collectPattern(p, names);
+        } else {
+            p = identEnd(p);
+            while (true) {
+                p = skipTrivia(collectPattern(p, names));
+                if (p < src.size() && src[p] == '=') {
+                    p = skipTrivia(skipExpression(p + 1, true));
+                }
+                if (p >= src.size() || src[p] != ',') {
+                    break;
+                }
+                ++p;
+            }
+        }
+        for (const auto& name : names) {
+            decl.names.emplace_back(name, name);
+        }
+    }
+
+    // Keys of an object literal assigned to module.exports
+    void objectLiteralKeys(size_t p) {
+        ++p;
+        while (true) {
+            p = skipTrivia(p);
+            if (p >= src.size() || src[p] == '}') {
+                return;
+            }
+            if (src[p] == ',') {
+                ++p;
+                continue;
+            }
+            std::string key;
+            size_t afterKey = src[p] == '\'' || src[p] == '"' || isIdentStart(src[p]) ? readName(p, key) : p;
+            size_t q = skipTrivia(afterKey);
+            if (afterKey != p && q < src.size() && (src[q] == ',' || src[q] == '}' || src[q] == ':' || src[q] == '(')) {
+                result.cjsExports.push_back(key);
+            }
+            size_t next = skipExpression(afterKey == p ? p : q, false);
+            if (next == p) {
+                return;
+            }
+            p = next;
+        }
+    }
+
+    // After `exports` or `module.exports`
+    void onExportsTarget(size_t p, bool viaModule) {
+        p = skipTrivia(p);
+        if (p >= src.size()) {
+            return;
+        }
+        std::string name;
+        size_t after = p;
+        if (src[p] == '.') {
+            after = readName(skipTrivia(p + 1), name);
+        } else if (src[p] == '[') {
+            size_t q = skipTrivia(p + 1);
+            if (q < src.size() && (src[q] == '\'' || src[q] == '"')) {
+                after = skipTrivia(readName(q, name));
+                after = after < src.size() && src[after] == ']' ? after + 1 : p;
+            }
+        }
+        size_t q = skipTrivia(after);
+        bool assigned = q + 1 < src.size() && src[q] == '=' && src[q + 1] != '=';
+        if (!name.empty() && assigned) {
+            result.cjsExports.push_back(name);
+            return;
+        }
+        if (!viaModule || src[p] != '=' || p + 1 >= src.size() || src[p + 1] == '=') {
+            return;
+        }
+        q = skipTrivia(p + 1);
+        if (identAt(q, "require")) {
+            size_t paren = skipTrivia(q + 7);
+            size_t quote = paren < src.size() && src[paren] == '(' ? skipTrivia(paren + 1) : src.size();
+            if (quote < src.size() && (src[quote] == '\'' || src[quote] == '"')) {
+                result.cjsReexports.push_back(src.substr(quote + 1, stringEnd(quote) - quote - 1));
+            }
+        } else if (q < src.size() && src[q] == '{') {
+            objectLiteralKeys(q);
+        }
+    }
+
+    // `require` at `start`, with `pos` just past it
+    void onRequire(size_t start) {
+        result.usesCommonJs = true;
+        size_t paren = skipTrivia(pos);
+        if (paren >= src.size() || src[paren] != '(') {
+            return;
+        }
+        size_t quote = skipTrivia(paren + 1);
+        if (quote >= src.size() || (src[quote] != '\'' && src[quote] != '"')) {
+            return;
+        }
+        size_t close = stringEnd(quote);
+        size_t end = skipTrivia(close + 1);
+        if (end < src.size() && src[end] == ')') {
+            RequireCall call;
+            call.specifier = src.substr(quote + 1, close - quote - 1);
+            call.start = start;
+            call.end = end + 1;
+            result.requires.push_back(std::move(call));
+        }
+    }
+
+    // `Object.defineProperty(exports, 'name', ...)`
+    void onDefineProperty() {
+        size_t p = skipTrivia(pos);
+        if (p >= src.size() || src[p] != '(') {
+            return;
+        }
+        p = skipTrivia(p + 1);
+        if (identAt(p, "module")) {
+            p = skipTrivia(p + 6);
+            if (p >= src.size() || src[p] != '.') {
+                return;
+            }
+            p = skipTrivia(p + 1);
+        }
+        if (!identAt(p, "exports")) {
+            return;
+        }
+        p = skipTrivia(p + 7);
+        if (p < src.size() && src[p] == ',') {
+            p = skipTrivia(p + 1);
+            if (p < src.size() && (src[p] == '\'' || src[p] == '"')) {
+                result.cjsExports.push_back(src.substr(p + 1, stringEnd(p) - p - 1));
+            }
+        }
+    }
+
+    // After `import` or `export`: walk an import/export clause such as
+    // `x, { a as b } from` up to its specifier. Returns the position of the
+    // opening quote, or npos when this is not a module declaration. Only a
+    // side-effect import (`import 'x'`) may omit the from clause.
+    size_t clauseSpecifier(size_t p, bool requireFrom) const {
+        bool first = true;
+        bool sawFrom = false;
+        int braces = 0;
+        while (true) {
+            p = skipTrivia(p);
+            if (p >= src.size() || braces < 0) {
+                return std::string::npos;
+            }
+            char c = src[p];
+            if (c == '\'' || c == '"') {
+                if (braces == 0) {
+                    return (sawFrom || (first && !requireFrom)) ? p : std::string::npos;
+                }
+                // String export names: `{ "a-b" as ab }`
+                p = stringEnd(p) + 1;
+            } else if (c == '{') {
+                ++braces;
+                ++p;
+            } else if (c == '}') {
+                --braces;
+                ++p;
+            } else if (c == ',' || c == '*') {
+                ++p;
+            } else if (isIdentStart(c)) {
+                size_t e = identEnd(p);
+                sawFrom = braces == 0 && identAt(p, "from");
+                p = e;
+            } else {
+                return std::string::npos;
+            }
+            first = false;
+        }
+    }
+
+    // import.meta.hot.accept(...) arguments decide what the module accepts
+    void scanAccept(size_t p) {
+        p = skipTrivia(p);
+        if (p >= src.size() || src[p] != '(') {
+            return;
+        }
+        p = skipTrivia(p + 1);
+        if (p < src.size() && (src[p] == '\'' || src[p] == '"')) {
+            size_t close = stringEnd(p);
+            result.acceptedDeps.push_back(src.substr(p + 1, close - p - 1));
+        } else if (p < src.size() && src[p] == '[') {
+            p = skipTrivia(p + 1);
+            while (p < src.size() && (src[p] == '\'' || src[p] == '"')) {
+                size_t close = stringEnd(p);
+                result.acceptedDeps.push_back(src.substr(p + 1, close - p - 1));
+                p = skipTrivia(close + 1);
+                if (p < src.size() && src[p] == ',') {
+                    p = skipTrivia(p + 1);
+                }
+            }
+        } else {
+            result.selfAccepting = true;
+        }
+    }
+
+    // `import.meta` at `p` (just past `import`)
+    void scanImportMeta(size_t p) {
+        p = skipTrivia(p + 1);
+        if (!identAt(p, "meta")) {
+            return;
+        }
+        p = skipTrivia(p + 4);
+        if (p >= src.size() || src[p] != '.') {
+            return;
+        }
+        p = skipTrivia(p + 1);
+        if (!identAt(p, "hot")) {
+            return;
+        }
+        result.usesHot = true;
+        p = skipTrivia(p + 3);
+        if (p < src.size() && src[p] == '.') {
+            p = skipTrivia(p + 1);
+            if (identAt(p, "accept")) {
+                scanAccept(p + 6);
+            }
+        }
+    }
+
+    // `import` at `start`, with `pos` just past it
+    void onImport(size_t start) {
+        size_t p = skipTrivia(pos);
+        if (p < src.size() && src[p] == '(') {
+            size_t q = skipTrivia(p + 1);
+            if (q < src.size() && (src[q] == '\'' || src[q] == '"')) {
+                size_t after = skipTrivia(stringEnd(q) + 1);
+                if (after < src.size() && (src[after] == ')' || src[after] == ',')) {
+                    ImportRecord& rec = record(q, true);
+                    if (src[after] == ')') {
+                        rec.callStart = start;
+                        rec.callEnd = after + 1;
+                    }
+                }
+            }
+            return;
+        }
+        if (p < src.size() && src[p] == '.') {
+            scanImportMeta(p);
+            return;
+        }
+        size_t quote = clauseSpecifier(p, false);
+        if (quote != std::string::npos) {
+            record(quote, false);
+            if (topLevel()) {
+                ModuleDeclaration decl;
+                decl.kind = ModuleDeclaration::Kind::Import;
+                decl.start = start;
+                decl.end = statementEnd(stringEnd(quote) + 1);
+                decl.importIndex = static_cast<int>(result.imports.size()) - 1;
+                parseBindings(p, quote, decl);
+                result.declarations.push_back(std::move(decl));
+            }
+            pos = stringEnd(quote) + 1;
+            regexAllowed = false;
+        }
+    }
+
+    // `export` at `start`, with `pos` just past it
+    void onExport(size_t start) {
+        size_t p = skipTrivia(pos);
+        if (p >= src.size()) {
+            return;
+        }
+        ModuleDeclaration decl;
+        decl.start = start;
+        if (src[p] == '*' || src[p] == '{') {
+            size_t quote = clauseSpecifier(p, true);
+            if (quote != std::string::npos) {
+                record(quote, false);
+                decl.end = statementEnd(stringEnd(quote) + 1);
+                decl.importIndex = static_cast<int>(result.imports.size()) - 1;
+                parseBindings(p, quote, decl);
+                decl.kind = src[p] == '*' && decl.namespaceBinding.empty() ? ModuleDeclaration::Kind::ExportAll
+                                                                            : ModuleDeclaration::Kind::ExportFrom;
+                pos = stringEnd(quote) + 1;
+                regexAllowed = false;
+            } else if (src[p] == '{') {
+                size_t close = p + 1;
+                while (close < src.size() && src[close] != '}') {
+                    close = src[close] == '\'' || src[close] == '"' ? stringEnd(close) + 1 : close + 1;
+                }
+                decl.kind = ModuleDeclaration::Kind::ExportList;
+                decl.end = statementEnd(close + 1);
+                parseBindings(p, close + 1, decl);
+                pos = close + 1;
+                regexAllowed = false;
+            } else {
+                return;
+            }
+            if (topLevel()) {
+                result.declarations.push_back(std::move(decl));
+            }
+            return;
+        }
+        if (!topLevel()) {
+            return;
+        }
+        if (identAt(p, "default")) {
+            decl.kind = ModuleDeclaration::Kind::ExportDefault;
+            size_t body = skipTrivia(p + 7);
+            decl.end = body;
+            size_t q = body;
+            if (identAt(q, "async") && identAt(skipTrivia(q + 5), "function")) {
+                q = skipTrivia(q + 5);
+            }
+            if (identAt(q, "function") || identAt(q, "class")) {
+                decl.defaultIsDeclaration = true;
+                q = skipTrivia(identEnd(q));
+                if (q < src.size() && src[q] == '*') {
+                    q = skipTrivia(q + 1);
+                }
+                if (q < src.size() && isIdentStart(src[q]) && !identAt(q, "extends")) {
+                    decl.defaultName = src.substr(q, identEnd(q) - q);
+                }
+            }
+        } else if (identAt(p, "const") || identAt(p, "let") || identAt(p, "var") || identAt(p, "function") ||
+                   identAt(p, "class") || identAt(p, "async")) {
+            decl.kind = ModuleDeclaration::Kind::ExportDeclaration;
+            decl.end = p;
+            declaredNames(p, decl);
+        } else {
+            return;
+        }
+        result.declarations.push_back(std::move(decl));
+    }
+
+    void run() {
+        char lastSignificant = 0;
+        while (pos < src.size()) {
+            char c = src[pos];
+            if (Simd::isSpaceByte(static_cast<unsigned char>(c))) {
+                pos = static_cast<size_t>(Simd::skipSpace(src.data() + pos, src.data() + src.size()) - src.data());
+                continue;
+            }
+            if (c == '/' && pos + 1 < src.size() && (src[pos + 1] == '/' || src[pos + 1] == '*')) {
+                pos = skipTrivia(pos);
+                continue;
+            }
+
+            if (c == '\'' || c == '"') {
+                pos = stringEnd(pos) + 1;
+                regexAllowed = false;
+            } else if (c == '`') {
+                ++pos;
+                scanTemplate();
+            } else if (c == '/') {
+                if (regexAllowed) {
+                    skipRegex();
+                } else {
+                    ++pos;
+                    regexAllowed = true;
+                }
+            } else if (c == '{') {
+                ++braceDepth;
+                ++pos;
+                regexAllowed = true;
+            } else if (c == '}') {
+                --braceDepth;
+                ++pos;
+                if (!templateBraces.empty() && templateBraces.back() == braceDepth) {
+                    templateBraces.pop_back();
+                    scanTemplate();
+                } else {
+                    regexAllowed = true;
+                }
+            } else if (c == ')' || c == ']') {
+                ++pos;
+                regexAllowed = false;
+            } else if (isIdentStart(c)) {
+                size_t start = pos;
+                pos = identEnd(pos);
+                // Property names such as `obj.import` are not keywords
+                bool property = lastSignificant == '.' && !(start >= 3 && src.compare(start - 3, 3, "...") == 0);
+                // Compared in place: most identifiers are none of these
+                const char* word = src.data() + start;
+                size_t length = pos - start;
+                auto is = [word, length](const char* keyword) {
+                    return std::strlen(keyword) == length && std::memcmp(word, keyword, length) == 0;
+                };
+                regexAllowed = !property && Lexer::keywordBeforeExpression(word, length);
+                if (!property && is("import")) {
+                    onImport(start);
+                } else if (!property && is("export")) {
+                    onExport(start);
+                } else if (!property && is("require")) {
+                    onRequire(start);
+                } else if (!property && is("exports")) {
+                    result.usesCommonJs = true;
+                    onExportsTarget(pos, false);
+                } else if (!property && is("module")) {
+                    size_t dot = skipTrivia(pos);
+                    size_t name = dot < src.size() && src[dot] == '.' ? skipTrivia(dot + 1) : src.size();
+                    if (identAt(name, "exports")) {
+                        result.usesCommonJs = true;
+                        onExportsTarget(name + 7, true);
+                    }
+                } else if (property && is("defineProperty")) {
+                    onDefineProperty();
+                }
+                lastSignificant = 'a';
+                continue;
+            } else if (std::isdigit(static_cast<unsigned char>(c))) {
+                while (pos < src.size() && (isIdentPart(src[pos]) || src[pos] == '.')) {
+                    ++pos;
+                }
+                regexAllowed = false;
+            } else {
+                ++pos;
+                regexAllowed = true;
+            }
+            lastSignificant = c;
+        }
+    }
+
+public:
+    static ImportScan scan(const std::string& source) {
+        ImportScanner scanner(source);
+        scanner.run();
+        return std::move(scanner.result);
+    }
+};
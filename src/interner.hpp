@@ -0,0 +1,229 @@
+#pragma once
+
+#include "arena.hpp"
+#include "hash.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// An interned string. Equal strings intern to the same Atom, so comparing
+// or hashing two atoms is a pointer operation, and an atom is as cheap to
+// copy as a pointer. The characters live for the rest of the process.
+class Atom {
+public:
+    struct Entry {
+        uint64_t hash;
+        uint32_t length;
+        // NUL-terminated
+        char text[1];
+    };
+
+private:
+    const Entry* entry = nullptr;
+
+    friend class Interner;
+    explicit Atom(const Entry* e) : entry(e) {}
+
+public:
+    // The empty string
+    Atom() = default;
+
+    std::string_view view() const {
+        return entry ? std::string_view(entry->text, entry->length) : std::string_view();
+    }
+
+    std::string str() const {
+        return std::string(view());
+    }
+
+    const char* c_str() const {
+        return entry ? entry->text : "";
+    }
+
+    size_t size() const {
+        return entry ? entry->length : 0;
+    }
+
+    bool empty() const {
+        return !entry;
+    }
+
+    const void* id() const {
+        return entry;
+    }
+
+    bool operator==(Atom other) const {
+        return entry == other.entry;
+    }
+
+    bool operator!=(Atom other) const {
+        return entry != other.entry;
+    }
+
+    bool operator==(std::string_view text) const {
+        return view() == text;
+    }
+
+    bool operator!=(std::string_view text) const {
+        return view() != text;
+    }
+
+    // Orders by text, for sorted output
+    bool operator<(Atom other) const {
+        return view() < other.view();
+    }
+};
+
+namespace std {
+template <>
+struct hash<Atom> {
+    size_t operator()(Atom atom) const {
+        return std::hash<const void*>()(atom.id());
+    }
+};
+}
+
+// The process-wide string table behind Atom. It is split into shards by
+// hash. Lookups take no lock: each shard publishes an open-addressed table
+// of entry pointers through an atomic, and a table is never modified in a
+// way a concurrent reader could misread (slots only go from empty to
+// filled). Inserts lock their shard; growing a shard publishes a copy and
+// keeps the old table alive, so readers still probing it stay safe and at
+// worst miss a brand-new entry and fall through to the locked path.
+class Interner {
+private:
+    static constexpr size_t SHARDS = 64;
+
+    struct Table {
+        size_t mask;
+        std::unique_ptr<std::atomic<const Atom::Entry*>[]> slots;
+
+        explicit Table(size_t capacity) : mask(capacity - 1), slots(new std::atomic<const Atom::Entry*>[capacity]) {
+            for (size_t i = 0; i < capacity; ++i) {
+                slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct Shard {
+        std::atomic<Table*> table{nullptr};
+        std::mutex mutex;
+        size_t count = 0;
+        Arena arena;
+        // Every table this shard published; readers may still hold any
+        std::vector<std::unique_ptr<Table>> tables;
+    };
+
+    std::array<Shard, SHARDS> shards;
+
+    static const Atom::Entry* probe(const Table* table, std::string_view text, uint64_t hash) {
+        for (size_t i = (hash / SHARDS) & table->mask;; i = (i + 1) & table->mask) {
+            const Atom::Entry* entry = table->slots[i].load(std::memory_order_acquire);
+            if (!entry) {
+                return nullptr;
+            }
+            if (entry->hash == hash && entry->length == text.size() &&
+                std::memcmp(entry->text, text.data(), text.size()) == 0) {
+                return entry;
+            }
+        }
+    }
+
+    static void place(Table* table, const Atom::Entry* entry) {
+        size_t i = (entry->hash / SHARDS) & table->mask;
+        while (table->slots[i].load(std::memory_order_relaxed)) {
+            i = (i + 1) & table->mask;
+        }
+        table->slots[i].store(entry, std::memory_order_release);
+    }
+
+    const Atom::Entry* insert(Shard& shard, std::string_view text, uint64_t hash) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Table* table = shard.table.load(std::memory_order_relaxed);
+        if (table) {
+            if (const Atom::Entry* entry = probe(table, text, hash)) {
+                return entry;
+            }
+        }
+        // Keep tables at most half full
+        if (!table || (shard.count + 1) * 2 > table->mask + 1) {
+            auto grown = std::make_unique<Table>(table ? (table->mask + 1) * 2 : 64);
+            if (table) {
+                for (size_t i = 0; i <= table->mask; ++i) {
+                    if (const Atom::Entry* entry = table->slots[i].load(std::memory_order_relaxed)) {
+                        place(grown.get(), entry);
+                    }
+                }
+            }
+            table = grown.get();
+            shard.tables.push_back(std::move(grown));
+            shard.table.store(table, std::memory_order_release);
+        }
+        auto* entry = static_cast<Atom::Entry*>(
+            shard.arena.allocate(offsetof(Atom::Entry, text) + text.size() + 1, alignof(Atom::Entry)));
+        entry->hash = hash;
+        entry->length = static_cast<uint32_t>(text.size());
+        std::memcpy(entry->text, text.data(), text.size());
+        entry->text[text.size()] = '\0';
+        place(table, entry);
+        ++shard.count;
+        return entry;
+    }
+
+public:
+    static Interner& global() {
+        static Interner instance;
+        return instance;
+    }
+
+    Atom intern(std::string_view text) {
+        if (text.empty()) {
+            return Atom();
+        }
+        uint64_t hash = Hash::xxh64(text.data(), text.size());
+        Shard& shard = shards[hash % SHARDS];
+        const Table* table = shard.table.load(std::memory_order_acquire);
+        if (table) {
+            if (const Atom::Entry* entry = probe(table, text, hash)) {
+                return Atom(entry);
+            }
+        }
+        return Atom(insert(shard, text, hash));
+    }
+
+    // The atom for `text` if it was ever interned, without adding it;
+    // `found` says whether it was
+    Atom find(std::string_view text, bool& found) const {
+        found = text.empty();
+        if (text.empty()) {
+            return Atom();
+        }
+        uint64_t hash = Hash::xxh64(text.data(), text.size());
+        const Table* table = shards[hash % SHARDS].table.load(std::memory_order_acquire);
+        const Atom::Entry* entry = table ? probe(table, text, hash) : nullptr;
+        found = entry != nullptr;
+        return Atom(entry);
+    }
+
+    size_t size() {
+        size_t total = 0;
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total += shard.count;
+        }
+        return total;
+    }
+};
+
+// Shorthand for Interner::global().intern(text)
+inline Atom intern(std::string_view text) {
+    return Interner::global().intern(text);
+}
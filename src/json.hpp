@@ -0,0 +1,294 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdlib>
+#include <cstdio>
+
+// Minimal JSON reader for package.json and similar metadata. Objects keep
+// their key order, which matters for package "exports" conditions.
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    bool isNull() const { return type == Type::Null; }
+    bool isString() const { return type == Type::String; }
+    bool isArray() const { return type == Type::Array; }
+    bool isObject() const { return type == Type::Object; }
+
+    // Member lookup; null when this is not an object or has no such key
+    const JsonValue* get(const std::string& key) const {
+        for (const auto& member : object) {
+            if (member.first == key) {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+
+    // The member's string value, or "" when missing or not a string
+    std::string getString(const std::string& key) const {
+        const JsonValue* value = get(key);
+        return value && value->isString() ? value->string : "";
+    }
+
+    // Compact JSON text for this value, members in their original order
+    std::string stringify() const {
+        std::string out;
+        write(out);
+        return out;
+    }
+
+    // Parse a complete document. Returns false on malformed input.
+    static bool parse(const std::string& text, JsonValue& out) {
+        Parser parser{text, 0};
+        return parser.value(out, 0) && (parser.skipSpace(), parser.pos == text.size());
+    }
+
+private:
+    static void writeString(std::string& out, const std::string& value) {
+        static const char* hex = "0123456789abcdef";
+        out += '"';
+        for (unsigned char c : value) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += static_cast<char>(c);
+            } else if (c < 0x20) {
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 0xf];
+            } else {
+                out += static_cast<char>(c);
+            }
+        }
+        out += '"';
+    }
+
+    void write(std::string& out) const {
+        switch (type) {
+            case Type::Null: out += "null"; break;
+            case Type::Bool: out += boolean ? "true" : "false"; break;
+            case Type::Number: {
+                char digits[32];
+                std::snprintf(digits, sizeof(digits), "%.17g", number);
+                out += digits;
+                break;
+            }
+            case Type::String: writeString(out, string); break;
+            case Type::Array:
+                out += '[';
+                for (size_t i = 0; i < array.size(); ++i) {
+                    if (i) out += ',';
+                    array[i].write(out);
+                }
+                out += ']';
+                break;
+            case Type::Object:
+                out += '{';
+                for (size_t i = 0; i < object.size(); ++i) {
+                    if (i) out += ',';
+                    writeString(out, object[i].first);
+                    out += ':';
+                    object[i].second.write(out);
+                }
+                out += '}';
+                break;
+        }
+    }
+
+    struct Parser {
+        static constexpr int MAX_DEPTH = 256;
+
+        const std::string& text;
+        size_t pos;
+
+        void skipSpace() {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+                ++pos;
+            }
+        }
+
+        bool literal(const char* word) {
+            size_t len = std::char_traits<char>::length(word);
+            if (text.compare(pos, len, word) != 0) {
+                return false;
+            }
+            pos += len;
+            return true;
+        }
+
+        static void appendUtf8(std::string& out, unsigned long cp) {
+            if (cp < 0x80) {
+                out += static_cast<char>(cp);
+            } else if (cp < 0x800) {
+                out += static_cast<char>(0xC0 | (cp >> 6));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            } else if (cp < 0x10000) {
+                out += static_cast<char>(0xE0 | (cp >> 12));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (cp >> 18));
+                out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+        }
+
+        bool hex4(unsigned long& cp) {
+            if (pos + 4 > text.size()) {
+                return false;
+            }
+            std::string digits = text.substr(pos, 4);
+            char* end = nullptr;
+            cp = std::strtoul(digits.c_str(), &end, 16);
+            pos += 4;
+            return end == digits.c_str() + 4;
+        }
+
+        bool str(std::string& out) {
+            ++pos;  // opening quote
+            while (pos < text.size()) {
+                char c = text[pos++];
+                if (c == '"') {
+                    return true;
+                }
+                if (c != '\\') {
+                    out += c;
+                    continue;
+                }
+                if (pos >= text.size()) {
+                    return false;
+                }
+                char e = text[pos++];
+                switch (e) {
+                    case '"': out += '"'; break;
+                    case '\\': out += '\\'; break;
+                    case '/': out += '/'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    case 'u': {
+                        unsigned long cp;
+                        if (!hex4(cp)) {
+                            return false;
+                        }
+                        if (cp >= 0xD800 && cp < 0xDC00 && text.compare(pos, 2, "\\u") == 0) {
+                            pos += 2;
+                            unsigned long low;
+                            if (!hex4(low)) {
+                                return false;
+                            }
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        appendUtf8(out, cp);
+                        break;
+                    }
+                    default:
+                        return false;
+                }
+            }
+            return false;
+        }
+
+        bool value(JsonValue& out, int depth) {
+            skipSpace();
+            if (pos >= text.size() || depth > MAX_DEPTH) {
+                return false;
+            }
+            char c = text[pos];
+            if (c == '{') {
+                out.type = Type::Object;
+                ++pos;
+                skipSpace();
+                if (pos < text.size() && text[pos] == '}') {
+                    ++pos;
+                    return true;
+                }
+                while (true) {
+                    skipSpace();
+                    std::string key;
+                    if (pos >= text.size() || text[pos] != '"' || !str(key)) {
+                        return false;
+                    }
+                    skipSpace();
+                    if (pos >= text.size() || text[pos++] != ':') {
+                        return false;
+                    }
+                    out.object.emplace_back(std::move(key), JsonValue());
+                    if (!value(out.object.back().second, depth + 1)) {
+                        return false;
+                    }
+                    skipSpace();
+                    if (pos < text.size() && text[pos] == ',') {
+                        ++pos;
+                    } else if (pos < text.size() && text[pos] == '}') {
+                        ++pos;
+                        return true;
+                    } else {
+                        return false;
+                    }
+                }
+            }
+            if (c == '[') {
+                out.type = Type::Array;
+                ++pos;
+                skipSpace();
+                if (pos < text.size() && text[pos] == ']') {
+                    ++pos;
+                    return true;
+                }
+                while (true) {
+                    out.array.emplace_back();
+                    if (!value(out.array.back(), depth + 1)) {
+                        return false;
+                    }
+                    skipSpace();
+                    if (pos < text.size() && text[pos] == ',') {
+                        ++pos;
+                    } else if (pos < text.size() && text[pos] == ']') {
+                        ++pos;
+                        return true;
+                    } else {
+                        return false;
+                    }
+                }
+            }
+            if (c == '"') {
+                out.type = Type::String;
+                return str(out.string);
+            }
+            if (literal("true")) {
+                out.type = Type::Bool;
+                out.boolean = true;
+                return true;
+            }
+            if (literal("false")) {
+                out.type = Type::Bool;
+                return true;
+            }
+            if (literal("null")) {
+                return true;
+            }
+            const char* start = text.c_str() + pos;
+            char* end = nullptr;
+            out.number = std::strtod(start, &end);
+            if (end == start) {
+                return false;
+            }
+            out.type = Type::Number;
+            pos += static_cast<size_t>(end - start);
+            return true;
+        }
+    };
+};
@@ -0,0 +1,634 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define VITE_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// Character-class scans that dominate lexing JavaScript: runs of whitespace
+// and identifier characters, and the next character that ends or escapes a
+// string or template literal. Each has an AVX2 and an SSE4.2 version picked
+// once at startup from what the CPU supports, and a scalar one for other
+// CPUs and for the last few bytes of a buffer. All return `end` when
+// nothing stops them.
+namespace Simd {
+    // Identifier characters: ASCII letters, digits, `_`, `$`, and every
+    // byte of a UTF-8 sequence, since non-ASCII code points in source
+    // text are almost always identifier characters
+    inline bool isIdentifierByte(unsigned char c) {
+        return static_cast<unsigned>((c | 0x20) - 'a') < 26 || static_cast<unsigned>(c - '0') < 10 || c == '_' ||
+               c == '$' || c >= 0x80;
+    }
+
+    inline bool isSpaceByte(unsigned char c) {
+        return c == ' ' || static_cast<unsigned>(c - '\t') < 5;
+    }
+
+    inline const char* skipSpaceScalar(const char* p, const char* end) {
+        while (p < end && isSpaceByte(static_cast<unsigned char>(*p))) {
+            ++p;
+        }
+        return p;
+    }
+
+    inline const char* identifierEndScalar(const char* p, const char* end) {
+        while (p < end && isIdentifierByte(static_cast<unsigned char>(*p))) {
+            ++p;
+        }
+        return p;
+    }
+
+    inline const char* findStringStopScalar(const char* p, const char* end, char quote) {
+        while (p < end && *p != quote && *p != '\\' && *p != '\n' && *p != '\r') {
+            ++p;
+        }
+        return p;
+    }
+
+    inline const char* findTemplateStopScalar(const char* p, const char* end) {
+        while (p < end && *p != '`' && *p != '\\' && *p != '$') {
+            ++p;
+        }
+        return p;
+    }
+
+#ifdef VITE_SIMD_X86
+    // SSE4.2: PCMPESTRI compares 16 bytes against a set or a list of
+    // ranges and returns the index of the first byte outside it
+
+    __attribute__((target("sse4.2"))) inline const char* skipSpaceSse42(const char* p, const char* end) {
+        const __m128i set = _mm_setr_epi8(' ', '\t', '\n', '\v', '\f', '\r', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+        for (; end - p >= 16; p += 16) {
+            int i = _mm_cmpestri(set, 6, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), 16,
+                                 _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_NEGATIVE_POLARITY);
+            if (i < 16) {
+                return p + i;
+            }
+        }
+        return skipSpaceScalar(p, end);
+    }
+
+    __attribute__((target("sse4.2"))) inline const char* identifierEndSse42(const char* p, const char* end) {
+        const __m128i ranges = _mm_setr_epi8('a', 'z', 'A', 'Z', '0', '9', '_', '_', '$', '$', char(0x80), char(0xff),
+                                             0, 0, 0, 0);
+        for (; end - p >= 16; p += 16) {
+            int i = _mm_cmpestri(ranges, 12, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), 16,
+                                 _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_NEGATIVE_POLARITY);
+            if (i < 16) {
+                return p + i;
+            }
+        }
+        return identifierEndScalar(p, end);
+    }
+
+    __attribute__((target("sse4.2"))) inline const char* findStringStopSse42(const char* p, const char* end,
+                                                                             char quote) {
+        const __m128i set = _mm_setr_epi8(quote, '\\', '\n', '\r', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+        for (; end - p >= 16; p += 16) {
+            int i = _mm_cmpestri(set, 4, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), 16,
+                                 _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY);
+            if (i < 16) {
+                return p + i;
+            }
+        }
+        return findStringStopScalar(p, end, quote);
+    }
+
+    __attribute__((target("sse4.2"))) inline const char* findTemplateStopSse42(const char* p, const char* end) {
+        const __m128i set = _mm_setr_epi8('`', '\\', '$', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+        for (; end - p >= 16; p += 16) {
+            int i = _mm_cmpestri(set, 3, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), 16,
+                                 _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY);
+            if (i < 16) {
+                return p + i;
+            }
+        }
+        return findTemplateStopScalar(p, end);
+    }
+
+    // AVX2: classify 32 bytes with compares, then find the first stop in
+    // the movemask
+
+    __attribute__((target("avx2"))) inline __m256i inRange(__m256i v, char lo, char hi) {
+        return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+                                _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), v));
+    }
+
+    __attribute__((target("avx2"))) inline const char* skipSpaceAvx2(const char* p, const char* end) {
+        for (; end - p >= 32; p += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), inRange(v, '\t', '\r'));
+            uint32_t stops = ~static_cast<uint32_t>(_mm256_movemask_epi8(space));
+            if (stops) {
+                return p + __builtin_ctz(stops);
+            }
+        }
+        return skipSpaceScalar(p, end);
+    }
+
+    __attribute__((target("avx2"))) inline const char* identifierEndAvx2(const char* p, const char* end) {
+        for (; end - p >= 32; p += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            // Bytes >= 0x80 are negative as signed chars
+            __m256i ident = _mm256_or_si256(inRange(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z'),
+                                            inRange(v, '0', '9'));
+            ident = _mm256_or_si256(ident, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+            ident = _mm256_or_si256(ident, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('$')));
+            ident = _mm256_or_si256(ident, _mm256_cmpgt_epi8(_mm256_setzero_si256(), v));
+            uint32_t stops = ~static_cast<uint32_t>(_mm256_movemask_epi8(ident));
+            if (stops) {
+                return p + __builtin_ctz(stops);
+            }
+        }
+        return identifierEndScalar(p, end);
+    }
+
+    __attribute__((target("avx2"))) inline const char* findStringStopAvx2(const char* p, const char* end,
+                                                                          char quote) {
+        const __m256i q = _mm256_set1_epi8(quote);
+        for (; end - p >= 32; p += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i stop = _mm256_or_si256(_mm256_cmpeq_epi8(v, q), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+            stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+            stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+            uint32_t stops = static_cast<uint32_t>(_mm256_movemask_epi8(stop));
+            if (stops) {
+                return p + __builtin_ctz(stops);
+            }
+        }
+        return findStringStopScalar(p, end, quote);
+    }
+
+    __attribute__((target("avx2"))) inline const char* findTemplateStopAvx2(const char* p, const char* end) {
+        for (; end - p >= 32; p += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i stop = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('`')),
+                                           _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+            stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('$')));
+            uint32_t stops = static_cast<uint32_t>(_mm256_movemask_epi8(stop));
+            if (stops) {
+                return p + __builtin_ctz(stops);
+            }
+        }
+        return findTemplateStopScalar(p, end);
+    }
+#endif
+
+    struct Kernels {
+        const char* (*skipSpace)(const char*, const char*);
+        const char* (*identifierEnd)(const char*, const char*);
+        const char* (*findStringStop)(const char*, const char*, char);
+        const char* (*findTemplateStop)(const char*, const char*);
+        const char* name;
+    };
+
+    inline const Kernels& kernels() {
+        static const Kernels selected = []() {
+#ifdef VITE_SIMD_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return Kernels{skipSpaceAvx2, identifierEndAvx2, findStringStopAvx2, findTemplateStopAvx2, "avx2"};
+            }
+            if (__builtin_cpu_supports("sse4.2")) {
+                return Kernels{skipSpaceSse42, identifierEndSse42, findStringStopSse42, findTemplateStopSse42,
+                               "sse4.2"};
+            }
+#endif
+            return Kernels{skipSpaceScalar, identifierEndScalar, findStringStopScalar, findTemplateStopScalar,
+                           "scalar"};
+        }();
+        return selected;
+    }
+
+    inline const char* skipSpace(const char* p, const char* end) {
+        // Most gaps between tokens are a single space; skip the call
+        if (p < end && !isSpaceByte(static_cast<unsigned char>(*p))) {
+            return p;
+        }
+        return kernels().skipSpace(p, end);
+    }
+
+    inline const char* identifierEnd(const char* p, const char* end) {
+        return kernels().identifierEnd(p, end);
+    }
+
+    // The next quote, backslash or line break
+    inline const char* findStringStop(const char* p, const char* end, char quote) {
+        return kernels().findStringStop(p, end, quote);
+    }
+
+    // The next backquote, backslash or `$`
+    inline const char* findTemplateStop(const char* p, const char* end) {
+        return kernels().findTemplateStop(p, end);
+    }
+
+    // The `*/` closing a block comment, or `end`
+    inline const char* findCommentEnd(const char* p, const char* end) {
+        while (p < end) {
+            const char* star = static_cast<const char*>(std::memchr(p, '*', static_cast<size_t>(end - p)));
+            if (!star || star + 1 >= end) {
+                return end;
+            }
+            if (star[1] == '/') {
+                return star;
+            }
+            p = star + 1;
+        }
+        return end;
+    }
+}
+
+enum class TokenKind : uint8_t {
+    End,
+    Identifier,
+    // #name in classes
+    PrivateName,
+    Number,
+    String,
+    // `text` with no substitutions
+    Template,
+    // `text${, }text${ and }text` of a template with substitutions
+    TemplateHead,
+    TemplateMiddle,
+    TemplateTail,
+    Regex,
+    Punctuator,
+    // Text between JSX tags, only produced by Lexer::jsxText()
+    JsxText,
+    // Unterminated literal or a byte that starts no token
+    Invalid
+};
+
+class Token {
+public:
+    TokenKind kind = TokenKind::End;
+    uint32_t start = 0;
+    uint32_t end = 0;
+    // A line break or a comment containing one precedes the token, which
+    // is what automatic semicolon insertion and restricted productions
+    // (`return`, postfix `++`) look at
+    bool newlineBefore = false;
+};
+
+// Tokenizer for JavaScript, TypeScript and JSX. Tokens are source ranges;
+// nothing is copied or decoded, so a token costs a few compares plus the
+// vectorized scans above. Whether a `/` starts a regex is decided from the
+// previous token, which is right for everything but contrived code, and a
+// `}` that closes a template substitution resumes the template.
+class Lexer {
+private:
+    const char* begin;
+    const char* p;
+    const char* end;
+    // After the previous token, a `/` begins a regex
+    bool regexAllowed = true;
+    bool sawNewline = false;
+    // Brace depth at each open `${`
+    std::vector<int> templateBraces;
+    int braceDepth = 0;
+
+    static bool isDigit(char c) {
+        return static_cast<unsigned char>(c - '0') < 10;
+    }
+
+    // Whitespace and comments; remembers whether they held a line break
+    void skipTrivia() {
+        while (p < end) {
+            const char* q = Simd::skipSpace(p, end);
+            if (q != p) {
+                sawNewline = sawNewline || std::memchr(p, '\n', static_cast<size_t>(q - p)) != nullptr;
+                p = q;
+                continue;
+            }
+            if (*p != '/' || p + 1 >= end) {
+                return;
+            }
+            if (p[1] == '/') {
+                const char* eol = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+                p = eol ? eol : end;
+            } else if (p[1] == '*') {
+                const char* close = Simd::findCommentEnd(p + 2, end);
+                sawNewline = sawNewline || std::memchr(p, '\n', static_cast<size_t>(close - p)) != nullptr;
+                p = close == end ? end : close + 2;
+            } else {
+                return;
+            }
+        }
+    }
+
+    Token make(TokenKind kind, const char* start) const {
+        Token token;
+        token.kind = kind;
+        token.start = static_cast<uint32_t>(start - begin);
+        token.end = static_cast<uint32_t>(p - begin);
+        token.newlineBefore = sawNewline;
+        return token;
+    }
+
+    // From just inside a template literal or after its `}`: the rest of
+    // the literal or the text up to the next `${`
+    TokenKind templateSpan(bool head) {
+        while (p < end) {
+            p = Simd::findTemplateStop(p, end);
+            if (p >= end) {
+                break;
+            }
+            if (*p == '\\') {
+                p += 2;
+            } else if (*p == '`') {
+                ++p;
+                regexAllowed = false;
+                return head ? TokenKind::Template : TokenKind::TemplateTail;
+            } else if (p + 1 < end && p[1] == '{') {
+                p += 2;
+                templateBraces.push_back(braceDepth);
+                ++braceDepth;
+                regexAllowed = true;
+                return head ? TokenKind::TemplateHead : TokenKind::TemplateMiddle;
+            } else {
+                ++p;
+            }
+        }
+        p = end;
+        return TokenKind::Invalid;
+    }
+
+    TokenKind string(char quote) {
+        ++p;
+        while (p < end) {
+            p = Simd::findStringStop(p, end, quote);
+            if (p >= end || *p == '\n' || *p == '\r') {
+                return TokenKind::Invalid;
+            }
+            if (*p == '\\') {
+                // A backslash before CRLF continues the line over both
+                p += p + 2 < end && p[1] == '\r' && p[2] == '\n' ? 3 : 2;
+                continue;
+            }
+            ++p;
+            return TokenKind::String;
+        }
+        p = end;
+        return TokenKind::Invalid;
+    }
+
+    TokenKind regex() {
+        bool inClass = false;
+        for (++p; p < end; ++p) {
+            char c = *p;
+            if (c == '\\') {
+                ++p;
+            } else if (c == '[') {
+                inClass = true;
+            } else if (c == ']') {
+                inClass = false;
+            } else if (c == '\n' || c == '\r') {
+                return TokenKind::Invalid;
+            } else if (c == '/' && !inClass) {
+                p = Simd::identifierEnd(p + 1, end);
+                return TokenKind::Regex;
+            }
+        }
+        p = end;
+        return TokenKind::Invalid;
+    }
+
+    void digits() {
+        while (p < end && (isDigit(*p) || *p == '_')) {
+            ++p;
+        }
+    }
+
+    void number() {
+        if (*p == '0' && p + 1 < end && std::strchr("xXoObB", p[1]) && p[1] != '\0') {
+            // 0x, 0o, 0b and a BigInt suffix are all identifier bytes
+            p = Simd::identifierEnd(p + 2, end);
+            return;
+        }
+        digits();
+        if (p < end && *p == '.') {
+            ++p;
+            digits();
+        }
+        if (p < end && (*p | 0x20) == 'e') {
+            ++p;
+            if (p < end && (*p == '+' || *p == '-')) {
+                ++p;
+            }
+            digits();
+        }
+        // BigInt `n`; anything else glued on makes the literal invalid,
+        // which the parser reports
+        p = Simd::identifierEnd(p, end);
+    }
+
+    // Longest punctuator at `p`
+    void punctuator() {
+        char c = *p;
+        auto at = [this](size_t i) { return p + i < end ? p[i] : '\0'; };
+        char c1 = at(1);
+        switch (c) {
+            case '.':
+                p += c1 == '.' && at(2) == '.' ? 3 : 1;
+                return;
+            case '=':
+                p += c1 == '>' ? 2 : c1 == '=' ? (at(2) == '=' ? 3 : 2) : 1;
+                return;
+            case '!':
+                p += c1 == '=' ? (at(2) == '=' ? 3 : 2) : 1;
+                return;
+            case '<':
+                p += c1 == '<' ? (at(2) == '=' ? 3 : 2) : c1 == '=' ? 2 : 1;
+                return;
+            case '>':
+                if (c1 == '>') {
+                    p += at(2) == '>' ? (at(3) == '=' ? 4 : 3) : at(2) == '=' ? 3 : 2;
+                } else {
+                    p += c1 == '=' ? 2 : 1;
+                }
+                return;
+            case '*':
+                p += c1 == '*' ? (at(2) == '=' ? 3 : 2) : c1 == '=' ? 2 : 1;
+                return;
+            case '&':
+            case '|':
+            case '?':
+                if (c1 == c) {
+                    p += at(2) == '=' ? 3 : 2;
+                } else if (c == '?') {
+                    // `a?.5:b` is a conditional, not optional chaining
+                    p += c1 == '.' && !isDigit(at(2)) ? 2 : 1;
+                } else {
+                    p += c1 == '=' ? 2 : 1;
+                }
+                return;
+            case '+':
+            case '-':
+                p += c1 == c || c1 == '=' ? 2 : 1;
+                return;
+            case '/':
+            case '%':
+            case '^':
+                p += c1 == '=' ? 2 : 1;
+                return;
+            default:
+                ++p;
+        }
+    }
+
+public:
+    // Keywords after which an expression, and so a regex, may start
+    static bool keywordBeforeExpression(const char* word, size_t length) {
+        // Every identifier is checked, so reject on length and first
+        // letter before comparing
+        if (length < 2 || length > 10 || word[0] < 'a' || word[0] > 'y') {
+            return false;
+        }
+        static const char* words[] = {"return", "typeof", "instanceof", "in", "of", "new", "delete",
+                                      "void", "throw", "case", "do", "else", "yield", "await", "default"};
+        for (const char* w : words) {
+            if (w[0] == word[0] && std::strlen(w) == length && std::memcmp(word, w, length) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    explicit Lexer(const std::string& source)
+        : begin(source.data()), p(source.data()), end(source.data() + source.size()) {
+        // Hashbang line of an executable script
+        if (source.compare(0, 2, "#!") == 0) {
+            const char* eol = static_cast<const char*>(std::memchr(p, '\n', source.size()));
+            p = eol ? eol : end;
+        }
+    }
+
+    Token next() {
+        sawNewline = false;
+        skipTrivia();
+        const char* start = p;
+        if (p >= end) {
+            return make(TokenKind::End, start);
+        }
+        char c = *p;
+        if (Simd::isIdentifierByte(static_cast<unsigned char>(c)) && !isDigit(c)) {
+            p = Simd::identifierEnd(p, end);
+            regexAllowed = keywordBeforeExpression(start, static_cast<size_t>(p - start));
+            return make(TokenKind::Identifier, start);
+        }
+        if (isDigit(c) || (c == '.' && p + 1 < end && isDigit(p[1]))) {
+            number();
+            regexAllowed = false;
+            return make(TokenKind::Number, start);
+        }
+        switch (c) {
+            case '"':
+            case '\'': {
+                TokenKind kind = string(c);
+                regexAllowed = false;
+                return make(kind, start);
+            }
+            case '`':
+                ++p;
+                return make(templateSpan(true), start);
+            case '#':
+                p = Simd::identifierEnd(p + 1, end);
+                regexAllowed = false;
+                return make(p - start > 1 ? TokenKind::PrivateName : TokenKind::Invalid, start);
+            case '/':
+                if (regexAllowed) {
+                    TokenKind kind = regex();
+                    regexAllowed = false;
+                    return make(kind, start);
+                }
+                break;
+            case '{':
+                ++braceDepth;
+                ++p;
+                regexAllowed = true;
+                return make(TokenKind::Punctuator, start);
+            case '}':
+                --braceDepth;
+                ++p;
+                if (!templateBraces.empty() && templateBraces.back() == braceDepth) {
+                    templateBraces.pop_back();
+                    return make(templateSpan(false), start);
+                }
+                regexAllowed = true;
+                return make(TokenKind::Punctuator, start);
+            case ')':
+            case ']':
+                ++p;
+                regexAllowed = false;
+                return make(TokenKind::Punctuator, start);
+            default:
+                break;
+        }
+        if (static_cast<unsigned char>(c) < 0x20 || c == '\\') {
+            ++p;
+            return make(TokenKind::Invalid, start);
+        }
+        punctuator();
+        // `a++ / b` divides; every other operator is followed by an operand
+        regexAllowed = !(p - start == 2 && (start[0] == '+' || start[0] == '-') && start[1] == start[0]);
+        return make(TokenKind::Punctuator, start);
+    }
+
+    // Lex `token` again as a regex or as division. The guess next() made
+    // from the previous token is wrong after e.g. `)` of an if-condition,
+    // which the parser knows and the lexer does not.
+    Token relex(const Token& token, bool regex) {
+        p = begin + token.start;
+        regexAllowed = regex;
+        Token again = next();
+        again.newlineBefore = token.newlineBefore;
+        return again;
+    }
+
+    // Text between JSX tags, up to the next `{` or `<`. The parser calls
+    // this after the `>` of an opening tag instead of next().
+    Token jsxText() {
+        sawNewline = false;
+        const char* start = p;
+        while (p < end && *p != '{' && *p != '<') {
+            ++p;
+        }
+        return make(TokenKind::JsxText, start);
+    }
+
+    // Where the lexer is, for a parser that needs to look ahead and
+    // then go back
+    struct State {
+        const char* p;
+        bool regexAllowed;
+        int braceDepth;
+        std::vector<int> templateBraces;
+    };
+
+    State save() const {
+        return State{p, regexAllowed, braceDepth, templateBraces};
+    }
+
+    void restore(const State& state) {
+        p = state.p;
+        regexAllowed = state.regexAllowed;
+        braceDepth = state.braceDepth;
+        templateBraces = state.templateBraces;
+    }
+
+    // Lex the `/` at the current position as a regex or as division,
+    // overriding the guess from the previous token
+    void setRegexAllowed(bool allowed) {
+        regexAllowed = allowed;
+    }
+
+    // Name of the scan kernels in use: "avx2", "sse4.2" or "scalar"
+    static const char* backend() {
+        return Simd::kernels().name;
+    }
+};
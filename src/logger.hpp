@@ -0,0 +1,112 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <iomanip>
+
+// ANSI Color Codes for beautiful terminal output
+namespace Colors {
+    const std::string RESET = "\033[0m";
+    const std::string BOLD = "\033[1m";
+    const std::string DIM = "\033[2m";
+    const std::string UNDERLINE = "\033[4m";
+    
+    // Colors
+    const std::string BLACK = "\033[30m";
+    const std::string RED = "\033[31m";
+    const std::string GREEN = "\033[32m";
+    const std::string YELLOW = "\033[33m";
+    const std::string BLUE = "\033[34m";
+    const std::string MAGENTA = "\033[35m";
+    const std::string CYAN = "\033[36m";
+    const std::string WHITE = "\033[37m";
+    
+    // Bright colors
+    const std::string BRIGHT_BLACK = "\033[90m";
+    const std::string BRIGHT_RED = "\033[91m";
+    const std::string BRIGHT_GREEN = "\033[92m";
+    const std::string BRIGHT_YELLOW = "\033[93m";
+    const std::string BRIGHT_BLUE = "\033[94m";
+    const std::string BRIGHT_MAGENTA = "\033[95m";
+    const std::string BRIGHT_CYAN = "\033[96m";
+    const std::string BRIGHT_WHITE = "\033[97m";
+    
+    // Background colors
+    const std::string BG_RED = "\033[41m";
+    const std::string BG_GREEN = "\033[42m";
+    const std::string BG_YELLOW = "\033[43m";
+    const std::string BG_BLUE = "\033[44m";
+    const std::string BG_MAGENTA = "\033[45m";
+    const std::string BG_CYAN = "\033[46m";
+}
+
+// Utility functions for beautiful output
+class Logger {
+public:
+    static void info(const std::string& message) {
+        std::cout << Colors::BRIGHT_BLUE << "ℹ " << Colors::RESET 
+                  << Colors::BRIGHT_WHITE << message << Colors::RESET << std::endl;
+    }
+    
+    static void success(const std::string& message) {
+        std::cout << Colors::BRIGHT_GREEN << "✓ " << Colors::RESET 
+                  << Colors::BRIGHT_WHITE << message << Colors::RESET << std::endl;
+    }
+    
+    static void error(const std::string& message) {
+        std::cerr << Colors::BRIGHT_RED << "✗ " << Colors::RESET 
+                  << Colors::BRIGHT_WHITE << message << Colors::RESET << std::endl;
+    }
+    
+    static void warning(const std::string& message) {
+        std::cout << Colors::BRIGHT_YELLOW << "⚠ " << Colors::RESET 
+                  << Colors::BRIGHT_WHITE << message << Colors::RESET << std::endl;
+    }
+    
+    static void debug(const std::string& message) {
+        std::cout << Colors::DIM << Colors::BRIGHT_BLACK << "DEBUG: " << message << Colors::RESET << std::endl;
+    }
+    
+    static void section(const std::string& title) {
+        std::cout << std::endl << Colors::BOLD << Colors::BRIGHT_CYAN 
+                  << "▶ " << title << Colors::RESET << std::endl;
+    }
+};
+
+// Progress bar implementation
+class ProgressBar {
+private:
+    int width;
+    std::string fill;
+    std::string empty;
+    
+public:
+    ProgressBar(int w = 50) : width(w), fill("█"), empty("░") {}
+    
+    void show(double progress, const std::string& message = "") {
+        int filled = static_cast<int>(progress * width);
+        std::cout << "\r" << Colors::BRIGHT_BLUE << "[";
+        
+        for (int i = 0; i < width; ++i) {
+            if (i < filled) {
+                std::cout << Colors::BRIGHT_GREEN << fill;
+            } else {
+                std::cout << Colors::DIM << empty;
+            }
+        }
+        
+        std::cout << Colors::BRIGHT_BLUE << "] " 
+                  << Colors::BRIGHT_WHITE << std::setw(3) << static_cast<int>(progress * 100) << "%"
+                  << Colors::RESET;
+        
+        if (!message.empty()) {
+            std::cout << " " << Colors::DIM << message << Colors::RESET;
+        }
+        
+        std::cout.flush();
+        
+        if (progress >= 1.0) {
+            std::cout << std::endl;
+        }
+    }
+};
@@ -1,8 +1,33 @@
 #include "CLI11.hpp"
+#include "logger.hpp"
+#include "server.hpp"
+#include "static_files.hpp"
+#include "transform.hpp"
+#include "watcher.hpp"
+#include "websocket.hpp"
+#include "import_scanner.hpp"
+#include "module_graph.hpp"
+#include "hmr.hpp"
+#include "hash.hpp"
+#include "interner.hpp"
+#include "disk_cache.hpp"
+#include "phase_timer.hpp"
+#include "resolver.hpp"
+#include "optimizer.hpp"
+#include "dep_scanner.hpp"
+#include "build.hpp"
 #include <iostream>
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <unordered_set>
+#include <sstream>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <chrono>
@@ -10,114 +35,12 @@
 #include <iomanip>
 #include <cstdlib>
 
-namespace fs = std::filesystem;
-
-// ANSI Color Codes for beautiful terminal output
-namespace Colors {
-    const std::string RESET = "\033[0m";
-    const std::string BOLD = "\033[1m";
-    const std::string DIM = "\033[2m";
-    const std::string UNDERLINE = "\033[4m";
-    
-    // Colors
-    const std::string BLACK = "\033[30m";
-    const std::string RED = "\033[31m";
-    const std::string GREEN = "\033[32m";
-    const std::string YELLOW = "\033[33m";
-    const std::string BLUE = "\033[34m";
-    const std::string MAGENTA = "\033[35m";
-    const std::string CYAN = "\033[36m";
-    const std::string WHITE = "\033[37m";
-    
-    // Bright colors
-    const std::string BRIGHT_BLACK = "\033[90m";
-    const std::string BRIGHT_RED = "\033[91m";
-    const std::string BRIGHT_GREEN = "\033[92m";
-    const std::string BRIGHT_YELLOW = "\033[93m";
-    const std::string BRIGHT_BLUE = "\033[94m";
-    const std::string BRIGHT_MAGENTA = "\033[95m";
-    const std::string BRIGHT_CYAN = "\033[96m";
-    const std::string BRIGHT_WHITE = "\033[97m";
-    
-    // Background colors
-    const std::string BG_RED = "\033[41m";
-    const std::string BG_GREEN = "\033[42m";
-    const std::string BG_YELLOW = "\033[43m";
-    const std::string BG_BLUE = "\033[44m";
-    const std::string BG_MAGENTA = "\033[45m";
-    const std::string BG_CYAN = "\033[46m";
-}
-
-// Utility functions for beautiful output
-class Logger {
-public:
-    static void info(const std::string& message) {
-        std::cout << Colors::BRIGHT_BLUE << "ℹ " << Colors::RESET 
-                  << Colors::BRIGHT_WHITE << message << Colors::RESET << std::endl;
-    }
-    
-    static void success(const std::string& message) {
-        std::cout << Colors::BRIGHT_GREEN << "✓ " << Colors::RESET 
-                  << Colors::BRIGHT_WHITE << message << Colors::RESET << std::endl;
-    }
-    
-    static void error(const std::string& message) {
-        std::cerr << Colors::BRIGHT_RED << "✗ " << Colors::RESET 
-                  << Colors::BRIGHT_WHITE << message << Colors::RESET << std::endl;
-    }
-    
-    static void warning(const std::string& message) {
-        std::cout << Colors::BRIGHT_YELLOW << "⚠ " << Colors::RESET 
-                  << Colors::BRIGHT_WHITE << message << Colors::RESET << std::endl;
-    }
-    
-    static void debug(const std::string& message) {
-        std::cout << Colors::DIM << Colors::BRIGHT_BLACK << "DEBUG: " << message << Colors::RESET << std::endl;
-    }
-    
-    static void section(const std::string& title) {
-        std::cout << std::endl << Colors::BOLD << Colors::BRIGHT_CYAN 
-                  << "▶ " << title << Colors::RESET << std::endl;
-    }
-};
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
 
-// Progress bar implementation
-class ProgressBar {
-private:
-    int width;
-    std::string fill;
-    std::string empty;
-    
-public:
-    ProgressBar(int w = 50) : width(w), fill("█"), empty("░") {}
-    
-    void show(double progress, const std::string& message = "") {
-        int filled = static_cast<int>(progress * width);
-        std::cout << "\r" << Colors::BRIGHT_BLUE << "[";
-        
-        for (int i = 0; i < width; ++i) {
-            if (i < filled) {
-                std::cout << Colors::BRIGHT_GREEN << fill;
-            } else {
-                std::cout << Colors::DIM << empty;
-            }
-        }
-        
-        std::cout << Colors::BRIGHT_BLUE << "] " 
-                  << Colors::BRIGHT_WHITE << std::setw(3) << static_cast<int>(progress * 100) << "%"
-                  << Colors::RESET;
-        
-        if (!message.empty()) {
-            std::cout << " " << Colors::DIM << message << Colors::RESET;
-        }
-        
-        std::cout.flush();
-        
-        if (progress >= 1.0) {
-            std::cout << std::endl;
-        }
-    }
-};
+namespace fs = std::filesystem;
 
 // Template system for project scaffolding
 class Template {
@@ -136,6 +59,7 @@ public:
 class TemplateManager {
 private:
     std::vector<Template> templates;
+    std::unordered_map<Atom, size_t> indexByName;
     
     void initializeTemplates() {
         // Vanilla JavaScript template
@@ -295,6 +219,9 @@ export default defineConfig({
 public:
     TemplateManager() {
         initializeTemplates();
+        for (size_t i = 0; i < templates.size(); ++i) {
+            indexByName.emplace(intern(templates[i].name), i);
+        }
     }
     
     void displayTemplates() {
@@ -309,12 +236,11 @@ public:
     }
     
     Template* getTemplate(const std::string& name) {
-        for (auto& tmpl : templates) {
-            if (tmpl.name == name) {
-                return &tmpl;
-            }
-        }
-        return nullptr;
+        // A name that was never interned names no template
+        bool known = false;
+        Atom atom = Interner::global().find(name, known);
+        auto it = known ? indexByName.find(atom) : indexByName.end();
+        return it == indexByName.end() ? nullptr : &templates[it->second];
     }
     
     Template* getTemplate(int index) {
@@ -567,60 +493,708 @@ public:
     }
 };
 
-// Development server simulator
+// The addresses other machines can reach a server on: `host` itself, or
+// for a wildcard host every non-loopback interface address
+static std::vector<std::string> networkAddresses(const std::string& host) {
+    if (host != "0.0.0.0" && host != "::") {
+        return {host};
+    }
+    std::vector<std::string> addresses;
+    ifaddrs* interfaces = nullptr;
+    if (getifaddrs(&interfaces) != 0) {
+        return {host};
+    }
+    for (ifaddrs* it = interfaces; it; it = it->ifa_next) {
+        if (!it->ifa_addr || (it->ifa_flags & IFF_LOOPBACK)) {
+            continue;
+        }
+        char text[INET6_ADDRSTRLEN] = {};
+        int family = it->ifa_addr->sa_family;
+        if (family == AF_INET) {
+            inet_ntop(AF_INET, &reinterpret_cast<sockaddr_in*>(it->ifa_addr)->sin_addr, text, sizeof(text));
+        } else if (family == AF_INET6 && host == "::") {
+            const in6_addr& address = reinterpret_cast<sockaddr_in6*>(it->ifa_addr)->sin6_addr;
+            if (IN6_IS_ADDR_LINKLOCAL(&address)) {
+                continue;
+            }
+            inet_ntop(AF_INET6, &address, text, sizeof(text));
+        } else {
+            continue;
+        }
+        if (std::find(addresses.begin(), addresses.end(), text) == addresses.end()) {
+            addresses.push_back(text);
+        }
+    }
+    freeifaddrs(interfaces);
+    return addresses;
+}
+
+// Print the Local and Network URLs of a server listening on `host`
+static void printServerUrls(const std::string& host, int port) {
+    auto url = [port](const std::string& address) {
+        bool ipv6 = address.find(':') != std::string::npos;
+        return "http://" + (ipv6 ? "[" + address + "]" : address) + ":" + std::to_string(port) + "/";
+    };
+    bool exposed = host != "localhost" && host != "127.0.0.1" && host != "::1";
+    std::string localHost = (host == "0.0.0.0" || host == "::" || !exposed) ? "localhost" : host;
+
+    std::cout << Colors::BRIGHT_GREEN << "➜" << Colors::RESET 
+              << "  " << Colors::BOLD << "Local:" << Colors::RESET 
+              << "   " << Colors::BRIGHT_CYAN << url(localHost) << Colors::RESET << std::endl;
+    
+    if (!exposed) {
+        std::cout << Colors::BRIGHT_GREEN << "➜" << Colors::RESET 
+                  << "  " << Colors::BOLD << "Network:" << Colors::RESET << " " << Colors::BRIGHT_CYAN
+                  << "use --host to expose" << Colors::RESET << std::endl;
+        return;
+    }
+    for (const auto& address : networkAddresses(host)) {
+        std::cout << Colors::BRIGHT_GREEN << "➜" << Colors::RESET 
+                  << "  " << Colors::BOLD << "Network:" << Colors::RESET << " " << Colors::BRIGHT_CYAN
+                  << url(address) << Colors::RESET << std::endl;
+    }
+}
+
+// Development server
 class DevServer {
+private:
+    bool verbose;
+    TransformCache transformCache;
+    ModuleGraph moduleGraph;
+    DiskCache diskCache;
+    ModuleResolver resolver;
+    std::atomic<uint64_t> configHash{0};
+    // Bundles written by `vite optimize`; null when missing or stale
+    std::shared_ptr<const OptimizedDeps> optimizedDeps;
+    // Background crawl started with the server; it reports only once the
+    // startup banner is out
+    std::thread dependencyScan;
+    std::mutex bannerMutex;
+    std::condition_variable bannerCv;
+    bool bannerShown = false;
+    
+    // Bump whenever transform output changes so persisted results from
+    // older builds are never served
+    static constexpr const char* TRANSFORM_CACHE_VERSION = "vite-transform-1";
+    
+    // Browsers mark module-script fetches with Sec-Fetch-Dest: script; the
+    // ?import query covers clients that do not send fetch metadata.
+    static bool isScriptImport(const HttpRequest& req) {
+        if (req.header("Sec-Fetch-Dest") == "script") {
+            return true;
+        }
+        std::string query = "&" + req.query + "&";
+        return query.find("&import&") != std::string::npos || query.find("&import=") != std::string::npos;
+    }
+    
+    static bool isJsModule(const std::string& ext) {
+        return ext == ".js" || ext == ".mjs" || ext == ".jsx" || ext == ".ts" || ext == ".tsx";
+    }
+    
+    static long long nowMillis() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    
+    // URL a file under the root is served at, "" for files outside it
+    static std::string urlForFile(const StaticFiles& files, const fs::path& file) {
+        if (file.empty()) {
+            return "";
+        }
+        fs::path relative = file.lexically_relative(files.getRoot());
+        if (relative.empty() || *relative.begin() == "..") {
+            return "";
+        }
+        return "/" + relative.generic_string();
+    }
+    
+    // Use the pre-bundled dependencies only while they match the installed
+    // packages; stale bundles would serve old code
+    void loadOptimizedDeps(const fs::path& root) {
+        auto deps = std::make_shared<OptimizedDeps>();
+        std::shared_ptr<const OptimizedDeps> loaded;
+        if (DepOptimizer::loadMetadata(root, *deps)) {
+            if (DepOptimizer::isCurrent(root, "development", *deps)) {
+                loaded = deps;
+            } else {
+                Logger::warning("Pre-bundled dependencies are out of date, run `vite optimize` to rebuild them");
+            }
+        }
+        std::atomic_store(&optimizedDeps, loaded);
+    }
+    
+    // Crawl the project on a background thread. It warms the resolver and
+    // stat caches for the first page load and reports bare imports that
+    // `vite optimize` has not pre-bundled, without delaying startup.
+    void startDependencyScan(const fs::path& root) {
+        dependencyScan = std::thread([this, root]() {
+            sigset_t all;
+            sigfillset(&all);
+            pthread_sigmask(SIG_BLOCK, &all, nullptr);
+            PhaseTimer timer;
+            DependencyScan scan = DependencyScanner(root, resolver).scan();
+            double millis = timer.totalMillis();
+            std::shared_ptr<const OptimizedDeps> deps = std::atomic_load(&optimizedDeps);
+            std::string missing;
+            for (const auto& dep : scan.deps) {
+                if (!deps || !deps->deps.count(dep.first)) {
+                    missing += (missing.empty() ? "" : ", ") + dep.first;
+                }
+            }
+            std::unique_lock<std::mutex> lock(bannerMutex);
+            bannerCv.wait(lock, [this]() { return bannerShown; });
+            if (!missing.empty()) {
+                Logger::info("Dependencies not pre-bundled: " + missing + ". Run `vite optimize` to bundle them.");
+            }
+            if (verbose) {
+                Logger::debug("Dependency scan: " + std::to_string(scan.files) + " files, " +
+                              std::to_string(scan.deps.size()) + " dependencies in " + PhaseTimer::format(millis));
+            }
+        });
+    }
+    
+    void showScanReport() {
+        {
+            std::lock_guard<std::mutex> lock(bannerMutex);
+            bannerShown = true;
+        }
+        bannerCv.notify_all();
+    }
+    
+    // Collect the module's imports in one pass over the source. Specifiers
+    // the browser could not load as written (packages, missing extensions,
+    // directory imports) are rewritten to the URL of the resolved file, and
+    // imports of hot-updated modules point at their new version with
+    // ?t=<timestamp>.
+    ModuleTransform transformModule(const StaticFiles& files, const std::string& url, const fs::path& file,
+                                    const std::string& source) {
+        ImportScan scan = ImportScanner::scan(source);
+        std::shared_ptr<const OptimizedDeps> deps = std::atomic_load(&optimizedDeps);
+        ModuleTransform out;
+        std::string code;
+        code.reserve(source.size() + source.size() / 8);
+        size_t copied = 0;
+        for (const auto& record : scan.imports) {
+            size_t queryStart = record.specifier.find_first_of("?#", 1);
+            std::string path = record.specifier.substr(0, queryStart);
+            std::string query = queryStart == std::string::npos ? "" : record.specifier.substr(queryStart);
+            if (deps && ModuleResolver::isBare(path)) {
+                auto optimized = deps->deps.find(path);
+                if (optimized != deps->deps.end()) {
+                    code.append(source, copied, record.start - copied);
+                    code += "/node_modules/.vite/deps/" + optimized->second.file + "?v=" + deps->browserHash;
+                    copied = record.end;
+                    continue;
+                }
+            }
+            fs::path depFile = resolver.resolve(path, file.parent_path());
+            std::string depUrl = urlForFile(files, depFile);
+            if (depUrl.empty()) {
+                continue;
+            }
+            out.imports[depUrl] = depFile.string();
+            long long timestamp = moduleGraph.timestampOf(depUrl);
+            bool verbatim = path[0] == '/' ? path == depUrl
+                                           : (file.parent_path() / path).lexically_normal() == depFile;
+            if (verbatim && timestamp == 0) {
+                continue;
+            }
+            std::string specifier = (verbatim ? path : depUrl) + query;
+            if (timestamp > 0) {
+                specifier += specifier.find('?') == std::string::npos ? "?t=" : "&t=";
+                specifier += std::to_string(timestamp);
+            }
+            code.append(source, copied, record.start - copied);
+            code += specifier;
+            copied = record.end;
+        }
+        code.append(source, copied, std::string::npos);
+        
+        for (const auto& dep : scan.acceptedDeps) {
+            std::string depUrl = urlForFile(files, resolver.resolve(dep, file.parent_path()));
+            if (!depUrl.empty()) {
+                out.acceptedDeps.insert(depUrl);
+            }
+        }
+        out.selfAccepting = scan.selfAccepting;
+        out.code = scan.usesHot ? Hmr::hotPreamble(url) + code : code;
+        return out;
+    }
+    
+    // Files whose contents change what transforms produce: the config, and
+    // the manifests and lockfiles that decide which packages imports
+    // resolve to
+    static const std::vector<std::string>& configFiles() {
+        static const std::vector<std::string> names = {
+            "vite.config.js", "vite.config.mjs", "vite.config.ts", "vite.config.json",
+            "package.json", "package-lock.json", "yarn.lock", "pnpm-lock.yaml"
+        };
+        return names;
+    }
+    
+    // Persisted transforms are only valid for the config, installed
+    // packages and transform code that produced them
+    static uint64_t computeConfigHash(const fs::path& root) {
+        Hash::Xxh64 state;
+        state.update(TRANSFORM_CACHE_VERSION, std::strlen(TRANSFORM_CACHE_VERSION));
+        for (const auto& name : configFiles()) {
+            if (Hash::updateWithFile(state, (root / name).string())) {
+                state.update("\n" + name + "\n");
+            }
+        }
+        return state.digest();
+    }
+    
+    std::string diskCacheKey(const std::string& url, uint64_t hash) const {
+        return url + "\n" + Hash::hex(hash) + Hash::hex(configHash.load());
+    }
+    
+    // Imports are stored as URLs and resolved again on load, so a moved
+    // project directory does not carry stale file paths
+    static std::string encodeModule(const ModuleTransform& module) {
+        ByteWriter out;
+        out.putString(module.code);
+        out.putU32(module.selfAccepting ? 1 : 0);
+        out.putU32(static_cast<uint32_t>(module.imports.size()));
+        for (const auto& imported : module.imports) {
+            out.putString(imported.first);
+        }
+        out.putU32(static_cast<uint32_t>(module.acceptedDeps.size()));
+        for (const auto& dep : module.acceptedDeps) {
+            out.putString(dep);
+        }
+        return out.bytes();
+    }
+    
+    static bool decodeModule(const StaticFiles& files, const std::string& bytes, ModuleTransform& module) {
+        ByteReader in(bytes);
+        uint32_t selfAccepting = 0;
+        uint32_t count = 0;
+        if (!in.getString(module.code) || !in.getU32(selfAccepting) || !in.getU32(count)) {
+            return false;
+        }
+        module.selfAccepting = selfAccepting != 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            std::string depUrl;
+            if (!in.getString(depUrl)) {
+                return false;
+            }
+            fs::path depFile = files.resolve(depUrl);
+            if (!depFile.empty()) {
+                module.imports[depUrl] = depFile.string();
+            }
+        }
+        if (!in.getU32(count)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            std::string dep;
+            if (!in.getString(dep)) {
+                return false;
+            }
+            module.acceptedDeps.insert(dep);
+        }
+        return in.done();
+    }
+    
+    // Reuse a transform persisted by an earlier run, unless a dependency
+    // was hot-updated since and the code needs its new ?t= stamp
+    bool loadPersisted(const StaticFiles& files, const std::string& key, ModuleTransform& module) const {
+        std::string bytes;
+        return diskCache.find(key, bytes) && decodeModule(files, bytes, module) &&
+               !moduleGraph.importsHotUpdated(module);
+    }
+    
+    static bool fileState(const fs::path& file, fs::file_time_type& mtime, uintmax_t& size) {
+        std::error_code ec;
+        if (file.empty() || !fs::is_regular_file(file, ec)) {
+            return false;
+        }
+        mtime = fs::last_write_time(file, ec);
+        if (ec) {
+            return false;
+        }
+        size = fs::file_size(file, ec);
+        return !ec;
+    }
+    
+    // Revalidations carrying the current ETag are answered with a bodyless
+    // 304, so unchanged modules cost a stat and a hash-string compare
+    static void respondWith(const TransformResult& result, const HttpRequest& req, HttpResponse& res) {
+        res.setHeader("ETag", result.etag);
+        if (Http::etagMatches(req.header("If-None-Match"), result.etag)) {
+            res.status = 304;
+            return;
+        }
+        res.status = 200;
+        res.setHeader("Content-Type", result.contentType);
+        res.body = result.code;
+    }
+    
+    // Serve a module from its graph node. The file is only read when its
+    // mtime or size moved, and only transformed when its content hash did
+    // and no earlier run left a transform of the same bytes on disk.
+    bool serveModule(const StaticFiles& files, const HttpRequest& req, const std::string& url, const fs::path& file,
+                     HttpResponse& res, const std::function<ModuleTransform(const std::string&)>& transform) {
+        fs::file_time_type mtime;
+        uintmax_t size = 0;
+        if (!fileState(file, mtime, size)) {
+            return false;
+        }
+        auto result = moduleGraph.cachedTransform(url, mtime, size);
+        if (!result) {
+            std::string source;
+            if (!StaticFiles::readFile(file, source)) {
+                return false;
+            }
+            uint64_t hash = Hash::xxh64(source);
+            std::shared_ptr<TransformResult> fresh;
+            if (auto same = moduleGraph.transformForContent(url, hash)) {
+                fresh = std::make_shared<TransformResult>(*same);
+            } else {
+                std::string key = diskCacheKey(url, hash);
+                ModuleTransform module;
+                if (!loadPersisted(files, key, module)) {
+                    module = transform(source);
+                    if (!moduleGraph.importsHotUpdated(module)) {
+                        diskCache.store(key, encodeModule(module));
+                    }
+                }
+                moduleGraph.updateImports(url, file.string(), module);
+                fresh = std::make_shared<TransformResult>();
+                fresh->contentType = "text/javascript; charset=utf-8";
+                fresh->code = std::move(module.code);
+                fresh->etag = Hash::etag(fresh->code);
+            }
+            fresh->mtime = mtime;
+            fresh->size = size;
+            moduleGraph.storeTransform(url, file.string(), fresh, hash);
+            result = fresh;
+        }
+        respondWith(*result, req, res);
+        return true;
+    }
+    
+    // Pages are not modules; their client-injected copies live in the
+    // transform cache
+    bool serveHtml(const HttpRequest& req, const fs::path& file, HttpResponse& res) {
+        auto result = transformCache.getOrTransform(file.string() + "?html", file,
+            [](const fs::path& path, TransformResult& out) {
+                std::string source;
+                if (!StaticFiles::readFile(path, source)) {
+                    return false;
+                }
+                out.code = Hmr::injectClient(source);
+                out.contentType = "text/html; charset=utf-8";
+                out.etag = Hash::etag(out.code);
+                return true;
+            });
+        if (!result) {
+            return false;
+        }
+        respondWith(*result, req, res);
+        return true;
+    }
+    
+    // Runs on the watcher thread with one debounced batch of changes: works
+    // out which modules accept the update and pushes it to every browser
+    void onFilesChanged(const StaticFiles& files, HttpServer& server, const std::vector<FileChange>& changes) {
+        long long timestamp = nowMillis();
+        std::vector<HmrBoundary> boundaries;
+        std::set<std::pair<std::string, std::string>> seenBoundaries;
+        std::vector<std::string> stylesheets;
+        std::string reloadUrl;
+        bool fullReload = false;
+        // The newest mtime in the batch marks when the user saved
+        long long savedAt = 0;
+        bool configChanged = false;
+        // The watcher lost events and reports the root: anything may have
+        // changed
+        bool rescan = std::any_of(changes.begin(), changes.end(), [&](const FileChange& change) {
+            return fs::path(change.path) == files.getRoot();
+        });
+        
+        for (const auto& change : changes) {
+            if (rescan) {
+                break;
+            }
+            transformCache.invalidate(change.path + "?html");
+            if (change.kind != FileChange::Kind::Modified) {
+                resolver.invalidate(change.path);
+            }
+            fs::path changed(change.path);
+            if (changed.parent_path() == files.getRoot()) {
+                const auto& names = configFiles();
+                configChanged = configChanged ||
+                                std::find(names.begin(), names.end(), changed.filename().string()) != names.end();
+            }
+            std::string url = "/" + fs::path(change.path).lexically_relative(files.getRoot()).generic_string();
+            struct stat st;
+            if (stat(change.path.c_str(), &st) == 0) {
+                savedAt = std::max(savedAt, static_cast<long long>(st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000);
+            }
+            
+            std::vector<std::string> urls = moduleGraph.urlsForFile(change.path);
+            if (urls.empty()) {
+                std::string ext = fs::path(change.path).extension().string();
+                if (ext == ".html") {
+                    fullReload = true;
+                    reloadUrl = url;
+                } else if (ext == ".css") {
+                    stylesheets.push_back(url);
+                }
+                continue;
+            }
+            if (change.kind == FileChange::Kind::Deleted) {
+                moduleGraph.invalidateFile(change.path);
+                fullReload = true;
+                reloadUrl = urls.front();
+                continue;
+            }
+            // A save or checkout that left the bytes alone needs no update
+            std::string source;
+            if (StaticFiles::readFile(change.path, source)) {
+                uint64_t hash = Hash::xxh64(source);
+                bool unchanged = true;
+                for (const auto& moduleUrl : urls) {
+                    unchanged = unchanged && moduleGraph.hashOf(moduleUrl) == hash;
+                }
+                if (unchanged) {
+                    continue;
+                }
+            }
+            for (const auto& moduleUrl : urls) {
+                std::vector<HmrBoundary> found;
+                if (!moduleGraph.collectUpdate(moduleUrl, timestamp, found)) {
+                    fullReload = true;
+                    reloadUrl = moduleUrl;
+                }
+                for (auto& boundary : found) {
+                    if (seenBoundaries.insert({boundary.boundary, boundary.acceptedVia}).second) {
+                        boundaries.push_back(std::move(boundary));
+                    }
+                }
+            }
+        }
+        
+        // New config or packages can change every transform and resolution
+        if (configChanged || rescan) {
+            configHash = computeConfigHash(files.getRoot());
+            resolver.clear();
+            loadOptimizedDeps(files.getRoot());
+            moduleGraph.invalidateAll();
+            fullReload = true;
+            reloadUrl = "*";
+        }
+        
+        std::string summary;
+        if (fullReload) {
+            server.broadcast(Hmr::fullReloadMessage(reloadUrl));
+            summary = "page reload " + reloadUrl;
+        } else if (!boundaries.empty() || !stylesheets.empty()) {
+            server.broadcast(Hmr::updateMessage(boundaries, stylesheets, timestamp));
+            std::set<std::string> paths;
+            for (const auto& boundary : boundaries) {
+                paths.insert(boundary.boundary);
+            }
+            paths.insert(stylesheets.begin(), stylesheets.end());
+            size_t shown = 0;
+            for (const auto& path : paths) {
+                if (shown++ == 3) {
+                    summary += " and " + std::to_string(paths.size() - 3) + " more";
+                    break;
+                }
+                summary += (summary.empty() ? "hmr update " : ", ") + path;
+            }
+        } else {
+            return;
+        }
+        Logger::info(summary);
+        if (verbose && savedAt > 0) {
+            Logger::debug("HMR latency: " + std::to_string(std::max(0LL, nowMillis() - savedAt)) +
+                          "ms from file save to browser message");
+        }
+    }
+    
+    void handleRequest(StaticFiles& files, const HttpRequest& req, HttpResponse& res) {
+        if (WebSocket::isUpgradeRequest(req)) {
+            if (req.header("Sec-WebSocket-Protocol").find(Hmr::PROTOCOL) == std::string::npos) {
+                res.status = 400;
+                res.setHeader("Content-Type", "text/plain; charset=utf-8");
+                res.body = "Unsupported WebSocket protocol\n";
+                return;
+            }
+            WebSocket::acceptUpgrade(req, res, Hmr::PROTOCOL);
+            return;
+        }
+        res.setHeader("Cache-Control", "no-cache");
+        
+        bool readable = req.method == "GET" || req.method == "HEAD";
+        if (readable && req.path == Hmr::CLIENT_PATH) {
+            res.status = 200;
+            res.setHeader("Content-Type", "text/javascript; charset=utf-8");
+            res.body = Hmr::clientScript();
+            return;
+        }
+        
+        std::string ext = fs::path(req.path).extension().string();
+        std::string url = req.path;
+        if (readable && (ext == ".css" || ext == ".json") && isScriptImport(req)) {
+            fs::path file = files.resolve(req.path);
+            bool served = serveModule(files, req, url, file, res,
+                [&](const std::string& source) {
+                    // CSS modules accept their own updates by replacing the
+                    // <style> they injected; JSON updates go to importers
+                    ModuleTransform module;
+                    module.selfAccepting = ext == ".css";
+                    module.code = module.selfAccepting
+                        ? Hmr::hotPreamble(url) + Transforms::cssToModule(source, url) + "import.meta.hot.accept();\n"
+                        : Transforms::jsonToModule(source);
+                    return module;
+                });
+            if (served) {
+                return;
+            }
+        } else if (readable && isJsModule(ext)) {
+            fs::path file = files.resolve(req.path);
+            bool served = serveModule(files, req, url, file, res,
+                [&](const std::string& source) { return transformModule(files, url, file, source); });
+            if (served) {
+                return;
+            }
+        } else if (readable) {
+            fs::path file = files.lookup(req);
+            if (file.extension() == ".html" && serveHtml(req, file, res)) {
+                return;
+            }
+        }
+        
+        files.serve(req, res);
+    }
+
 public:
-    void start(int port = 5173, bool open = false) {
+    explicit DevServer(bool verboseOutput = false) : verbose(verboseOutput), resolver(fs::current_path()) {}
+    
+    ~DevServer() {
+        showScanReport();
+        if (dependencyScan.joinable()) {
+            dependencyScan.join();
+        }
+    }
+    
+    void start(int port = 5173, bool open = false, const std::string& host = "localhost", int workers = 1,
+               IoBackend backend = IoBackend::Epoll) {
+        PhaseTimer timer;
         Logger::section("Starting Development Server");
         
-        // Simulate server startup
         ProgressBar progress(30);
         std::vector<std::string> startupTasks = {
             "Loading configuration",
-            "Initializing plugins",
-            "Scanning dependencies",
-            "Building optimized deps",
-            "Starting server"
+            "Starting dependency scan",
+            "Starting server",
+            "Watching files"
+        };
+        size_t task = 0;
+        auto beginTask = [&]() {
+            timer.begin(startupTasks[task]);
+            progress.show(static_cast<double>(task) / startupTasks.size(), startupTasks[task]);
+            ++task;
         };
         
-        for (size_t i = 0; i < startupTasks.size(); ++i) {
-            double prog = static_cast<double>(i + 1) / startupTasks.size();
-            progress.show(prog, startupTasks[i]);
-            std::this_thread::sleep_for(std::chrono::milliseconds(300 + (rand() % 200)));
-        }
+        beginTask();
+        StaticFiles files(fs::current_path());
+        configHash = computeConfigHash(files.getRoot());
+        loadOptimizedDeps(files.getRoot());
+        bool cacheOpen = diskCache.open(files.getRoot() / "node_modules" / ".vite" / "transforms.cache");
+        
+        // Nothing is transformed up front: modules are transformed when the
+        // browser first requests them. The scan runs in the background and
+        // reports its own time once it finishes.
+        beginTask();
+        startDependencyScan(files.getRoot());
+        
+        beginTask();
+        HttpServer server;
+        int requestedPort = port;
+        port = server.listenAvailable(host, port, workers);
+        std::string fallbackReason;
+        IoBackend activeBackend = HttpServer::resolveBackend(backend, fallbackReason);
+        
+        beginTask();
+        FileWatcher watcher(files.getRoot());
+        bool watching = watcher.start([this, &files, &server](const std::vector<FileChange>& changes) {
+            onFilesChanged(files, server, changes);
+        });
+        timer.end();
+        progress.show(1.0, "Ready");
         
         std::cout << std::endl;
+        if (port != requestedPort) {
+            Logger::warning("Port " + std::to_string(requestedPort) + " is in use, using " + std::to_string(port) + " instead");
+        }
         Logger::success("Development server started!");
+        if (activeBackend != backend) {
+            Logger::warning("io_uring unavailable (" + fallbackReason + "), falling back to epoll");
+        }
+        if (server.workerCount() > 1) {
+            Logger::info("Serving with " + std::to_string(server.workerCount()) + " worker threads");
+        }
         
         // Display server info
         std::cout << std::endl;
-        std::cout << Colors::BRIGHT_GREEN << "➜" << Colors::RESET 
-                  << "  " << Colors::BOLD << "Local:" << Colors::RESET 
-                  << "   " << Colors::BRIGHT_CYAN << "http://localhost:" << port << "/" << Colors::RESET << std::endl;
-                  
-        std::cout << Colors::BRIGHT_GREEN << "➜" << Colors::RESET 
-                  << "  " << Colors::BOLD << "Network:" << Colors::RESET 
-                  << " " << Colors::BRIGHT_CYAN << "use --host to expose" << Colors::RESET << std::endl;
+        printServerUrls(host, server.port());
         
         std::cout << std::endl;
-        std::cout << Colors::DIM << "ready in " << Colors::BRIGHT_WHITE << "850ms" << Colors::RESET << std::endl;
+        std::cout << Colors::DIM << "ready in " << Colors::BRIGHT_WHITE << PhaseTimer::format(timer.totalMillis())
+                  << Colors::RESET << std::endl;
         std::cout << std::endl;
+        if (verbose) {
+            timer.report();
+            Logger::debug(std::string("Lexer: ") + Lexer::backend() + " scan kernels");
+            if (cacheOpen) {
+                Logger::debug("Transform cache: " + std::to_string(diskCache.size()) + " entries on disk");
+            }
+        }
         
         if (open) {
             Logger::info("Opening browser...");
             // In a real implementation, this would open the browser
         }
         
-        // Simulate file watching
-        Logger::info("Watching for file changes...");
+        if (watching) {
+            Logger::info("Watching for file changes...");
+        }
         std::cout << Colors::DIM << "Press Ctrl+C to stop" << Colors::RESET << std::endl;
+        showScanReport();
+        
+        server.run([this, &files](const HttpRequest& req, HttpResponse& res) {
+            handleRequest(files, req, res);
+        }, activeBackend);
+        
+        watcher.stop();
+        if (dependencyScan.joinable()) {
+            dependencyScan.join();
+        }
+        std::cout << std::endl;
+        if (verbose) {
+            Logger::debug("Resolver: " + std::to_string(resolver.size()) + " cached resolutions, " +
+                          std::to_string(resolver.statCalls()) + " stat calls");
+        }
+        Logger::info("Development server stopped");
     }
 };
 
 // Build system
 class Builder {
+private:
+    bool verbose;
+    
 public:
-    void build(bool minify = true, const std::string& outDir = "dist") {
+    explicit Builder(bool verboseOutput = false) : verbose(verboseOutput) {}
+    
+    // Returns false when the build failed; the errors are already logged
+    bool build(bool minify = true, const std::string& outDir = "dist", size_t minChunkSize = 10000) {
+        PhaseTimer timer;
         Logger::section("Building for Production");
         
         // Display build configuration
@@ -630,50 +1204,110 @@ public:
             Logger::info("Minification disabled");
         }
         
-        // Simulate build process
         ProgressBar progress(40);
-        std::vector<std::string> buildTasks = {
-            "Cleaning output directory",
-            "Analyzing dependencies",
-            "Bundling modules",
-            "Optimizing assets",
-            minify ? "Minifying code" : "Preserving code formatting",
-            "Generating source maps",
-            "Writing output files"
-        };
-        
-        for (size_t i = 0; i < buildTasks.size(); ++i) {
-            double prog = static_cast<double>(i + 1) / buildTasks.size();
-            progress.show(prog, buildTasks[i]);
-            std::this_thread::sleep_for(std::chrono::milliseconds(400 + (rand() % 300)));
+        ModuleResolver resolver(fs::current_path(), true);
+        BuildPipeline pipeline(fs::current_path(), outDir, resolver);
+        pipeline.setMinChunkSize(minChunkSize);
+        pipeline.setMinify(minify);
+        if (!pipeline.run(timer, progress)) {
+            Logger::error("Build failed");
+            return false;
         }
+        const BuildResult& result = pipeline.output();
         
         std::cout << std::endl;
         Logger::success("Build completed!");
         
+        // Every file written, pages first, like Vite's summary
+        std::cout << std::endl;
+        std::vector<BuildOutput> outputs = result.outputs;
+        std::stable_sort(outputs.begin(), outputs.end(), [](const BuildOutput& a, const BuildOutput& b) {
+            return a.kind < b.kind;
+        });
+        size_t width = 0;
+        for (const auto& output : outputs) {
+            width = std::max(width, outDir.size() + 1 + output.name.size());
+        }
+        for (const auto& output : outputs) {
+            std::string name = outDir + "/" + output.name;
+            std::cout << Colors::DIM << "  " << name << std::string(width - name.size() + 2, ' ')
+                      << Colors::RESET << Colors::BRIGHT_WHITE << std::fixed << std::setprecision(2)
+                      << std::setw(8) << output.bytes / 1000.0 << " kB" << Colors::RESET << std::endl;
+        }
+        
         // Display build stats
         std::cout << std::endl;
         Logger::section("Build Statistics");
         std::cout << Colors::BRIGHT_WHITE << "  Output directory: " << Colors::BRIGHT_CYAN 
                   << outDir << Colors::RESET << std::endl;
+        std::cout << Colors::BRIGHT_WHITE << "  Modules transformed: " << Colors::BRIGHT_GREEN 
+                  << result.modules << Colors::RESET << std::endl;
         std::cout << Colors::BRIGHT_WHITE << "  Bundle size: " << Colors::BRIGHT_GREEN 
-                  << (minify ? "142.43 kB" : "284.12 kB") << Colors::RESET << std::endl;
-        std::cout << Colors::BRIGHT_WHITE << "  Gzipped size: " << Colors::BRIGHT_GREEN 
-                  << (minify ? "46.21 kB" : "78.45 kB") << Colors::RESET << std::endl;
+                  << std::fixed << std::setprecision(2) << result.bundleBytes() / 1000.0 << " kB"
+                  << Colors::RESET << std::endl;
         std::cout << Colors::BRIGHT_WHITE << "  Build time: " << Colors::BRIGHT_YELLOW 
-                  << "2.84s" << Colors::RESET << std::endl;
+                  << PhaseTimer::format(timer.totalMillis()) << Colors::RESET << std::endl;
         std::cout << std::endl;
+        if (verbose) {
+            timer.report();
+            Logger::debug(std::string("Lexer: ") + Lexer::backend() + " scan kernels");
+            Logger::debug("Syntax trees: " + std::to_string(result.astBytes / 1024) + " KiB in per-module arenas");
+            Logger::debug("Tree shaking: dropped " + std::to_string(result.shakenModules) + " modules and " +
+                          std::to_string(result.shakenStatements) + " top-level statements (" +
+                          std::to_string(result.shakenBytes / 1024) + " KiB of source)");
+            Logger::debug("Code splitting: " + std::to_string(result.chunks) + " chunks, " +
+                          std::to_string(result.sharedChunks) + " shared; " + std::to_string(result.copiedModules) +
+                          " modules copied into pages under the " + std::to_string(minChunkSize) +
+                          " byte minimum chunk size");
+            if (minify && result.minifyInputBytes > 0) {
+                std::ostringstream line;
+                line << std::fixed << std::setprecision(1) << "Minification: " << result.minifyInputBytes / 1024
+                     << " KiB -> " << result.minifyOutputBytes / 1024 << " KiB ("
+                     << 100.0 * result.minifyOutputBytes / result.minifyInputBytes << "%) in "
+                     << PhaseTimer::format(result.minifyMillis) << ", "
+                     << result.minifyInputBytes / 1e3 / std::max(result.minifyMillis, 1e-3) << " MB/s; "
+                     << result.renamedBindings << " bindings renamed, " << result.foldedConstants
+                     << " constants folded, " << result.droppedBranches << " dead branches dropped";
+                Logger::debug(line.str());
+            }
+        }
+        return true;
     }
     
-    void preview(int port = 4173) {
+    void preview(int port = 4173, const std::string& host = "localhost", const std::string& outDir = "dist",
+                 IoBackend backend = IoBackend::Epoll) {
         Logger::section("Preview Production Build");
+        
+        if (!fs::is_directory(outDir)) {
+            Logger::error("The directory \"" + outDir + "\" does not exist. Did you build your project?");
+            return;
+        }
+        
+        HttpServer server;
+        int requestedPort = port;
+        port = server.listenAvailable(host, port);
+        std::string fallbackReason;
+        IoBackend activeBackend = HttpServer::resolveBackend(backend, fallbackReason);
+        if (port != requestedPort) {
+            Logger::warning("Port " + std::to_string(requestedPort) + " is in use, using " + std::to_string(port) + " instead");
+        }
+        if (activeBackend != backend) {
+            Logger::warning("io_uring unavailable (" + fallbackReason + "), falling back to epoll");
+        }
         Logger::success("Preview server started!");
         
         std::cout << std::endl;
-        std::cout << Colors::BRIGHT_GREEN << "➜" << Colors::RESET 
-                  << "  " << Colors::BOLD << "Local:" << Colors::RESET 
-                  << "   " << Colors::BRIGHT_CYAN << "http://localhost:" << port << "/" << Colors::RESET << std::endl;
+        printServerUrls(host, server.port());
+        std::cout << std::endl;
+        std::cout << Colors::DIM << "Press Ctrl+C to stop" << Colors::RESET << std::endl;
+        
+        StaticFiles files(outDir);
+        server.run([&files](const HttpRequest& req, HttpResponse& res) {
+            files.serve(req, res);
+        }, activeBackend);
+        
         std::cout << std::endl;
+        Logger::info("Preview server stopped");
     }
 };
 
@@ -738,25 +1372,41 @@ int main(int argc, char** argv) {
     int devPort = 5173;
     bool openBrowser = false;
     std::string host = "localhost";
+    int workers = 1;
     
     dev->add_option("-p,--port", devPort, "Port number");
     dev->add_flag("--open", openBrowser, "Open browser automatically");
     dev->add_option("--host", host, "Host to bind to");
+    dev->add_option("-w,--workers", workers, "Number of event loop threads")->check(CLI::Range(1, 256));
+    
+    // Shared by dev and preview
+    std::string ioBackend = "epoll";
+    dev->add_option("--io-backend", ioBackend, "Server I/O backend (epoll or uring)")
+        ->check(CLI::IsMember({"epoll", "uring"}));
     
     // Build command
     auto build = app.add_subcommand("build", "Build for production");
     std::string outDir = "dist";
     bool minify = true;
     bool sourcemap = true;
+    size_t minChunkSize = 10000;
     
     build->add_option("-o,--outDir", outDir, "Output directory");
+    build->add_option("--min-chunk-size", minChunkSize,
+                      "Copy shared chunks smaller than this many bytes into the pages using them");
     build->add_flag("--no-minify", [&](bool) { minify = false; }, "Disable minification");
     build->add_flag("--sourcemap", sourcemap, "Generate source maps");
     
     // Preview command
     auto preview = app.add_subcommand("preview", "Preview production build");
     int previewPort = 4173;
+    std::string previewHost = "localhost";
+    std::string previewOutDir = "dist";
     preview->add_option("-p,--port", previewPort, "Port number");
+    preview->add_option("--host", previewHost, "Host to bind to");
+    preview->add_option("-o,--outDir", previewOutDir, "Directory to serve");
+    preview->add_option("--io-backend", ioBackend, "Server I/O backend (epoll or uring)")
+        ->check(CLI::IsMember({"epoll", "uring"}));
     
     // Config command
     auto config = app.add_subcommand("config", "Manage configuration");
@@ -780,6 +1430,8 @@ int main(int argc, char** argv) {
     
     // Optimize command
     auto optimize = app.add_subcommand("optimize", "Optimize dependencies");
+    bool forceOptimize = false;
+    optimize->add_flag("--force", forceOptimize, "Rebuild even if the lockfile hash is unchanged");
     
     try {
         app.parse(argc, argv);
@@ -793,8 +1445,8 @@ int main(int argc, char** argv) {
         
         // Initialize instances
         ProjectCreator creator;
-        DevServer devServer;
-        Builder builder;
+        DevServer devServer(verbose);
+        Builder builder(verbose);
         ConfigManager configManager;
         PluginManager pluginManager;
         
@@ -810,19 +1462,23 @@ int main(int argc, char** argv) {
             if (verbose) {
                 Logger::debug("Starting development server with verbose output");
             }
-            devServer.start(devPort, openBrowser);
+            devServer.start(devPort, openBrowser, host, workers,
+                            ioBackend == "uring" ? IoBackend::Uring : IoBackend::Epoll);
         }
         else if (*build) {
             if (verbose) {
                 Logger::debug("Building for production with output directory: " + outDir);
             }
-            builder.build(minify, outDir);
+            if (!builder.build(minify, outDir, minChunkSize)) {
+                return 1;
+            }
         }
         else if (*preview) {
             if (verbose) {
                 Logger::debug("Starting preview server on port " + std::to_string(previewPort));
             }
-            builder.preview(previewPort);
+            builder.preview(previewPort, previewHost, previewOutDir,
+                            ioBackend == "uring" ? IoBackend::Uring : IoBackend::Epoll);
         }
         else if (*configList) {
             configManager.list();
@@ -855,23 +1511,11 @@ int main(int argc, char** argv) {
             std::cout << std::endl;
         }
         else if (*optimize) {
-            Logger::section("Optimizing Dependencies");
-            ProgressBar progress(25);
-        
-            std::vector<std::string> optimizeTasks = {
-                "Scanning dependencies",
-                "Pre-bundling dependencies",
-                "Optimizing chunks",
-                "Writing cache"
-            };
-        
-            for (size_t i = 0; i < optimizeTasks.size(); ++i) {
-                double prog = static_cast<double>(i + 1) / optimizeTasks.size();
-                progress.show(prog, optimizeTasks[i]);
-                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            ModuleResolver resolver(fs::current_path());
+            DepOptimizer optimizer(fs::current_path(), resolver, "development", verbose);
+            if (!optimizer.run(forceOptimize)) {
+                return 1;
             }
-        
-            Logger::success("Dependencies optimized!");
         }
         else {
             // Show help if no subcommand is provided
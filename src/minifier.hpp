@@ -0,0 +1,1801 @@
+#pragma once
+
+#include "ast.hpp"
+#include "interner.hpp"
+#include "transform.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <numeric>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+// Shrinks an ES module through its syntax tree. The script is parsed,
+// its scopes are resolved in one walk to rename bindings, and a second
+// walk prints the tree back without whitespace or comments, folding
+// constant expressions and leaving out branches whose test is a constant
+// and statements after a return, throw, break or continue on the way.
+// Parentheses are not in the tree; the printer adds the ones operator
+// precedence needs.
+//
+// Bindings are renamed by slot: a scope's bindings take the slots after
+// those of the scopes around it, so sibling scopes reuse the same names
+// while a nested binding never takes the name of one it could shadow, and
+// the slots named most often get the shortest names. Names the script uses
+// without declaring them are never handed out, and a script that calls
+// eval() directly or uses `with` keeps all its names. Imports and exports
+// keep the names other modules know them by through `as`; only bindings
+// of `export` declarations keep their names.
+class Minifier {
+private:
+    // Precedence levels of the printer, lowest binding first; binary
+    // operators sit at 3 + binaryPrecedence()
+    static constexpr int LOWEST = 0;
+    static constexpr int SEQUENCE = 1;
+    static constexpr int ASSIGN = 2;
+    static constexpr int CONDITIONAL = 3;
+    static constexpr int PREFIX = 16;
+    static constexpr int POSTFIX = 17;
+    static constexpr int CALL = 19;
+
+    struct Binding {
+        Atom name;
+        // Its declaration and every reference
+        std::vector<Node*> uses;
+        size_t slot = 0;
+        // Named by an export declaration
+        bool fixed = false;
+    };
+
+    struct Scope {
+        Scope* parent = nullptr;
+        std::unordered_map<Atom, size_t> names;
+        std::vector<size_t> bindings;
+        std::vector<Scope*> children;
+    };
+
+    // The value of a constant expression
+    struct Constant {
+        enum class Kind { Boolean, Number, String, Null, Undefined };
+        Kind kind = Kind::Undefined;
+        bool boolean = false;
+        double number = 0;
+        // A string's characters as written between its quotes
+        std::string text;
+        char quote = '"';
+    };
+
+    // Opens a parenthesis if `on`; `in` is an operator again inside
+    class Parens {
+    public:
+        Minifier& m;
+        bool on;
+        bool noIn;
+
+        Parens(Minifier& minifier, bool open) : m(minifier), on(open), noIn(minifier.noIn) {
+            if (on) {
+                m.emit("(");
+                m.noIn = false;
+            }
+        }
+
+        ~Parens() {
+            if (on) {
+                m.emit(")");
+                m.noIn = noIn;
+            }
+        }
+    };
+
+    // Brackets, braces and argument lists end the init of a for statement
+    // as far as `in` is concerned
+    class Brackets {
+    public:
+        Minifier& m;
+        bool noIn;
+
+        explicit Brackets(Minifier& minifier) : m(minifier), noIn(minifier.noIn) {
+            m.noIn = false;
+        }
+
+        ~Brackets() {
+            m.noIn = noIn;
+        }
+    };
+
+    const std::string& source;
+    Ast ast;
+    std::deque<Scope> scopes;
+    std::vector<Binding> bindings;
+    // Names that must keep meaning what they mean: globals and bindings
+    // that are not renamed
+    std::unordered_set<Atom> reserved;
+    // A direct eval() or a `with` statement can reach bindings by name
+    bool dynamicScope = false;
+    std::string out;
+    // Printing the init of a for statement, where `in` needs parentheses
+    bool noIn = false;
+    std::string errorMessage;
+
+    // --- Scopes ---
+
+    static void patternNames(const Node* pattern, std::vector<Atom>& names) {
+        if (!pattern) {
+            return;
+        }
+        switch (pattern->kind) {
+            case NodeKind::Identifier:
+                names.push_back(pattern->name);
+                break;
+            case NodeKind::Array:
+                for (const Node* element : pattern->list) {
+                    patternNames(element, names);
+                }
+                break;
+            case NodeKind::Object:
+                for (const Node* property : pattern->list) {
+                    patternNames(property->kind == NodeKind::Spread ? property->a : property->b, names);
+                }
+                break;
+            case NodeKind::Assign:
+            case NodeKind::Spread:
+                patternNames(pattern->a, names);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Calls `declare` with the target of every `var` declarator in `node`
+    // outside nested functions
+    template <typename Declare>
+    static void varTargets(const Node* node, Declare declare) {
+        if (!node) {
+            return;
+        }
+        switch (node->kind) {
+            case NodeKind::VarDecl:
+                if (node->varKind == VarKind::Var) {
+                    for (const Node* declarator : node->list) {
+                        declare(declarator->a);
+                    }
+                }
+                break;
+            case NodeKind::Block:
+            case NodeKind::Program:
+            case NodeKind::StaticBlock:
+                for (const Node* statement : node->list) {
+                    varTargets(statement, declare);
+                }
+                break;
+            case NodeKind::Switch:
+                for (const Node* branch : node->list) {
+                    for (const Node* statement : branch->list) {
+                        varTargets(statement, declare);
+                    }
+                }
+                break;
+            case NodeKind::If:
+                varTargets(node->b, declare);
+                varTargets(node->c, declare);
+                break;
+            case NodeKind::For:
+            case NodeKind::ForIn:
+            case NodeKind::ForOf:
+                varTargets(node->a, declare);
+                varTargets(node->d, declare);
+                break;
+            case NodeKind::While:
+            case NodeKind::DoWhile:
+            case NodeKind::Labeled:
+            case NodeKind::With:
+                varTargets(node->d, declare);
+                break;
+            case NodeKind::Try:
+                varTargets(node->a, declare);
+                varTargets(node->c, declare);
+                varTargets(node->d, declare);
+                break;
+            case NodeKind::ExportDecl:
+                varTargets(node->a, declare);
+                break;
+            default:
+                break;
+        }
+    }
+
+    Scope& childScope(Scope& parent) {
+        scopes.emplace_back();
+        Scope& scope = scopes.back();
+        scope.parent = &parent;
+        parent.children.push_back(&scope);
+        return scope;
+    }
+
+    void declare(Scope& scope, Atom name) {
+        if (!name.empty() && scope.names.emplace(name, bindings.size()).second) {
+            scope.bindings.push_back(bindings.size());
+            bindings.emplace_back();
+            bindings.back().name = name;
+        }
+    }
+
+    void declarePattern(Scope& scope, const Node* pattern) {
+        std::vector<Atom> names;
+        patternNames(pattern, names);
+        for (Atom name : names) {
+            declare(scope, name);
+        }
+    }
+
+    void hoistVars(const Node* node, Scope& scope) {
+        varTargets(node, [&](const Node* target) { declarePattern(scope, target); });
+    }
+
+    void declareLexical(const NodeList& statements, Scope& scope) {
+        for (const Node* statement : statements) {
+            if (statement->kind == NodeKind::ExportDecl ||
+                (statement->kind == NodeKind::ExportDefault &&
+                 (statement->a->kind == NodeKind::Function || statement->a->kind == NodeKind::Class))) {
+                statement = statement->a;
+            }
+            if (statement->kind == NodeKind::VarDecl && statement->varKind != VarKind::Var) {
+                for (const Node* declarator : statement->list) {
+                    declarePattern(scope, declarator->a);
+                }
+            } else if ((statement->kind == NodeKind::Function || statement->kind == NodeKind::Class) && statement->a) {
+                declare(scope, statement->a->name);
+            } else if (statement->kind == NodeKind::Import) {
+                for (const Node* specifier : statement->list) {
+                    declare(scope, specifier->a->name);
+                }
+            }
+        }
+    }
+
+    void reference(Node* identifier, Scope& scope, bool callee) {
+        for (Scope* s = &scope; s; s = s->parent) {
+            auto it = s->names.find(identifier->name);
+            if (it != s->names.end()) {
+                bindings[it->second].uses.push_back(identifier);
+                return;
+            }
+        }
+        reserved.insert(identifier->name);
+        if (callee && identifier->name == "eval") {
+            dynamicScope = true;
+        }
+    }
+
+    void visitList(const NodeList& nodes, Scope& scope) {
+        for (Node* node : nodes) {
+            visit(node, scope);
+        }
+    }
+
+    void visitFunction(Node* node, Scope& outer) {
+        Scope& scope = childScope(outer);
+        for (const Node* param : node->list) {
+            declarePattern(scope, param);
+        }
+        Node* body = node->b;
+        bool block = body && body->kind == NodeKind::Block && !node->has(Node::ExpressionBody);
+        if (block) {
+            hoistVars(body, scope);
+            declareLexical(body->list, scope);
+        }
+        visitList(node->list, scope);
+        if (block) {
+            visitList(body->list, scope);
+        } else {
+            visit(body, scope);
+        }
+    }
+
+    void visitClass(Node* node, Scope& outer) {
+        Scope& scope = childScope(outer);
+        if (node->kind == NodeKind::ClassExpr && node->a) {
+            declare(scope, node->a->name);
+        }
+        visit(node->a, node->kind == NodeKind::Class ? outer : scope);
+        visit(node->b, scope);
+        for (Node* member : node->list) {
+            if (member->kind == NodeKind::StaticBlock) {
+                Scope& block = childScope(scope);
+                hoistVars(member, block);
+                declareLexical(member->list, block);
+                visitList(member->list, block);
+                continue;
+            }
+            if (member->has(Node::Computed)) {
+                visit(member->a, scope);
+            }
+            visit(member->b, scope);
+        }
+    }
+
+    void visit(Node* node, Scope& scope) {
+        if (!node) {
+            return;
+        }
+        switch (node->kind) {
+            case NodeKind::Identifier:
+                reference(node, scope, false);
+                return;
+            case NodeKind::Import:
+                for (Node* specifier : node->list) {
+                    reference(specifier->a, scope, false);
+                }
+                return;
+            case NodeKind::ExportNamed:
+                if (node->c) {
+                    return;
+                }
+                for (Node* specifier : node->list) {
+                    // `export { a }` names the binding and the export with
+                    // one node; split them so renaming the binding keeps
+                    // the export's name
+                    if (specifier->b == specifier->a) {
+                        specifier->b = ast.arena.make<Node>();
+                        *specifier->b = *specifier->a;
+                    }
+                    if (specifier->a->kind == NodeKind::Identifier) {
+                        reference(specifier->a, scope, false);
+                    }
+                }
+                return;
+            case NodeKind::ExportAll:
+            case NodeKind::PrivateName:
+            case NodeKind::MetaProperty:
+                return;
+            case NodeKind::With:
+                dynamicScope = true;
+                break;
+            case NodeKind::Member:
+                visit(node->a, scope);
+                return;
+            case NodeKind::Property:
+                if (node->has(Node::Computed)) {
+                    visit(node->a, scope);
+                }
+                if (node->has(Node::Shorthand)) {
+                    Node* value = node->b->kind == NodeKind::Assign ? node->b->a : node->b;
+                    reference(value, scope, false);
+                    if (node->b->kind == NodeKind::Assign) {
+                        visit(node->b->b, scope);
+                    }
+                    return;
+                }
+                visit(node->b, scope);
+                return;
+            case NodeKind::Method:
+            case NodeKind::Field:
+                if (node->has(Node::Computed)) {
+                    visit(node->a, scope);
+                }
+                visit(node->b, scope);
+                return;
+            case NodeKind::Call:
+            case NodeKind::TaggedTemplate:
+                if (node->a->kind == NodeKind::Identifier) {
+                    reference(node->a, scope, true);
+                } else {
+                    visit(node->a, scope);
+                }
+                visit(node->b, scope);
+                visitList(node->list, scope);
+                return;
+            case NodeKind::Function:
+                visit(node->a, scope);
+                visitFunction(node, scope);
+                return;
+            case NodeKind::FunctionExpr:
+                if (node->a) {
+                    Scope& named = childScope(scope);
+                    declare(named, node->a->name);
+                    visit(node->a, named);
+                    visitFunction(node, named);
+                } else {
+                    visitFunction(node, scope);
+                }
+                return;
+            case NodeKind::Arrow:
+                visitFunction(node, scope);
+                return;
+            case NodeKind::Class:
+            case NodeKind::ClassExpr:
+                visitClass(node, scope);
+                return;
+            case NodeKind::Block: {
+                Scope& block = childScope(scope);
+                declareLexical(node->list, block);
+                visitList(node->list, block);
+                return;
+            }
+            case NodeKind::For:
+            case NodeKind::ForIn:
+            case NodeKind::ForOf: {
+                Scope& head = childScope(scope);
+                if (node->a && node->a->kind == NodeKind::VarDecl && node->a->varKind != VarKind::Var) {
+                    for (const Node* declarator : node->a->list) {
+                        declarePattern(head, declarator->a);
+                    }
+                }
+                visit(node->a, head);
+                visit(node->b, head);
+                visit(node->c, head);
+                visit(node->d, head);
+                return;
+            }
+            case NodeKind::Switch: {
+                visit(node->a, scope);
+                Scope& body = childScope(scope);
+                for (const Node* branch : node->list) {
+                    declareLexical(branch->list, body);
+                }
+                for (Node* branch : node->list) {
+                    visit(branch->a, body);
+                    visitList(branch->list, body);
+                }
+                return;
+            }
+            case NodeKind::Try: {
+                visit(node->a, scope);
+                Scope& handler = childScope(scope);
+                declarePattern(handler, node->b);
+                visit(node->b, handler);
+                visit(node->c, handler);
+                visit(node->d, scope);
+                return;
+            }
+            default:
+                break;
+        }
+        visit(node->a, scope);
+        visit(node->b, scope);
+        visit(node->c, scope);
+        visit(node->d, scope);
+        visitList(node->list, scope);
+    }
+
+    // --- Renaming ---
+
+    // The i-th short name: a letter, `_` or `$`, then letters and digits
+    static std::string shortName(size_t i) {
+        static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_$0123456789";
+        std::string name(1, chars[i % 54]);
+        for (i /= 54; i > 0; i /= 64) {
+            --i;
+            name += chars[i % 64];
+        }
+        return name;
+    }
+
+    // Words a binding cannot be named in module code
+    static bool isKeyword(std::string_view name) {
+        static const std::unordered_set<std::string_view> keywords = {
+            "do", "if", "in", "for", "let", "new", "try", "var", "case", "else", "enum", "eval", "null", "this",
+            "true", "void", "with", "await", "break", "catch", "class", "const", "false", "super", "throw",
+            "while", "yield", "delete", "export", "import", "public", "return", "static", "switch", "typeof",
+            "default", "extends", "finally", "package", "private", "continue", "debugger", "function",
+            "arguments", "interface", "protected", "implements", "instanceof"};
+        return keywords.count(name) > 0;
+    }
+
+    void assignSlots(const Scope& scope, size_t next, std::vector<size_t>& uses) {
+        for (size_t index : scope.bindings) {
+            Binding& binding = bindings[index];
+            if (binding.fixed) {
+                continue;
+            }
+            binding.slot = next++;
+            if (uses.size() < next) {
+                uses.resize(next, 0);
+            }
+            uses[binding.slot] += binding.uses.size();
+        }
+        for (const Scope* child : scope.children) {
+            assignSlots(*child, next, uses);
+        }
+    }
+
+    void rename() {
+        if (dynamicScope) {
+            return;
+        }
+        for (const Binding& binding : bindings) {
+            if (binding.fixed) {
+                reserved.insert(binding.name);
+            }
+        }
+        std::vector<size_t> uses;
+        assignSlots(scopes.front(), 0, uses);
+        std::vector<size_t> order(uses.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return uses[a] > uses[b]; });
+        std::vector<Atom> slotNames(uses.size());
+        size_t next = 0;
+        for (size_t slot : order) {
+            for (;;) {
+                std::string name = shortName(next++);
+                Atom atom = intern(name);
+                if (!isKeyword(name) && !reserved.count(atom)) {
+                    slotNames[slot] = atom;
+                    break;
+                }
+            }
+        }
+        for (Binding& binding : bindings) {
+            if (binding.fixed) {
+                continue;
+            }
+            Atom name = slotNames[binding.slot];
+            renamed += name != binding.name;
+            for (Node* use : binding.uses) {
+                use->name = name;
+            }
+        }
+    }
+
+    void resolve() {
+        Scope& program = scopes.emplace_back();
+        hoistVars(ast.program, program);
+        declareLexical(ast.program->list, program);
+        for (const Node* statement : ast.program->list) {
+            if (statement->kind != NodeKind::ExportDecl) {
+                continue;
+            }
+            const Node* declaration = statement->a;
+            std::vector<Atom> names;
+            if (declaration->kind == NodeKind::VarDecl) {
+                for (const Node* declarator : declaration->list) {
+                    patternNames(declarator->a, names);
+                }
+            } else if (declaration->a) {
+                names.push_back(declaration->a->name);
+            }
+            for (Atom name : names) {
+                bindings[program.names.at(name)].fixed = true;
+            }
+        }
+        visitList(ast.program->list, program);
+    }
+
+    // --- Constants ---
+
+    std::string_view raw(const Node* node) const {
+        return std::string_view(source.data() + node->start, node->end - node->start);
+    }
+
+    bool numberValue(const Node* node, double& value) const {
+        std::string text(raw(node));
+        text.erase(std::remove(text.begin(), text.end(), '_'), text.end());
+        if (text.empty() || text.back() == 'n') {
+            return false;
+        }
+        char* end = nullptr;
+        if (text.size() > 2 && text[0] == '0' && std::isalpha(static_cast<unsigned char>(text[1]))) {
+            char prefix = static_cast<char>(std::tolower(static_cast<unsigned char>(text[1])));
+            int base = prefix == 'x' ? 16 : prefix == 'o' ? 8 : prefix == 'b' ? 2 : 0;
+            if (!base || text.size() > 15) {
+                return false;
+            }
+            value = static_cast<double>(std::strtoull(text.c_str() + 2, &end, base));
+            return *end == '\0';
+        }
+        if (text.size() > 1 && text[0] == '0' && std::isdigit(static_cast<unsigned char>(text[1]))) {
+            return false;
+        }
+        value = std::strtod(text.c_str(), &end);
+        return *end == '\0';
+    }
+
+    // Integers print exactly; other numbers are left as written
+    static bool integerText(double value, std::string& text) {
+        if (!std::isfinite(value) || value != std::trunc(value) || std::fabs(value) >= 1e15 ||
+            (value == 0 && std::signbit(value))) {
+            return false;
+        }
+        text = std::to_string(static_cast<long long>(value));
+        return true;
+    }
+
+    static int32_t toInt32(double value) {
+        if (!std::isfinite(value)) {
+            return 0;
+        }
+        double wrapped = std::fmod(std::trunc(value), 4294967296.0);
+        if (wrapped < 0) {
+            wrapped += 4294967296.0;
+        }
+        return static_cast<int32_t>(static_cast<uint32_t>(wrapped));
+    }
+
+    static bool truthy(const Constant& value, bool& result) {
+        switch (value.kind) {
+            case Constant::Kind::Boolean:
+                result = value.boolean;
+                return true;
+            case Constant::Kind::Number:
+                result = value.number != 0 && !std::isnan(value.number);
+                return true;
+            case Constant::Kind::String:
+                // A line continuation is no character at all
+                if (value.text.find("\\\n") != std::string::npos || value.text.find("\\\r") != std::string::npos) {
+                    return false;
+                }
+                result = !value.text.empty();
+                return true;
+            default:
+                result = false;
+                return true;
+        }
+    }
+
+    static bool nullish(const Constant& value) {
+        return value.kind == Constant::Kind::Null || value.kind == Constant::Kind::Undefined;
+    }
+
+    static Constant number(double value) {
+        Constant constant;
+        constant.kind = Constant::Kind::Number;
+        constant.number = value;
+        return constant;
+    }
+
+    static Constant boolean(bool value) {
+        Constant constant;
+        constant.kind = Constant::Kind::Boolean;
+        constant.boolean = value;
+        return constant;
+    }
+
+    // 1 or 0 for equal or not, -1 when it cannot tell
+    static int equals(const Constant& left, const Constant& right, bool strict) {
+        if (left.kind != right.kind) {
+            if (strict) {
+                return 0;
+            }
+            if (nullish(left) && nullish(right)) {
+                return 1;
+            }
+            return nullish(left) || nullish(right) ? 0 : -1;
+        }
+        switch (left.kind) {
+            case Constant::Kind::Boolean:
+                return left.boolean == right.boolean;
+            case Constant::Kind::Number:
+                return left.number == right.number;
+            case Constant::Kind::String:
+                if (left.text == right.text) {
+                    return 1;
+                }
+                return left.text.find('\\') == std::string::npos && right.text.find('\\') == std::string::npos ? 0
+                                                                                                                : -1;
+            default:
+                return 1;
+        }
+    }
+
+    // Numbers only turn into text here when they are integers
+    static bool stringValue(const Constant& value, Constant& string) {
+        if (value.kind == Constant::Kind::String) {
+            string = value;
+            return true;
+        }
+        std::string digits;
+        if (value.kind != Constant::Kind::Number || !integerText(value.number, digits)) {
+            return false;
+        }
+        string.kind = Constant::Kind::String;
+        string.text = digits;
+        string.quote = '"';
+        return true;
+    }
+
+    static bool concat(const Constant& left, const Constant& right, Constant& value) {
+        Constant l;
+        Constant r;
+        if (!stringValue(left, l) || !stringValue(right, r)) {
+            return false;
+        }
+        // Both halves must fit between the same quotes, and an escape at
+        // the end of the left one must not swallow digits of the right
+        char quote = l.quote;
+        if (r.text.find(quote) != std::string::npos) {
+            quote = r.quote;
+            if (l.text.find(quote) != std::string::npos) {
+                return false;
+            }
+        }
+        if (l.text.find('\\') != std::string::npos && !r.text.empty() &&
+            std::isdigit(static_cast<unsigned char>(r.text[0]))) {
+            return false;
+        }
+        value.kind = Constant::Kind::String;
+        value.quote = quote;
+        value.text = l.text + r.text;
+        return true;
+    }
+
+    bool evaluateUnary(const Node* node, Constant& value) const {
+        Constant operand;
+        if (!evaluate(node->a, operand)) {
+            return false;
+        }
+        bool isNumber = operand.kind == Constant::Kind::Number;
+        switch (node->op) {
+            case Op::Not: {
+                bool t;
+                if (!truthy(operand, t)) {
+                    return false;
+                }
+                value = boolean(!t);
+                return true;
+            }
+            case Op::Neg:
+                value = number(-operand.number);
+                return isNumber;
+            case Op::Pos:
+                value = operand;
+                return isNumber;
+            case Op::BitNot:
+                value = number(~toInt32(operand.number));
+                return isNumber;
+            case Op::Void:
+                value = Constant();
+                return true;
+            case Op::TypeOf: {
+                static const char* types[] = {"boolean", "number", "string", "object", "undefined"};
+                value = Constant();
+                value.kind = Constant::Kind::String;
+                value.text = types[static_cast<int>(operand.kind)];
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    bool evaluateBinary(const Node* node, Constant& value) const {
+        Constant left;
+        if (!evaluate(node->a, left)) {
+            return false;
+        }
+        bool t;
+        switch (node->op) {
+            case Op::And:
+            case Op::Or:
+                if (!truthy(left, t)) {
+                    return false;
+                }
+                if (t == (node->op == Op::Or)) {
+                    value = left;
+                    return true;
+                }
+                return evaluate(node->b, value);
+            case Op::Coalesce:
+                if (!nullish(left)) {
+                    value = left;
+                    return true;
+                }
+                return evaluate(node->b, value);
+            default:
+                break;
+        }
+        Constant right;
+        if (!evaluate(node->b, right)) {
+            return false;
+        }
+        bool numbers = left.kind == Constant::Kind::Number && right.kind == Constant::Kind::Number;
+        double x = left.number;
+        double y = right.number;
+        int32_t i = toInt32(x);
+        uint32_t shift = static_cast<uint32_t>(toInt32(y)) & 31;
+        switch (node->op) {
+            case Op::Add:
+                if (numbers) {
+                    value = number(x + y);
+                    return true;
+                }
+                return (left.kind == Constant::Kind::String || right.kind == Constant::Kind::String) &&
+                       concat(left, right, value);
+            case Op::Sub: value = number(x - y); return numbers;
+            case Op::Mul: value = number(x * y); return numbers;
+            case Op::Div: value = number(x / y); return numbers;
+            case Op::Mod: value = number(std::fmod(x, y)); return numbers;
+            case Op::Exp: value = number(std::pow(x, y)); return numbers;
+            case Op::BitAnd: value = number(i & toInt32(y)); return numbers;
+            case Op::BitOr: value = number(i | toInt32(y)); return numbers;
+            case Op::BitXor: value = number(i ^ toInt32(y)); return numbers;
+            case Op::Shl: value = number(static_cast<int32_t>(static_cast<uint32_t>(i) << shift)); return numbers;
+            case Op::Shr: value = number(i >> shift); return numbers;
+            case Op::UShr: value = number(static_cast<uint32_t>(i) >> shift); return numbers;
+            case Op::Lt: value = boolean(x < y); return numbers;
+            case Op::Gt: value = boolean(x > y); return numbers;
+            case Op::Le: value = boolean(x <= y); return numbers;
+            case Op::Ge: value = boolean(x >= y); return numbers;
+            case Op::StrictEq:
+            case Op::StrictNe:
+            case Op::Eq:
+            case Op::Ne: {
+                bool strict = node->op == Op::StrictEq || node->op == Op::StrictNe;
+                int equal = equals(left, right, strict);
+                value = boolean((equal == 1) == (node->op == Op::StrictEq || node->op == Op::Eq));
+                return equal >= 0;
+            }
+            default:
+                return false;
+        }
+    }
+
+    // The value of `node` if it is made of literals alone
+    bool evaluate(const Node* node, Constant& value) const {
+        switch (node->kind) {
+            case NodeKind::True:
+            case NodeKind::False:
+                value = boolean(node->kind == NodeKind::True);
+                return true;
+            case NodeKind::Null:
+                value = Constant();
+                value.kind = Constant::Kind::Null;
+                return true;
+            case NodeKind::Number:
+                value = number(0);
+                return numberValue(node, value.number);
+            case NodeKind::String:
+                value = Constant();
+                value.kind = Constant::Kind::String;
+                value.quote = source[node->start];
+                value.text.assign(source, node->start + 1, node->end - node->start - 2);
+                return true;
+            case NodeKind::Unary:
+                return evaluateUnary(node, value);
+            case NodeKind::Binary:
+                return evaluateBinary(node, value);
+            case NodeKind::Conditional: {
+                Constant test;
+                bool t;
+                return evaluate(node->a, test) && truthy(test, t) && evaluate(t ? node->b : node->c, value);
+            }
+            default:
+                return false;
+        }
+    }
+
+    // The shortest source for a constant, and whether it is a unary
+    // expression rather than a literal
+    static bool constantText(const Constant& value, std::string& text, bool& unary) {
+        unary = false;
+        switch (value.kind) {
+            case Constant::Kind::Boolean:
+                text = value.boolean ? "!0" : "!1";
+                unary = true;
+                return true;
+            case Constant::Kind::Number:
+                if (!integerText(value.number, text)) {
+                    return false;
+                }
+                unary = text[0] == '-';
+                return true;
+            case Constant::Kind::String:
+                text = value.quote + value.text + value.quote;
+                return true;
+            case Constant::Kind::Null:
+                text = "null";
+                return true;
+            default:
+                text = "void 0";
+                unary = true;
+                return true;
+        }
+    }
+
+    // Print `node` as a constant if it is one and that is no longer
+    bool printConstant(const Node* node, int level) {
+        switch (node->kind) {
+            case NodeKind::Binary:
+            case NodeKind::Conditional:
+                break;
+            case NodeKind::Unary:
+                if (node->a->kind == NodeKind::Number || node->a->kind == NodeKind::String) {
+                    return false;
+                }
+                break;
+            default:
+                return false;
+        }
+        Constant value;
+        std::string text;
+        bool unary;
+        if (!evaluate(node, value) || !constantText(value, text, unary) || text.size() > node->end - node->start) {
+            return false;
+        }
+        Parens parens(*this, unary && level > PREFIX);
+        if (text[0] == '-') {
+            emit("-");
+            emit(std::string_view(text).substr(1));
+        } else if (value.kind == Constant::Kind::Undefined) {
+            emit("void");
+            emit("0");
+        } else {
+            emit(text);
+        }
+        ++folded;
+        return true;
+    }
+
+    // --- Printing ---
+
+    static bool wordChar(char c) {
+        return Simd::isIdentifierByte(static_cast<unsigned char>(c)) || static_cast<unsigned char>(c) >= 0x80 ||
+               c == '\\';
+    }
+
+    // Append a token, with a space only where it would merge with the last
+    void emit(std::string_view token) {
+        if (token.empty()) {
+            return;
+        }
+        if (!out.empty()) {
+            char last = out.back();
+            char next = token[0];
+            if ((wordChar(last) && wordChar(next)) || ((last == '+' || last == '-' || last == '/') && next == last)) {
+                out += ' ';
+            }
+        }
+        out.append(token.data(), token.size());
+    }
+
+    // Parenthesize what was printed since `mark` where it would otherwise
+    // read as a block, a declaration or a `let` declaration
+    void guardStart(size_t mark, bool brace, bool declaration) {
+        while (mark < out.size() && out[mark] == ' ') {
+            ++mark;
+        }
+        std::string_view printed(out.data() + mark, out.size() - mark);
+        auto startsWith = [&](std::string_view word) {
+            return printed.substr(0, word.size()) == word &&
+                   (printed.size() == word.size() || !wordChar(printed[word.size()]));
+        };
+        bool wrap = (brace && (printed.substr(0, 1) == "{" || printed.substr(0, 4) == "let[")) ||
+                    (declaration &&
+                     (startsWith("function") || startsWith("class") || startsWith("async function")));
+        if (wrap) {
+            out.insert(mark, "(");
+            out += ')';
+        }
+    }
+
+    static bool isIdentifierName(std::string_view name) {
+        if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) {
+            return false;
+        }
+        return std::all_of(name.begin(), name.end(), [](char c) { return wordChar(c) && c != '\\'; });
+    }
+
+    // A module export name: an identifier, or a string for anything else
+    void exportName(Atom name) {
+        if (isIdentifierName(name.view())) {
+            emit(name.view());
+        } else {
+            emit(Transforms::jsStringLiteral(name.str()));
+        }
+    }
+
+    void list(const NodeList& nodes, int level) {
+        for (size_t i = 0; i < nodes.size; ++i) {
+            if (i) {
+                emit(",");
+            }
+            expression(nodes[i], level);
+        }
+    }
+
+    void arguments(const NodeList& nodes) {
+        Brackets brackets(*this);
+        emit("(");
+        list(nodes, ASSIGN);
+        emit(")");
+    }
+
+    // Parameters and body of a function or method
+    void functionRest(Node* node) {
+        arguments(node->list);
+        block(node->b);
+    }
+
+    void function(Node* node) {
+        if (node->has(Node::Async)) {
+            emit("async");
+        }
+        emit("function");
+        if (node->has(Node::Generator)) {
+            emit("*");
+        }
+        if (node->a) {
+            emit(node->a->name.view());
+        }
+        functionRest(node);
+    }
+
+    void key(Node* node) {
+        if (node->has(Node::Computed)) {
+            Brackets brackets(*this);
+            emit("[");
+            expression(node->a, ASSIGN);
+            emit("]");
+        } else if (node->a->kind == NodeKind::Identifier || node->a->kind == NodeKind::PrivateName) {
+            emit(node->a->name.view());
+        } else {
+            emit(raw(node->a));
+        }
+    }
+
+    void method(Node* node) {
+        if (node->has(Node::Static)) {
+            emit("static");
+        }
+        if (node->has(Node::Async)) {
+            emit("async");
+        }
+        if (node->has(Node::Generator)) {
+            emit("*");
+        }
+        if (node->has(Node::Getter)) {
+            emit("get");
+        } else if (node->has(Node::Setter)) {
+            emit("set");
+        }
+        key(node);
+        functionRest(node->b);
+    }
+
+    void classNode(Node* node) {
+        emit("class");
+        if (node->a) {
+            emit(node->a->name.view());
+        }
+        if (node->b) {
+            emit("extends");
+            expression(node->b, CALL);
+        }
+        Brackets brackets(*this);
+        emit("{");
+        for (Node* member : node->list) {
+            if (member->kind == NodeKind::StaticBlock) {
+                emit("static");
+                emit("{");
+                statements(member->list);
+                emit("}");
+            } else if (member->kind == NodeKind::Method) {
+                method(member);
+            } else {
+                if (member->has(Node::Static)) {
+                    emit("static");
+                }
+                key(member);
+                if (member->b) {
+                    emit("=");
+                    expression(member->b, ASSIGN);
+                }
+                emit(";");
+            }
+        }
+        emit("}");
+    }
+
+    void object(Node* node) {
+        Brackets brackets(*this);
+        emit("{");
+        for (size_t i = 0; i < node->list.size; ++i) {
+            Node* entry = node->list[i];
+            if (i) {
+                emit(",");
+            }
+            if (entry->kind == NodeKind::Spread) {
+                expression(entry, ASSIGN);
+            } else if (entry->kind == NodeKind::Method) {
+                method(entry);
+            } else if (entry->has(Node::Shorthand)) {
+                Node* value = entry->b->kind == NodeKind::Assign ? entry->b->a : entry->b;
+                if (value->name != entry->a->name) {
+                    emit(entry->a->name.view());
+                    emit(":");
+                }
+                expression(entry->b, ASSIGN);
+            } else {
+                key(entry);
+                emit(":");
+                expression(entry->b, ASSIGN);
+            }
+        }
+        emit("}");
+    }
+
+    // Whether a callee of `new` would take a call's arguments as its own
+    static bool containsCall(const Node* node) {
+        for (; node; node = node->a) {
+            if (node->kind == NodeKind::Call) {
+                return true;
+            }
+            if (node->kind != NodeKind::Member && node->kind != NodeKind::Index &&
+                node->kind != NodeKind::TaggedTemplate) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    void binary(Node* node, int level, bool fold) {
+        Op op = node->op;
+        Constant left;
+        bool t;
+        // `true && x` is x; a left side deciding the value on its own was
+        // folded with the whole expression
+        if (fold && (op == Op::And || op == Op::Or || op == Op::Coalesce) && evaluate(node->a, left) &&
+            (op == Op::Coalesce ? nullish(left) : truthy(left, t) && t == (op == Op::And))) {
+            ++dropped;
+            expression(node->b, level);
+            return;
+        }
+        int precedence = 3 + binaryPrecedence(op);
+        Parens parens(*this, precedence < level || (noIn && op == Op::In));
+        // `??` cannot mix with `&&` or `||` without parentheses, and the
+        // left side of `**` cannot be a unary expression
+        auto mixes = [op](const Node* side) {
+            if (side->kind != NodeKind::Binary) {
+                return false;
+            }
+            bool logical = side->op == Op::And || side->op == Op::Or;
+            return (op == Op::Coalesce && logical) || ((op == Op::And || op == Op::Or) && side->op == Op::Coalesce);
+        };
+        int leftLevel = op == Op::Exp ? POSTFIX : precedence;
+        int rightLevel = op == Op::Exp ? precedence : precedence + 1;
+        expression(node->a, mixes(node->a) ? CALL : leftLevel);
+        emit(opText(op));
+        expression(node->b, mixes(node->b) ? CALL : rightLevel);
+    }
+
+    // Print an expression where only operators binding at least as tightly
+    // as `level` may stand without parentheses. `fold` false keeps the node
+    // itself as written, for callees whose `this` depends on it.
+    void expression(Node* node, int level, bool fold = true) {
+        if (fold && printConstant(node, level)) {
+            return;
+        }
+        switch (node->kind) {
+            case NodeKind::Identifier:
+            case NodeKind::PrivateName:
+            case NodeKind::MetaProperty:
+                emit(node->name.view());
+                return;
+            case NodeKind::Number:
+            case NodeKind::String:
+            case NodeKind::Regex:
+                emit(raw(node));
+                return;
+            case NodeKind::This:
+                emit("this");
+                return;
+            case NodeKind::Super:
+                emit("super");
+                return;
+            case NodeKind::Null:
+                emit("null");
+                return;
+            case NodeKind::True:
+            case NodeKind::False: {
+                Parens parens(*this, level > PREFIX);
+                emit(node->kind == NodeKind::True ? "!0" : "!1");
+                return;
+            }
+            case NodeKind::Hole:
+                return;
+            case NodeKind::Template: {
+                Brackets brackets(*this);
+                for (Node* part : node->list) {
+                    if (part->kind == NodeKind::TemplateElement) {
+                        out.append(raw(part));
+                    } else {
+                        expression(part, LOWEST);
+                    }
+                }
+                return;
+            }
+            case NodeKind::TaggedTemplate: {
+                Parens parens(*this, level > CALL);
+                expression(node->a, CALL, false);
+                expression(node->b, CALL);
+                return;
+            }
+            case NodeKind::Array: {
+                Brackets brackets(*this);
+                emit("[");
+                list(node->list, ASSIGN);
+                if (!node->list.empty() && node->list[node->list.size - 1]->kind == NodeKind::Hole) {
+                    emit(",");
+                }
+                emit("]");
+                return;
+            }
+            case NodeKind::Object:
+                object(node);
+                return;
+            case NodeKind::Function:
+            case NodeKind::FunctionExpr:
+                function(node);
+                return;
+            case NodeKind::Class:
+            case NodeKind::ClassExpr:
+                classNode(node);
+                return;
+            case NodeKind::Arrow: {
+                Parens parens(*this, level > ASSIGN);
+                if (node->has(Node::Async)) {
+                    emit("async");
+                }
+                if (node->list.size == 1 && node->list[0]->kind == NodeKind::Identifier) {
+                    emit(node->list[0]->name.view());
+                } else {
+                    arguments(node->list);
+                }
+                emit("=>");
+                if (node->has(Node::ExpressionBody)) {
+                    size_t mark = out.size();
+                    expression(node->b, ASSIGN);
+                    guardStart(mark, true, false);
+                } else {
+                    block(node->b);
+                }
+                return;
+            }
+            case NodeKind::Spread:
+                emit("...");
+                expression(node->a, ASSIGN);
+                return;
+            case NodeKind::ImportCall:
+                emit("import");
+                arguments(node->list);
+                return;
+            case NodeKind::Call: {
+                Parens parens(*this, level > CALL);
+                expression(node->a, CALL, false);
+                if (node->has(Node::Optional)) {
+                    emit("?.");
+                }
+                arguments(node->list);
+                return;
+            }
+            case NodeKind::New: {
+                Parens parens(*this, level > CALL);
+                emit("new");
+                if (containsCall(node->a)) {
+                    Parens callee(*this, true);
+                    expression(node->a, LOWEST);
+                } else {
+                    expression(node->a, CALL);
+                }
+                arguments(node->list);
+                return;
+            }
+            case NodeKind::Member: {
+                Parens parens(*this, level > CALL);
+                size_t mark = out.size();
+                expression(node->a, CALL);
+                // `1.x` would read as a number
+                bool digits = mark < out.size();
+                for (size_t i = mark; i < out.size(); ++i) {
+                    digits = digits && (std::isdigit(static_cast<unsigned char>(out[i])) || (i == mark && out[i] == ' '));
+                }
+                if (digits) {
+                    out += '.';
+                }
+                emit(node->has(Node::Optional) ? "?." : ".");
+                emit(node->name.view());
+                return;
+            }
+            case NodeKind::Index: {
+                Parens parens(*this, level > CALL);
+                expression(node->a, CALL);
+                Brackets brackets(*this);
+                emit(node->has(Node::Optional) ? "?.[" : "[");
+                expression(node->b, LOWEST);
+                emit("]");
+                return;
+            }
+            case NodeKind::Unary: {
+                Parens parens(*this, level > PREFIX);
+                emit(opText(node->op));
+                expression(node->a, PREFIX, node->op != Op::Delete && node->op != Op::TypeOf);
+                return;
+            }
+            case NodeKind::Update: {
+                bool prefix = node->has(Node::Prefix);
+                Parens parens(*this, level > (prefix ? PREFIX : POSTFIX));
+                if (prefix) {
+                    emit(opText(node->op));
+                }
+                expression(node->a, CALL);
+                if (!prefix) {
+                    emit(opText(node->op));
+                }
+                return;
+            }
+            case NodeKind::Await: {
+                Parens parens(*this, level > PREFIX);
+                emit("await");
+                expression(node->a, PREFIX);
+                return;
+            }
+            case NodeKind::Yield: {
+                Parens parens(*this, level > ASSIGN);
+                emit("yield");
+                if (node->has(Node::Delegate)) {
+                    emit("*");
+                }
+                if (node->a) {
+                    expression(node->a, ASSIGN);
+                }
+                return;
+            }
+            case NodeKind::Binary:
+                binary(node, level, fold);
+                return;
+            case NodeKind::Assign: {
+                Parens parens(*this, level > ASSIGN);
+                expression(node->a, CALL);
+                emit(opText(node->op));
+                expression(node->b, ASSIGN);
+                return;
+            }
+            case NodeKind::Conditional: {
+                Constant test;
+                bool t;
+                if (fold && evaluate(node->a, test) && truthy(test, t)) {
+                    ++dropped;
+                    expression(t ? node->b : node->c, level);
+                    return;
+                }
+                Parens parens(*this, level > CONDITIONAL);
+                expression(node->a, CONDITIONAL + 1);
+                emit("?");
+                expression(node->b, ASSIGN);
+                emit(":");
+                expression(node->c, ASSIGN);
+                return;
+            }
+            case NodeKind::Sequence: {
+                Parens parens(*this, level > SEQUENCE);
+                list(node->list, ASSIGN);
+                return;
+            }
+            default:
+                emit(raw(node));
+                return;
+        }
+    }
+
+    void block(Node* node) {
+        Brackets brackets(*this);
+        emit("{");
+        statements(node->list);
+        emit("}");
+    }
+
+    // `var` declarations, without their values, for code left out
+    void keepVars(const Node* node) {
+        std::vector<Atom> names;
+        varTargets(node, [&](const Node* target) { patternNames(target, names); });
+        if (names.empty()) {
+            return;
+        }
+        emit("var");
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (i) {
+                emit(",");
+            }
+            emit(names[i].view());
+        }
+        emit(";");
+    }
+
+    static bool hasVars(const Node* node) {
+        bool found = false;
+        varTargets(node, [&](const Node*) { found = true; });
+        return found;
+    }
+
+    // Declarations that are scoped to the statement list they are in
+    static bool declaresLexically(const NodeList& list) {
+        return std::any_of(list.begin(), list.end(), [](const Node* statement) {
+            return statement->kind == NodeKind::Function || statement->kind == NodeKind::Class ||
+                   (statement->kind == NodeKind::VarDecl && statement->varKind != VarKind::Var);
+        });
+    }
+
+    // An `if` without `else` at the end of `node` would take an `else`
+    // that follows it
+    static bool endsInBareIf(const Node* node) {
+        switch (node->kind) {
+            case NodeKind::If:
+                return !node->c || endsInBareIf(node->c);
+            case NodeKind::For:
+            case NodeKind::ForIn:
+            case NodeKind::ForOf:
+            case NodeKind::While:
+            case NodeKind::Labeled:
+            case NodeKind::With:
+                return endsInBareIf(node->d);
+            default:
+                return false;
+        }
+    }
+
+    void varDecl(Node* node) {
+        emit(node->varKind == VarKind::Var ? "var" : node->varKind == VarKind::Let ? "let" : "const");
+        for (size_t i = 0; i < node->list.size; ++i) {
+            Node* declarator = node->list[i];
+            if (i) {
+                emit(",");
+            }
+            expression(declarator->a, ASSIGN);
+            if (declarator->b) {
+                emit("=");
+                expression(declarator->b, ASSIGN);
+            }
+        }
+    }
+
+    // A statement whose test is a constant: the branch taken, and the
+    // `var`s of the one left out
+    void constantBranch(Node* taken, Node* skipped, bool inList) {
+        ++dropped;
+        bool braces = !inList && taken && hasVars(skipped);
+        if (braces) {
+            emit("{");
+        }
+        keepVars(skipped);
+        if (taken && taken->kind == NodeKind::Block && (inList || braces) && !declaresLexically(taken->list)) {
+            statements(taken->list);
+        } else if (taken) {
+            statement(taken, inList || braces);
+        } else if (!inList && !hasVars(skipped)) {
+            emit(";");
+        }
+        if (braces) {
+            emit("}");
+        }
+    }
+
+    // Print a statement; `inList` when it stands in a statement list,
+    // where printing nothing is fine, rather than as the body of another
+    void statement(Node* node, bool inList) {
+        switch (node->kind) {
+            case NodeKind::Empty:
+                if (!inList) {
+                    emit(";");
+                }
+                return;
+            case NodeKind::Block:
+                block(node);
+                return;
+            case NodeKind::Expression: {
+                size_t mark = out.size();
+                expression(node->a, LOWEST);
+                guardStart(mark, true, true);
+                emit(";");
+                return;
+            }
+            case NodeKind::If: {
+                Constant test;
+                bool t;
+                if (evaluate(node->a, test) && truthy(test, t)) {
+                    constantBranch(t ? node->b : node->c, t ? node->c : node->b, inList);
+                    return;
+                }
+                emit("if(");
+                expression(node->a, LOWEST);
+                emit(")");
+                if (node->c && endsInBareIf(node->b)) {
+                    emit("{");
+                    statement(node->b, true);
+                    emit("}");
+                } else {
+                    statement(node->b, false);
+                }
+                if (node->c) {
+                    emit("else");
+                    statement(node->c, false);
+                }
+                return;
+            }
+            case NodeKind::For:
+                emit("for(");
+                if (node->a) {
+                    noIn = true;
+                    if (node->a->kind == NodeKind::VarDecl) {
+                        varDecl(node->a);
+                    } else {
+                        expression(node->a, LOWEST);
+                    }
+                    noIn = false;
+                }
+                emit(";");
+                if (node->b) {
+                    expression(node->b, LOWEST);
+                }
+                emit(";");
+                if (node->c) {
+                    expression(node->c, LOWEST);
+                }
+                emit(")");
+                statement(node->d, false);
+                return;
+            case NodeKind::ForIn:
+            case NodeKind::ForOf:
+                emit("for");
+                if (node->has(Node::Await)) {
+                    emit("await");
+                }
+                emit("(");
+                if (node->a->kind == NodeKind::VarDecl) {
+                    varDecl(node->a);
+                } else {
+                    expression(node->a, CALL);
+                }
+                emit(node->kind == NodeKind::ForIn ? "in" : "of");
+                expression(node->b, node->kind == NodeKind::ForIn ? LOWEST : ASSIGN);
+                emit(")");
+                statement(node->d, false);
+                return;
+            case NodeKind::While: {
+                Constant test;
+                bool t;
+                if (evaluate(node->a, test) && truthy(test, t) && !t) {
+                    constantBranch(nullptr, node->d, inList);
+                    return;
+                }
+                emit("while(");
+                expression(node->a, LOWEST);
+                emit(")");
+                statement(node->d, false);
+                return;
+            }
+            case NodeKind::DoWhile:
+                emit("do");
+                statement(node->d, false);
+                emit("while(");
+                expression(node->a, LOWEST);
+                emit(");");
+                return;
+            case NodeKind::Return:
+            case NodeKind::Throw:
+                emit(node->kind == NodeKind::Return ? "return" : "throw");
+                if (node->a) {
+                    expression(node->a, LOWEST);
+                }
+                emit(";");
+                return;
+            case NodeKind::Break:
+            case NodeKind::Continue:
+                emit(node->kind == NodeKind::Break ? "break" : "continue");
+                emit(node->name.view());
+                emit(";");
+                return;
+            case NodeKind::Try:
+                emit("try");
+                block(node->a);
+                if (node->c) {
+                    emit("catch");
+                    if (node->b) {
+                        Parens parens(*this, true);
+                        expression(node->b, ASSIGN);
+                    }
+                    block(node->c);
+                }
+                if (node->d) {
+                    emit("finally");
+                    block(node->d);
+                }
+                return;
+            case NodeKind::Switch:
+                emit("switch(");
+                expression(node->a, LOWEST);
+                emit("){");
+                for (Node* branch : node->list) {
+                    if (branch->a) {
+                        emit("case");
+                        expression(branch->a, LOWEST);
+                    } else {
+                        emit("default");
+                    }
+                    emit(":");
+                    statements(branch->list);
+                }
+                emit("}");
+                return;
+            case NodeKind::Labeled:
+                emit(node->name.view());
+                emit(":");
+                statement(node->d, false);
+                return;
+            case NodeKind::VarDecl:
+                varDecl(node);
+                emit(";");
+                return;
+            case NodeKind::Debugger:
+                emit("debugger;");
+                return;
+            case NodeKind::With:
+                emit("with(");
+                expression(node->a, LOWEST);
+                emit(")");
+                statement(node->d, false);
+                return;
+            case NodeKind::Function:
+                function(node);
+                return;
+            case NodeKind::Class:
+                classNode(node);
+                return;
+            case NodeKind::Import:
+                importDeclaration(node);
+                return;
+            case NodeKind::ExportNamed:
+                emit("export{");
+                for (size_t i = 0; i < node->list.size; ++i) {
+                    Node* specifier = node->list[i];
+                    if (i) {
+                        emit(",");
+                    }
+                    std::string_view local = specifier->a->kind == NodeKind::Identifier ? specifier->a->name.view()
+                                                                                        : raw(specifier->a);
+                    std::string_view exported = specifier->b->kind == NodeKind::Identifier
+                                                    ? specifier->b->name.view()
+                                                    : raw(specifier->b);
+                    emit(local);
+                    if (exported != local) {
+                        emit("as");
+                        emit(exported);
+                    }
+                }
+                emit("}");
+                if (node->c) {
+                    emit("from");
+                    emit(raw(node->c));
+                }
+                emit(";");
+                return;
+            case NodeKind::ExportDecl:
+                emit("export");
+                statement(node->a, true);
+                return;
+            case NodeKind::ExportDefault:
+                emit("export");
+                emit("default");
+                if (node->a->kind == NodeKind::Function || node->a->kind == NodeKind::Class) {
+                    statement(node->a, true);
+                } else {
+                    size_t mark = out.size();
+                    expression(node->a, ASSIGN);
+                    guardStart(mark, false, true);
+                    emit(";");
+                }
+                return;
+            case NodeKind::ExportAll:
+                emit("export*");
+                if (node->b) {
+                    emit("as");
+                    emit(node->b->kind == NodeKind::Identifier ? node->b->name.view() : raw(node->b));
+                }
+                emit("from");
+                emit(raw(node->c));
+                emit(";");
+                return;
+            default:
+                emit(raw(node));
+                return;
+        }
+    }
+
+    void importDeclaration(Node* node) {
+        emit("import");
+        bool named = false;
+        for (size_t i = 0; i < node->list.size; ++i) {
+            Node* specifier = node->list[i];
+            // The default binding is the one named by the specifier itself
+            bool defaultBinding = specifier->name == "default" && specifier->start == specifier->a->start;
+            if (specifier->name == "*") {
+                if (i) {
+                    emit(",");
+                }
+                emit("*");
+                emit("as");
+                emit(specifier->a->name.view());
+                continue;
+            }
+            if (defaultBinding) {
+                emit(specifier->a->name.view());
+                continue;
+            }
+            emit(named ? "," : i ? ",{" : "{");
+            named = true;
+            if (specifier->name != specifier->a->name) {
+                exportName(specifier->name);
+                emit("as");
+            }
+            emit(specifier->a->name.view());
+        }
+        if (named) {
+            emit("}");
+        }
+        if (!node->list.empty()) {
+            emit("from");
+        }
+        emit(raw(node->b));
+        emit(";");
+    }
+
+    static bool terminates(const Node* statement) {
+        return statement->kind == NodeKind::Return || statement->kind == NodeKind::Throw ||
+               statement->kind == NodeKind::Break || statement->kind == NodeKind::Continue;
+    }
+
+    // A statement list, leaving out what follows a return, throw, break
+    // or continue except for the declarations the rest of the list sees
+    void statements(const NodeList& list) {
+        bool reachable = true;
+        for (Node* statement : list) {
+            if (reachable) {
+                this->statement(statement, true);
+                reachable = !terminates(statement);
+            } else if (statement->kind == NodeKind::Function || statement->kind == NodeKind::Class ||
+                       (statement->kind == NodeKind::VarDecl && statement->varKind != VarKind::Var)) {
+                this->statement(statement, true);
+            } else {
+                ++dropped;
+                keepVars(statement);
+            }
+        }
+    }
+
+public:
+    // Bindings given a new name, constant expressions folded, and branches
+    // and statements left out
+    size_t renamed = 0;
+    size_t folded = 0;
+    size_t dropped = 0;
+
+    explicit Minifier(const std::string& script) : source(script), ast(script.size()) {}
+
+    Minifier(const Minifier&) = delete;
+    Minifier& operator=(const Minifier&) = delete;
+
+    // Minify the script into `minified`; false when it does not parse,
+    // with the reason in error()
+    bool minify(std::string& minified) {
+        Parser parser(source, ast, true);
+        if (!parser.parse()) {
+            errorMessage = parser.error();
+            return false;
+        }
+        resolve();
+        rename();
+        out.reserve(source.size() / 2);
+        statements(ast.program->list);
+        minified = std::move(out);
+        return true;
+    }
+
+    const std::string& error() const {
+        return errorMessage;
+    }
+};
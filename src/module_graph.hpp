@@ -0,0 +1,277 @@
+#pragma once
+
+#include "transform.hpp"
+#include "interner.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+// A module the dev server has served, keyed by its URL path
+class ModuleNode {
+public:
+    Atom url;
+    Atom file;
+    std::unordered_set<ModuleNode*> importedModules;
+    std::unordered_set<ModuleNode*> importers;
+    bool selfAccepting = false;
+    std::unordered_set<Atom> acceptedDeps;
+    // Last transform output; null until requested or after invalidation
+    std::shared_ptr<const TransformResult> transformResult;
+    fs::file_time_type lastModified;
+    uint64_t hash = 0;
+    // Time of the last hot update that invalidated this module; served
+    // imports of it carry ?t=<timestamp> so browsers fetch the new version
+    long long lastHmrTimestamp = 0;
+
+    ModuleNode(Atom u, Atom f) : url(u), file(f) {}
+};
+
+// Where an update stops: `boundary` re-imports `acceptedVia` and handles it
+class HmrBoundary {
+public:
+    std::string boundary;
+    std::string acceptedVia;
+};
+
+// What transforming one module produced: the served code plus the edges
+// and accept calls found in its source. `imports` maps each imported URL
+// to its file.
+class ModuleTransform {
+public:
+    std::string code;
+    std::map<std::string, std::string> imports;
+    bool selfAccepting = false;
+    std::unordered_set<std::string> acceptedDeps;
+};
+
+// Import relationships between served modules, populated on demand as the
+// browser requests them, together with each module's transform result.
+// Both edge directions are hash sets, so walking the importers of a shared
+// utility touches exactly the modules that import it. URLs and files are
+// atoms, so lookups hash a pointer and nodes hold no string copies. Lookups
+// take a shared lock; transforms and invalidations take it exclusively.
+class ModuleGraph {
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<Atom, std::unique_ptr<ModuleNode>> byUrl;
+    std::unordered_map<Atom, std::unordered_set<ModuleNode*>> byFile;
+
+    // The node for `url` without interning it; null when never stored
+    ModuleNode* findLocked(const std::string& url) const {
+        bool known = false;
+        Atom atom = Interner::global().find(url, known);
+        auto it = known ? byUrl.find(atom) : byUrl.end();
+        return it == byUrl.end() ? nullptr : it->second.get();
+    }
+
+    ModuleNode* ensureLocked(Atom url, Atom file) {
+        auto it = byUrl.find(url);
+        if (it != byUrl.end()) {
+            return it->second.get();
+        }
+        auto node = std::make_unique<ModuleNode>(url, file);
+        ModuleNode* raw = node.get();
+        byUrl.emplace(url, std::move(node));
+        byFile[file].insert(raw);
+        return raw;
+    }
+
+    // Walk importers from `node` until every path ends at a module that
+    // accepts the update. Modules that will re-execute go in `stale`, which
+    // also marks them visited so shared subgraphs and cycles are walked
+    // once; importers accepting a dependency go in `acceptors`. Returns true
+    // on a dead end: a path reached a module nothing accepts, so only a full
+    // reload is safe.
+    bool propagate(ModuleNode* node, std::vector<HmrBoundary>& boundaries,
+                   std::unordered_set<ModuleNode*>& stale, std::unordered_set<ModuleNode*>& acceptors) const {
+        stale.insert(node);
+        if (node->selfAccepting) {
+            boundaries.push_back(HmrBoundary{node->url.str(), node->url.str()});
+            return false;
+        }
+        if (node->importers.empty()) {
+            return true;
+        }
+        for (ModuleNode* importer : node->importers) {
+            if (importer->acceptedDeps.count(node->url)) {
+                acceptors.insert(importer);
+                boundaries.push_back(HmrBoundary{importer->url.str(), node->url.str()});
+                continue;
+            }
+            if (stale.count(importer)) {
+                continue;
+            }
+            if (propagate(importer, boundaries, stale, acceptors)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    ModuleGraph() = default;
+    ModuleGraph(const ModuleGraph&) = delete;
+    ModuleGraph& operator=(const ModuleGraph&) = delete;
+
+    // The stored transform of `url`, if it was made from this version of
+    // the file
+    std::shared_ptr<const TransformResult> cachedTransform(const std::string& url, fs::file_time_type mtime,
+                                                           uintmax_t size) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        ModuleNode* node = findLocked(url);
+        if (!node) {
+            return nullptr;
+        }
+        const auto& result = node->transformResult;
+        return result && result->mtime == mtime && result->size == size ? result : nullptr;
+    }
+
+    // The stored transform of `url` if it was made from source with this
+    // content hash, whatever the file's mtime says; touched or checked-out
+    // files with unchanged bytes are not transformed again
+    std::shared_ptr<const TransformResult> transformForContent(const std::string& url, uint64_t hash) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        ModuleNode* node = findLocked(url);
+        if (!node || node->hash != hash) {
+            return nullptr;
+        }
+        return node->transformResult;
+    }
+
+    // Content hash of the source last transformed for `url`, 0 if none
+    uint64_t hashOf(const std::string& url) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        ModuleNode* node = findLocked(url);
+        return !node || !node->transformResult ? 0 : node->hash;
+    }
+
+    void storeTransform(const std::string& url, const std::string& file,
+                        std::shared_ptr<const TransformResult> result, uint64_t hash) {
+        Atom urlAtom = intern(url);
+        Atom fileAtom = intern(file);
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        ModuleNode* node = ensureLocked(urlAtom, fileAtom);
+        node->lastModified = result->mtime;
+        node->hash = hash;
+        node->transformResult = std::move(result);
+    }
+
+    // Replace a module's outgoing edges after it was (re)transformed
+    void updateImports(const std::string& url, const std::string& file, const ModuleTransform& transform) {
+        // Intern before locking; the interner has its own locks
+        std::vector<std::pair<Atom, Atom>> imports;
+        for (const auto& imported : transform.imports) {
+            imports.emplace_back(intern(imported.first), intern(imported.second));
+        }
+        std::unordered_set<Atom> acceptedDeps;
+        for (const auto& dep : transform.acceptedDeps) {
+            acceptedDeps.insert(intern(dep));
+        }
+        Atom urlAtom = intern(url);
+        Atom fileAtom = intern(file);
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        ModuleNode* node = ensureLocked(urlAtom, fileAtom);
+        for (ModuleNode* dep : node->importedModules) {
+            dep->importers.erase(node);
+        }
+        node->importedModules.clear();
+        for (const auto& imported : imports) {
+            ModuleNode* dep = ensureLocked(imported.first, imported.second);
+            node->importedModules.insert(dep);
+            dep->importers.insert(node);
+        }
+        node->selfAccepting = transform.selfAccepting;
+        node->acceptedDeps = std::move(acceptedDeps);
+    }
+
+    long long timestampOf(const std::string& url) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        ModuleNode* node = findLocked(url);
+        return node ? node->lastHmrTimestamp : 0;
+    }
+
+    // Whether any of the transform's imports was hot-updated this session,
+    // i.e. its code carries ?t= stamps that only hold until a restart
+    bool importsHotUpdated(const ModuleTransform& transform) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        for (const auto& imported : transform.imports) {
+            ModuleNode* node = findLocked(imported.first);
+            if (node && node->lastHmrTimestamp > 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::string> urlsForFile(const std::string& file) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        std::vector<std::string> urls;
+        bool known = false;
+        Atom atom = Interner::global().find(file, known);
+        auto it = known ? byFile.find(atom) : byFile.end();
+        if (it != byFile.end()) {
+            for (ModuleNode* node : it->second) {
+                urls.push_back(node->url.str());
+            }
+        }
+        return urls;
+    }
+
+    // Drop the transform results of every module served from `file`
+    void invalidateFile(const std::string& file) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        bool known = false;
+        Atom atom = Interner::global().find(file, known);
+        auto it = known ? byFile.find(atom) : byFile.end();
+        if (it != byFile.end()) {
+            for (ModuleNode* node : it->second) {
+                node->transformResult.reset();
+            }
+        }
+    }
+
+    void invalidateAll() {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        for (auto& entry : byUrl) {
+            entry.second->transformResult.reset();
+        }
+    }
+    
+    // Work out the hot update for a changed module. Every module that will
+    // re-execute is stamped with `timestamp`; those and the accepting
+    // importers lose their transform results so they are redone with the
+    // new import URLs. Returns false when the change needs a full page
+    // reload.
+    bool collectUpdate(const std::string& url, long long timestamp, std::vector<HmrBoundary>& boundaries) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        ModuleNode* changed = findLocked(url);
+        if (!changed) {
+            return false;
+        }
+        std::unordered_set<ModuleNode*> stale;
+        std::unordered_set<ModuleNode*> acceptors;
+        bool deadEnd = propagate(changed, boundaries, stale, acceptors);
+        for (ModuleNode* node : stale) {
+            node->lastHmrTimestamp = timestamp;
+            node->transformResult.reset();
+        }
+        for (ModuleNode* node : acceptors) {
+            node->transformResult.reset();
+        }
+        return !deadEnd;
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return byUrl.size();
+    }
+};
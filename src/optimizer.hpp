@@ -0,0 +1,344 @@
+#pragma once
+
+#include "bundler.hpp"
+#include "dep_scanner.hpp"
+#include "hash.hpp"
+#include "import_scanner.hpp"
+#include "json.hpp"
+#include "logger.hpp"
+#include "phase_timer.hpp"
+#include "resolver.hpp"
+#include "static_files.hpp"
+#include "transform.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <tuple>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <filesystem>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+// One pre-bundled dependency as recorded in _metadata.json
+class OptimizedDep {
+public:
+    // Entry file the specifier resolved to
+    std::string src;
+    // Bundle file name inside the deps directory
+    std::string file;
+    // The entry is CommonJS; its bundle's default export is module.exports
+    bool needsInterop = false;
+};
+
+class OptimizedDeps {
+public:
+    // Lockfiles, config and environment the bundles were built from
+    std::string hash;
+    // Appended as ?v= to bundle URLs so browsers refetch after a rebuild
+    std::string browserHash;
+    // Size, mtime and inode of the hashed files when `hash` was computed
+    std::string inputs;
+    std::map<std::string, OptimizedDep> deps;
+};
+
+// Pre-bundles third-party dependencies: bundles each bare import the
+// DependencyScanner finds from the project's HTML entry points into a single
+// ES module under node_modules/.vite/deps and records them in
+// _metadata.json. A package with hundreds of internal modules becomes one
+// request, and CommonJS packages become importable ES modules. Nothing is
+// rebuilt while the lockfiles and config hash the same.
+class DepOptimizer {
+private:
+    static constexpr const char* OPTIMIZER_VERSION = "vite-optimize-1";
+
+    fs::path root;
+    ModuleResolver& resolver;
+    std::string nodeEnv;
+    bool verbose;
+
+    // File name of a dependency's bundle: "@scope/pkg/sub" -> "@scope_pkg_sub.js"
+    static std::string bundleName(const std::string& specifier) {
+        std::string name;
+        for (char c : specifier) {
+            name += c == '/' || c == '\\' || c == ':' ? '_' : c;
+        }
+        return name + ".js";
+    }
+
+    static bool writeFile(const fs::path& path, const std::string& contents) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << contents;
+        return static_cast<bool>(out);
+    }
+
+    static std::string encodeMetadata(const OptimizedDeps& metadata) {
+        std::string out = "{\n  \"hash\": " + Transforms::jsStringLiteral(metadata.hash) + ",\n";
+        out += "  \"browserHash\": " + Transforms::jsStringLiteral(metadata.browserHash) + ",\n";
+        out += "  \"inputs\": " + Transforms::jsStringLiteral(metadata.inputs) + ",\n";
+        out += "  \"optimized\": {";
+        bool first = true;
+        for (const auto& dep : metadata.deps) {
+            out += first ? "\n" : ",\n";
+            first = false;
+            out += "    " + Transforms::jsStringLiteral(dep.first) + ": { \"src\": " +
+                   Transforms::jsStringLiteral(dep.second.src) + ", \"file\": " +
+                   Transforms::jsStringLiteral(dep.second.file) + ", \"needsInterop\": " +
+                   (dep.second.needsInterop ? "true" : "false") + " }";
+        }
+        out += metadata.deps.empty() ? "}\n}\n" : "\n  }\n}\n";
+        return out;
+    }
+
+public:
+    DepOptimizer(const fs::path& rootDir, ModuleResolver& moduleResolver, const std::string& nodeEnvValue = "development",
+                 bool verboseOutput = false)
+        : root(fs::absolute(rootDir).lexically_normal()), resolver(moduleResolver), nodeEnv(nodeEnvValue),
+          verbose(verboseOutput) {}
+
+    // Hashed whole: the lockfiles and the config
+    static const std::vector<std::string>& hashedFiles() {
+        static const std::vector<std::string> names = {
+            "package-lock.json", "npm-shrinkwrap.json", "yarn.lock", "pnpm-lock.yaml", "bun.lockb",
+            "vite.config.js", "vite.config.mjs", "vite.config.ts", "vite.config.json"
+        };
+        return names;
+    }
+
+    static fs::path depsDir(const fs::path& root) {
+        return root / "node_modules" / ".vite" / "deps";
+    }
+
+    // Fingerprint of everything that decides what the bundles contain: the
+    // lockfiles that pin package versions, the dependency-related keys of
+    // package.json (editing "scripts" or "version" changes nothing), the
+    // config, the NODE_ENV the bundles were built for and this optimizer's
+    // output format. Files are hashed straight from a mapping in one
+    // streaming pass.
+    static std::string computeHash(const fs::path& root, const std::string& nodeEnv) {
+        static const std::vector<std::string> manifestKeys = {
+            "dependencies", "devDependencies", "peerDependencies", "optionalDependencies",
+            "overrides", "resolutions", "pnpm", "imports", "browser"
+        };
+        Hash::Xxh64 state;
+        state.update(std::string(OPTIMIZER_VERSION) + "\n" + nodeEnv + "\n");
+        for (const auto& name : hashedFiles()) {
+            // The name separates inputs, so moving bytes from one file to
+            // another changes the fingerprint
+            if (Hash::updateWithFile(state, (root / name).string())) {
+                state.update("\n" + name + "\n");
+            }
+        }
+        std::string text;
+        JsonValue manifest;
+        if (StaticFiles::readFile(root / "package.json", text) && JsonValue::parse(text, manifest)) {
+            for (const auto& key : manifestKeys) {
+                if (const JsonValue* value = manifest.get(key)) {
+                    state.update(key + "=" + value->stringify() + "\n");
+                }
+            }
+        } else if (!text.empty()) {
+            state.update(text);
+        }
+        return Hash::hex(state.digest());
+    }
+
+    // Size, mtime and inode of every file computeHash reads. While these
+    // match what was recorded next to the hash, the files were not touched
+    // and the hash still holds without reading them.
+    static std::string inputSignature(const fs::path& root, const std::string& nodeEnv) {
+        Hash::Xxh64 state;
+        state.update(std::string(OPTIMIZER_VERSION) + "\n" + nodeEnv + "\n");
+        std::vector<std::string> names = hashedFiles();
+        names.push_back("package.json");
+        for (const auto& name : names) {
+            struct stat st;
+            if (stat((root / name).c_str(), &st) != 0) {
+                continue;
+            }
+            uint64_t fields[] = {static_cast<uint64_t>(st.st_size), static_cast<uint64_t>(st.st_mtim.tv_sec),
+                                 static_cast<uint64_t>(st.st_mtim.tv_nsec), static_cast<uint64_t>(st.st_ino)};
+            state.update(name);
+            state.update(fields, sizeof(fields));
+        }
+        return Hash::hex(state.digest());
+    }
+
+    // Whether `metadata` was built from the current lockfiles and config.
+    // Untouched inputs are recognized from their stat(2) results alone, so
+    // the common check costs a few syscalls; only changed files are hashed.
+    static bool isCurrent(const fs::path& root, const std::string& nodeEnv, const OptimizedDeps& metadata) {
+        if (!metadata.inputs.empty() && metadata.inputs == inputSignature(root, nodeEnv)) {
+            return true;
+        }
+        return metadata.hash == computeHash(root, nodeEnv);
+    }
+
+    // Read _metadata.json; false when it is missing or malformed
+    static bool loadMetadata(const fs::path& root, OptimizedDeps& out) {
+        std::string text;
+        JsonValue json;
+        if (!StaticFiles::readFile(depsDir(root) / "_metadata.json", text) || !JsonValue::parse(text, json) ||
+            !json.isObject()) {
+            return false;
+        }
+        out.hash = json.getString("hash");
+        out.browserHash = json.getString("browserHash");
+        out.inputs = json.getString("inputs");
+        out.deps.clear();
+        if (const JsonValue* optimized = json.get("optimized")) {
+            for (const auto& member : optimized->object) {
+                OptimizedDep dep;
+                dep.src = member.second.getString("src");
+                dep.file = member.second.getString("file");
+                const JsonValue* interop = member.second.get("needsInterop");
+                dep.needsInterop = interop && interop->boolean;
+                if (!dep.file.empty()) {
+                    out.deps.emplace(member.first, dep);
+                }
+            }
+        }
+        return true;
+    }
+
+    // Scan, bundle and write the dependencies unless the metadata already
+    // matches the current lockfiles and config (or `force` is set). Returns
+    // false when a bundle could not be built or written.
+    bool run(bool force = false) {
+        PhaseTimer timer;
+        Logger::section("Optimizing Dependencies");
+        ProgressBar progress(25);
+
+        timer.begin("Checking lockfile hash");
+        OptimizedDeps previous;
+        if (!force && loadMetadata(root, previous) && isCurrent(root, nodeEnv, previous)) {
+            // Touched but unchanged inputs: record their new stat results
+            // so the next check skips hashing again
+            std::string signature = inputSignature(root, nodeEnv);
+            if (previous.inputs != signature && computeHash(root, nodeEnv) == previous.hash) {
+                previous.inputs = signature;
+                writeFile(depsDir(root) / "_metadata.json", encodeMetadata(previous));
+            }
+            timer.end();
+            Logger::info("Dependencies are up to date (hash " + previous.hash + "), skipping. Use --force to rebuild.");
+            if (verbose) {
+                timer.report();
+            }
+            return true;
+        }
+
+        timer.begin("Scanning dependencies");
+        progress.show(0.0, "Scanning dependencies");
+        DependencyScan scan = DependencyScanner(root, resolver).scan();
+        const std::map<std::string, fs::path>& entries = scan.deps;
+
+        // Signature first: a file changed while hashing then fails the
+        // stat check next time instead of vouching for a stale hash
+        OptimizedDeps metadata;
+        metadata.inputs = inputSignature(root, nodeEnv);
+        metadata.hash = computeHash(root, nodeEnv);
+        const std::string& hash = metadata.hash;
+        std::map<std::string, std::string> depByEntry;
+        std::string depList = hash;
+        for (const auto& entry : entries) {
+            OptimizedDep dep;
+            dep.src = entry.second.lexically_relative(depsDir(root)).generic_string();
+            dep.file = bundleName(entry.first);
+            std::string source;
+            if (StaticFiles::readFile(entry.second, source)) {
+                dep.needsInterop = entry.second.extension() != ".json" && !ImportScanner::scan(source).isEsm();
+            }
+            metadata.deps.emplace(entry.first, dep);
+            depByEntry.emplace(entry.second.string(), entry.first);
+            depList += "\n" + entry.first + "=" + entry.second.string();
+        }
+        metadata.browserHash = Hash::hex(Hash::xxh64(depList)).substr(0, 8);
+
+        timer.begin("Pre-bundling dependencies");
+        fs::path finalDir = depsDir(root);
+        fs::path tempDir = finalDir.parent_path() / ("deps_temp_" + std::to_string(getpid()));
+        std::error_code ec;
+        fs::remove_all(tempDir, ec);
+        fs::create_directories(tempDir, ec);
+        if (ec) {
+            std::cout << std::endl;
+            Logger::error("Cannot create " + tempDir.string() + ": " + ec.message());
+            return false;
+        }
+
+        // Name, bundle bytes and module count per dependency
+        std::vector<std::tuple<std::string, size_t, size_t>> bundled;
+        size_t done = 0;
+        for (const auto& entry : entries) {
+            progress.show(static_cast<double>(done++) / std::max<size_t>(entries.size(), 1), entry.first);
+            Bundler bundler(resolver, nodeEnv);
+            // Imports of another pre-bundled entry stay imports of its
+            // bundle, so shared packages are not duplicated
+            bundler.setExternals([&](const std::string& specifier, const fs::path& importer, ExternalModule& out) {
+                if (!ModuleResolver::isBare(specifier)) {
+                    return false;
+                }
+                fs::path file = resolver.resolve(specifier, importer.parent_path());
+                auto it = depByEntry.find(file.string());
+                if (it == depByEntry.end() || file == entry.second) {
+                    return false;
+                }
+                const OptimizedDep& dep = metadata.deps[it->second];
+                out.path = "./" + dep.file + "?v=" + metadata.browserHash;
+                out.commonJs = dep.needsInterop;
+                return true;
+            });
+            std::string code;
+            if (!bundler.bundle(entry.second, code) ||
+                !writeFile(tempDir / metadata.deps[entry.first].file, code)) {
+                std::cout << std::endl;
+                Logger::error("Failed to pre-bundle " + entry.first);
+                fs::remove_all(tempDir, ec);
+                return false;
+            }
+            bundled.emplace_back(entry.first, code.size(), bundler.moduleCount());
+        }
+
+        timer.begin("Writing cache");
+        progress.show(1.0, "Writing cache");
+        // Swap the whole directory in at once so a dev server never sees
+        // a mix of old and new bundles
+        if (!writeFile(tempDir / "_metadata.json", encodeMetadata(metadata))) {
+            std::cout << std::endl;
+            Logger::error("Cannot write " + (tempDir / "_metadata.json").string());
+            fs::remove_all(tempDir, ec);
+            return false;
+        }
+        fs::remove_all(finalDir, ec);
+        fs::rename(tempDir, finalDir, ec);
+        if (ec) {
+            std::cout << std::endl;
+            Logger::error("Cannot move bundles to " + finalDir.string() + ": " + ec.message());
+            return false;
+        }
+        timer.end();
+        std::cout << std::endl;
+
+        if (entries.empty()) {
+            Logger::info("No dependencies to optimize (scanned " + std::to_string(scan.files) + " files)");
+        } else {
+            Logger::success("Pre-bundled " + std::to_string(entries.size()) + " dependencies in " +
+                            PhaseTimer::format(timer.totalMillis()));
+            for (const auto& dep : bundled) {
+                std::cout << Colors::BRIGHT_WHITE << "  " << std::get<0>(dep) << Colors::DIM << "  " << std::fixed
+                          << std::setprecision(2) << std::get<1>(dep) / 1000.0 << " kB, " << std::get<2>(dep)
+                          << (std::get<2>(dep) == 1 ? " module" : " modules") << Colors::RESET << std::endl;
+            }
+        }
+        if (verbose) {
+            timer.report();
+        }
+        return true;
+    }
+};
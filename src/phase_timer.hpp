@@ -0,0 +1,80 @@
+#pragma once
+
+#include "logger.hpp"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+
+// Times consecutive named phases on the monotonic clock, so reported
+// startup and build times are measured rather than made up and are not
+// skewed by wall-clock adjustments.
+class PhaseTimer {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Phase {
+        std::string name;
+        double millis;
+    };
+
+    Clock::time_point origin;
+    Clock::time_point phaseStart;
+    std::string current;
+    std::vector<Phase> phases;
+
+    static double millisBetween(Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+public:
+    PhaseTimer() : origin(Clock::now()), phaseStart(origin) {}
+
+    // End the running phase, if any, and start timing `name`
+    void begin(const std::string& name) {
+        end();
+        current = name;
+        phaseStart = Clock::now();
+    }
+
+    void end() {
+        if (!current.empty()) {
+            phases.push_back(Phase{current, millisBetween(phaseStart, Clock::now())});
+            current.clear();
+        }
+    }
+
+    // Time since the timer was created, including gaps between phases
+    double totalMillis() const {
+        return millisBetween(origin, Clock::now());
+    }
+
+    // Vite's style: milliseconds below a second, seconds above; sub-10ms
+    // times keep a decimal so a fast start does not read as "0ms"
+    static std::string format(double millis) {
+        char buf[32];
+        if (millis < 10) {
+            std::snprintf(buf, sizeof(buf), "%.1fms", millis);
+        } else if (millis < 1000) {
+            std::snprintf(buf, sizeof(buf), "%.0fms", millis);
+        } else {
+            std::snprintf(buf, sizeof(buf), "%.2fs", millis / 1000);
+        }
+        return buf;
+    }
+
+    // One debug line per finished phase
+    void report() const {
+        size_t width = 0;
+        for (const auto& phase : phases) {
+            width = std::max(width, phase.name.size());
+        }
+        for (const auto& phase : phases) {
+            char millis[32];
+            std::snprintf(millis, sizeof(millis), "%9.2fms", phase.millis);
+            Logger::debug(phase.name + std::string(width - phase.name.size(), ' ') + millis);
+        }
+    }
+};
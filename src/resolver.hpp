@@ -0,0 +1,407 @@
+#pragma once
+
+#include "interner.hpp"
+#include "json.hpp"
+#include "logger.hpp"
+#include "stat_cache.hpp"
+#include "static_files.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// Node-style module resolution shared by dev, build and optimize: relative
+// and root-absolute paths with extension and index probing, bare package
+// imports through package.json "exports" or the main fields, and "#"
+// imports through the enclosing package's "imports". Every existence check
+// goes through a StatCache, and finished resolutions, including failures,
+// are cached per specifier and importing directory. Cache keys and results
+// are atoms: a lookup hashes two pointers and a hit copies none of the
+// strings involved.
+class ModuleResolver {
+private:
+    fs::path root;
+    std::vector<std::string> conditions;
+    std::vector<std::string> extensions = {".mjs", ".js", ".mts", ".ts", ".jsx", ".tsx", ".json"};
+    std::vector<std::string> mainFields = {"browser", "module", "jsnext:main", "jsnext", "main"};
+    StatCache stats;
+
+    struct ResolutionKey {
+        Atom importerDir;
+        Atom specifier;
+
+        bool operator==(const ResolutionKey& other) const {
+            return importerDir == other.importerDir && specifier == other.specifier;
+        }
+    };
+
+    struct ResolutionKeyHash {
+        size_t operator()(const ResolutionKey& key) const {
+            return std::hash<Atom>()(key.importerDir) * 31 + std::hash<Atom>()(key.specifier);
+        }
+    };
+
+    mutable std::shared_mutex mutex;
+    std::unordered_map<ResolutionKey, Atom, ResolutionKeyHash> resolved;
+    // Parsed package.json per directory; null when missing or malformed
+    std::unordered_map<Atom, std::shared_ptr<const JsonValue>> manifests;
+
+    std::shared_ptr<const JsonValue> manifest(const fs::path& dir) {
+        Atom key = intern(dir.native());
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = manifests.find(key);
+            if (it != manifests.end()) {
+                return it->second;
+            }
+        }
+        std::shared_ptr<JsonValue> parsed;
+        fs::path file = dir / "package.json";
+        std::string text;
+        if (stats.isFile(file) && StaticFiles::readFile(file, text)) {
+            parsed = std::make_shared<JsonValue>();
+            if (!JsonValue::parse(text, *parsed) || !parsed->isObject()) {
+                Logger::warning("Ignoring malformed " + file.string());
+                parsed.reset();
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        return manifests.emplace(key, std::move(parsed)).first->second;
+    }
+
+    // `file` as written, then with each known extension
+    fs::path tryFile(const fs::path& file) {
+        if (stats.isFile(file)) {
+            return file;
+        }
+        for (const auto& ext : extensions) {
+            fs::path candidate = file;
+            candidate += ext;
+            if (stats.isFile(candidate)) {
+                return candidate;
+            }
+        }
+        return {};
+    }
+
+    // A file, or a directory through its package.json main or index file
+    fs::path tryPath(const fs::path& path) {
+        fs::path file = tryFile(path);
+        if (!file.empty() || !stats.isDirectory(path)) {
+            return file;
+        }
+        if (auto pkg = manifest(path)) {
+            std::string main = pkg->getString("main");
+            if (!main.empty()) {
+                file = tryFile((path / main).lexically_normal());
+                if (!file.empty()) {
+                    return file;
+                }
+            }
+        }
+        return tryFile(path / "index");
+    }
+
+    // Pick the first target whose conditions this resolver satisfies;
+    // "*" in the target is replaced with the part of the subpath the
+    // pattern matched
+    bool resolveTarget(const JsonValue& target, const std::string& match, std::string& out) const {
+        if (target.isString()) {
+            out.clear();
+            for (char c : target.string) {
+                out += c == '*' ? match : std::string(1, c);
+            }
+            return true;
+        }
+        if (target.isArray()) {
+            for (const auto& candidate : target.array) {
+                if (resolveTarget(candidate, match, out)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (target.isObject()) {
+            for (const auto& member : target.object) {
+                if (member.first != "default" &&
+                    std::find(conditions.begin(), conditions.end(), member.first) == conditions.end()) {
+                    continue;
+                }
+                // null excludes the subpath; a nested map without a
+                // matching condition falls through to the next one
+                if (member.second.isNull()) {
+                    return false;
+                }
+                if (resolveTarget(member.second, match, out)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Look `key` up in an "exports" or "imports" map: an exact entry wins,
+    // otherwise the "*" pattern with the longest prefix
+    bool matchSubpath(const JsonValue& map, const std::string& key, std::string& out) const {
+        const JsonValue* exact = map.get(key);
+        if (exact && key.find('*') == std::string::npos) {
+            return resolveTarget(*exact, "", out);
+        }
+        const JsonValue* best = nullptr;
+        size_t bestPrefix = 0;
+        std::string bestMatch;
+        for (const auto& member : map.object) {
+            const std::string& pattern = member.first;
+            size_t star = pattern.find('*');
+            if (star == std::string::npos || pattern.find('*', star + 1) != std::string::npos) {
+                continue;
+            }
+            size_t suffix = pattern.size() - star - 1;
+            if (key.size() < pattern.size() || key.compare(0, star, pattern, 0, star) != 0 ||
+                key.compare(key.size() - suffix, suffix, pattern, star + 1, suffix) != 0) {
+                continue;
+            }
+            if (!best || star > bestPrefix) {
+                best = &member.second;
+                bestPrefix = star;
+                bestMatch = key.substr(star, key.size() - star - suffix);
+            }
+        }
+        return best && resolveTarget(*best, bestMatch, out);
+    }
+
+    fs::path resolvePackage(const std::string& specifier, const fs::path& importerDir) {
+        size_t nameEnd = specifier.find('/');
+        if (specifier[0] == '@' && nameEnd != std::string::npos) {
+            nameEnd = specifier.find('/', nameEnd + 1);
+        }
+        std::string name = specifier.substr(0, nameEnd);
+        std::string subpath = nameEnd == std::string::npos ? "" : specifier.substr(nameEnd + 1);
+
+        for (fs::path dir = importerDir; ; dir = dir.parent_path()) {
+            fs::path packageDir = dir / "node_modules" / name;
+            if (stats.isDirectory(packageDir)) {
+                return resolveInPackage(packageDir, subpath);
+            }
+            if (dir.parent_path() == dir) {
+                return {};
+            }
+        }
+    }
+
+    fs::path resolveInPackage(const fs::path& packageDir, const std::string& subpath) {
+        auto pkg = manifest(packageDir);
+        const JsonValue* exports = pkg ? pkg->get("exports") : nullptr;
+        if (exports && !exports->isNull()) {
+            // "exports" hides everything it does not list
+            std::string key = subpath.empty() ? "." : "./" + subpath;
+            bool sugar = !exports->isObject() || exports->object.empty() || exports->object.front().first[0] != '.';
+            std::string target;
+            bool found = sugar ? key == "." && resolveTarget(*exports, "", target)
+                               : matchSubpath(*exports, key, target);
+            if (!found) {
+                return {};
+            }
+            fs::path file = (packageDir / target).lexically_normal();
+            return stats.isFile(file) ? file : fs::path();
+        }
+        if (!subpath.empty()) {
+            return tryPath(packageDir / subpath);
+        }
+        if (pkg) {
+            for (const auto& field : mainFields) {
+                std::string entry = pkg->getString(field);
+                if (!entry.empty()) {
+                    fs::path file = tryPath((packageDir / entry).lexically_normal());
+                    if (!file.empty()) {
+                        return file;
+                    }
+                }
+            }
+        }
+        return tryFile(packageDir / "index");
+    }
+
+    // "#name" imports map through the nearest enclosing package.json
+    fs::path resolvePackageImport(const std::string& specifier, const fs::path& importerDir) {
+        for (fs::path dir = importerDir; ; dir = dir.parent_path()) {
+            if (auto pkg = manifest(dir)) {
+                const JsonValue* imports = pkg->get("imports");
+                std::string target;
+                if (!imports || !imports->isObject() || !matchSubpath(*imports, specifier, target)) {
+                    return {};
+                }
+                if (target.compare(0, 2, "./") == 0) {
+                    fs::path file = (dir / target).lexically_normal();
+                    return stats.isFile(file) ? file : fs::path();
+                }
+                return resolvePackage(target, dir);
+            }
+            if (dir.parent_path() == dir) {
+                return {};
+            }
+        }
+    }
+
+    // Glob match of a package-relative path: `*` and `?` stay within a
+    // path segment, `**/` spans any number of them
+    static bool globMatch(std::string_view pattern, std::string_view path) {
+        if (pattern.compare(0, 2, "**") == 0) {
+            pattern.remove_prefix(pattern.compare(0, 3, "**/") == 0 ? 3 : 2);
+            if (pattern.empty()) {
+                return true;
+            }
+            for (size_t i = 0; i <= path.size(); ++i) {
+                if ((i == 0 || path[i - 1] == '/') && globMatch(pattern, path.substr(i))) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (pattern.empty()) {
+            return path.empty();
+        }
+        if (pattern[0] == '*') {
+            for (size_t i = 0; i <= path.size(); ++i) {
+                if (globMatch(pattern.substr(1), path.substr(i))) {
+                    return true;
+                }
+                if (i < path.size() && path[i] == '/') {
+                    break;
+                }
+            }
+            return false;
+        }
+        if (path.empty() || (pattern[0] == '?' ? path[0] == '/' : pattern[0] != path[0])) {
+            return false;
+        }
+        return globMatch(pattern.substr(1), path.substr(1));
+    }
+
+    fs::path resolveUncached(const std::string& specifier, const fs::path& importerDir) {
+        if (specifier[0] == '/') {
+            return tryPath((root / specifier.substr(1)).lexically_normal());
+        }
+        if (specifier == "." || specifier == ".." || specifier.compare(0, 2, "./") == 0 ||
+            specifier.compare(0, 3, "../") == 0) {
+            return tryPath((importerDir / specifier).lexically_normal());
+        }
+        if (specifier[0] == '#') {
+            return resolvePackageImport(specifier, importerDir);
+        }
+        return resolvePackage(specifier, importerDir);
+    }
+
+public:
+    // `root` anchors "/"-absolute specifiers. Exports conditions are the
+    // ones a browser build matches, plus "production" or "development".
+    explicit ModuleResolver(const fs::path& rootDir, bool production = false)
+        : root(fs::absolute(rootDir).lexically_normal()),
+          conditions({"import", "module", "browser", production ? "production" : "development"}) {}
+
+    ModuleResolver(const ModuleResolver&) = delete;
+    ModuleResolver& operator=(const ModuleResolver&) = delete;
+
+    // Package imports: not relative, not root-absolute and not a URL
+    static bool isBare(const std::string& specifier) {
+        if (specifier.empty() || specifier[0] == '.' || specifier[0] == '/') {
+            return false;
+        }
+        size_t colon = specifier.find(':');
+        return colon == std::string::npos || specifier.find('/') < colon;
+    }
+
+    // The file `specifier` imported from a module in `importerDir` refers
+    // to, or an empty path when it cannot be resolved. URLs with a scheme
+    // are never resolved.
+    fs::path resolve(const std::string& specifier, const fs::path& importerDir) {
+        if (specifier.empty() || (specifier[0] != '.' && specifier[0] != '/' && !isBare(specifier))) {
+            return {};
+        }
+        ResolutionKey key{intern(importerDir.native()), intern(specifier)};
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = resolved.find(key);
+            if (it != resolved.end()) {
+                return fs::path(it->second.view());
+            }
+        }
+        fs::path file = resolveUncached(specifier, importerDir);
+        if (file.empty()) {
+            Logger::warning("Failed to resolve import \"" + specifier + "\" from " + importerDir.string());
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        resolved.emplace(key, intern(file.native()));
+        return file;
+    }
+
+    // Whether importing `file` may do more than define its exports, going
+    // by the "sideEffects" field of the nearest package.json: `false`, or
+    // a list of globs that does not match the file, says it does not.
+    // Globs without a slash match file names anywhere in the package.
+    bool hasSideEffects(const fs::path& file) {
+        for (fs::path dir = file.parent_path();; dir = dir.parent_path()) {
+            if (auto pkg = manifest(dir)) {
+                const JsonValue* field = pkg->get("sideEffects");
+                if (!field || field->type == JsonValue::Type::Bool) {
+                    return !field || field->boolean;
+                }
+                if (!field->isArray()) {
+                    return true;
+                }
+                std::string relative = file.lexically_relative(dir).generic_string();
+                for (const auto& glob : field->array) {
+                    std::string pattern = glob.isString() ? glob.string : "";
+                    if (pattern.compare(0, 2, "./") == 0) {
+                        pattern.erase(0, 2);
+                    } else if (pattern.find('/') == std::string::npos) {
+                        pattern = "**/" + pattern;
+                    }
+                    if (!pattern.empty() && globMatch(pattern, relative)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+            if (dir.parent_path() == dir) {
+                return true;
+            }
+        }
+    }
+
+    // A file was created or deleted: forget what was known about it and
+    // every resolution that may have depended on it
+    void invalidate(const fs::path& path) {
+        stats.invalidate(path);
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (path.filename() == "package.json") {
+            manifests.erase(intern(path.parent_path().native()));
+        }
+        resolved.clear();
+    }
+
+    // Forget everything, e.g. after packages were installed or removed
+    void clear() {
+        stats.clear();
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        resolved.clear();
+        manifests.clear();
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return resolved.size();
+    }
+
+    uint64_t statCalls() const {
+        return stats.syscalls();
+    }
+};
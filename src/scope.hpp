@@ -0,0 +1,371 @@
+#pragma once
+
+#include "ast.hpp"
+#include "interner.hpp"
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+// Where a top-level binding is named in the source: a declaration of it
+// or a reference that resolves to it
+class BindingUse {
+public:
+    uint32_t start = 0;
+    uint32_t end = 0;
+    // The value of a `{ name }` shorthand, whose key a rename must keep
+    bool shorthand = false;
+    // The callee of a call or the tag of a tagged template
+    bool callee = false;
+};
+
+// Resolves every identifier of a module against the scopes it is in:
+// function and arrow parameters and bodies, blocks, loop heads, catch
+// clauses, class bodies and the names of function and class expressions,
+// with `var` and function declarations hoisted the way ES modules (strict
+// code) hoist them. What callers get is the module's top-level bindings
+// with every place they are named, the names no scope declares (globals),
+// and the names declared in nested scopes. Import and export statements
+// are not walked; import locals count as top-level bindings.
+class ScopeAnalysis {
+public:
+    // Top-level bindings, imports included, and where each is named
+    std::unordered_map<Atom, std::vector<BindingUse>> topLevel;
+    // Referenced but declared nowhere in the module
+    std::unordered_set<Atom> freeNames;
+    // Declared in some scope below the top level
+    std::unordered_set<Atom> nestedNames;
+    // A direct eval() can reach any binding by name, so none may be renamed
+    bool directEval = false;
+
+private:
+    struct Scope {
+        const Scope* parent;
+        std::unordered_set<Atom> names;
+    };
+
+    Scope program{nullptr, {}};
+
+    static void patternNames(const Node* pattern, std::vector<Atom>& names) {
+        if (!pattern) {
+            return;
+        }
+        switch (pattern->kind) {
+            case NodeKind::Identifier:
+                names.push_back(pattern->name);
+                break;
+            case NodeKind::Array:
+                for (const Node* element : pattern->list) {
+                    patternNames(element, names);
+                }
+                break;
+            case NodeKind::Object:
+                for (const Node* property : pattern->list) {
+                    patternNames(property->kind == NodeKind::Spread ? property->a : property->b, names);
+                }
+                break;
+            case NodeKind::Assign:
+            case NodeKind::Spread:
+                patternNames(pattern->a, names);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void declare(Scope& scope, Atom name) {
+        if (name.empty()) {
+            return;
+        }
+        scope.names.insert(name);
+        if (&scope != &program) {
+            nestedNames.insert(name);
+        }
+    }
+
+    void declarePattern(Scope& scope, const Node* pattern) {
+        std::vector<Atom> names;
+        patternNames(pattern, names);
+        for (Atom name : names) {
+            declare(scope, name);
+        }
+    }
+
+    // `var` declarations anywhere in a function body outside nested
+    // functions belong to the function's scope
+    void hoistVars(const Node* node, Scope& scope) {
+        if (!node) {
+            return;
+        }
+        switch (node->kind) {
+            case NodeKind::VarDecl:
+                if (node->varKind == VarKind::Var) {
+                    for (const Node* declarator : node->list) {
+                        declarePattern(scope, declarator->a);
+                    }
+                }
+                break;
+            case NodeKind::Block:
+            case NodeKind::Program:
+            case NodeKind::StaticBlock:
+                for (const Node* statement : node->list) {
+                    hoistVars(statement, scope);
+                }
+                break;
+            case NodeKind::Switch:
+                for (const Node* branch : node->list) {
+                    for (const Node* statement : branch->list) {
+                        hoistVars(statement, scope);
+                    }
+                }
+                break;
+            case NodeKind::If:
+                hoistVars(node->b, scope);
+                hoistVars(node->c, scope);
+                break;
+            case NodeKind::For:
+            case NodeKind::ForIn:
+            case NodeKind::ForOf:
+                hoistVars(node->a, scope);
+                hoistVars(node->d, scope);
+                break;
+            case NodeKind::While:
+            case NodeKind::DoWhile:
+            case NodeKind::Labeled:
+            case NodeKind::With:
+                hoistVars(node->d, scope);
+                break;
+            case NodeKind::Try:
+                hoistVars(node->a, scope);
+                hoistVars(node->c, scope);
+                hoistVars(node->d, scope);
+                break;
+            case NodeKind::ExportDecl:
+                hoistVars(node->a, scope);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Lexical declarations directly in a statement list: let, const,
+    // classes and functions
+    void declareLexical(const NodeList& statements, Scope& scope) {
+        for (const Node* statement : statements) {
+            if (statement->kind == NodeKind::ExportDecl ||
+                (statement->kind == NodeKind::ExportDefault &&
+                 (statement->a->kind == NodeKind::Function || statement->a->kind == NodeKind::Class))) {
+                statement = statement->a;
+            }
+            if (statement->kind == NodeKind::VarDecl && statement->varKind != VarKind::Var) {
+                for (const Node* declarator : statement->list) {
+                    declarePattern(scope, declarator->a);
+                }
+            } else if ((statement->kind == NodeKind::Function || statement->kind == NodeKind::Class) && statement->a) {
+                declare(scope, statement->a->name);
+            } else if (statement->kind == NodeKind::Import) {
+                for (const Node* specifier : statement->list) {
+                    declare(scope, specifier->a->name);
+                }
+            }
+        }
+    }
+
+    void reference(const Node* identifier, const Scope& scope, bool shorthand, bool callee) {
+        Atom name = identifier->name;
+        for (const Scope* s = &scope; s; s = s->parent) {
+            if (s->names.count(name)) {
+                if (s == &program) {
+                    topLevel[name].push_back(BindingUse{identifier->start, identifier->end, shorthand, callee});
+                }
+                return;
+            }
+        }
+        freeNames.insert(name);
+        if (callee && name == "eval") {
+            directEval = true;
+        }
+    }
+
+    void visitList(const NodeList& nodes, const Scope& scope) {
+        for (const Node* node : nodes) {
+            visit(node, scope);
+        }
+    }
+
+    // Parameters and body of a function or arrow in a scope of their own
+    void visitFunction(const Node* node, const Scope& outer) {
+        Scope scope{&outer, {}};
+        for (const Node* param : node->list) {
+            declarePattern(scope, param);
+        }
+        const Node* body = node->b;
+        bool block = body && body->kind == NodeKind::Block && !node->has(Node::ExpressionBody);
+        if (block) {
+            hoistVars(body, scope);
+            declareLexical(body->list, scope);
+        }
+        visitList(node->list, scope);
+        if (block) {
+            visitList(body->list, scope);
+        } else {
+            visit(body, scope);
+        }
+    }
+
+    void visitClass(const Node* node, const Scope& outer) {
+        Scope scope{&outer, {}};
+        if (node->kind == NodeKind::ClassExpr && node->a) {
+            declare(scope, node->a->name);
+        }
+        visit(node->a, node->kind == NodeKind::Class ? outer : scope);
+        visit(node->b, scope);
+        for (const Node* member : node->list) {
+            if (member->kind == NodeKind::StaticBlock) {
+                Scope block{&scope, {}};
+                hoistVars(member, block);
+                declareLexical(member->list, block);
+                visitList(member->list, block);
+                continue;
+            }
+            if (member->has(Node::Computed)) {
+                visit(member->a, scope);
+            }
+            visit(member->b, scope);
+        }
+    }
+
+    void visit(const Node* node, const Scope& scope) {
+        if (!node) {
+            return;
+        }
+        switch (node->kind) {
+            case NodeKind::Identifier:
+                reference(node, scope, false, false);
+                return;
+            case NodeKind::Import:
+            case NodeKind::ExportNamed:
+            case NodeKind::ExportAll:
+            case NodeKind::PrivateName:
+            case NodeKind::MetaProperty:
+                return;
+            case NodeKind::Member:
+                visit(node->a, scope);
+                return;
+            case NodeKind::Property:
+                if (node->has(Node::Computed)) {
+                    visit(node->a, scope);
+                }
+                if (node->has(Node::Shorthand)) {
+                    const Node* value = node->b->kind == NodeKind::Assign ? node->b->a : node->b;
+                    reference(value, scope, true, false);
+                    if (node->b->kind == NodeKind::Assign) {
+                        visit(node->b->b, scope);
+                    }
+                    return;
+                }
+                visit(node->b, scope);
+                return;
+            case NodeKind::Method:
+            case NodeKind::Field:
+                if (node->has(Node::Computed)) {
+                    visit(node->a, scope);
+                }
+                visit(node->b, scope);
+                return;
+            case NodeKind::Call:
+            case NodeKind::TaggedTemplate:
+                if (node->a->kind == NodeKind::Identifier) {
+                    reference(node->a, scope, false, true);
+                } else {
+                    visit(node->a, scope);
+                }
+                visit(node->b, scope);
+                visitList(node->list, scope);
+                return;
+            case NodeKind::Function:
+                visit(node->a, scope);
+                visitFunction(node, scope);
+                return;
+            case NodeKind::FunctionExpr:
+                if (node->a) {
+                    Scope named{&scope, {}};
+                    declare(named, node->a->name);
+                    visit(node->a, named);
+                    visitFunction(node, named);
+                } else {
+                    visitFunction(node, scope);
+                }
+                return;
+            case NodeKind::Arrow:
+                visitFunction(node, scope);
+                return;
+            case NodeKind::Class:
+            case NodeKind::ClassExpr:
+                visitClass(node, scope);
+                return;
+            case NodeKind::Block: {
+                Scope block{&scope, {}};
+                declareLexical(node->list, block);
+                visitList(node->list, block);
+                return;
+            }
+            case NodeKind::For:
+            case NodeKind::ForIn:
+            case NodeKind::ForOf: {
+                Scope head{&scope, {}};
+                if (node->a && node->a->kind == NodeKind::VarDecl && node->a->varKind != VarKind::Var) {
+                    for (const Node* declarator : node->a->list) {
+                        declarePattern(head, declarator->a);
+                    }
+                }
+                visit(node->a, head);
+                visit(node->b, head);
+                visit(node->c, head);
+                visit(node->d, head);
+                return;
+            }
+            case NodeKind::Switch: {
+                visit(node->a, scope);
+                Scope body{&scope, {}};
+                for (const Node* branch : node->list) {
+                    declareLexical(branch->list, body);
+                }
+                for (const Node* branch : node->list) {
+                    visit(branch->a, body);
+                    visitList(branch->list, body);
+                }
+                return;
+            }
+            case NodeKind::Try: {
+                visit(node->a, scope);
+                Scope handler{&scope, {}};
+                declarePattern(handler, node->b);
+                visit(node->b, handler);
+                visit(node->c, handler);
+                visit(node->d, scope);
+                return;
+            }
+            default:
+                visit(node->a, scope);
+                visit(node->b, scope);
+                visit(node->c, scope);
+                visit(node->d, scope);
+                visitList(node->list, scope);
+                return;
+        }
+    }
+
+public:
+    explicit ScopeAnalysis(const Ast& ast) {
+        hoistVars(ast.program, program);
+        declareLexical(ast.program->list, program);
+        for (Atom name : program.names) {
+            topLevel[name];
+        }
+        visitList(ast.program->list, program);
+    }
+
+    ScopeAnalysis(const ScopeAnalysis&) = delete;
+    ScopeAnalysis& operator=(const ScopeAnalysis&) = delete;
+};
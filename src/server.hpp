@@ -0,0 +1,259 @@
+#pragma once
+
+#include "event_loop.hpp"
+#include "uring_loop.hpp"
+#include "logger.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <stdexcept>
+#include <system_error>
+#include <csignal>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// One or more listening sockets, each served by its own event loop. With
+// several workers every loop owns a SO_REUSEPORT listener on the same
+// address, so the kernel shards incoming connections across threads and no
+// accept lock or cross-thread handoff is needed.
+class HttpServer {
+private:
+    std::vector<int> listenFds;
+    int boundPort = 0;
+    std::mutex loopsMutex;
+    std::vector<EventLoop*> activeLoops;
+
+    static int openListener(const addrinfo* ai, bool reusePort) {
+        int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) {
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (reusePort) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+        }
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0) {
+            return fd;
+        }
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    static int socketPort(int fd) {
+        sockaddr_storage addr{};
+        socklen_t len = sizeof(addr);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        return addr.ss_family == AF_INET6
+            ? ntohs(reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port)
+            : ntohs(reinterpret_cast<sockaddr_in*>(&addr)->sin_port);
+    }
+
+    void closeListeners() {
+        for (int fd : listenFds) {
+            close(fd);
+        }
+        listenFds.clear();
+    }
+
+    // Bind `workers` SO_REUSEPORT listeners to one address. A plain probe
+    // bind runs first: SO_REUSEPORT would otherwise let us silently share a
+    // port with another dev server run by the same user.
+    bool bindShards(addrinfo* ai, int workers, int& error) {
+        int probe = openListener(ai, false);
+        if (probe < 0) {
+            error = errno;
+            return false;
+        }
+        int port = socketPort(probe);
+        close(probe);
+
+        if (ai->ai_family == AF_INET6) {
+            reinterpret_cast<sockaddr_in6*>(ai->ai_addr)->sin6_port = htons(static_cast<uint16_t>(port));
+        } else {
+            reinterpret_cast<sockaddr_in*>(ai->ai_addr)->sin_port = htons(static_cast<uint16_t>(port));
+        }
+        for (int i = 0; i < workers; ++i) {
+            int fd = openListener(ai, true);
+            if (fd < 0) {
+                error = errno;
+                closeListeners();
+                return false;
+            }
+            listenFds.push_back(fd);
+        }
+        return true;
+    }
+
+public:
+    HttpServer() = default;
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    ~HttpServer() {
+        closeListeners();
+    }
+
+    // Bind and listen on host:port with one listener per worker. Throws
+    // std::system_error carrying the errno of the last failed attempt so
+    // callers can detect EADDRINUSE.
+    void listen(const std::string& host, int port, int workers = 1) {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+
+        addrinfo* results = nullptr;
+        std::string service = std::to_string(port);
+        int rc = getaddrinfo(host.empty() ? nullptr : host.c_str(), service.c_str(), &hints, &results);
+        if (rc != 0) {
+            throw std::runtime_error("Cannot resolve host '" + host + "': " + gai_strerror(rc));
+        }
+
+        closeListeners();
+        int lastErrno = 0;
+        for (addrinfo* ai = results; ai; ai = ai->ai_next) {
+            if (workers <= 1) {
+                int fd = openListener(ai, false);
+                if (fd >= 0) {
+                    listenFds.push_back(fd);
+                    break;
+                }
+                lastErrno = errno;
+            } else if (bindShards(ai, workers, lastErrno)) {
+                break;
+            }
+        }
+        freeaddrinfo(results);
+
+        if (listenFds.empty()) {
+            throw std::system_error(lastErrno, std::generic_category(), "Cannot listen on " + host + ":" + service);
+        }
+        boundPort = socketPort(listenFds.front());
+    }
+
+    // Listen on the first free port in [port, port + attempts), the way Vite
+    // moves on when its default port is taken. Returns the bound port.
+    int listenAvailable(const std::string& host, int port, int workers = 1, int attempts = 10) {
+        for (int attempt = 0; ; ++attempt) {
+            try {
+                listen(host, port + attempt, workers);
+                return boundPort;
+            } catch (const std::system_error& e) {
+                if (e.code() != std::errc::address_in_use || attempt + 1 >= attempts) {
+                    throw;
+                }
+            }
+        }
+    }
+
+    int port() const {
+        return boundPort;
+    }
+
+    size_t workerCount() const {
+        return listenFds.size();
+    }
+
+    // Pick the backend to run with, falling back to epoll when io_uring is
+    // unavailable (old kernel, seccomp filter, sysctl io_uring_disabled).
+    // `reason` explains a fallback.
+    static IoBackend resolveBackend(IoBackend requested, std::string& reason) {
+        if (requested == IoBackend::Uring && !UringLoop::supported(reason)) {
+            return IoBackend::Epoll;
+        }
+        return requested;
+    }
+
+    // Push a text message to every WebSocket client on every worker. Safe to
+    // call from any thread; a no-op while the server is not running.
+    void broadcast(const std::string& message) {
+        std::lock_guard<std::mutex> lock(loopsMutex);
+        for (EventLoop* loop : activeLoops) {
+            loop->broadcast(message);
+        }
+    }
+
+    // Serve requests until SIGINT or SIGTERM is received. The first loop runs
+    // on the calling thread and owns the signalfd; the others get a thread
+    // each and are stopped once the first one returns. The handler is shared
+    // by every loop and must be thread-safe when there is more than one.
+    void run(RequestHandler handler, IoBackend backend = IoBackend::Epoll) {
+        sigset_t mask, previous;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &mask, &previous);
+        int sigFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+        {
+            std::vector<std::unique_ptr<EventLoop>> loops;
+            for (int fd : listenFds) {
+                if (backend == IoBackend::Uring) {
+                    loops.push_back(std::make_unique<UringLoop>(fd, handler));
+                } else {
+                    loops.push_back(std::make_unique<EpollLoop>(fd, handler));
+                }
+            }
+            if (sigFd >= 0) {
+                loops.front()->watchSignals(sigFd);
+            }
+            {
+                std::lock_guard<std::mutex> lock(loopsMutex);
+                for (auto& loop : loops) {
+                    activeLoops.push_back(loop.get());
+                }
+            }
+
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < loops.size(); ++i) {
+                EventLoop* loop = loops[i].get();
+                threads.emplace_back([loop]() {
+                    try {
+                        loop->run();
+                    } catch (const std::exception& e) {
+                        Logger::error(std::string("Worker stopped: ") + e.what());
+                    }
+                });
+            }
+
+            std::exception_ptr failure;
+            try {
+                loops.front()->run();
+            } catch (...) {
+                failure = std::current_exception();
+            }
+            for (size_t i = 1; i < loops.size(); ++i) {
+                loops[i]->stop();
+            }
+            for (auto& t : threads) {
+                t.join();
+            }
+            {
+                std::lock_guard<std::mutex> lock(loopsMutex);
+                activeLoops.clear();
+            }
+            if (failure) {
+                if (sigFd >= 0) close(sigFd);
+                pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+                std::rethrow_exception(failure);
+            }
+        }
+
+        if (sigFd >= 0) {
+            close(sigFd);
+        }
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    }
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+#include <cstdint>
+
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+// Remembers what stat(2) said about each path, including that it does not
+// exist. Resolution probes many candidate files per import and most of them
+// are misses, so caching negatives is what removes most of the syscalls.
+class StatCache {
+public:
+    enum class Kind : uint8_t { Missing, File, Directory };
+
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, Kind> entries;
+    std::atomic<uint64_t> statCalls{0};
+
+public:
+    StatCache() = default;
+    StatCache(const StatCache&) = delete;
+    StatCache& operator=(const StatCache&) = delete;
+
+    Kind kind(const fs::path& path) {
+        const std::string& key = path.native();
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = entries.find(key);
+            if (it != entries.end()) {
+                return it->second;
+            }
+        }
+        struct stat st;
+        Kind result = Kind::Missing;
+        if (stat(key.c_str(), &st) == 0) {
+            result = S_ISDIR(st.st_mode) ? Kind::Directory : S_ISREG(st.st_mode) ? Kind::File : Kind::Missing;
+        }
+        statCalls.fetch_add(1, std::memory_order_relaxed);
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        entries.emplace(key, result);
+        return result;
+    }
+
+    bool isFile(const fs::path& path) {
+        return kind(path) == Kind::File;
+    }
+
+    bool isDirectory(const fs::path& path) {
+        return kind(path) == Kind::Directory;
+    }
+
+    // Forget one path after it was created or deleted
+    void invalidate(const fs::path& path) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        entries.erase(path.native());
+    }
+
+    void clear() {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        entries.clear();
+    }
+
+    // Real stat(2) calls made so far; every other lookup was a cache hit
+    uint64_t syscalls() const {
+        return statCalls.load(std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "http.hpp"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+// LRU of open file descriptors shared by every server worker. Each lookup
+// stats the path and reopens when the inode, size or mtime changed, so edits
+// are picked up while unchanged assets skip the open/close per request.
+class FileCache {
+private:
+    struct Entry {
+        std::shared_ptr<const OpenFile> file;
+        std::list<std::string>::iterator position;
+    };
+
+    size_t capacity;
+    std::mutex mutex;
+    std::list<std::string> recent;
+    std::unordered_map<std::string, Entry> entries;
+
+    static bool sameFile(const OpenFile& f, const struct stat& st) {
+        return f.inode == st.st_ino && f.size == static_cast<size_t>(st.st_size) &&
+               f.mtime.tv_sec == st.st_mtim.tv_sec && f.mtime.tv_nsec == st.st_mtim.tv_nsec;
+    }
+
+public:
+    explicit FileCache(size_t maxOpen = 256) : capacity(maxOpen) {}
+
+    FileCache(const FileCache&) = delete;
+    FileCache& operator=(const FileCache&) = delete;
+
+    std::shared_ptr<const OpenFile> open(const std::string& path) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            return nullptr;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(path);
+            if (it != entries.end()) {
+                if (sameFile(*it->second.file, st)) {
+                    recent.splice(recent.begin(), recent, it->second.position);
+                    return it->second.file;
+                }
+                recent.erase(it->second.position);
+                entries.erase(it);
+            }
+        }
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return nullptr;
+        }
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return nullptr;
+        }
+        auto file = std::make_shared<const OpenFile>(fd, static_cast<size_t>(st.st_size), st.st_ino, st.st_mtim);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(path);
+        if (it != entries.end()) {
+            recent.erase(it->second.position);
+            entries.erase(it);
+        }
+        recent.push_front(path);
+        entries[path] = Entry{file, recent.begin()};
+        while (entries.size() > capacity) {
+            entries.erase(recent.back());
+            recent.pop_back();
+        }
+        return file;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+};
+
+// Maps request paths onto files below a root directory
+class StaticFiles {
+private:
+    fs::path root;
+    bool spaFallback;
+    FileCache openFiles;
+
+public:
+    StaticFiles(const fs::path& rootDir, bool fallbackToIndex = true)
+        : root(fs::absolute(rootDir).lexically_normal()), spaFallback(fallbackToIndex) {}
+
+    const fs::path& getRoot() const {
+        return root;
+    }
+
+    // Dotfiles and dot directories such as .env or .git hold secrets, not
+    // site content. Only .well-known and the dependency optimizer's output
+    // in node_modules/.vite/deps are served.
+    static bool hiddenPath(const std::vector<std::string>& segments) {
+        for (size_t i = 0; i < segments.size(); ++i) {
+            const std::string& segment = segments[i];
+            if (segment[0] != '.' || segment == ".well-known") {
+                continue;
+            }
+            bool optimizedDeps = segment == ".vite" && i > 0 && segments[i - 1] == "node_modules" &&
+                                 i + 1 < segments.size() && segments[i + 1] == "deps";
+            if (!optimizedDeps) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Resolve a decoded URL path to a file under the root. Returns an empty
+    // path when the request tries to escape the root or names a hidden file.
+    fs::path resolve(const std::string& urlPath) const {
+        std::vector<std::string> segments;
+        std::stringstream ss(urlPath);
+        std::string segment;
+        while (std::getline(ss, segment, '/')) {
+            if (segment.empty() || segment == ".") {
+                continue;
+            }
+            if (segment == "..") {
+                if (segments.empty()) {
+                    return {};
+                }
+                segments.pop_back();
+                continue;
+            }
+            if (segment.find('\0') != std::string::npos || segment.find('\\') != std::string::npos) {
+                return {};
+            }
+            segments.push_back(segment);
+        }
+        if (hiddenPath(segments)) {
+            return {};
+        }
+
+        fs::path result = root;
+        for (const auto& s : segments) {
+            result /= s;
+        }
+        return result;
+    }
+
+    // Find the file to serve for a request: directories map to their
+    // index.html, and HTML navigations to unknown paths fall back to the
+    // root index.html like a single-page app expects.
+    fs::path lookup(const HttpRequest& req) const {
+        fs::path file = resolve(req.path);
+        if (file.empty()) {
+            return {};
+        }
+        std::error_code ec;
+        if (fs::is_directory(file, ec)) {
+            file /= "index.html";
+        }
+        if (fs::is_regular_file(file, ec)) {
+            return file;
+        }
+        if (spaFallback && req.header("Accept").find("text/html") != std::string::npos) {
+            fs::path index = root / "index.html";
+            if (fs::is_regular_file(index, ec)) {
+                return index;
+            }
+        }
+        return {};
+    }
+
+    static bool readFile(const fs::path& path, std::string& out) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::ostringstream content;
+        content << file.rdbuf();
+        out = content.str();
+        return true;
+    }
+
+    // Serve the request from disk, answering 403/404/405 as appropriate. The
+    // body is streamed with sendfile(2) from a cached descriptor, so assets
+    // never pass through a userspace buffer.
+    void serve(const HttpRequest& req, HttpResponse& res) {
+        if (req.method != "GET" && req.method != "HEAD") {
+            res.status = 405;
+            res.setHeader("Allow", "GET, HEAD");
+            res.setHeader("Content-Type", "text/plain; charset=utf-8");
+            res.body = "Method Not Allowed\n";
+            return;
+        }
+        if (resolve(req.path).empty()) {
+            res.status = 403;
+            res.setHeader("Content-Type", "text/plain; charset=utf-8");
+            res.body = "Forbidden\n";
+            return;
+        }
+
+        fs::path file = lookup(req);
+        std::shared_ptr<const OpenFile> opened = file.empty() ? nullptr : openFiles.open(file.string());
+        if (!opened) {
+            res.status = 404;
+            res.setHeader("Content-Type", "text/plain; charset=utf-8");
+            res.body = "Not Found: " + req.path + "\n";
+            return;
+        }
+
+        res.status = 200;
+        res.setHeader("Content-Type", Http::mimeType(file.string()));
+        res.sendFile(opened);
+    }
+};
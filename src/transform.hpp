@@ -0,0 +1,156 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <filesystem>
+#include <array>
+
+namespace fs = std::filesystem;
+
+// Output of a dev-server transform, tagged with the file state it came from
+class TransformResult {
+public:
+    std::string code;
+    std::string contentType;
+    // Strong validator derived from `code`
+    std::string etag;
+    fs::file_time_type mtime;
+    uintmax_t size = 0;
+};
+
+// Transform results shared by every dev-server worker. Lookups vastly
+// outnumber inserts, so each shard sits behind a shared_mutex and readers on
+// different shards never touch the same lock word.
+class TransformCache {
+private:
+    static constexpr size_t SHARDS = 16;
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<const TransformResult>> entries;
+    };
+
+    std::array<Shard, SHARDS> shards;
+
+    Shard& shardFor(const std::string& key) {
+        return shards[std::hash<std::string>{}(key) % SHARDS];
+    }
+
+public:
+    std::shared_ptr<const TransformResult> find(const std::string& key) {
+        Shard& shard = shardFor(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.entries.find(key);
+        return it == shard.entries.end() ? nullptr : it->second;
+    }
+
+    void store(const std::string& key, std::shared_ptr<const TransformResult> result) {
+        Shard& shard = shardFor(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.entries[key] = std::move(result);
+    }
+
+    void invalidate(const std::string& key) {
+        Shard& shard = shardFor(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.entries.erase(key);
+    }
+
+    // Return the cached result for `file` when the file is unchanged on disk,
+    // otherwise run `transform` and cache what it produces. Two workers racing
+    // on the same stale entry may both transform; the last store wins, which
+    // is harmless because transforms are pure functions of the file.
+    std::shared_ptr<const TransformResult> getOrTransform(
+        const std::string& key, const fs::path& file,
+        const std::function<bool(const fs::path&, TransformResult&)>& transform) {
+        std::error_code ec;
+        auto mtime = fs::last_write_time(file, ec);
+        if (ec) {
+            return nullptr;
+        }
+        uintmax_t size = fs::file_size(file, ec);
+        if (ec) {
+            return nullptr;
+        }
+
+        auto cached = find(key);
+        if (cached && cached->mtime == mtime && cached->size == size) {
+            return cached;
+        }
+
+        auto result = std::make_shared<TransformResult>();
+        result->mtime = mtime;
+        result->size = size;
+        if (!transform(file, *result)) {
+            return nullptr;
+        }
+        store(key, result);
+        return result;
+    }
+};
+
+// Transforms that turn non-JavaScript files into ES modules when a script
+// imports them, e.g. `import './style.css'` or `import data from './x.json'`.
+namespace Transforms {
+    inline std::string jsStringLiteral(const std::string& s) {
+        std::string out;
+        out.reserve(s.size() + 16);
+        out += '"';
+        for (unsigned char c : s) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (c < 0x20) {
+                        static const char* hex = "0123456789abcdef";
+                        out += "\\u00";
+                        out += hex[c >> 4];
+                        out += hex[c & 0xf];
+                    } else {
+                        out += static_cast<char>(c);
+                    }
+            }
+        }
+        // U+2028/U+2029 are line terminators inside older JS string literals
+        size_t pos = 0;
+        while ((pos = out.find("\xE2\x80\xA8", pos)) != std::string::npos) {
+            out.replace(pos, 3, "\\u2028");
+        }
+        pos = 0;
+        while ((pos = out.find("\xE2\x80\xA9", pos)) != std::string::npos) {
+            out.replace(pos, 3, "\\u2029");
+        }
+        out += '"';
+        return out;
+    }
+
+    // CSS imported from JS becomes a module that injects a <style> tag
+    inline std::string cssToModule(const std::string& css, const std::string& id) {
+        std::string code;
+        code.reserve(css.size() + 512);
+        code += "const __vite__id = " + jsStringLiteral(id) + ";\n";
+        code += "const __vite__css = " + jsStringLiteral(css) + ";\n";
+        code += "let __vite__style = document.querySelector(`style[data-vite-dev-id=\"${__vite__id}\"]`);\n";
+        code += "if (!__vite__style) {\n";
+        code += "  __vite__style = document.createElement('style');\n";
+        code += "  __vite__style.setAttribute('type', 'text/css');\n";
+        code += "  __vite__style.setAttribute('data-vite-dev-id', __vite__id);\n";
+        code += "  document.head.appendChild(__vite__style);\n";
+        code += "}\n";
+        code += "__vite__style.textContent = __vite__css;\n";
+        code += "export default __vite__css;\n";
+        return code;
+    }
+
+    // JSON is already a valid JS expression
+    inline std::string jsonToModule(const std::string& json) {
+        return "export default " + json + ";\n";
+    }
+}
@@ -0,0 +1,597 @@
+#pragma once
+
+#include "bundle_module.hpp"
+#include "interner.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <cctype>
+
+// Works out what of a module graph a bundle needs. Starting from the
+// entry, it follows which exports each module's live code uses: a module
+// is kept when it is loaded and either has side effects or has a used
+// export, and inside an ES module with a syntax tree only the top-level
+// statements that have side effects, or declare something live code
+// refers to, are kept. Usage only ever grows, so the analysis runs to a
+// fixed point over a worklist of modules.
+//
+// It errs on the side of keeping code: any identifier with a matching
+// name counts as a reference whatever scope it is in, calls count as side
+// effects unless annotated /*#__PURE__*/, and modules it cannot analyze
+// (CommonJS, unparsed, or calling eval) are kept whole with every import
+// they make.
+class TreeShaker {
+public:
+    // What the bundle keeps of one module
+    class ModuleUsage {
+    public:
+        bool included = false;
+        // Some importer needs the whole namespace, e.g. through require(),
+        // import() or a namespace import it passes around
+        bool allExports = false;
+        std::unordered_set<std::string> exports;
+        // Top-level bindings live code refers to; all of them when the
+        // module could not be analyzed
+        bool allBindings = true;
+        std::unordered_set<Atom> bindings;
+        // Source ranges of the top-level statements nothing needs
+        std::vector<std::pair<uint32_t, uint32_t>> removed;
+
+        // Usage of a module kept as it is, for bundles that are not shaken
+        static const ModuleUsage& whole() {
+            static const ModuleUsage usage = [] {
+                ModuleUsage all;
+                all.included = true;
+                all.allExports = true;
+                return all;
+            }();
+            return usage;
+        }
+
+        bool keepsExport(const std::string& name) const {
+            return allExports || exports.count(name) > 0;
+        }
+
+        bool keepsBinding(const std::string& local) const {
+            return allBindings || bindings.count(intern(local)) > 0;
+        }
+    };
+
+private:
+    // A use of a top-level name; `member` is set for `name.member`
+    struct Reference {
+        Atom name;
+        Atom member;
+    };
+
+    struct Statement {
+        uint32_t start = 0;
+        uint32_t end = 0;
+        bool pure = false;
+        std::vector<Atom> declares;
+        std::vector<Reference> references;
+    };
+
+    // What the analysis needs of one module, gathered once
+    struct Facts {
+        bool analyzed = false;
+        bool sideEffects = true;
+        std::vector<Statement> statements;
+        std::unordered_map<Atom, std::vector<size_t>> declaredBy;
+        ModuleBindings bindings;
+    };
+
+    const std::vector<BundleModule>& modules;
+    std::vector<Facts> facts;
+    std::vector<ModuleUsage> usages;
+    std::vector<char> loaded;
+    std::deque<int> worklist;
+    std::vector<char> queued;
+
+    // Whether a /*#__PURE__*/ or /* @__PURE__ */ comment directly precedes
+    // the expression starting at `at`
+    static bool annotatedPure(const std::string& source, uint32_t at) {
+        size_t p = at;
+        while (p > 0 && std::isspace(static_cast<unsigned char>(source[p - 1]))) {
+            --p;
+        }
+        if (p < 4 || source.compare(p - 2, 2, "*/") != 0) {
+            return false;
+        }
+        size_t open = source.rfind("/*", p - 2);
+        if (open == std::string::npos) {
+            return false;
+        }
+        std::string_view comment(source.data() + open, p - open);
+        size_t mark = comment.find("__PURE__");
+        return mark != std::string_view::npos && mark > 0 && (comment[mark - 1] == '#' || comment[mark - 1] == '@');
+    }
+
+    // Builtins that only build values: Symbol(), Symbol.for(),
+    // Object.freeze() and Object.create()
+    static bool knownPureCall(const Node* call) {
+        const Node* callee = call->a;
+        if (callee->kind == NodeKind::Identifier) {
+            return callee->name == "Symbol";
+        }
+        if (callee->kind != NodeKind::Member || callee->a->kind != NodeKind::Identifier) {
+            return false;
+        }
+        if (callee->a->name == "Symbol") {
+            return callee->name == "for";
+        }
+        return callee->a->name == "Object" && (callee->name == "freeze" || callee->name == "create");
+    }
+
+    static bool pureClass(const Node* node, const std::string& source) {
+        if (!pure(node->b, source)) {
+            return false;
+        }
+        for (const Node* member : node->list) {
+            if (member->kind == NodeKind::StaticBlock) {
+                return false;
+            }
+            if (member->has(Node::Computed) && !pure(member->a, source)) {
+                return false;
+            }
+            // Instance fields only run when the class is constructed
+            if (member->kind == NodeKind::Field && member->has(Node::Static) && !pure(member->b, source)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Whether evaluating the expression can have no visible effect
+    static bool pure(const Node* node, const std::string& source) {
+        if (!node) {
+            return true;
+        }
+        switch (node->kind) {
+            case NodeKind::Identifier:
+            case NodeKind::Number:
+            case NodeKind::String:
+            case NodeKind::Regex:
+            case NodeKind::This:
+            case NodeKind::Null:
+            case NodeKind::True:
+            case NodeKind::False:
+            case NodeKind::Hole:
+            case NodeKind::TemplateElement:
+            case NodeKind::MetaProperty:
+            case NodeKind::Function:
+            case NodeKind::FunctionExpr:
+            case NodeKind::Arrow:
+                return true;
+            case NodeKind::Class:
+            case NodeKind::ClassExpr:
+                return pureClass(node, source);
+            case NodeKind::Template:
+            case NodeKind::Sequence:
+            case NodeKind::Array:
+                for (const Node* item : node->list) {
+                    if (item->kind == NodeKind::Spread || !pure(item, source)) {
+                        return false;
+                    }
+                }
+                return true;
+            case NodeKind::Object:
+                for (const Node* item : node->list) {
+                    if (item->kind == NodeKind::Spread || (item->has(Node::Computed) && !pure(item->a, source)) ||
+                        (item->kind == NodeKind::Property && !pure(item->b, source))) {
+                        return false;
+                    }
+                }
+                return true;
+            case NodeKind::Unary:
+                return node->op != Op::Delete && pure(node->a, source);
+            case NodeKind::Binary:
+                return pure(node->a, source) && pure(node->b, source);
+            case NodeKind::Conditional:
+                return pure(node->a, source) && pure(node->b, source) && pure(node->c, source);
+            case NodeKind::Call:
+            case NodeKind::New:
+                if (!annotatedPure(source, node->start) && !knownPureCall(node)) {
+                    return false;
+                }
+                for (const Node* argument : node->list) {
+                    if (argument->kind == NodeKind::Spread || !pure(argument, source)) {
+                        return false;
+                    }
+                }
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Whether running the top-level statement can have no visible effect
+    // beyond declaring its names
+    static bool pureStatement(const Node* node, const std::string& source) {
+        switch (node->kind) {
+            case NodeKind::Empty:
+            case NodeKind::Function:
+                return true;
+            case NodeKind::Class:
+                return pureClass(node, source);
+            case NodeKind::VarDecl:
+                for (const Node* declarator : node->list) {
+                    // Destructuring may run getters or iterators
+                    if (declarator->a->kind != NodeKind::Identifier || !pure(declarator->b, source)) {
+                        return false;
+                    }
+                }
+                return true;
+            case NodeKind::ExportDecl:
+                return pureStatement(node->a, source);
+            case NodeKind::ExportDefault:
+                return node->a->kind == NodeKind::Function ? true
+                       : node->a->kind == NodeKind::Class  ? pureClass(node->a, source)
+                                                           : pure(node->a, source);
+            default:
+                return false;
+        }
+    }
+
+    static void bindingNames(const Node* target, std::vector<Atom>& names) {
+        if (!target) {
+            return;
+        }
+        switch (target->kind) {
+            case NodeKind::Identifier:
+                names.push_back(target->name);
+                break;
+            case NodeKind::Array:
+                for (const Node* element : target->list) {
+                    bindingNames(element, names);
+                }
+                break;
+            case NodeKind::Object:
+                for (const Node* property : target->list) {
+                    bindingNames(property->kind == NodeKind::Spread ? property->a : property->b, names);
+                }
+                break;
+            case NodeKind::Assign:
+            case NodeKind::Spread:
+                bindingNames(target->a, names);
+                break;
+            default:
+                break;
+        }
+    }
+
+    static void declaredNames(const Node* node, std::vector<Atom>& names) {
+        switch (node->kind) {
+            case NodeKind::Function:
+            case NodeKind::Class:
+                if (node->a) {
+                    names.push_back(node->a->name);
+                }
+                break;
+            case NodeKind::VarDecl:
+                for (const Node* declarator : node->list) {
+                    bindingNames(declarator->a, names);
+                }
+                break;
+            case NodeKind::ExportDecl:
+                declaredNames(node->a, names);
+                break;
+            case NodeKind::ExportDefault:
+                names.push_back(ModuleBindings::defaultLocal());
+                if (node->a->kind == NodeKind::Function || node->a->kind == NodeKind::Class) {
+                    declaredNames(node->a, names);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    static void references(const Node* node, std::vector<Reference>& out) {
+        if (!node) {
+            return;
+        }
+        switch (node->kind) {
+            case NodeKind::Identifier:
+                out.push_back(Reference{node->name, Atom()});
+                return;
+            case NodeKind::Member:
+                if (node->a->kind == NodeKind::Identifier) {
+                    out.push_back(Reference{node->a->name, node->name});
+                    return;
+                }
+                break;
+            case NodeKind::Property:
+            case NodeKind::Method:
+            case NodeKind::Field:
+                // Plain keys are names, not references
+                if (node->has(Node::Computed)) {
+                    references(node->a, out);
+                }
+                references(node->b, out);
+                return;
+            default:
+                break;
+        }
+        references(node->a, out);
+        references(node->b, out);
+        references(node->c, out);
+        references(node->d, out);
+        for (const Node* child : node->list) {
+            references(child, out);
+        }
+    }
+
+    void gather(int id) {
+        const BundleModule& module = modules[id];
+        Facts& f = facts[id];
+        if (module.empty || module.json) {
+            f.sideEffects = false;
+            return;
+        }
+        f.sideEffects = module.sideEffects;
+        if (!module.esm) {
+            return;
+        }
+        f.bindings = ModuleBindings(module.scan);
+        if (!module.ast) {
+            return;
+        }
+        bool ownEffects = false;
+        for (const Node* node : module.ast->program->list) {
+            if (node->kind == NodeKind::Import || node->kind == NodeKind::ExportNamed ||
+                node->kind == NodeKind::ExportAll) {
+                continue;
+            }
+            Statement statement;
+            statement.start = node->start;
+            statement.end = node->end;
+            statement.pure = pureStatement(node, module.source);
+            declaredNames(node, statement.declares);
+            references(node->kind == NodeKind::ExportDecl || node->kind == NodeKind::ExportDefault ? node->a : node,
+                       statement.references);
+            for (const auto& reference : statement.references) {
+                // Direct eval can reach any binding by name
+                if (reference.name == "eval" && reference.member.empty()) {
+                    f.statements.clear();
+                    f.declaredBy.clear();
+                    return;
+                }
+            }
+            ownEffects = ownEffects || !statement.pure;
+            for (Atom name : statement.declares) {
+                f.declaredBy[name].push_back(f.statements.size());
+            }
+            f.statements.push_back(std::move(statement));
+        }
+        f.analyzed = true;
+        // Imports are side effects too; those are added once every module
+        // is gathered
+        f.sideEffects = module.sideEffects && ownEffects;
+    }
+
+    // A module with no side effects of its own still has the effects of
+    // the modules it imports, unless its package vouches for it
+    void propagateSideEffects() {
+        for (bool changed = true; changed;) {
+            changed = false;
+            // Imports mostly have higher ids, so walk backwards
+            for (size_t i = modules.size(); i-- > 0;) {
+                Facts& f = facts[i];
+                if (f.sideEffects || !f.analyzed || !modules[i].sideEffects) {
+                    continue;
+                }
+                const BundleModule& module = modules[i];
+                for (size_t k = 0; k < module.scan.imports.size() && !f.sideEffects; ++k) {
+                    int target = module.importTargets[k];
+                    if (!module.scan.imports[k].dynamic && (target < 0 || facts[target].sideEffects)) {
+                        f.sideEffects = changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    void enqueue(int id) {
+        if (!queued[id]) {
+            queued[id] = 1;
+            worklist.push_back(id);
+        }
+    }
+
+    // `target` is loaded and, unless `name` is empty, needs that export;
+    // "*" asks for all of them
+    void demand(int target, const std::string& name) {
+        if (target < 0) {
+            return;
+        }
+        ModuleUsage& usage = usages[target];
+        bool changed = !loaded[target];
+        loaded[target] = 1;
+        if (name == "*") {
+            changed = changed || !usage.allExports;
+            usage.allExports = true;
+        } else if (!name.empty() && !usage.allExports) {
+            changed = usage.exports.insert(name).second || changed;
+        }
+        if (changed) {
+            enqueue(target);
+        }
+    }
+
+    // The import a binding refers to needs the export the reference reads
+    void demandBinding(int id, const ModuleBindings::Import& binding, Atom member) {
+        int target = modules[id].importTargets[binding.importIndex];
+        if (binding.imported == "*") {
+            demand(target, member.empty() ? "*" : member.str());
+        } else {
+            demand(target, binding.imported);
+        }
+    }
+
+    bool isIncluded(int id) const {
+        const ModuleUsage& usage = usages[id];
+        return loaded[id] && (facts[id].sideEffects || usage.allExports || !usage.exports.empty());
+    }
+
+    // Mark the statements live code needs, from those with side effects
+    // and those declaring used exports, and demand what they import
+    void markLive(int id, std::vector<char>& live) {
+        const Facts& f = facts[id];
+        ModuleUsage& usage = usages[id];
+        live.assign(f.statements.size(), 0);
+        std::vector<size_t> pending;
+        auto use = [&](Atom name, Atom member) {
+            auto imported = f.bindings.imports.find(name);
+            if (imported != f.bindings.imports.end()) {
+                usage.bindings.insert(name);
+                demandBinding(id, imported->second, member);
+                return;
+            }
+            auto declared = f.declaredBy.find(name);
+            if (declared == f.declaredBy.end() || !usage.bindings.insert(name).second) {
+                return;
+            }
+            for (size_t statement : declared->second) {
+                if (!live[statement]) {
+                    live[statement] = 1;
+                    pending.push_back(statement);
+                }
+            }
+        };
+        for (size_t i = 0; i < f.statements.size(); ++i) {
+            if (!f.statements[i].pure) {
+                live[i] = 1;
+                pending.push_back(i);
+            }
+        }
+        for (const auto& exported : f.bindings.exportLocals) {
+            if (usage.keepsExport(exported.first)) {
+                use(exported.second, Atom());
+            }
+        }
+        while (!pending.empty()) {
+            size_t statement = pending.back();
+            pending.pop_back();
+            for (const auto& reference : f.statements[statement].references) {
+                use(reference.name, reference.member);
+            }
+        }
+    }
+
+    void process(int id) {
+        const BundleModule& module = modules[id];
+        const Facts& f = facts[id];
+        ModuleUsage& usage = usages[id];
+        for (size_t i = 0; i < module.scan.imports.size(); ++i) {
+            demand(module.importTargets[i], module.scan.imports[i].dynamic ? "*" : "");
+        }
+        for (int target : module.requireTargets) {
+            demand(target, "*");
+        }
+        if (f.analyzed) {
+            std::vector<char> live;
+            markLive(id, live);
+        } else {
+            for (const auto& binding : f.bindings.imports) {
+                demandBinding(id, binding.second, Atom());
+            }
+        }
+        for (const auto& reexport : f.bindings.reexports) {
+            if (usage.keepsExport(reexport.exported)) {
+                demand(module.importTargets[reexport.importIndex], reexport.imported);
+            }
+        }
+        for (int star : f.bindings.stars) {
+            int target = module.importTargets[star];
+            if (usage.allExports) {
+                demand(target, "*");
+                continue;
+            }
+            // Names this module does not export itself may come from any
+            // of its `export *` modules
+            for (const auto& name : usage.exports) {
+                bool own = f.bindings.exportLocals.count(name) > 0 || name == "default";
+                for (const auto& reexport : f.bindings.reexports) {
+                    own = own || reexport.exported == name;
+                }
+                if (!own) {
+                    demand(target, name);
+                }
+            }
+        }
+    }
+
+public:
+    // Shake the graph whose entry is module 0. An exported entry needs
+    // all of its exports.
+    TreeShaker(const std::vector<BundleModule>& graph, bool exportEntry)
+        : TreeShaker(graph, std::vector<int>{0}, exportEntry) {}
+
+    // Shake a graph with several entries, such as the pages of an app
+    TreeShaker(const std::vector<BundleModule>& graph, const std::vector<int>& entries, bool exportEntries)
+        : modules(graph), facts(graph.size()), usages(graph.size()), loaded(graph.size(), 0),
+          queued(graph.size(), 0) {
+        if (modules.empty()) {
+            return;
+        }
+        for (size_t id = 0; id < modules.size(); ++id) {
+            gather(static_cast<int>(id));
+        }
+        propagateSideEffects();
+        // An entry runs whatever it contains
+        for (int entry : entries) {
+            facts[entry].sideEffects = true;
+            demand(entry, exportEntries ? "*" : "");
+        }
+        while (!worklist.empty()) {
+            int id = worklist.front();
+            worklist.pop_front();
+            queued[id] = 0;
+            if (isIncluded(id)) {
+                process(id);
+            }
+        }
+        for (size_t id = 0; id < modules.size(); ++id) {
+            ModuleUsage& usage = usages[id];
+            usage.included = isIncluded(static_cast<int>(id));
+            if (!usage.included) {
+                if (!modules[id].empty) {
+                    ++modulesRemoved;
+                    bytesRemoved += modules[id].source.size();
+                }
+                continue;
+            }
+            if (!facts[id].analyzed) {
+                continue;
+            }
+            usage.allBindings = false;
+            usage.bindings.clear();
+            std::vector<char> live;
+            markLive(static_cast<int>(id), live);
+            for (size_t i = 0; i < live.size(); ++i) {
+                const Statement& statement = facts[id].statements[i];
+                if (!live[i]) {
+                    usage.removed.emplace_back(statement.start, statement.end);
+                    ++statementsRemoved;
+                    bytesRemoved += statement.end - statement.start;
+                }
+            }
+        }
+    }
+
+    const ModuleUsage& usage(int id) const {
+        return usages[id];
+    }
+
+    // Scripts left out entirely, top-level statements dropped from the
+    // rest, and the source bytes both account for
+    size_t modulesRemoved = 0;
+    size_t statementsRemoved = 0;
+    size_t bytesRemoved = 0;
+};
@@ -0,0 +1,710 @@
+#pragma once
+
+#include "event_loop.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/io_uring.h>
+
+// Thin wrapper over the raw io_uring syscalls and shared rings, so the
+// backend needs no liburing at build or run time.
+class IoUring {
+private:
+    int ringFd = -1;
+    void* sqRing = MAP_FAILED;
+    void* cqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    size_t sqesSize = 0;
+
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    io_uring_sqe* sqes = reinterpret_cast<io_uring_sqe*>(MAP_FAILED);
+
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    unsigned localTail = 0;
+    unsigned submittedTail = 0;
+
+    static int enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+public:
+    IoUring() = default;
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    ~IoUring() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+        if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+        if (ringFd >= 0) close(ringFd);
+    }
+
+    // Returns false (with errno set) when io_uring is unavailable
+    bool init(unsigned entries) {
+        io_uring_params params{};
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ringFd < 0) {
+            return false;
+        }
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            return false;
+        }
+        cqRing = singleMmap ? sqRing
+            : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            return false;
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+
+        char* sq = static_cast<char*>(sqRing);
+        sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqEntries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+        // Identity-map the indirection array once so submission is a tail bump
+        unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        for (unsigned i = 0; i < sqEntries; ++i) {
+            array[i] = i;
+        }
+        localTail = submittedTail = *sqTail;
+
+        char* cq = static_cast<char*>(cqRing);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // Check that the kernel implements every opcode the server relies on
+    bool supports(const std::vector<int>& opcodes) const {
+        const unsigned count = 256;
+        std::vector<char> storage(sizeof(io_uring_probe) + count * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, count) < 0) {
+            return false;
+        }
+        for (int op : opcodes) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Next free submission entry, zeroed. Flushes the queue when it is full.
+    io_uring_sqe* nextSqe() {
+        unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+        if (localTail - head >= sqEntries) {
+            submit(0);
+            head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+            if (localTail - head >= sqEntries) {
+                return nullptr;
+            }
+        }
+        io_uring_sqe* sqe = &sqes[localTail & sqMask];
+        std::memset(sqe, 0, sizeof(*sqe));
+        ++localTail;
+        return sqe;
+    }
+
+    // Publish queued entries and optionally wait for completions. Every
+    // entry queued since the last call goes to the kernel in one syscall.
+    int submit(unsigned waitFor) {
+        __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+        unsigned toSubmit = localTail - submittedTail;
+        while (true) {
+            int rc = enter(ringFd, toSubmit, waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0);
+            if (rc >= 0) {
+                submittedTail += static_cast<unsigned>(rc);
+                return rc;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            // EBUSY/EAGAIN: the completion queue is full; the caller reaps first
+            return -errno;
+        }
+    }
+
+    template <typename F>
+    unsigned reap(F&& handle) {
+        unsigned head = *cqHead;
+        unsigned count = 0;
+        while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe cqe = cqes[head & cqMask];
+            ++head;
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+            handle(cqe);
+            ++count;
+        }
+        return count;
+    }
+};
+
+// Completion-based loop on io_uring. Accepts, receives, header sends and
+// file bodies (spliced file -> pipe -> socket as one linked pair) are queued
+// as submission entries and handed to the kernel in a single io_uring_enter
+// per loop iteration, so a busy loop makes one syscall per batch instead of
+// several per request.
+class UringLoop : public EventLoop {
+private:
+    static constexpr unsigned RING_ENTRIES = 4096;
+    static constexpr size_t RECV_BUFFER_BYTES = 16 * 1024;
+    static constexpr int PIPE_BYTES = 256 * 1024;
+    static constexpr auto IDLE_TIMEOUT = std::chrono::seconds(5);
+
+    // Completion tags. Connection ops carry the connection pointer with the
+    // tag in its low bits; loop-level ops use small constants below 4096,
+    // which no heap pointer can collide with.
+    enum Tag : uint64_t {
+        TAG_RECV = 1, TAG_SEND = 2, TAG_SPLICE_IN = 3, TAG_SPLICE_OUT = 4,
+        OP_ACCEPT = 8, OP_WAKE = 16, OP_SIGNAL = 24, OP_TIMER = 32, OP_CANCEL = 40, OP_DEADLINE = 48
+    };
+
+    struct Connection {
+        HttpConnection http;
+        std::unique_ptr<char[]> recvBuffer;
+        int pipeRead = -1;
+        int pipeWrite = -1;
+        size_t pipeCapacity = 0;
+        size_t pipeBytes = 0;
+        size_t index = 0;
+        int inflight = 0;
+        bool receiving = false;
+        bool sending = false;
+        bool closing = false;
+
+        explicit Connection(int fd) : http(fd) {}
+    };
+
+    IoUring ring;
+    int listenFd;
+    int wakeFd = -1;
+    int signalFd = -1;
+    int spareFd = -1;
+    RequestHandler handler;
+    std::vector<std::unique_ptr<Connection>> connections;
+    int loopOps = 0;
+    bool running = false;
+    uint64_t wakeValue = 0;
+    signalfd_siginfo signalInfo{};
+    __kernel_timespec tick{1, 0};
+    __kernel_timespec deadline{2, 0};
+    std::time_t dateSecond = 0;
+    std::string date;
+
+    void wake() override {
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+
+    io_uring_sqe* sqe() {
+        io_uring_sqe* entry = ring.nextSqe();
+        if (!entry) {
+            throw std::runtime_error("io_uring submission queue overflow");
+        }
+        return entry;
+    }
+
+    static uint64_t tagged(Connection* conn, Tag tag) {
+        return reinterpret_cast<uint64_t>(conn) | tag;
+    }
+
+    void refreshDate() {
+        std::time_t now = std::time(nullptr);
+        if (now != dateSecond) {
+            dateSecond = now;
+            date = Http::formatDate(now);
+        }
+    }
+
+    void armAccept() {
+        io_uring_sqe* e = sqe();
+        e->opcode = IORING_OP_ACCEPT;
+        e->fd = listenFd;
+        e->accept_flags = SOCK_CLOEXEC;
+        e->user_data = OP_ACCEPT;
+        ++loopOps;
+    }
+
+    void armRead(int fd, void* buf, unsigned len, Tag tag) {
+        io_uring_sqe* e = sqe();
+        e->opcode = IORING_OP_READ;
+        e->fd = fd;
+        e->addr = reinterpret_cast<uint64_t>(buf);
+        e->len = len;
+        e->user_data = tag;
+        ++loopOps;
+    }
+
+    void armTimer(__kernel_timespec* ts, Tag tag) {
+        io_uring_sqe* e = sqe();
+        e->opcode = IORING_OP_TIMEOUT;
+        e->fd = -1;
+        e->addr = reinterpret_cast<uint64_t>(ts);
+        e->len = 1;
+        e->user_data = tag;
+        ++loopOps;
+    }
+
+    void cancel(uint64_t target) {
+        io_uring_sqe* e = sqe();
+        e->opcode = target == OP_TIMER ? IORING_OP_TIMEOUT_REMOVE : IORING_OP_ASYNC_CANCEL;
+        e->fd = -1;
+        e->addr = target;
+        e->user_data = OP_CANCEL;
+        ++loopOps;
+    }
+
+    void armRecv(Connection* conn) {
+        if (conn->receiving || conn->closing || conn->http.peerClosed) {
+            return;
+        }
+        if (!conn->recvBuffer) {
+            conn->recvBuffer.reset(new char[RECV_BUFFER_BYTES]);
+        }
+        io_uring_sqe* e = sqe();
+        e->opcode = IORING_OP_RECV;
+        e->fd = conn->http.fd;
+        e->addr = reinterpret_cast<uint64_t>(conn->recvBuffer.get());
+        e->len = RECV_BUFFER_BYTES;
+        e->user_data = tagged(conn, TAG_RECV);
+        conn->receiving = true;
+        ++conn->inflight;
+    }
+
+    bool ensurePipe(Connection* conn) {
+        if (conn->pipeRead >= 0) {
+            return true;
+        }
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC) != 0) {
+            return false;
+        }
+        conn->pipeRead = fds[0];
+        conn->pipeWrite = fds[1];
+        int size = fcntl(fds[1], F_SETPIPE_SZ, PIPE_BYTES);
+        conn->pipeCapacity = static_cast<size_t>(size > 0 ? size : fcntl(fds[1], F_GETPIPE_SZ));
+        return true;
+    }
+
+    void spliceOut(Connection* conn, size_t len) {
+        io_uring_sqe* e = sqe();
+        e->opcode = IORING_OP_SPLICE;
+        e->fd = conn->http.fd;
+        e->off = static_cast<uint64_t>(-1);
+        e->splice_fd_in = conn->pipeRead;
+        e->splice_off_in = static_cast<uint64_t>(-1);
+        e->len = static_cast<uint32_t>(len);
+        e->splice_flags = SPLICE_F_MOVE;
+        e->user_data = tagged(conn, TAG_SPLICE_OUT);
+        ++conn->inflight;
+    }
+
+    // Start writing the next queued output chunk, if nothing is in flight
+    void pumpOutput(Connection* conn) {
+        if (conn->sending || conn->closing) {
+            return;
+        }
+        auto& output = conn->http.output;
+        if (output.empty()) {
+            if (conn->http.closeAfterFlush || (conn->http.peerClosed && conn->http.input.empty())) {
+                beginClose(conn);
+            }
+            return;
+        }
+
+        OutputChunk& chunk = output.front();
+        if (!chunk.file) {
+            int flags = MSG_NOSIGNAL;
+            if (output.size() > 1 && output[1].file) {
+                flags |= MSG_MORE;
+            }
+            io_uring_sqe* e = sqe();
+            e->opcode = IORING_OP_SEND;
+            e->fd = conn->http.fd;
+            e->addr = reinterpret_cast<uint64_t>(chunk.data.data() + chunk.offset);
+            e->len = static_cast<uint32_t>(chunk.data.size() - static_cast<size_t>(chunk.offset));
+            e->msg_flags = static_cast<uint32_t>(flags);
+            e->user_data = tagged(conn, TAG_SEND);
+            ++conn->inflight;
+            chunk.sealed = true;
+        } else {
+            if (!ensurePipe(conn)) {
+                beginClose(conn);
+                return;
+            }
+            if (conn->pipeBytes == 0) {
+                size_t len = std::min(static_cast<size_t>(chunk.end - chunk.offset), conn->pipeCapacity);
+                io_uring_sqe* e = sqe();
+                e->opcode = IORING_OP_SPLICE;
+                e->fd = conn->pipeWrite;
+                e->off = static_cast<uint64_t>(-1);
+                e->splice_fd_in = chunk.file->fd;
+                e->splice_off_in = static_cast<uint64_t>(chunk.offset);
+                e->len = static_cast<uint32_t>(len);
+                e->splice_flags = SPLICE_F_MOVE;
+                e->flags = IOSQE_IO_LINK;
+                e->user_data = tagged(conn, TAG_SPLICE_IN);
+                ++conn->inflight;
+                spliceOut(conn, len);
+            } else {
+                spliceOut(conn, conn->pipeBytes);
+            }
+        }
+        conn->sending = true;
+    }
+
+    // Mark the connection for teardown. The memory is only released by
+    // releaseIfIdle() once no submitted op still references its buffers.
+    void beginClose(Connection* conn) {
+        if (conn->closing) {
+            return;
+        }
+        conn->closing = true;
+        // Wakes any receive or send still parked in the kernel
+        shutdown(conn->http.fd, SHUT_RDWR);
+    }
+
+    void releaseIfIdle(Connection* conn) {
+        if (!conn->closing || conn->inflight > 0) {
+            return;
+        }
+        close(conn->http.fd);
+        if (conn->pipeRead >= 0) close(conn->pipeRead);
+        if (conn->pipeWrite >= 0) close(conn->pipeWrite);
+        size_t index = conn->index;
+        if (index + 1 != connections.size()) {
+            connections[index] = std::move(connections.back());
+            connections[index]->index = index;
+        }
+        connections.pop_back();
+    }
+
+    void serviceInput(Connection* conn) {
+        conn->http.processInput(handler, date);
+        pumpOutput(conn);
+    }
+
+    void onAccept(int res) {
+        --loopOps;
+        if (res >= 0) {
+            if (!running) {
+                close(res);
+                return;
+            }
+            int one = 1;
+            setsockopt(res, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            auto conn = std::make_unique<Connection>(res);
+            conn->index = connections.size();
+            Connection* raw = conn.get();
+            connections.push_back(std::move(conn));
+            armRecv(raw);
+        } else if (res == -EMFILE || res == -ENFILE) {
+            // Same reserve-descriptor trick as the epoll loop
+            close(spareFd);
+            int dropped = accept(listenFd, nullptr, nullptr);
+            if (dropped >= 0) {
+                close(dropped);
+            }
+            spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        }
+        if (running) {
+            armAccept();
+        }
+    }
+
+    void onConnection(Connection* conn, Tag tag, int res) {
+        --conn->inflight;
+        switch (tag) {
+            case TAG_RECV:
+                conn->receiving = false;
+                if (conn->closing) {
+                    break;
+                }
+                conn->http.lastActive = std::chrono::steady_clock::now();
+                if (res > 0) {
+                    conn->http.input.append(conn->recvBuffer.get(), static_cast<size_t>(res));
+                    if (conn->http.input.size() > HttpConnection::MAX_INPUT_BYTES) {
+                        beginClose(conn);
+                        break;
+                    }
+                    serviceInput(conn);
+                    armRecv(conn);
+                } else if (res == 0) {
+                    conn->http.peerClosed = true;
+                    serviceInput(conn);
+                    if (!conn->sending && conn->http.output.empty()) {
+                        beginClose(conn);
+                    }
+                } else if (res == -EINTR || res == -EAGAIN) {
+                    armRecv(conn);
+                } else {
+                    beginClose(conn);
+                }
+                break;
+
+            case TAG_SEND:
+                conn->sending = false;
+                if (conn->closing) {
+                    break;
+                }
+                if (res <= 0) {
+                    beginClose(conn);
+                    break;
+                }
+                {
+                    OutputChunk& chunk = conn->http.output.front();
+                    chunk.offset += res;
+                    conn->http.consumedBuffered(static_cast<size_t>(res));
+                    if (chunk.done()) {
+                        conn->http.output.pop_front();
+                    }
+                }
+                // Flushing may have freed room for requests held back earlier
+                serviceInput(conn);
+                break;
+
+            case TAG_SPLICE_IN:
+                if (conn->closing) {
+                    break;
+                }
+                if (res > 0) {
+                    conn->http.output.front().offset += res;
+                    conn->pipeBytes += static_cast<size_t>(res);
+                } else {
+                    // res == 0 means the file shrank below its promised length
+                    beginClose(conn);
+                }
+                break;
+
+            case TAG_SPLICE_OUT:
+                conn->sending = false;
+                if (conn->closing) {
+                    break;
+                }
+                if (res > 0) {
+                    conn->pipeBytes -= static_cast<size_t>(res);
+                    if (conn->pipeBytes == 0 && conn->http.output.front().done()) {
+                        conn->http.output.pop_front();
+                        serviceInput(conn);
+                        break;
+                    }
+                } else if (res != -ECANCELED) {
+                    // -ECANCELED only means a short splice-in broke the link;
+                    // whatever did reach the pipe is sent on the next pump
+                    beginClose(conn);
+                    break;
+                }
+                pumpOutput(conn);
+                break;
+
+            default:
+                break;
+        }
+        releaseIfIdle(conn);
+    }
+
+    void closeIdleConnections() {
+        auto now = std::chrono::steady_clock::now();
+        // Walk backwards: releasing swaps the last connection into the hole,
+        // and that one has already been visited
+        for (size_t i = connections.size(); i-- > 0;) {
+            Connection* conn = connections[i].get();
+            if (!conn->http.websocket && !conn->sending && conn->http.output.empty() &&
+                now - conn->http.lastActive > IDLE_TIMEOUT) {
+                beginClose(conn);
+                releaseIfIdle(conn);
+            }
+        }
+    }
+
+    void deliverBroadcasts() {
+        std::vector<std::string> frames = takeBroadcasts();
+        for (size_t i = connections.size(); i-- > 0;) {
+            Connection* conn = connections[i].get();
+            if (!conn->http.websocket || conn->closing) {
+                continue;
+            }
+            for (const auto& frame : frames) {
+                conn->http.sendFrame(frame);
+            }
+            pumpOutput(conn);
+            releaseIfIdle(conn);
+        }
+    }
+
+    void dispatch(const io_uring_cqe& cqe) {
+        uint64_t data = cqe.user_data;
+        if (data >= 4096) {
+            onConnection(reinterpret_cast<Connection*>(data & ~uint64_t(7)), static_cast<Tag>(data & 7), cqe.res);
+            return;
+        }
+        switch (data) {
+            case OP_ACCEPT:
+                onAccept(cqe.res);
+                break;
+            case OP_WAKE:
+                --loopOps;
+                if (stopRequested) {
+                    running = false;
+                    break;
+                }
+                deliverBroadcasts();
+                // Cleared so drain() can tell a re-armed wake from a stop
+                wakeValue = 0;
+                armRead(wakeFd, &wakeValue, sizeof(wakeValue), OP_WAKE);
+                break;
+            case OP_SIGNAL:
+                --loopOps;
+                running = false;
+                break;
+            case OP_TIMER:
+                --loopOps;
+                if (running) {
+                    closeIdleConnections();
+                    armTimer(&tick, OP_TIMER);
+                }
+                break;
+            default:
+                --loopOps;
+                break;
+        }
+    }
+
+    // Wait for completions, reaping whatever is ready when the completion
+    // queue is too full to accept more submissions.
+    void submitAndWait() {
+        int rc = ring.submit(1);
+        if (rc == -EBUSY || rc == -EAGAIN) {
+            return;
+        }
+        if (rc < 0) {
+            throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(-rc));
+        }
+    }
+
+    // Cancel loop-level ops and close every connection, then reap until the
+    // kernel no longer references any of our buffers.
+    void drain() {
+        cancel(OP_ACCEPT);
+        cancel(OP_TIMER);
+        cancel(wakeValue ? static_cast<uint64_t>(OP_SIGNAL) : static_cast<uint64_t>(OP_WAKE));
+        for (size_t i = connections.size(); i-- > 0;) {
+            beginClose(connections[i].get());
+            releaseIfIdle(connections[i].get());
+        }
+        armTimer(&deadline, OP_DEADLINE);
+        bool expired = false;
+        while (!expired && (loopOps > 1 || !connections.empty())) {
+            submitAndWait();
+            ring.reap([&](const io_uring_cqe& cqe) {
+                if (cqe.user_data == OP_DEADLINE) {
+                    expired = true;
+                }
+                dispatch(cqe);
+            });
+        }
+    }
+
+public:
+    // Probe whether this kernel can run the backend at all
+    static bool supported(std::string& reason) {
+        IoUring probe;
+        if (!probe.init(8)) {
+            reason = std::string("io_uring_setup failed: ") + std::strerror(errno);
+            return false;
+        }
+        if (!probe.supports({IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_SPLICE,
+                             IORING_OP_READ, IORING_OP_TIMEOUT, IORING_OP_ASYNC_CANCEL})) {
+            reason = "kernel lacks required io_uring opcodes";
+            return false;
+        }
+        return true;
+    }
+
+    UringLoop(int listenSocket, RequestHandler h) : listenFd(listenSocket), handler(std::move(h)) {
+        if (!ring.init(RING_ENTRIES)) {
+            throw std::runtime_error(std::string("io_uring_setup failed: ") + std::strerror(errno));
+        }
+        wakeFd = eventfd(0, EFD_CLOEXEC);
+        spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (wakeFd < 0) {
+            throw std::runtime_error(std::string("Failed to create event loop: ") + std::strerror(errno));
+        }
+    }
+
+    ~UringLoop() override {
+        for (auto& conn : connections) {
+            close(conn->http.fd);
+            if (conn->pipeRead >= 0) close(conn->pipeRead);
+            if (conn->pipeWrite >= 0) close(conn->pipeWrite);
+        }
+        if (spareFd >= 0) close(spareFd);
+        if (wakeFd >= 0) close(wakeFd);
+    }
+
+    UringLoop(const UringLoop&) = delete;
+    UringLoop& operator=(const UringLoop&) = delete;
+
+    void watchSignals(int fd) override {
+        signalFd = fd;
+    }
+
+    void run() override {
+        running = true;
+        armAccept();
+        armRead(wakeFd, &wakeValue, sizeof(wakeValue), OP_WAKE);
+        if (signalFd >= 0) {
+            armRead(signalFd, &signalInfo, sizeof(signalInfo), OP_SIGNAL);
+        }
+        armTimer(&tick, OP_TIMER);
+
+        while (running) {
+            submitAndWait();
+            refreshDate();
+            ring.reap([this](const io_uring_cqe& cqe) { dispatch(cqe); });
+        }
+        drain();
+    }
+};
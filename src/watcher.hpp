@@ -0,0 +1,394 @@
+#pragma once
+
+#include "logger.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <iterator>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <fnmatch.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+
+namespace fs = std::filesystem;
+
+class FileChange {
+public:
+    enum class Kind { Created, Modified, Deleted };
+
+    std::string path;
+    Kind kind;
+};
+
+// Recursive inotify watcher over a project tree. Events are coalesced per
+// path and delivered as one batch once the tree has been quiet for the
+// debounce window, so a `git checkout` touching thousands of files produces a
+// single callback instead of thousands. Directories beyond the inotify watch
+// limit are polled instead of being silently ignored. When the kernel's
+// event queue overflows, the tree is walked again and the batch reports the
+// root itself as modified, meaning anything may have changed.
+class FileWatcher {
+public:
+    using BatchCallback = std::function<void(const std::vector<FileChange>&)>;
+
+private:
+    static constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE |
+                                           IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR;
+    static constexpr auto MAX_BATCH_DELAY = std::chrono::milliseconds(1000);
+    static constexpr auto POLL_INTERVAL = std::chrono::milliseconds(2000);
+
+    fs::path root;
+    std::vector<std::string> ignorePatterns;
+    std::chrono::milliseconds debounce;
+    int inotifyFd = -1;
+    int wakeFd = -1;
+    std::unordered_map<int, fs::path> watches;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    BatchCallback callback;
+
+    std::map<std::string, FileChange::Kind> pending;
+    std::chrono::steady_clock::time_point firstPending;
+    std::chrono::steady_clock::time_point lastEvent;
+
+    // Directories we could not get a watch for, with the mtimes of their
+    // entries at the last scan
+    std::map<fs::path, std::map<std::string, fs::file_time_type>> polled;
+    std::chrono::steady_clock::time_point lastPoll;
+    bool limitReported = false;
+
+    void record(const fs::path& path, FileChange::Kind kind) {
+        if (pending.empty()) {
+            firstPending = std::chrono::steady_clock::now();
+        }
+        lastEvent = std::chrono::steady_clock::now();
+
+        auto it = pending.find(path.string());
+        if (it == pending.end()) {
+            pending.emplace(path.string(), kind);
+            return;
+        }
+        // Fold the burst into its net effect
+        FileChange::Kind previous = it->second;
+        if (previous == FileChange::Kind::Created && kind == FileChange::Kind::Deleted) {
+            pending.erase(it);
+        } else if (previous == FileChange::Kind::Deleted && kind == FileChange::Kind::Created) {
+            it->second = FileChange::Kind::Modified;
+        } else if (previous != FileChange::Kind::Created) {
+            it->second = kind;
+        }
+    }
+
+    static std::map<std::string, fs::file_time_type> snapshot(const fs::path& dir) {
+        std::map<std::string, fs::file_time_type> entries;
+        std::error_code ec;
+        for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file(ec)) {
+                entries[it->path().filename().string()] = it->last_write_time(ec);
+            }
+        }
+        return entries;
+    }
+
+    void watchDirectory(const fs::path& dir) {
+        int wd = inotify_add_watch(inotifyFd, dir.c_str(), WATCH_MASK);
+        if (wd >= 0) {
+            watches[wd] = dir;
+            return;
+        }
+        if (errno == ENOSPC) {
+            if (!limitReported) {
+                Logger::warning("inotify watch limit reached; polling the remaining directories. "
+                                "Raise fs.inotify.max_user_watches for instant updates.");
+                limitReported = true;
+            }
+            polled[dir] = snapshot(dir);
+        }
+    }
+
+    // Watch `dir` and everything below it. With `reportFiles`, files found
+    // along the way are reported as created: they may have appeared before
+    // the new directory's watch was in place.
+    void addTree(const fs::path& dir, bool reportFiles) {
+        if (isIgnored(dir)) {
+            return;
+        }
+        watchDirectory(dir);
+
+        std::error_code ec;
+        fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec);
+        for (fs::recursive_directory_iterator end; !ec && it != end; it.increment(ec)) {
+            if (isIgnored(it->path())) {
+                if (it->is_directory(ec)) {
+                    it.disable_recursion_pending();
+                }
+                continue;
+            }
+            if (it->is_directory(ec) && !it->is_symlink(ec)) {
+                watchDirectory(it->path());
+            } else if (reportFiles && it->is_regular_file(ec)) {
+                record(it->path(), FileChange::Kind::Created);
+            }
+        }
+    }
+
+    // Stop watching `dir` and everything below it, once it was moved away
+    // or deleted
+    void unwatchTree(const fs::path& dir) {
+        const std::string& prefix = dir.native();
+        auto below = [&](const fs::path& path) {
+            const std::string& p = path.native();
+            return p.compare(0, prefix.size(), prefix) == 0 && (p.size() == prefix.size() || p[prefix.size()] == '/');
+        };
+        for (auto it = watches.begin(); it != watches.end();) {
+            if (below(it->second)) {
+                inotify_rm_watch(inotifyFd, it->first);
+                it = watches.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (auto it = polled.begin(); it != polled.end();) {
+            it = below(it->first) ? polled.erase(it) : std::next(it);
+        }
+    }
+
+    void readEvents() {
+        alignas(inotify_event) char buf[64 * 1024];
+        while (true) {
+            ssize_t n = read(inotifyFd, buf, sizeof(buf));
+            if (n <= 0) {
+                return;
+            }
+            for (char* p = buf; p < buf + n;) {
+                auto* ev = reinterpret_cast<inotify_event*>(p);
+                p += sizeof(inotify_event) + ev->len;
+                handleEvent(*ev);
+            }
+        }
+    }
+
+    void handleEvent(const inotify_event& ev) {
+        if (ev.mask & IN_Q_OVERFLOW) {
+            // Events were dropped: forget directories that are gone, walk the
+            // tree again to watch the ones that appeared, and report the root
+            // so consumers rescan
+            for (auto it = watches.begin(); it != watches.end();) {
+                std::error_code ec;
+                if (!fs::is_directory(it->second, ec)) {
+                    inotify_rm_watch(inotifyFd, it->first);
+                    it = watches.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            addTree(root, true);
+            record(root, FileChange::Kind::Modified);
+            return;
+        }
+        if (ev.mask & IN_IGNORED) {
+            watches.erase(ev.wd);
+            return;
+        }
+        auto it = watches.find(ev.wd);
+        if (it == watches.end()) {
+            return;
+        }
+        if (ev.mask & IN_DELETE_SELF) {
+            fs::path dir = it->second;
+            unwatchTree(dir);
+            record(dir, FileChange::Kind::Deleted);
+            return;
+        }
+        if (ev.len == 0) {
+            return;
+        }
+
+        fs::path path = it->second / ev.name;
+        if (isIgnored(path)) {
+            return;
+        }
+        if (ev.mask & IN_ISDIR) {
+            if (ev.mask & (IN_CREATE | IN_MOVED_TO)) {
+                addTree(path, true);
+            } else if (ev.mask & IN_MOVED_FROM) {
+                // Its watches would go on reporting under the old path
+                unwatchTree(path);
+                record(path, FileChange::Kind::Deleted);
+            }
+            return;
+        }
+        if (ev.mask & (IN_CREATE | IN_MOVED_TO)) {
+            record(path, FileChange::Kind::Created);
+        } else if (ev.mask & (IN_DELETE | IN_MOVED_FROM)) {
+            record(path, FileChange::Kind::Deleted);
+        } else if (ev.mask & (IN_MODIFY | IN_CLOSE_WRITE)) {
+            record(path, FileChange::Kind::Modified);
+        }
+    }
+
+    void pollUnwatched() {
+        for (auto& dir : polled) {
+            auto current = snapshot(dir.first);
+            for (const auto& entry : current) {
+                auto old = dir.second.find(entry.first);
+                if (old == dir.second.end()) {
+                    record(dir.first / entry.first, FileChange::Kind::Created);
+                } else if (old->second != entry.second) {
+                    record(dir.first / entry.first, FileChange::Kind::Modified);
+                }
+            }
+            for (const auto& entry : dir.second) {
+                if (!current.count(entry.first)) {
+                    record(dir.first / entry.first, FileChange::Kind::Deleted);
+                }
+            }
+            dir.second = std::move(current);
+        }
+    }
+
+    void flush() {
+        std::vector<FileChange> batch;
+        batch.reserve(pending.size());
+        for (const auto& change : pending) {
+            batch.push_back(FileChange{change.first, change.second});
+        }
+        pending.clear();
+        if (callback && !batch.empty()) {
+            callback(batch);
+        }
+    }
+
+    void loop() {
+        pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+        lastPoll = std::chrono::steady_clock::now();
+
+        while (running) {
+            auto now = std::chrono::steady_clock::now();
+            auto timeout = std::chrono::milliseconds(-1);
+            if (!pending.empty()) {
+                auto quietAt = lastEvent + debounce;
+                auto latestAt = firstPending + MAX_BATCH_DELAY;
+                timeout = std::chrono::duration_cast<std::chrono::milliseconds>(std::min(quietAt, latestAt) - now);
+                timeout = std::max(timeout, std::chrono::milliseconds(0));
+            }
+            if (!polled.empty()) {
+                auto untilPoll = std::chrono::duration_cast<std::chrono::milliseconds>(lastPoll + POLL_INTERVAL - now);
+                untilPoll = std::max(untilPoll, std::chrono::milliseconds(0));
+                timeout = timeout.count() < 0 ? untilPoll : std::min(timeout, untilPoll);
+            }
+
+            int rc = poll(fds, 2, static_cast<int>(timeout.count()));
+            if (rc < 0 && errno != EINTR) {
+                Logger::error(std::string("File watcher stopped: ") + std::strerror(errno));
+                return;
+            }
+            if (fds[1].revents & POLLIN) {
+                return;
+            }
+            if (fds[0].revents & POLLIN) {
+                readEvents();
+            }
+
+            now = std::chrono::steady_clock::now();
+            if (!polled.empty() && now - lastPoll >= POLL_INTERVAL) {
+                pollUnwatched();
+                lastPoll = now;
+            }
+            if (!pending.empty() && (now - lastEvent >= debounce || now - firstPending >= MAX_BATCH_DELAY)) {
+                flush();
+            }
+        }
+    }
+
+public:
+    FileWatcher(const fs::path& rootDir,
+                std::vector<std::string> ignore = {".git", "node_modules", "dist"},
+                std::chrono::milliseconds debounceWindow = std::chrono::milliseconds(50))
+        : root(fs::absolute(rootDir).lexically_normal()), ignorePatterns(std::move(ignore)), debounce(debounceWindow) {}
+
+    ~FileWatcher() {
+        stop();
+    }
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Patterns without a slash match any single path segment (e.g.
+    // "node_modules", "*.log"); patterns with one match the whole path
+    // relative to the root (e.g. "src/generated/*").
+    bool isIgnored(const fs::path& path) const {
+        fs::path rel = path.lexically_relative(root);
+        std::string relStr = rel.generic_string();
+        for (const auto& pattern : ignorePatterns) {
+            if (pattern.find('/') != std::string::npos) {
+                if (fnmatch(pattern.c_str(), relStr.c_str(), 0) == 0) {
+                    return true;
+                }
+                continue;
+            }
+            for (const auto& segment : rel) {
+                if (fnmatch(pattern.c_str(), segment.c_str(), 0) == 0) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    size_t watchedDirectories() const {
+        return watches.size();
+    }
+
+    size_t polledDirectories() const {
+        return polled.size();
+    }
+
+    // Watch the tree and deliver change batches on a background thread.
+    // Returns false when inotify is unavailable.
+    bool start(BatchCallback onBatch) {
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (inotifyFd < 0 || wakeFd < 0) {
+            Logger::warning(std::string("File watching disabled: ") + std::strerror(errno));
+            return false;
+        }
+        callback = std::move(onBatch);
+        addTree(root, false);
+        running = true;
+        thread = std::thread([this]() {
+            // Leave SIGINT/SIGTERM to the server's signalfd; delivered here
+            // they would kill the process before it can shut down cleanly
+            sigset_t all;
+            sigfillset(&all);
+            pthread_sigmask(SIG_BLOCK, &all, nullptr);
+            loop();
+        });
+        return true;
+    }
+
+    void stop() {
+        if (running.exchange(false)) {
+            uint64_t one = 1;
+            ssize_t ignored = write(wakeFd, &one, sizeof(one));
+            (void)ignored;
+            thread.join();
+        }
+        if (inotifyFd >= 0) close(inotifyFd);
+        if (wakeFd >= 0) close(wakeFd);
+        inotifyFd = wakeFd = -1;
+    }
+};
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "http.hpp"
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+// RFC 6455 pieces needed by the dev server: the opening handshake and
+// framing. Server frames are never masked; client frames always are.
+namespace WebSocket {
+    enum Opcode : uint8_t {
+        CONTINUATION = 0x0, TEXT = 0x1, BINARY = 0x2, CLOSE = 0x8, PING = 0x9, PONG = 0xA
+    };
+
+    constexpr size_t MAX_PAYLOAD_BYTES = 1024 * 1024;
+
+    inline std::string sha1(const std::string& input) {
+        uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+        std::string msg = input;
+        uint64_t bitLen = static_cast<uint64_t>(input.size()) * 8;
+        msg += static_cast<char>(0x80);
+        while (msg.size() % 64 != 56) {
+            msg += static_cast<char>(0);
+        }
+        for (int i = 7; i >= 0; --i) {
+            msg += static_cast<char>((bitLen >> (i * 8)) & 0xff);
+        }
+
+        auto rotl = [](uint32_t v, int n) { return (v << n) | (v >> (32 - n)); };
+        for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
+            uint32_t w[80];
+            for (int i = 0; i < 16; ++i) {
+                const auto* p = reinterpret_cast<const unsigned char*>(msg.data() + chunk + i * 4);
+                w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+            }
+            for (int i = 16; i < 80; ++i) {
+                w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            }
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; ++i) {
+                uint32_t f, k;
+                if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+                else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+                else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+                else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+                uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+                e = d; d = c; c = rotl(b, 30); b = a; a = temp;
+            }
+            h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+        }
+
+        std::string digest(20, '\0');
+        for (int i = 0; i < 5; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                digest[i * 4 + j] = static_cast<char>((h[i] >> (24 - j * 8)) & 0xff);
+            }
+        }
+        return digest;
+    }
+
+    inline std::string base64(const std::string& data) {
+        static const char* table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string out;
+        size_t i = 0;
+        for (; i + 2 < data.size(); i += 3) {
+            uint32_t n = (uint32_t(static_cast<unsigned char>(data[i])) << 16) |
+                         (uint32_t(static_cast<unsigned char>(data[i + 1])) << 8) |
+                         uint32_t(static_cast<unsigned char>(data[i + 2]));
+            out += table[(n >> 18) & 63];
+            out += table[(n >> 12) & 63];
+            out += table[(n >> 6) & 63];
+            out += table[n & 63];
+        }
+        if (i < data.size()) {
+            uint32_t n = uint32_t(static_cast<unsigned char>(data[i])) << 16;
+            if (i + 1 < data.size()) {
+                n |= uint32_t(static_cast<unsigned char>(data[i + 1])) << 8;
+            }
+            out += table[(n >> 18) & 63];
+            out += table[(n >> 12) & 63];
+            out += i + 1 < data.size() ? table[(n >> 6) & 63] : '=';
+            out += '=';
+        }
+        return out;
+    }
+
+    inline bool isUpgradeRequest(const HttpRequest& req) {
+        std::string connection = req.header("Connection");
+        for (auto& c : connection) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return req.method == "GET" && Http::iequals(req.header("Upgrade"), "websocket") &&
+               connection.find("upgrade") != std::string::npos && !req.header("Sec-WebSocket-Key").empty();
+    }
+
+    // Fill in the 101 response completing the handshake
+    inline void acceptUpgrade(const HttpRequest& req, HttpResponse& res, const std::string& protocol = "") {
+        static const std::string GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        res.status = 101;
+        res.upgrade = true;
+        res.setHeader("Upgrade", "websocket");
+        res.setHeader("Connection", "Upgrade");
+        res.setHeader("Sec-WebSocket-Accept", base64(sha1(req.header("Sec-WebSocket-Key") + GUID)));
+        if (!protocol.empty()) {
+            res.setHeader("Sec-WebSocket-Protocol", protocol);
+        }
+    }
+
+    inline std::string encodeFrame(const std::string& payload, Opcode opcode = TEXT) {
+        std::string frame;
+        frame.reserve(payload.size() + 10);
+        frame += static_cast<char>(0x80 | opcode);
+        if (payload.size() < 126) {
+            frame += static_cast<char>(payload.size());
+        } else if (payload.size() <= 0xffff) {
+            frame += static_cast<char>(126);
+            frame += static_cast<char>((payload.size() >> 8) & 0xff);
+            frame += static_cast<char>(payload.size() & 0xff);
+        } else {
+            frame += static_cast<char>(127);
+            for (int i = 7; i >= 0; --i) {
+                frame += static_cast<char>((static_cast<uint64_t>(payload.size()) >> (i * 8)) & 0xff);
+            }
+        }
+        frame += payload;
+        return frame;
+    }
+
+    enum class ParseResult { Complete, Incomplete, Error };
+
+    // Decode one client frame from `data`. On Complete, `consumed` bytes make
+    // up the frame and `payload` holds the unmasked payload.
+    inline ParseResult parseFrame(const char* data, size_t len, Opcode& opcode, std::string& payload, size_t& consumed) {
+        if (len < 2) {
+            return ParseResult::Incomplete;
+        }
+        const auto* p = reinterpret_cast<const unsigned char*>(data);
+        opcode = static_cast<Opcode>(p[0] & 0x0f);
+        bool masked = p[1] & 0x80;
+        uint64_t payloadLen = p[1] & 0x7f;
+        size_t pos = 2;
+        if (!masked) {
+            return ParseResult::Error;
+        }
+        if (payloadLen == 126) {
+            if (len < 4) return ParseResult::Incomplete;
+            payloadLen = (uint64_t(p[2]) << 8) | p[3];
+            pos = 4;
+        } else if (payloadLen == 127) {
+            if (len < 10) return ParseResult::Incomplete;
+            payloadLen = 0;
+            for (int i = 0; i < 8; ++i) {
+                payloadLen = (payloadLen << 8) | p[2 + i];
+            }
+            pos = 10;
+        }
+        if (payloadLen > MAX_PAYLOAD_BYTES) {
+            return ParseResult::Error;
+        }
+        if (len < pos + 4 + payloadLen) {
+            return ParseResult::Incomplete;
+        }
+        const unsigned char* mask = p + pos;
+        pos += 4;
+        payload.resize(static_cast<size_t>(payloadLen));
+        for (size_t i = 0; i < payloadLen; ++i) {
+            payload[i] = static_cast<char>(p[pos + i] ^ mask[i & 3]);
+        }
+        consumed = pos + static_cast<size_t>(payloadLen);
+        return ParseResult::Complete;
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <pthread.h>
+
+// Runs tasks that discover more tasks, such as the files of an import
+// graph, on a fixed set of threads. Each worker owns a deque: it pushes the
+// tasks it discovers and pops the newest one, so a worker mostly walks its
+// own part of the graph depth-first with warm caches, and idle workers
+// steal the oldest entries from the others. Deduplicating tasks is up to
+// the caller.
+template <typename Task>
+class WorkStealingPool {
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    // Tasks queued or running; the run is over when it drops to 0
+    std::atomic<size_t> outstanding{0};
+
+    // Newest task of our own deque, else the oldest of someone else's
+    bool take(size_t worker, Task& task) {
+        {
+            Queue& own = *queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i) {
+            Queue& victim = *queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(size_t worker, const std::function<void(size_t, Task&)>& process) {
+        Task task;
+        while (true) {
+            if (take(worker, task)) {
+                process(worker, task);
+                outstanding.fetch_sub(1, std::memory_order_acq_rel);
+            } else if (outstanding.load(std::memory_order_acquire) == 0) {
+                return;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+public:
+    // `threads` = 0 uses one worker per hardware thread
+    explicit WorkStealingPool(size_t threads = 0) {
+        size_t count = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < count; ++i) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t workers() const {
+        return queues.size();
+    }
+
+    // Queue `task` on `worker`'s deque: before run(), or from inside a
+    // task with the worker it was given
+    void push(size_t worker, Task task) {
+        outstanding.fetch_add(1, std::memory_order_relaxed);
+        Queue& queue = *queues[worker % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    // Call `process(worker, task)` for every queued task and every task
+    // those push, until none are left. The calling thread is worker 0.
+    void run(const std::function<void(size_t, Task&)>& process) {
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < queues.size(); ++i) {
+            threads.emplace_back([this, i, &process]() {
+                // Leave SIGINT/SIGTERM to the thread that handles them
+                sigset_t all;
+                sigfillset(&all);
+                pthread_sigmask(SIG_BLOCK, &all, nullptr);
+                work(i, process);
+            });
+        }
+        work(0, process);
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+};
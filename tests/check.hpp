@@ -0,0 +1,31 @@
+#pragma once
+
+#include <iostream>
+
+// Minimal assertions for the test executables: a failed check reports its
+// location and the test exits non-zero at the end
+namespace check {
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+}  // namespace check
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << "\n"; \
+            ++check::failures();                                                               \
+        }                                                                                      \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                              \
+    do {                                                                                        \
+        auto&& actualValue = (actual);                                                          \
+        auto&& expectedValue = (expected);                                                      \
+        if (!(actualValue == expectedValue)) {                                                  \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #actual " is " << actualValue      \
+                      << ", expected " << expectedValue << "\n";                                \
+            ++check::failures();                                                                \
+        }                                                                                       \
+    } while (0)
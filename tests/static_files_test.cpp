@@ -0,0 +1,48 @@
+#include "check.hpp"
+#include "static_files.hpp"
+
+#include <fstream>
+#include <unistd.h>
+
+namespace {
+
+void writeFile(const fs::path& path, const std::string& content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+int status(StaticFiles& files, const std::string& path) {
+    HttpRequest req;
+    req.method = "GET";
+    req.path = path;
+    HttpResponse res;
+    files.serve(req, res);
+    return res.status;
+}
+
+}  // namespace
+
+int main() {
+    fs::path root = fs::temp_directory_path() / ("vite-static-files-" + std::to_string(getpid()));
+    writeFile(root / "index.html", "<html></html>");
+    writeFile(root / ".env", "SECRET=1");
+    writeFile(root / "sub" / ".env.local", "SECRET=1");
+    writeFile(root / ".git" / "config", "[core]");
+    writeFile(root / ".well-known" / "security.txt", "Contact: x");
+    writeFile(root / "node_modules" / ".vite" / "deps" / "dep.js", "export {}");
+    writeFile(root / "node_modules" / ".vite" / "transforms.cache", "");
+
+    StaticFiles files(root, false);
+    CHECK_EQ(status(files, "/index.html"), 200);
+    CHECK_EQ(status(files, "/.env"), 403);
+    CHECK_EQ(status(files, "/sub/.env.local"), 403);
+    CHECK_EQ(status(files, "/.git/config"), 403);
+    CHECK_EQ(status(files, "/sub/../.env"), 403);
+    CHECK_EQ(status(files, "/.well-known/security.txt"), 200);
+    CHECK_EQ(status(files, "/node_modules/.vite/deps/dep.js"), 200);
+    CHECK_EQ(status(files, "/node_modules/.vite/transforms.cache"), 403);
+    CHECK(files.resolve("/.env").empty());
+
+    fs::remove_all(root);
+    return check::failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+#include "check.hpp"
+#include "uring_loop.hpp"
+
+#include <string>
+#include <thread>
+#include <chrono>
+
+#include <malloc.h>
+#include <arpa/inet.h>
+
+// Requests pipelined and frames broadcast while a large response is still
+// being sent must queue behind it, not reallocate the buffer the kernel is
+// reading from
+namespace {
+
+// How many bytes a loopback connection takes in before a reader with a
+// small window holds the writer up
+size_t loopbackBacklog() {
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    listen(listenFd, 1);
+    getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &length);
+    int reader = socket(AF_INET, SOCK_STREAM, 0);
+    int small = 4096;
+    setsockopt(reader, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+    connect(reader, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    int writer = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+    std::string block(64 * 1024, 'x');
+    size_t total = 0;
+    for (ssize_t n; (n = send(writer, block.data(), block.size(), MSG_NOSIGNAL)) > 0;) {
+        total += static_cast<size_t>(n);
+    }
+    close(writer);
+    close(reader);
+    close(listenFd);
+    return total;
+}
+
+// Larger than the connection takes in, so the send of its tail stays in
+// flight, but with less than the output high-water mark left unsent, so
+// pipelined requests are still read and answered meanwhile
+std::string bigBody() {
+    std::string body(loopbackBacklog() + 512 * 1024, '\0');
+    for (size_t i = 0; i < body.size(); ++i) {
+        body[i] = static_cast<char>('a' + (i * 7 + i / 4096) % 26);
+    }
+    return body;
+}
+
+class Client {
+private:
+    int fd;
+    std::string buffer;
+
+    bool fill() {
+        char chunk[64 * 1024];
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) {
+            return false;
+        }
+        buffer.append(chunk, static_cast<size_t>(n));
+        return true;
+    }
+
+public:
+    explicit Client(int port) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        // A small window keeps the server's send in flight while we write
+        int small = 4096;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+        timeval timeout{5, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+
+    ~Client() {
+        close(fd);
+    }
+
+    void write(const std::string& bytes) {
+        ssize_t ignored = send(fd, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+        (void)ignored;
+    }
+
+    bool readHead(std::string& head) {
+        size_t end;
+        while ((end = buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        head = buffer.substr(0, end + 4);
+        buffer.erase(0, end + 4);
+        return true;
+    }
+
+    bool readBytes(size_t n, std::string& out) {
+        while (buffer.size() < n) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        out = buffer.substr(0, n);
+        buffer.erase(0, n);
+        return true;
+    }
+
+    // The body of a response with a Content-Length
+    bool readResponse(std::string& head, std::string& body) {
+        if (!readHead(head)) {
+            return false;
+        }
+        size_t at = head.find("Content-Length: ");
+        if (at == std::string::npos) {
+            return false;
+        }
+        return readBytes(std::stoul(head.substr(at + 16)), body);
+    }
+};
+
+}  // namespace
+
+int main() {
+    // Large buffers get their own mappings and are unmapped when freed, so a
+    // send still reading a reallocated buffer faults instead of finding the
+    // old bytes in place
+    mallopt(M_MMAP_THRESHOLD, 64 * 1024);
+
+    std::string reason;
+    if (!UringLoop::supported(reason)) {
+        std::cout << "skipped: " << reason << "\n";
+        return 77;
+    }
+
+    int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listenFd, 16) != 0 ||
+        getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &length) != 0) {
+        std::cerr << "cannot listen on loopback\n";
+        return 1;
+    }
+    int port = ntohs(addr.sin_port);
+
+    const std::string big = bigBody();
+    UringLoop loop(listenFd, [&big](const HttpRequest& req, HttpResponse& res) {
+        if (req.path == "/ws") {
+            WebSocket::acceptUpgrade(req, res);
+            return;
+        }
+        res.status = 200;
+        res.setHeader("Content-Type", "text/plain");
+        res.body = req.path == "/big" ? big : "small";
+    });
+    std::thread server([&loop]() { loop.run(); });
+
+    {
+        Client client(port);
+        client.write("GET /big HTTP/1.1\r\nHost: test\r\n\r\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        client.write("GET /small HTTP/1.1\r\nHost: test\r\n\r\n"
+                     "GET /small HTTP/1.1\r\nHost: test\r\n\r\n"
+                     "GET /ws HTTP/1.1\r\nHost: test\r\nConnection: Upgrade\r\nUpgrade: websocket\r\n"
+                     "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        loop.broadcast("{\"type\":\"full-reload\"}");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        std::string head, body;
+        CHECK(client.readResponse(head, body));
+        CHECK(head.compare(0, 12, "HTTP/1.1 200") == 0);
+        CHECK(body == big);
+        for (int i = 0; i < 2; ++i) {
+            CHECK(client.readResponse(head, body));
+            CHECK_EQ(body, std::string("small"));
+        }
+        CHECK(client.readHead(head));
+        CHECK(head.compare(0, 12, "HTTP/1.1 101") == 0);
+        std::string frame;
+        CHECK(client.readBytes(WebSocket::encodeFrame("{\"type\":\"full-reload\"}").size(), frame));
+        CHECK(frame == WebSocket::encodeFrame("{\"type\":\"full-reload\"}"));
+    }
+
+    loop.stop();
+    server.join();
+    close(listenFd);
+    return check::failures() == 0 ? 0 : 1;
+}